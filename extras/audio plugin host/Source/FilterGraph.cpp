@@ -75,6 +75,7 @@ FilterGraph::FilterGraph (AudioPluginFormatManager& formatManager_)
 
 FilterGraph::~FilterGraph()
 {
+    loader = nullptr;
     graph.clear();
 }
 
@@ -226,6 +227,10 @@ void FilterGraph::clear()
 {
     PluginWindow::closeAllCurrentlyOpenWindows();
 
+    loader = nullptr;
+    xmlBeingLoaded = nullptr;
+    filtersBeingLoaded.clear();
+
     graph.clear();
     changed();
 }
@@ -315,44 +320,46 @@ static XmlElement* createNodeXml (AudioProcessorGraph::Node* const node) noexcep
     return e;
 }
 
-void FilterGraph::createNodeFromXml (const XmlElement& xml)
+void FilterGraph::pluginInstanceLoaded (PluginInstanceLoader&, int index,
+                                        AudioPluginInstance* instance, const String&)
 {
-    PluginDescription pd;
-
-    forEachXmlChildElement (xml, e)
-    {
-        if (pd.loadFromXml (*e))
-            break;
-    }
-
-    String errorMessage;
-
-    AudioPluginInstance* instance = formatManager.createPluginInstance (pd, errorMessage);
-
     if (instance == nullptr)
     {
         // xxx handle ins + outs
+        return;
     }
 
-    if (instance == nullptr)
-        return;
+    const XmlElement& xml = *filtersBeingLoaded.getUnchecked (index);
 
     AudioProcessorGraph::Node::Ptr node (graph.addNode (instance, xml.getIntAttribute ("uid")));
 
-    const XmlElement* const state = xml.getChildByName ("STATE");
+    node->properties.set ("x", xml.getDoubleAttribute ("x"));
+    node->properties.set ("y", xml.getDoubleAttribute ("y"));
+    node->properties.set ("uiLastX", xml.getIntAttribute ("uiLastX"));
+    node->properties.set ("uiLastY", xml.getIntAttribute ("uiLastY"));
 
-    if (state != nullptr)
+    // Connect up any wires whose ends have both arrived, so that the graph can start
+    // playing the parts of the session that have already loaded.
+    forEachXmlChildElementWithTagName (*xmlBeingLoaded, e, "CONNECTION")
     {
-        MemoryBlock m;
-        m.fromBase64Encoding (state->getAllSubText());
+        const uint32 srcFilter = (uint32) e->getIntAttribute ("srcFilter");
+        const uint32 dstFilter = (uint32) e->getIntAttribute ("dstFilter");
 
-        node->getProcessor()->setStateInformation (m.getData(), (int) m.getSize());
+        if ((srcFilter == node->nodeId && getNodeForId (dstFilter) != nullptr)
+             || (dstFilter == node->nodeId && getNodeForId (srcFilter) != nullptr))
+        {
+            graph.addConnection (srcFilter, e->getIntAttribute ("srcChannel"),
+                                 dstFilter, e->getIntAttribute ("dstChannel"));
+        }
     }
 
-    node->properties.set ("x", xml.getDoubleAttribute ("x"));
-    node->properties.set ("y", xml.getDoubleAttribute ("y"));
-    node->properties.set ("uiLastX", xml.getIntAttribute ("uiLastX"));
-    node->properties.set ("uiLastY", xml.getIntAttribute ("uiLastY"));
+    sendChangeMessage();
+}
+
+void FilterGraph::allPluginInstancesLoaded (PluginInstanceLoader&)
+{
+    graph.removeIllegalConnections();
+    sendChangeMessage();
 }
 
 XmlElement* FilterGraph::createXml() const
@@ -386,19 +393,30 @@ void FilterGraph::restoreFromXml (const XmlElement& xml)
 {
     clear();
 
-    forEachXmlChildElementWithTagName (xml, e, "FILTER")
-    {
-        createNodeFromXml (*e);
-        changed();
-    }
+    // The plugins are created in the background, and get added to the graph by
+    // pluginInstanceLoaded() as each one arrives.
+    xmlBeingLoaded = new XmlElement (xml);
+    loader = new PluginInstanceLoader (formatManager, *this);
 
-    forEachXmlChildElementWithTagName (xml, e, "CONNECTION")
+    forEachXmlChildElementWithTagName (*xmlBeingLoaded, e, "FILTER")
     {
-        addConnection ((uint32) e->getIntAttribute ("srcFilter"),
-                       e->getIntAttribute ("srcChannel"),
-                       (uint32) e->getIntAttribute ("dstFilter"),
-                       e->getIntAttribute ("dstChannel"));
+        PluginDescription pd;
+
+        forEachXmlChildElement (*e, child)
+        {
+            if (pd.loadFromXml (*child))
+                break;
+        }
+
+        MemoryBlock state;
+        const XmlElement* const stateXml = e->getChildByName ("STATE");
+
+        if (stateXml != nullptr)
+            state.fromBase64Encoding (stateXml->getAllSubText());
+
+        loader->addPlugin (pd, state);
+        filtersBeingLoaded.add (e);
     }
 
-    graph.removeIllegalConnections();
+    loader->start();
 }
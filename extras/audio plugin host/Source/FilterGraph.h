@@ -63,7 +63,8 @@ private:
 /**
     A collection of filters and some connections between them.
 */
-class FilterGraph   : public FileBasedDocument
+class FilterGraph   : public FileBasedDocument,
+                     private PluginInstanceLoader::Listener
 {
 public:
     //==============================================================================
@@ -133,7 +134,12 @@ private:
     uint32 lastUID;
     uint32 getNextUID() noexcept;
 
-    void createNodeFromXml (const XmlElement& xml);
+    ScopedPointer<PluginInstanceLoader> loader;
+    ScopedPointer<XmlElement> xmlBeingLoaded;
+    Array<const XmlElement*> filtersBeingLoaded;
+
+    void pluginInstanceLoaded (PluginInstanceLoader&, int index, AudioPluginInstance*, const String&);
+    void allPluginInstancesLoaded (PluginInstanceLoader&);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FilterGraph);
 };
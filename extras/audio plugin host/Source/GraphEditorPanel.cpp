@@ -123,6 +123,23 @@ void PluginWindow::closeButtonPressed()
     delete this;
 }
 
+//==============================================================================
+static const String timeToString (const double microseconds)
+{
+    return String (microseconds / 1000.0, 3) + " ms";
+}
+
+static const String describeTimes (AudioProcessorGraph::TimingHistory& history)
+{
+    const AudioProcessorGraph::TimingHistory::Summary s (history.getSummary());
+
+    return "min " + timeToString (s.minimum)
+            + ", avg " + timeToString (s.average)
+            + ", 95% " + timeToString (s.percentile95)
+            + ", 99% " + timeToString (s.percentile99)
+            + ", max " + timeToString (s.maximum);
+}
+
 //==============================================================================
 class PinComponent   : public Component,
                        public SettableTooltipClient
@@ -209,7 +226,9 @@ private:
 };
 
 //==============================================================================
-class FilterComponent    : public Component
+class FilterComponent    : public Component,
+                           public SettableTooltipClient,
+                           private Timer
 {
 public:
     FilterComponent (FilterGraph& graph_,
@@ -227,6 +246,7 @@ public:
         setComponentEffect (&shadow);
 
         setSize (150, 60);
+        startTimer (500);
     }
 
     ~FilterComponent()
@@ -334,12 +354,49 @@ public:
 
         g.setColour (Colours::black);
         g.setFont (font);
-        g.drawFittedText (getName(), getLocalBounds().reduced (4, 2), Justification::centred, 2);
+        g.drawFittedText (getName(), x, y, w, h - timeTextHeight, Justification::centred, 2);
+
+        g.setColour (Colours::darkgrey);
+        g.setFont (timeTextHeight - 1.0f);
+        g.drawFittedText (timeText, x, y + h - timeTextHeight - 1, w, timeTextHeight, Justification::centred, 1);
 
         g.setColour (Colours::grey);
         g.drawRect (x, y, w, h);
     }
 
+    void timerCallback()
+    {
+        const AudioProcessorGraph::Node::Ptr f (graph.getNodeForId (filterID));
+
+        if (f == nullptr)
+            return;
+
+        AudioProcessor* const processor = f->getProcessor();
+        const AudioProcessorGraph::TimingHistory::Summary s (f->getProcessingTimes().getSummary());
+
+        String newText;
+
+        if (s.numBlocks > 0)
+        {
+            newText = "avg " + timeToString (s.average) + ", max " + timeToString (s.maximum);
+
+            if (processor->getSampleRate() > 0)
+            {
+                // show how much of each block's deadline the filter is using..
+                const double blockMicroseconds = processor->getBlockSize() * 1000000.0 / processor->getSampleRate();
+                newText << " (" << roundToInt (100.0 * s.average / blockMicroseconds) << "%)";
+            }
+
+            setTooltip (getName() + ": " + describeTimes (f->getProcessingTimes()));
+        }
+
+        if (newText != timeText)
+        {
+            timeText = newText;
+            repaint();
+        }
+    }
+
     void resized()
     {
         for (int i = 0; i < getNumChildComponents(); ++i)
@@ -392,12 +449,13 @@ public:
             ++numOuts;
 
         int w = 100;
-        int h = 60;
+        int h = 60 + timeTextHeight;
 
         w = jmax (w, (jmax (numIns, numOuts) + 1) * 20);
 
         const int textWidth = font.getStringWidth (f->getProcessor()->getName());
         w = jmax (w, 16 + jmin (textWidth, 300));
+        w = jmax (w, 150);
         if (textWidth > 300)
             h = 100;
 
@@ -445,6 +503,9 @@ private:
     Font font;
     int numIns, numOuts;
     DropShadowEffect shadow;
+    String timeText;
+
+    enum { timeTextHeight = 12 };
 
     GraphEditorPanel* getGraphPanel() const noexcept
     {
@@ -976,7 +1037,8 @@ class TooltipBar   : public Component,
                      private Timer
 {
 public:
-    TooltipBar()
+    TooltipBar (AudioProcessorGraph& graph_)
+        : graph (graph_)
     {
         startTimer (100);
     }
@@ -998,6 +1060,11 @@ public:
         if (ttc != nullptr && ! (underMouse->isMouseButtonDown() || underMouse->isCurrentlyBlockedByAnotherModalComponent()))
             newTip = ttc->getTooltip();
 
+        // when there's no tooltip to show, show how long the whole graph is taking..
+        if (newTip.isEmpty() && graph.getTotalProcessingTimes().getSummary().numBlocks > 0)
+            newTip = "Graph: " + describeTimes (graph.getTotalProcessingTimes())
+                       + "  (buffer overhead: avg " + timeToString (graph.getOverheadProcessingTimes().getSummary().average) + ")";
+
         if (newTip != tip)
         {
             tip = newTip;
@@ -1006,6 +1073,7 @@ public:
     }
 
 private:
+    AudioProcessorGraph& graph;
     String tip;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TooltipBar);
@@ -1025,7 +1093,7 @@ GraphDocumentComponent::GraphDocumentComponent (AudioPluginFormatManager& format
     addAndMakeVisible (keyboardComp = new MidiKeyboardComponent (keyState,
                                                                  MidiKeyboardComponent::horizontalKeyboard));
 
-    addAndMakeVisible (statusBar = new TooltipBar());
+    addAndMakeVisible (statusBar = new TooltipBar (graph.getGraph()));
 
     deviceManager->addAudioCallback (&graphPlayer);
     deviceManager->addMidiInputCallback (String::empty, &graphPlayer.getMidiMessageCollector());
@@ -47,6 +47,18 @@ public:
 
     void initialise (const String& commandLine)
     {
+        // if we've been launched as a plugin-scanning worker, just do the scan and quit..
+        {
+            AudioPluginFormatManager scanFormatManager;
+            scanFormatManager.addDefaultFormats();
+
+            if (PluginDirectoryScanner::performWorkerScan (scanFormatManager, getCommandLineParameterArray()))
+            {
+                quit();
+                return;
+            }
+        }
+
         // initialise our settings file..
 
         PropertiesFile::Options options;
@@ -80,7 +92,9 @@ public:
     void shutdown()
     {
         mainWindow = 0;
-        appProperties->closeFiles();
+
+        if (appProperties != nullptr)
+            appProperties->closeFiles();
 
         deleteAndZero (commandManager);
         deleteAndZero (appProperties);
@@ -40,10 +40,17 @@ public:
         const File deadMansPedalFile (appProperties->getUserSettings()
                                         ->getFile().getSiblingFile ("RecentlyCrashedPluginsList"));
 
-        setContentOwned (new PluginListComponent (formatManager,
-                                                  owner.knownPluginList,
-                                                  deadMansPedalFile,
-                                                  appProperties->getUserSettings()), true);
+        PluginListComponent* const pluginList
+            = new PluginListComponent (formatManager,
+                                       owner.knownPluginList,
+                                       deadMansPedalFile,
+                                       appProperties->getUserSettings());
+
+        // scan in copies of this app, so that a crashing plugin can't take the host with it
+        pluginList->setScanWorkerCommand (StringArray (File::getSpecialLocation (File::currentExecutableFile)
+                                                         .getFullPathName()));
+
+        setContentOwned (pluginList, true);
 
         setResizable (true, false);
         setResizeLimits (300, 400, 800, 1500);
@@ -97,10 +104,16 @@ MainHostWindow::MainHostWindow()
     InternalPluginFormat internalFormat;
     internalFormat.getAllTypes (internalTypes);
 
-    ScopedPointer<XmlElement> savedPluginList (appProperties->getUserSettings()->getXmlValue ("pluginList"));
+    ScopedPointer<FileInputStream> pluginListCache (getPluginListCacheFile().createInputStream());
+
+    if (pluginListCache == nullptr || ! knownPluginList.readFromStream (*pluginListCache))
+    {
+        // no cache yet, so try the XML list that older versions used to save..
+        ScopedPointer<XmlElement> savedPluginList (appProperties->getUserSettings()->getXmlValue ("pluginList"));
 
-    if (savedPluginList != nullptr)
-        knownPluginList.recreateFromXml (*savedPluginList);
+        if (savedPluginList != nullptr)
+            knownPluginList.recreateFromXml (*savedPluginList);
+    }
 
     pluginSortMethod = (KnownPluginList::SortMethod) appProperties->getUserSettings()
                             ->getIntValue ("pluginSortMethod", KnownPluginList::sortByManufacturer);
@@ -159,13 +172,23 @@ void MainHostWindow::changeListenerCallback (ChangeBroadcaster*)
 
     // save the plugin list every time it gets chnaged, so that if we're scanning
     // and it crashes, we've still saved the previous ones
-    ScopedPointer<XmlElement> savedPluginList (knownPluginList.createXml());
+    TemporaryFile temp (getPluginListCacheFile());
 
-    if (savedPluginList != nullptr)
     {
-        appProperties->getUserSettings()->setValue ("pluginList", savedPluginList);
-        appProperties->saveIfNeeded();
+        FileOutputStream out (temp.getFile());
+
+        if (out.failedToOpen())
+            return;
+
+        knownPluginList.writeToStream (out);
     }
+
+    temp.overwriteTargetFileWithTemporary();
+}
+
+File MainHostWindow::getPluginListCacheFile()
+{
+    return appProperties->getUserSettings()->getFile().getSiblingFile ("PluginListCache");
 }
 
 StringArray MainHostWindow::getMenuBarNames()
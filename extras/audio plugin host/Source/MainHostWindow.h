@@ -98,6 +98,7 @@ private:
     ScopedPointer <PluginListWindow> pluginListWindow;
 
     void showAudioSettings();
+    static File getPluginListCacheFile();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainHostWindow);
 };
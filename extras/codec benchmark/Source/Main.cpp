@@ -0,0 +1,470 @@
+/*
+  ==============================================================================
+
+   A command-line tool that measures the speed of the audio formats and sample
+   converters in juce_audio_formats and juce_audio_basics, so that changes to
+   their inner loops can be checked for regressions.
+
+   It prints a table of the results, and can also write them as JSON so that
+   they can be compared between versions.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+//==============================================================================
+struct BenchmarkOptions
+{
+    BenchmarkOptions()
+        : sampleRate (44100.0), numSeconds (20.0), numRepeats (3), numSeeks (200)
+    {
+    }
+
+    double sampleRate, numSeconds;
+    int numRepeats, numSeeks;
+    File jsonFile, mp3File;
+};
+
+static double getSecondsNow()
+{
+    return Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+//==============================================================================
+// Creates some material that looks roughly like music to the codecs - a few
+// decaying chords, plus a little noise so that nothing compresses too easily.
+static void createTestSignal (AudioSampleBuffer& buffer, const double sampleRate)
+{
+    Random random (0x1234);
+    const double chordLength = sampleRate * 0.5;
+    const double frequencies[] = { 110.0, 138.6, 164.8, 220.0, 329.6, 440.0, 554.4, 880.0 };
+
+    for (int chan = 0; chan < buffer.getNumChannels(); ++chan)
+    {
+        float* const data = buffer.getSampleData (chan);
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            const int chord = (int) (i / chordLength);
+            const double t = i / sampleRate;
+            const double envelope = std::exp (-3.0 * (i - chord * chordLength) / chordLength);
+            double value = 0;
+
+            for (int j = 0; j < 3; ++j)
+            {
+                const double freq = frequencies [(chord + j * 2 + chan) % numElementsInArray (frequencies)];
+                value += std::sin (2.0 * double_Pi * freq * t) * 0.2;
+            }
+
+            data[i] = (float) (value * envelope + (random.nextFloat() - 0.5f) * 0.01f);
+        }
+    }
+}
+
+//==============================================================================
+// Records the fastest of several runs of a test.
+class BenchmarkResult
+{
+public:
+    BenchmarkResult (const String& group_, const String& name_, const int numChannels_)
+        : group (group_), name (name_), numChannels (numChannels_),
+          bestTime (std::numeric_limits<double>::max()),
+          bytesProcessed (0), audioSeconds (0), numOperations (0)
+    {
+    }
+
+    void addRun (const double seconds)                  { bestTime = jmin (bestTime, jmax (seconds, 1.0e-9)); }
+
+    double getMegabytesPerSecond() const                { return bytesProcessed / (1024.0 * 1024.0 * bestTime); }
+    double getRealtimeFactor() const                    { return audioSeconds / bestTime; }
+
+    var toVar() const
+    {
+        DynamicObject* const d = new DynamicObject();
+        d->setProperty ("group", group);
+        d->setProperty ("test", name);
+        d->setProperty ("channels", numChannels);
+        d->setProperty ("seconds", bestTime);
+        d->setProperty ("MBPerSecond", getMegabytesPerSecond());
+
+        if (audioSeconds > 0)
+            d->setProperty ("realtimeFactor", getRealtimeFactor());
+
+        if (numOperations > 0)
+            d->setProperty ("operationsPerSecond", numOperations / bestTime);
+
+        return var (d);
+    }
+
+    void print() const
+    {
+        String line (group.paddedRight (' ', 18) + name.paddedRight (' ', 32)
+                       + String (numChannels).paddedLeft (' ', 3) + " ch "
+                       + String (getMegabytesPerSecond(), 1).paddedLeft (' ', 10) + " MB/s");
+
+        if (audioSeconds > 0)
+            line << String (getRealtimeFactor(), 1).paddedLeft (' ', 11) << " x realtime";
+
+        if (numOperations > 0)
+            line << String (roundToInt (numOperations / bestTime)).paddedLeft (' ', 10) << " ops/s";
+
+        std::cout << line << std::endl;
+    }
+
+    String group, name;
+    int numChannels;
+    double bestTime, bytesProcessed, audioSeconds;
+    int numOperations;
+};
+
+//==============================================================================
+class CodecBenchmark
+{
+public:
+    CodecBenchmark (const BenchmarkOptions& options_)
+        : options (options_)
+    {
+        formatManager.registerBasicFormats();
+    }
+
+    void runAll()
+    {
+        for (int numChannels = 1; numChannels <= 2; ++numChannels)
+        {
+            AudioSampleBuffer signal (numChannels, (int) (options.sampleRate * options.numSeconds));
+            createTestSignal (signal, options.sampleRate);
+
+            for (int i = 0; i < formatManager.getNumKnownFormats(); ++i)
+                benchmarkFormat (*formatManager.getKnownFormat (i), signal);
+        }
+
+        if (options.mp3File.existsAsFile())
+            benchmarkMP3File();
+
+        const int channelCounts[] = { 1, 2, 8 };
+
+        for (int i = 0; i < numElementsInArray (channelCounts); ++i)
+            benchmarkConverters (channelCounts[i]);
+    }
+
+    var getResultsAsVar() const
+    {
+        DynamicObject* const d = new DynamicObject();
+        d->setProperty ("benchmark", "codec benchmark");
+        d->setProperty ("juceVersion", SystemStats::getJUCEVersion());
+        d->setProperty ("operatingSystem", SystemStats::getOperatingSystemName());
+        d->setProperty ("cpuVendor", SystemStats::getCpuVendor());
+        d->setProperty ("cpuSpeedMHz", SystemStats::getCpuSpeedInMegaherz());
+        d->setProperty ("time", Time::getCurrentTime().formatted ("%Y-%m-%d %H:%M:%S"));
+        d->setProperty ("sampleRate", options.sampleRate);
+        d->setProperty ("lengthSeconds", options.numSeconds);
+        d->setProperty ("repeats", options.numRepeats);
+
+        Array<var> resultList;
+        for (int i = 0; i < results.size(); ++i)
+            resultList.add (results.getUnchecked (i)->toVar());
+
+        d->setProperty ("results", resultList);
+        d->setProperty ("skipped", skipped);
+        return var (d);
+    }
+
+private:
+    //==============================================================================
+    const BenchmarkOptions& options;
+    AudioFormatManager formatManager;
+    OwnedArray<BenchmarkResult> results;
+    Array<var> skipped;
+
+    BenchmarkResult& addResult (const String& group, const String& name, const int numChannels)
+    {
+        BenchmarkResult* const r = new BenchmarkResult (group, name, numChannels);
+        results.add (r);
+        return *r;
+    }
+
+    void skip (const String& group, const String& reason)
+    {
+        DynamicObject* const d = new DynamicObject();
+        d->setProperty ("group", group);
+        d->setProperty ("reason", reason);
+        skipped.add (var (d));
+
+        std::cout << group.paddedRight (' ', 18) << "(skipped: " << reason << ")" << std::endl;
+    }
+
+    //==============================================================================
+    void benchmarkFormat (AudioFormat& format, const AudioSampleBuffer& signal)
+    {
+        const Array<int> bitDepths (format.getPossibleBitDepths());
+        const int numChannels = signal.getNumChannels();
+
+        if (bitDepths.size() == 0 || (numChannels == 1 ? ! format.canDoMono() : ! format.canDoStereo()))
+        {
+            if (numChannels == 1)
+                skip (format.getFormatName(), "can't write this format");
+
+            return;
+        }
+
+        const StringArray qualities (format.getQualityOptions());
+
+        for (int i = 0; i < bitDepths.size(); ++i)
+        {
+            // for compressed formats, the bit depth matters less than the quality setting
+            if (format.isCompressed() && i < bitDepths.size() - 1)
+                continue;
+
+            const String testName (format.isCompressed() && qualities.size() > 0
+                                     ? "quality " + qualities [qualities.size() / 2]
+                                     : String (bitDepths[i]) + " bit");
+
+            MemoryBlock encoded;
+
+            if (benchmarkWriting (format, signal, bitDepths[i], qualities.size() / 2, testName, encoded))
+            {
+                benchmarkReading (format, encoded, signal.getNumChannels(), testName);
+                benchmarkSeeking (format, encoded, signal.getNumChannels(), testName);
+            }
+        }
+    }
+
+    bool benchmarkWriting (AudioFormat& format, const AudioSampleBuffer& signal, const int bitDepth,
+                           const int qualityIndex, const String& testName, MemoryBlock& encoded)
+    {
+        BenchmarkResult& r = addResult (format.getFormatName(), "write " + testName, signal.getNumChannels());
+
+        for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+        {
+            encoded.setSize (0);
+            const double startTime = getSecondsNow();
+
+            {
+                ScopedPointer<AudioFormatWriter> writer (format.createWriterFor (new MemoryOutputStream (encoded, false),
+                                                                                 options.sampleRate,
+                                                                                 (unsigned int) signal.getNumChannels(),
+                                                                                 bitDepth, StringPairArray(), qualityIndex));
+                if (writer == nullptr)
+                {
+                    results.removeObject (&r);
+                    skip (format.getFormatName(), "couldn't create a writer for " + testName);
+                    return false;
+                }
+
+                for (int pos = 0; pos < signal.getNumSamples(); pos += 4096)
+                    writer->writeFromAudioSampleBuffer (signal, pos, jmin (4096, signal.getNumSamples() - pos));
+            }
+
+            r.addRun (getSecondsNow() - startTime);
+        }
+
+        r.bytesProcessed = signal.getNumSamples() * signal.getNumChannels() * (double) sizeof (float);
+        r.audioSeconds = signal.getNumSamples() / options.sampleRate;
+        r.print();
+        return true;
+    }
+
+    void benchmarkReading (AudioFormat& format, const MemoryBlock& encoded,
+                           const int numChannels, const String& testName)
+    {
+        BenchmarkResult& r = addResult (format.getFormatName(), "read " + testName, numChannels);
+        int64 length = 0;
+
+        for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+        {
+            const double startTime = getSecondsNow();
+            ScopedPointer<AudioFormatReader> reader (format.createReaderFor (new MemoryInputStream (encoded, false), true));
+
+            if (reader == nullptr)
+                return;
+
+            AudioSampleBuffer buffer ((int) reader->numChannels, 4096);
+            length = reader->lengthInSamples;
+
+            for (int64 pos = 0; pos < length; pos += 4096)
+                reader->read (&buffer, 0, (int) jmin ((int64) 4096, length - pos), pos, true, true);
+
+            r.addRun (getSecondsNow() - startTime);
+        }
+
+        r.bytesProcessed = length * numChannels * (double) sizeof (float);
+        r.audioSeconds = length / options.sampleRate;
+        r.print();
+    }
+
+    void benchmarkSeeking (AudioFormat& format, const MemoryBlock& encoded,
+                           const int numChannels, const String& testName)
+    {
+        const int samplesPerSeek = 1024;
+        BenchmarkResult& r = addResult (format.getFormatName(), "seek " + testName, numChannels);
+
+        for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+        {
+            ScopedPointer<AudioFormatReader> reader (format.createReaderFor (new MemoryInputStream (encoded, false), true));
+
+            if (reader == nullptr || reader->lengthInSamples <= samplesPerSeek)
+                return;
+
+            AudioSampleBuffer buffer ((int) reader->numChannels, samplesPerSeek);
+            Random random (0x4321);
+            const double startTime = getSecondsNow();
+
+            for (int i = 0; i < options.numSeeks; ++i)
+            {
+                const int64 pos = (int64) (random.nextDouble() * (reader->lengthInSamples - samplesPerSeek));
+                reader->read (&buffer, 0, samplesPerSeek, pos, true, true);
+            }
+
+            r.addRun (getSecondsNow() - startTime);
+        }
+
+        r.bytesProcessed = options.numSeeks * samplesPerSeek * numChannels * (double) sizeof (float);
+        r.numOperations = options.numSeeks;
+        r.print();
+    }
+
+    void benchmarkMP3File()
+    {
+        MemoryBlock encoded;
+        options.mp3File.loadFileAsData (encoded);
+
+        for (int i = 0; i < formatManager.getNumKnownFormats(); ++i)
+        {
+            AudioFormat& format = *formatManager.getKnownFormat (i);
+
+            if (format.canHandleFile (options.mp3File))
+            {
+                ScopedPointer<AudioFormatReader> reader (format.createReaderFor (new MemoryInputStream (encoded, false), true));
+
+                if (reader != nullptr)
+                {
+                    const String testName (options.mp3File.getFileName());
+                    benchmarkReading (format, encoded, (int) reader->numChannels, testName);
+                    benchmarkSeeking (format, encoded, (int) reader->numChannels, testName);
+                    return;
+                }
+            }
+        }
+
+        skip (options.mp3File.getFileName(), "no format could read this file");
+    }
+
+    //==============================================================================
+    template <class SourceType, class DestType>
+    void benchmarkConverter (const String& testName, const int numChannels,
+                             const bool sourceIsInterleaved, const int bytesPerPackedSample)
+    {
+        const int numSamples = 65536;
+        const int numPasses = 64;
+
+        // The packed data is interleaved, and the float data is in separate channels
+        HeapBlock<char> packed ((size_t) (numSamples * numChannels * bytesPerPackedSample), true);
+        AudioSampleBuffer floats (numChannels, numSamples);
+        createTestSignal (floats, options.sampleRate);
+
+        const AudioData::ConverterInstance<SourceType, DestType> converter (sourceIsInterleaved ? numChannels : 1,
+                                                                           sourceIsInterleaved ? 1 : numChannels);
+        BenchmarkResult& r = addResult ("AudioData", testName, numChannels);
+
+        for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+        {
+            const double startTime = getSecondsNow();
+
+            for (int pass = 0; pass < numPasses; ++pass)
+            {
+                for (int chan = 0; chan < numChannels; ++chan)
+                {
+                    if (sourceIsInterleaved)
+                        converter.convertSamples (floats.getSampleData (chan), 0, packed, chan, numSamples);
+                    else
+                        converter.convertSamples (packed, chan, floats.getSampleData (chan), 0, numSamples);
+                }
+            }
+
+            r.addRun (getSecondsNow() - startTime);
+        }
+
+        r.bytesProcessed = numPasses * (double) numSamples * numChannels * sizeof (float);
+        r.audioSeconds = numPasses * numSamples / options.sampleRate;
+        r.print();
+    }
+
+    template <class SampleFormat, class Endianness>
+    void benchmarkConverterPair (const String& formatName, const int numChannels, const int bytesPerSample)
+    {
+        typedef AudioData::Pointer <SampleFormat, Endianness, AudioData::Interleaved, AudioData::Const>               PackedSource;
+        typedef AudioData::Pointer <SampleFormat, Endianness, AudioData::Interleaved, AudioData::NonConst>            PackedDest;
+        typedef AudioData::Pointer <AudioData::Float32, AudioData::NativeEndian, AudioData::NonInterleaved, AudioData::Const>    FloatSource;
+        typedef AudioData::Pointer <AudioData::Float32, AudioData::NativeEndian, AudioData::NonInterleaved, AudioData::NonConst> FloatDest;
+
+        benchmarkConverter <PackedSource, FloatDest> (formatName + " to float", numChannels, true, bytesPerSample);
+        benchmarkConverter <FloatSource, PackedDest> ("float to " + formatName, numChannels, false, bytesPerSample);
+    }
+
+    void benchmarkConverters (const int numChannels)
+    {
+        benchmarkConverterPair <AudioData::Int16,   AudioData::LittleEndian> ("int16 LE",   numChannels, 2);
+        benchmarkConverterPair <AudioData::Int16,   AudioData::BigEndian>    ("int16 BE",   numChannels, 2);
+        benchmarkConverterPair <AudioData::Int24,   AudioData::LittleEndian> ("int24 LE",   numChannels, 3);
+        benchmarkConverterPair <AudioData::Int24,   AudioData::BigEndian>    ("int24 BE",   numChannels, 3);
+        benchmarkConverterPair <AudioData::Int32,   AudioData::LittleEndian> ("int32 LE",   numChannels, 4);
+        benchmarkConverterPair <AudioData::Float32, AudioData::LittleEndian> ("float32 LE", numChannels, 4);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (CodecBenchmark);
+};
+
+//==============================================================================
+static void printUsage()
+{
+    std::cout << " Usage: CodecBenchmark [options]\n\n"
+                 "  --json <file>      writes the results to a JSON file\n"
+                 "  --seconds <n>      the length of test signal to encode (default 20)\n"
+                 "  --repeats <n>      the number of times to run each test - the fastest run is used (default 3)\n"
+                 "  --seeks <n>        the number of random seeks in each seek test (default 200)\n"
+                 "  --mp3 <file>       an mp3 file to use for the mp3 decoding tests\n\n";
+}
+
+int main (int argc, char* argv[])
+{
+    std::cout << "\n Codec Benchmark - measures the speed of the juce_audio_formats codecs\n\n";
+
+    BenchmarkOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const String arg (argv[i]);
+        const String value (i < argc - 1 ? String (argv [i + 1]).unquoted() : String::empty);
+
+        if (arg == "--json")            options.jsonFile = File::getCurrentWorkingDirectory().getChildFile (value);
+        else if (arg == "--mp3")        options.mp3File  = File::getCurrentWorkingDirectory().getChildFile (value);
+        else if (arg == "--seconds")    options.numSeconds = jmax (1.0, value.getDoubleValue());
+        else if (arg == "--repeats")    options.numRepeats = jmax (1, value.getIntValue());
+        else if (arg == "--seeks")      options.numSeeks = jmax (1, value.getIntValue());
+        else                            { printUsage(); return 1; }
+
+        ++i;
+    }
+
+    CodecBenchmark benchmark (options);
+    benchmark.runAll();
+
+    if (options.jsonFile != File::nonexistent)
+    {
+        options.jsonFile.deleteFile();
+        FileOutputStream out (options.jsonFile);
+
+        if (out.failedToOpen())
+        {
+            std::cout << "\nCouldn't write to " << options.jsonFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        JSON::writeToStream (out, benchmark.getResultsAsVar());
+        std::cout << "\nWrote results to " << options.jsonFile.getFullPathName() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,545 @@
+/*
+  ==============================================================================
+
+   A command-line tool that tests PluginBridge, by launching a copy of itself as
+   the bridge server, and hosting a simple gain plugin inside it.
+
+   It checks that the audio, MIDI, parameters and state all make the round trip
+   correctly, that a plugin which crashes just leaves the host with silence, and
+   measures how long a processBlock() call takes through the bridge, compared
+   with calling the same plugin directly.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+//==============================================================================
+struct TestOptions
+{
+    TestOptions()
+        : sampleRate (44100.0), blockSize (256), numBlocks (2000), numRepeats (5)
+    {
+    }
+
+    double sampleRate;
+    int blockSize, numBlocks, numRepeats;
+    File jsonFile;
+};
+
+static double getSecondsNow()
+{
+    return Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+//==============================================================================
+// A stereo plugin with a single gain parameter, which passes its MIDI straight through.
+// The "crash" version brings down its process as soon as it's asked for any audio.
+class GainPlugin  : public AudioPluginInstance
+{
+public:
+    GainPlugin (const bool shouldCrash_)
+        : gain (0.5f), shouldCrash (shouldCrash_)
+    {
+        setPlayConfigDetails (2, 2, 44100.0, 512);
+    }
+
+    static PluginDescription createDescription (const bool shouldCrash)
+    {
+        PluginDescription desc;
+        desc.name = shouldCrash ? "Crashing gain" : "Gain";
+        desc.descriptiveName = desc.name;
+        desc.pluginFormatName = "Test";
+        desc.category = "Effect";
+        desc.manufacturerName = "Raw Material Software Ltd.";
+        desc.version = ProjectInfo::versionString;
+        desc.fileOrIdentifier = shouldCrash ? "crash" : "gain";
+        desc.uid = shouldCrash ? 2 : 1;
+        desc.isInstrument = false;
+        desc.numInputChannels = 2;
+        desc.numOutputChannels = 2;
+        return desc;
+    }
+
+    void fillInPluginDescription (PluginDescription& desc) const    { desc = createDescription (shouldCrash); }
+
+    const String getName() const                                { return createDescription (shouldCrash).name; }
+
+    void prepareToPlay (double, int)                            {}
+    void releaseResources()                                     {}
+
+    void processBlock (AudioSampleBuffer& buffer, MidiBuffer&)
+    {
+        if (shouldCrash)
+            abort();
+
+        buffer.applyGain (0, buffer.getNumSamples(), gain);
+    }
+
+    const String getInputChannelName (int channelIndex) const   { return String (channelIndex + 1); }
+    const String getOutputChannelName (int channelIndex) const  { return String (channelIndex + 1); }
+    bool isInputChannelStereoPair (int) const                   { return true; }
+    bool isOutputChannelStereoPair (int) const                  { return true; }
+    bool acceptsMidi() const                                    { return true; }
+    bool producesMidi() const                                   { return true; }
+
+    AudioProcessorEditor* createEditor()                        { return nullptr; }
+    bool hasEditor() const                                      { return false; }
+
+    int getNumParameters()                                      { return 1; }
+    const String getParameterName (int)                         { return "Gain"; }
+    float getParameter (int)                                    { return gain; }
+    const String getParameterText (int)                         { return String (gain, 2); }
+    void setParameter (int, float newValue)                     { gain = newValue; }
+
+    int getNumPrograms()                                        { return 0; }
+    int getCurrentProgram()                                     { return 0; }
+    void setCurrentProgram (int)                                {}
+    const String getProgramName (int)                           { return String::empty; }
+    void changeProgramName (int, const String&)                 {}
+
+    void getStateInformation (juce::MemoryBlock& destData)
+    {
+        // (this is deliberately slow, to check that it doesn't hold up the audio)
+        Thread::sleep (stateDelayMs);
+
+        MemoryOutputStream out (destData, false);
+        out.writeFloat (gain);
+    }
+
+    void setStateInformation (const void* data, int sizeInBytes)
+    {
+        MemoryInputStream in (data, (size_t) sizeInBytes, false);
+        gain = in.readFloat();
+    }
+
+    enum { stateDelayMs = 250 };
+
+private:
+    float gain;
+    const bool shouldCrash;
+
+    JUCE_DECLARE_NON_COPYABLE (GainPlugin);
+};
+
+//==============================================================================
+// A format that can only create the plugin above, so that the test doesn't
+// depend on any real plugins being installed.
+class TestPluginFormat  : public AudioPluginFormat
+{
+public:
+    TestPluginFormat() {}
+
+    String getName() const                                      { return "Test"; }
+
+    void findAllTypesForFile (OwnedArray <PluginDescription>& results, const String& fileOrIdentifier)
+    {
+        if (fileMightContainThisPluginType (fileOrIdentifier))
+            results.add (new PluginDescription (GainPlugin::createDescription (fileOrIdentifier == "crash")));
+    }
+
+    AudioPluginInstance* createInstanceFromDescription (const PluginDescription& desc)
+    {
+        if (desc.pluginFormatName == getName() && fileMightContainThisPluginType (desc.fileOrIdentifier))
+            return new GainPlugin (desc.fileOrIdentifier == "crash");
+
+        return nullptr;
+    }
+
+    bool fileMightContainThisPluginType (const String& fileOrIdentifier)    { return fileOrIdentifier == "gain" || fileOrIdentifier == "crash"; }
+    String getNameOfPluginFromIdentifier (const String& fileOrIdentifier)   { return fileOrIdentifier; }
+    bool doesPluginStillExist (const PluginDescription& desc)               { return fileMightContainThisPluginType (desc.fileOrIdentifier); }
+    bool canScanForPlugins() const                                          { return false; }
+    StringArray searchPathsForPlugins (const FileSearchPath&, bool)         { return StringArray(); }
+    FileSearchPath getDefaultLocationsToSearch()                            { return FileSearchPath(); }
+
+private:
+    JUCE_DECLARE_NON_COPYABLE (TestPluginFormat);
+};
+
+//==============================================================================
+class PluginBridgeTest
+{
+public:
+    PluginBridgeTest (const TestOptions& options_)
+        : options (options_), numFailures (0),
+          bridgedMicrosecondsPerBlock (0), directMicrosecondsPerBlock (0)
+    {
+    }
+
+    void runAll()
+    {
+        ScopedPointer <AudioPluginInstance> plugin (createBridgedPlugin (false));
+
+        if (plugin == nullptr)
+            return;
+
+        testDescription (*plugin);
+        testAudio (*plugin, 0.5f);
+        testParameters (*plugin);
+        testAudio (*plugin, 0.25f);
+        testMidi (*plugin);
+        testState (*plugin);
+        testProcessingWhileBusy (*plugin);
+
+        measureRoundTrip (*plugin);
+        plugin = nullptr;
+
+        testCrash();
+    }
+
+    int getNumFailures() const noexcept         { return numFailures; }
+
+    var getResultsAsVar() const
+    {
+        DynamicObject* const d = new DynamicObject();
+        d->setProperty ("benchmark", "plugin bridge test");
+        d->setProperty ("juceVersion", SystemStats::getJUCEVersion());
+        d->setProperty ("operatingSystem", SystemStats::getOperatingSystemName());
+        d->setProperty ("cpuVendor", SystemStats::getCpuVendor());
+        d->setProperty ("numCpus", SystemStats::getNumCpus());
+        d->setProperty ("time", Time::getCurrentTime().formatted ("%Y-%m-%d %H:%M:%S"));
+        d->setProperty ("sampleRate", options.sampleRate);
+        d->setProperty ("blockSize", options.blockSize);
+        d->setProperty ("failures", numFailures);
+        d->setProperty ("bridgedMicrosecondsPerBlock", bridgedMicrosecondsPerBlock);
+        d->setProperty ("directMicrosecondsPerBlock", directMicrosecondsPerBlock);
+        return var (d);
+    }
+
+private:
+    //==============================================================================
+    const TestOptions& options;
+    int numFailures;
+    double bridgedMicrosecondsPerBlock, directMicrosecondsPerBlock;
+
+    void expect (const bool result, const String& failureMessage)
+    {
+        if (! result)
+        {
+            std::cout << "   *** FAILED: " << failureMessage << std::endl;
+            ++numFailures;
+        }
+    }
+
+    AudioPluginInstance* createBridgedPlugin (const bool shouldCrash)
+    {
+        const StringArray serverCommand (File::getSpecialLocation (File::currentExecutableFile).getFullPathName());
+        String errorMessage;
+
+        AudioPluginInstance* const plugin
+            = PluginBridge::createBridgedInstance (GainPlugin::createDescription (shouldCrash), serverCommand, errorMessage);
+
+        expect (plugin != nullptr, "couldn't launch the server: " + errorMessage);
+
+        if (plugin != nullptr)
+            plugin->prepareToPlay (options.sampleRate, options.blockSize);
+
+        return plugin;
+    }
+
+    static void fillWithNoise (AudioSampleBuffer& buffer, Random& random)
+    {
+        for (int chan = 0; chan < buffer.getNumChannels(); ++chan)
+        {
+            float* const data = buffer.getSampleData (chan);
+
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                data[i] = random.nextFloat() * 2.0f - 1.0f;
+        }
+    }
+
+    //==============================================================================
+    void testDescription (AudioPluginInstance& plugin)
+    {
+        std::cout << " Checking the plugin's description" << std::endl;
+
+        PluginDescription desc;
+        plugin.fillInPluginDescription (desc);
+
+        expect (plugin.getName() == "Gain", "wrong name: " + plugin.getName());
+        expect (desc.fileOrIdentifier == "gain", "wrong identifier: " + desc.fileOrIdentifier);
+        expect (plugin.getNumInputChannels() == 2 && plugin.getNumOutputChannels() == 2, "wrong number of channels");
+        expect (plugin.acceptsMidi() && plugin.producesMidi(), "wrong MIDI flags");
+        expect (plugin.getNumParameters() == 1, "wrong number of parameters");
+        expect (plugin.getParameterName (0) == "Gain", "wrong parameter name: " + plugin.getParameterName (0));
+    }
+
+    void testAudio (AudioPluginInstance& plugin, const float expectedGain)
+    {
+        std::cout << " Checking that the audio comes back with a gain of " << expectedGain << std::endl;
+
+        Random random (1234);
+        AudioSampleBuffer buffer (2, options.blockSize), original (2, options.blockSize);
+        MidiBuffer midi;
+
+        // (one block that's bigger than the bridge's shared buffer, so that it has to be split up)
+        const int blockSizes[] = { options.blockSize, 1, 17, 5000 };
+
+        for (int i = 0; i < numElementsInArray (blockSizes); ++i)
+        {
+            buffer.setSize (2, blockSizes[i]);
+            original.setSize (2, blockSizes[i]);
+
+            fillWithNoise (buffer, random);
+
+            for (int chan = 0; chan < 2; ++chan)
+                original.copyFrom (chan, 0, buffer, chan, 0, blockSizes[i]);
+
+            plugin.processBlock (buffer, midi);
+
+            float maxError = 0;
+
+            for (int chan = 0; chan < 2; ++chan)
+                for (int j = 0; j < blockSizes[i]; ++j)
+                    maxError = jmax (maxError, std::abs (buffer.getSampleData (chan)[j] - original.getSampleData (chan)[j] * expectedGain));
+
+            expect (maxError < 1.0e-6f, "the audio in a block of " + String (blockSizes[i])
+                                          + " samples was wrong, by up to " + String (maxError));
+        }
+    }
+
+    void testParameters (AudioPluginInstance& plugin)
+    {
+        std::cout << " Checking parameters" << std::endl;
+
+        expect (plugin.getParameter (0) == 0.5f, "wrong initial parameter value: " + String (plugin.getParameter (0)));
+        plugin.setParameter (0, 0.25f);
+        expect (plugin.getParameter (0) == 0.25f, "the parameter wasn't changed: " + String (plugin.getParameter (0)));
+        expect (plugin.getParameterText (0) == "0.25", "wrong parameter text: " + plugin.getParameterText (0));
+    }
+
+    void testMidi (AudioPluginInstance& plugin)
+    {
+        std::cout << " Checking that MIDI comes back" << std::endl;
+
+        AudioSampleBuffer buffer (2, options.blockSize);
+        buffer.clear();
+
+        MidiBuffer midi;
+        midi.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 0);
+        midi.addEvent (MidiMessage::noteOff (1, 60), options.blockSize - 1);
+
+        plugin.processBlock (buffer, midi);
+
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage message;
+        int samplePos, numEvents = 0;
+
+        while (iter.getNextEvent (message, samplePos))
+        {
+            if (numEvents == 0)
+                expect (message.isNoteOn() && samplePos == 0, "the note-on came back wrong");
+            else
+                expect (message.isNoteOff() && samplePos == options.blockSize - 1, "the note-off came back wrong");
+
+            ++numEvents;
+        }
+
+        expect (numEvents == 2, "expected 2 MIDI events back, but got " + String (numEvents));
+    }
+
+    void testState (AudioPluginInstance& plugin)
+    {
+        std::cout << " Checking that the state can be saved and restored" << std::endl;
+
+        MemoryBlock state;
+        plugin.getStateInformation (state);
+        expect (state.getSize() == sizeof (float), "wrong state size: " + String ((int) state.getSize()));
+
+        plugin.setParameter (0, 1.0f);
+        plugin.setStateInformation (state.getData(), (int) state.getSize());
+        expect (plugin.getParameter (0) == 0.25f, "the state wasn't restored: " + String (plugin.getParameter (0)));
+    }
+
+    // Calls getStateInformation() on another thread, to keep the bridge's control channel busy
+    class StateReaderThread  : public Thread
+    {
+    public:
+        StateReaderThread (AudioPluginInstance& plugin_)
+            : Thread ("state reader"), plugin (plugin_)
+        {
+        }
+
+        void run()
+        {
+            MemoryBlock state;
+            plugin.getStateInformation (state);
+        }
+
+    private:
+        AudioPluginInstance& plugin;
+
+        JUCE_DECLARE_NON_COPYABLE (StateReaderThread);
+    };
+
+    void testProcessingWhileBusy (AudioPluginInstance& plugin)
+    {
+        std::cout << " Checking that the audio isn't held up by other calls" << std::endl;
+
+        AudioSampleBuffer buffer (2, options.blockSize);
+        MidiBuffer midi;
+        buffer.clear();
+
+        StateReaderThread reader (plugin);
+        reader.startThread();
+        Thread::sleep (20);
+
+        double longestBlock = 0;
+        int numBlocks = 0;
+
+        while (reader.isThreadRunning())
+        {
+            const double startTime = getSecondsNow();
+            plugin.processBlock (buffer, midi);
+            longestBlock = jmax (longestBlock, getSecondsNow() - startTime);
+            ++numBlocks;
+        }
+
+        expect (numBlocks > 1, "processBlock() was blocked while the state was being read");
+        expect (longestBlock * 1000.0 < GainPlugin::stateDelayMs / 2,
+                "a processBlock() call took " + String (longestBlock * 1000.0, 1)
+                  + "ms while the state was being read");
+    }
+
+    void testCrash()
+    {
+        std::cout << " Checking that a crashing plugin just goes silent" << std::endl;
+
+        ScopedPointer <AudioPluginInstance> plugin (createBridgedPlugin (true));
+
+        if (plugin == nullptr)
+            return;
+
+        AudioSampleBuffer buffer (2, options.blockSize);
+        MidiBuffer midi;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            Random random (i);
+            fillWithNoise (buffer, random);
+
+            plugin->processBlock (buffer, midi);
+
+            expect (buffer.getMagnitude (0, options.blockSize) == 0, "a crashed plugin should produce silence");
+        }
+
+        // the control calls must also fail cleanly rather than hanging..
+        expect (plugin->getParameter (0) == 0, "a crashed plugin's parameters should all be 0");
+    }
+
+    //==============================================================================
+    double measureMicrosecondsPerBlock (AudioProcessor& plugin)
+    {
+        AudioSampleBuffer buffer (2, options.blockSize);
+        MidiBuffer midi;
+        Random random (1);
+        fillWithNoise (buffer, random);
+
+        double bestTime = std::numeric_limits<double>::max();
+
+        for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+        {
+            const double startTime = getSecondsNow();
+
+            for (int i = 0; i < options.numBlocks; ++i)
+                plugin.processBlock (buffer, midi);
+
+            bestTime = jmin (bestTime, getSecondsNow() - startTime);
+        }
+
+        return bestTime * 1.0e6 / options.numBlocks;
+    }
+
+    void measureRoundTrip (AudioPluginInstance& bridgedPlugin)
+    {
+        std::cout << std::endl;
+
+        GainPlugin directPlugin (false);
+        directPlugin.prepareToPlay (options.sampleRate, options.blockSize);
+
+        directMicrosecondsPerBlock  = measureMicrosecondsPerBlock (directPlugin);
+        bridgedMicrosecondsPerBlock = measureMicrosecondsPerBlock (bridgedPlugin);
+
+        const double blockLengthMicroseconds = options.blockSize * 1.0e6 / options.sampleRate;
+
+        std::cout << " Direct:  " << String (directMicrosecondsPerBlock, 2).paddedLeft (' ', 10) << " us per block" << std::endl
+                  << " Bridged: " << String (bridgedMicrosecondsPerBlock, 2).paddedLeft (' ', 10) << " us per block ("
+                  << String (100.0 * bridgedMicrosecondsPerBlock / blockLengthMicroseconds, 2) << "% of a "
+                  << options.blockSize << "-sample block)" << std::endl << std::endl;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (PluginBridgeTest);
+};
+
+//==============================================================================
+static void printUsage()
+{
+    std::cout << " Usage: PluginBridgeTest [options]\n\n"
+                 "  --json <file>      writes the results to a JSON file\n"
+                 "  --blocksize <n>    the block size to use (default 256)\n"
+                 "  --blocks <n>       the number of blocks to render when timing the round trip (default 2000)\n"
+                 "  --repeats <n>      the number of times to time the blocks - the fastest run is used (default 5)\n\n";
+}
+
+int main (int argc, char* argv[])
+{
+    StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add (argv[i]);
+
+    {
+        // When the test launches a copy of itself as the server, this is where it ends up..
+        AudioPluginFormatManager formatManager;
+        formatManager.addFormat (new TestPluginFormat());
+
+        if (PluginBridge::performBridgeServer (formatManager, args))
+            return 0;
+    }
+
+    std::cout << "\n Plugin Bridge Test - checks that plugins work correctly through a PluginBridge\n\n";
+
+    TestOptions options;
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        const String arg (args[i]);
+        const String value (args[i + 1].unquoted());
+
+        if (arg == "--json")            options.jsonFile = File::getCurrentWorkingDirectory().getChildFile (value);
+        else if (arg == "--blocksize")  options.blockSize = jlimit (1, 4096, value.getIntValue());
+        else if (arg == "--blocks")     options.numBlocks = jmax (1, value.getIntValue());
+        else if (arg == "--repeats")    options.numRepeats = jmax (1, value.getIntValue());
+        else                            { printUsage(); return 1; }
+
+        ++i;
+    }
+
+    PluginBridgeTest test (options);
+    test.runAll();
+
+    if (options.jsonFile != File::nonexistent)
+    {
+        options.jsonFile.deleteFile();
+        FileOutputStream out (options.jsonFile);
+
+        if (out.failedToOpen())
+        {
+            std::cout << "\nCouldn't write to " << options.jsonFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        JSON::writeToStream (out, test.getResultsAsVar());
+        std::cout << "\nWrote results to " << options.jsonFile.getFullPathName() << std::endl;
+    }
+
+    if (test.getNumFailures() > 0)
+    {
+        std::cout << " " << test.getNumFailures() << " test(s) FAILED" << std::endl;
+        return 1;
+    }
+
+    std::cout << " All tests passed" << std::endl;
+    return 0;
+}
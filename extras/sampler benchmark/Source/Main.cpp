@@ -0,0 +1,327 @@
+/*
+  ==============================================================================
+
+   A command-line tool that measures how many SamplerVoices one CPU core can
+   play in real time, for each of the voice's interpolation qualities, with and
+   without mip-mapped sounds.
+
+   The voices play a range of notes from two octaves below the sample's root
+   note to two octaves above it, so that the mip-map levels and the sinc
+   interpolator's stretched kernel all get used.
+
+   It prints a table of the results, and can also write them as JSON so that
+   they can be compared between versions.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+//==============================================================================
+struct BenchmarkOptions
+{
+    BenchmarkOptions()
+        : sampleRate (44100.0), blockSize (512), numVoices (32), numBlocks (200), numRepeats (3)
+    {
+    }
+
+    double sampleRate;
+    int blockSize, numVoices, numBlocks, numRepeats;
+    File jsonFile;
+};
+
+static double getSecondsNow()
+{
+    return Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+//==============================================================================
+// Creates a stereo sample with plenty of high harmonics, so that the interpolators
+// have some real work to do.
+static AudioFormatReader* createTestSample (const double sampleRate, const double numSeconds)
+{
+    const int numSamples = roundToInt (sampleRate * numSeconds);
+    AudioSampleBuffer buffer (2, numSamples);
+    Random random (0x1234);
+
+    for (int chan = 0; chan < 2; ++chan)
+    {
+        float* const data = buffer.getSampleData (chan);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double t = i / sampleRate;
+            double value = 0;
+
+            for (int harmonic = 1; harmonic <= 8; ++harmonic)
+                value += std::sin (2.0 * double_Pi * 261.6 * harmonic * (1.0 + chan * 0.001) * t) * (0.3 / harmonic);
+
+            data[i] = (float) (value + (random.nextFloat() - 0.5f) * 0.01f);
+        }
+    }
+
+    MemoryBlock wavData;
+
+    {
+        WavAudioFormat wav;
+        ScopedPointer <AudioFormatWriter> writer (wav.createWriterFor (new MemoryOutputStream (wavData, false),
+                                                                       sampleRate, 2, 24, StringPairArray(), 0));
+        writer->writeFromAudioSampleBuffer (buffer, 0, numSamples);
+    }
+
+    WavAudioFormat wav;
+    return wav.createReaderFor (new MemoryInputStream (wavData, true), true);
+}
+
+//==============================================================================
+// Records the fastest of several runs of a test.
+class BenchmarkResult
+{
+public:
+    BenchmarkResult (const String& quality_, const bool mipMapped_, const int numVoices_)
+        : quality (quality_), mipMapped (mipMapped_), numVoices (numVoices_),
+          bestTime (std::numeric_limits<double>::max()), audioSeconds (0)
+    {
+    }
+
+    void addRun (const double seconds)                  { bestTime = jmin (bestTime, jmax (seconds, 1.0e-9)); }
+
+    // i.e. how many voices could be played in real time if the core did nothing else
+    double getVoicesPerCore() const                     { return numVoices * audioSeconds / bestTime; }
+
+    double getNanosecondsPerVoiceSample (const double sampleRate) const
+    {
+        return bestTime * 1.0e9 / (numVoices * audioSeconds * sampleRate);
+    }
+
+    var toVar (const double sampleRate) const
+    {
+        DynamicObject* const d = new DynamicObject();
+        d->setProperty ("quality", quality);
+        d->setProperty ("mipMaps", mipMapped);
+        d->setProperty ("voices", numVoices);
+        d->setProperty ("seconds", bestTime);
+        d->setProperty ("audioSeconds", audioSeconds);
+        d->setProperty ("voicesPerCore", getVoicesPerCore());
+        d->setProperty ("nanosecondsPerVoiceSample", getNanosecondsPerVoiceSample (sampleRate));
+        return var (d);
+    }
+
+    void print (const double sampleRate) const
+    {
+        std::cout << quality.paddedRight (' ', 10)
+                  << String (mipMapped ? "mip-maps" : "-").paddedRight (' ', 10)
+                  << String (roundToInt (getVoicesPerCore())).paddedLeft (' ', 10) << " voices per core"
+                  << String (getNanosecondsPerVoiceSample (sampleRate), 2).paddedLeft (' ', 10) << " ns per voice-sample"
+                  << std::endl;
+    }
+
+    String quality;
+    bool mipMapped;
+    int numVoices;
+    double bestTime, audioSeconds;
+};
+
+//==============================================================================
+class SamplerBenchmark
+{
+public:
+    SamplerBenchmark (const BenchmarkOptions& options_)
+        : options (options_)
+    {
+    }
+
+    void runAll()
+    {
+        // (the sample needs to be long enough that none of the voices reach its end,
+        // even when they're pitched up by two octaves)
+        const double sampleSeconds = 4.0 * options.blockSize * options.numBlocks / options.sampleRate + 1.0;
+        const ScopedPointer <AudioFormatReader> reader (createTestSample (options.sampleRate, sampleSeconds));
+
+        if (reader == nullptr)
+        {
+            std::cout << "*** Error: couldn't create the test sample" << std::endl;
+            return;
+        }
+
+        const SamplerVoice::InterpolationQuality qualities[] = { SamplerVoice::linearInterpolation,
+                                                                 SamplerVoice::cubicInterpolation,
+                                                                 SamplerVoice::sincInterpolation };
+
+        for (int mipMaps = 0; mipMaps < 2; ++mipMaps)
+            for (int i = 0; i < numElementsInArray (qualities); ++i)
+                benchmarkQuality (*reader, qualities[i], mipMaps != 0);
+    }
+
+    var getResultsAsVar() const
+    {
+        DynamicObject* const d = new DynamicObject();
+        d->setProperty ("benchmark", "sampler benchmark");
+        d->setProperty ("juceVersion", SystemStats::getJUCEVersion());
+        d->setProperty ("operatingSystem", SystemStats::getOperatingSystemName());
+        d->setProperty ("cpuVendor", SystemStats::getCpuVendor());
+        d->setProperty ("time", Time::getCurrentTime().formatted ("%Y-%m-%d %H:%M:%S"));
+        d->setProperty ("sampleRate", options.sampleRate);
+        d->setProperty ("blockSize", options.blockSize);
+        d->setProperty ("repeats", options.numRepeats);
+
+        Array<var> resultList;
+        for (int i = 0; i < results.size(); ++i)
+            resultList.add (results.getUnchecked (i)->toVar (options.sampleRate));
+
+        d->setProperty ("results", resultList);
+        return var (d);
+    }
+
+private:
+    //==============================================================================
+    const BenchmarkOptions& options;
+    OwnedArray<BenchmarkResult> results;
+
+    static String getQualityName (const SamplerVoice::InterpolationQuality quality)
+    {
+        switch (quality)
+        {
+            case SamplerVoice::linearInterpolation:     return "linear";
+            case SamplerVoice::cubicInterpolation:      return "cubic";
+            case SamplerVoice::sincInterpolation:       return "sinc";
+            default:                                    break;
+        }
+
+        return String::empty;
+    }
+
+    // Starts all the voices, on notes spread over four octaves around the root note.
+    // Each note is used on one MIDI channel only, because the synth would stop a voice
+    // that's already playing the same note and channel.
+    void startVoices (Synthesiser& synth)
+    {
+        MidiBuffer midi;
+
+        for (int i = 0; i < options.numVoices; ++i)
+            midi.addEvent (MidiMessage::noteOn (1 + (i / 49) % 16, 36 + (i * 11) % 49, 0.5f), 0);
+
+        AudioSampleBuffer buffer (2, 1);
+        buffer.clear();
+        synth.renderNextBlock (buffer, midi, 0, 1);
+    }
+
+    static int countActiveVoices (Synthesiser& synth)
+    {
+        int num = 0;
+
+        for (int i = 0; i < synth.getNumVoices(); ++i)
+            if (synth.getVoice (i)->getCurrentlyPlayingNote() >= 0)
+                ++num;
+
+        return num;
+    }
+
+    void benchmarkQuality (AudioFormatReader& reader, const SamplerVoice::InterpolationQuality quality, const bool mipMapped)
+    {
+        BenchmarkResult* const r = new BenchmarkResult (getQualityName (quality), mipMapped, options.numVoices);
+        results.add (r);
+
+        BigInteger allNotes;
+        allNotes.setRange (0, 128, true);
+
+        SamplerSound* const sound = new SamplerSound ("test", reader, allNotes, 60, 0.0, 0.1, 1000.0);
+
+        if (mipMapped)
+            sound->createMipMaps();
+
+        Synthesiser synth;
+        synth.addSound (sound);
+        synth.setCurrentPlaybackSampleRate (options.sampleRate);
+
+        for (int i = 0; i < options.numVoices; ++i)
+            synth.addVoice (new SamplerVoice (quality));
+
+        AudioSampleBuffer buffer (2, options.blockSize);
+        MidiBuffer noMidi;
+
+        for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+        {
+            startVoices (synth);
+
+            const double startTime = getSecondsNow();
+
+            for (int i = 0; i < options.numBlocks; ++i)
+            {
+                buffer.clear();
+                synth.renderNextBlock (buffer, noMidi, 0, options.blockSize);
+            }
+
+            r->addRun (getSecondsNow() - startTime);
+
+            if (countActiveVoices (synth) != options.numVoices)
+            {
+                std::cout << "\n*** Error: some of the voices stopped before the end of the test" << std::endl;
+                jassertfalse;
+            }
+
+            synth.allNotesOff (0, false);
+        }
+
+        r->audioSeconds = options.blockSize * options.numBlocks / options.sampleRate;
+        r->print (options.sampleRate);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (SamplerBenchmark);
+};
+
+//==============================================================================
+static void printUsage()
+{
+    std::cout << " Usage: SamplerBenchmark [options]\n\n"
+                 "  --json <file>      writes the results to a JSON file\n"
+                 "  --voices <n>       the number of voices to play at once (default 32)\n"
+                 "  --blocksize <n>    the block size to render (default 512)\n"
+                 "  --blocks <n>       the number of blocks to render in each run (default 200)\n"
+                 "  --repeats <n>      the number of times to run each test - the fastest run is used (default 3)\n"
+                 "  --rate <n>         the sample rate (default 44100)\n\n";
+}
+
+int main (int argc, char* argv[])
+{
+    std::cout << "\n Sampler Benchmark - measures how many SamplerVoices can be played on one core\n\n";
+
+    BenchmarkOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const String arg (argv[i]);
+        const String value (i < argc - 1 ? String (argv [i + 1]).unquoted() : String::empty);
+
+        if (arg == "--json")            options.jsonFile = File::getCurrentWorkingDirectory().getChildFile (value);
+        else if (arg == "--voices")     options.numVoices = jlimit (1, 49 * 16, value.getIntValue());
+        else if (arg == "--blocksize")  options.blockSize = jmax (1, value.getIntValue());
+        else if (arg == "--blocks")     options.numBlocks = jmax (1, value.getIntValue());
+        else if (arg == "--repeats")    options.numRepeats = jmax (1, value.getIntValue());
+        else if (arg == "--rate")       options.sampleRate = jmax (8000.0, value.getDoubleValue());
+        else                            { printUsage(); return 1; }
+
+        ++i;
+    }
+
+    SamplerBenchmark benchmark (options);
+    benchmark.runAll();
+
+    if (options.jsonFile != File::nonexistent)
+    {
+        options.jsonFile.deleteFile();
+        FileOutputStream out (options.jsonFile);
+
+        if (out.failedToOpen())
+        {
+            std::cout << "\nCouldn't write to " << options.jsonFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        JSON::writeToStream (out, benchmark.getResultsAsVar());
+        std::cout << "\nWrote results to " << options.jsonFile.getFullPathName() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,379 @@
+/*
+  ==============================================================================
+
+   A command-line tool that measures how much it costs the ThreadPool to
+   schedule a piece of work - i.e. the time per task when the tasks themselves
+   do almost nothing - for the lightweight TaskGroup tasks, parallelFor() and
+   parallelReduce(), and for old-style ThreadPoolJobs.
+
+   It prints a table of the results, and can also write them as JSON so that
+   they can be compared between versions.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+//==============================================================================
+struct BenchmarkOptions
+{
+    BenchmarkOptions()
+        : numTasks (100000), numJobs (10000), numRepeats (5),
+          maxThreads (jmax (4, SystemStats::getNumCpus()))
+    {
+    }
+
+    int numTasks, numJobs, numRepeats, maxThreads;
+    File jsonFile;
+};
+
+static double getSecondsNow()
+{
+    return Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+//==============================================================================
+// Records the fastest of several runs of a test.
+class BenchmarkResult
+{
+public:
+    BenchmarkResult (const String& name_, const int numThreads_, const int numItems_)
+        : name (name_), numThreads (numThreads_), numItems (numItems_),
+          bestTime (std::numeric_limits<double>::max())
+    {
+    }
+
+    void addRun (const double seconds)                  { bestTime = jmin (bestTime, jmax (seconds, 1.0e-9)); }
+
+    double getNanosecondsPerItem() const                { return bestTime * 1.0e9 / numItems; }
+
+    var toVar() const
+    {
+        DynamicObject* const d = new DynamicObject();
+        d->setProperty ("test", name);
+        d->setProperty ("threads", numThreads);
+        d->setProperty ("items", numItems);
+        d->setProperty ("seconds", bestTime);
+        d->setProperty ("nanosecondsPerItem", getNanosecondsPerItem());
+        return var (d);
+    }
+
+    void print() const
+    {
+        std::cout << name.paddedRight (' ', 36)
+                  << String (numThreads).paddedLeft (' ', 3) << " threads "
+                  << String (getNanosecondsPerItem(), 1).paddedLeft (' ', 10) << " ns per item"
+                  << std::endl;
+    }
+
+    String name;
+    int numThreads, numItems;
+    double bestTime;
+};
+
+//==============================================================================
+// The work items all do next to nothing, so what gets measured is the scheduling.
+struct EmptyTask
+{
+    EmptyTask (Atomic<int>& counter_) noexcept : counter (counter_) {}
+    void operator()() const noexcept            { ++counter; }
+
+    Atomic<int>& counter;
+};
+
+struct EmptyLoopBody
+{
+    EmptyLoopBody (Atomic<int>& counter_) noexcept : counter (counter_) {}
+    void operator() (int) const noexcept        { ++counter; }
+
+    Atomic<int>& counter;
+};
+
+struct IndexValue
+{
+    int64 operator() (int index) const noexcept                     { return index; }
+};
+
+struct Sum
+{
+    int64 operator() (const int64 a, const int64 b) const noexcept  { return a + b; }
+};
+
+// A task that adds a whole group of tasks from inside one of the pool's threads,
+// which is where nested parallel work gets scheduled from.
+struct TaskSpawner
+{
+    TaskSpawner (ThreadPool& pool_, Atomic<int>& counter_, const int numTasks_) noexcept
+        : pool (pool_), counter (counter_), numTasks (numTasks_)
+    {
+    }
+
+    void operator()() const
+    {
+        ThreadPool::TaskGroup group (pool);
+
+        for (int i = numTasks; --i >= 0;)
+            group.run (EmptyTask (counter));
+
+        group.wait();
+    }
+
+    ThreadPool& pool;
+    Atomic<int>& counter;
+    int numTasks;
+};
+
+class EmptyJob  : public ThreadPoolJob
+{
+public:
+    EmptyJob (Atomic<int>& counter_) : ThreadPoolJob ("empty"), counter (counter_) {}
+    JobStatus runJob()              { ++counter; return jobHasFinished; }
+
+private:
+    Atomic<int>& counter;
+};
+
+//==============================================================================
+class ThreadPoolBenchmark
+{
+public:
+    ThreadPoolBenchmark (const BenchmarkOptions& options_)
+        : options (options_)
+    {
+    }
+
+    void runAll()
+    {
+        for (int numThreads = 1; numThreads <= options.maxThreads; numThreads *= 2)
+        {
+            ThreadPool pool (numThreads);
+
+            benchmarkTaskGroup (pool);
+            benchmarkNestedTaskGroup (pool);
+            benchmarkParallelFor (pool);
+            benchmarkParallelReduce (pool);
+            benchmarkJobs (pool);
+
+            std::cout << std::endl;
+        }
+    }
+
+    var getResultsAsVar() const
+    {
+        DynamicObject* const d = new DynamicObject();
+        d->setProperty ("benchmark", "threadpool benchmark");
+        d->setProperty ("juceVersion", SystemStats::getJUCEVersion());
+        d->setProperty ("operatingSystem", SystemStats::getOperatingSystemName());
+        d->setProperty ("cpuVendor", SystemStats::getCpuVendor());
+        d->setProperty ("numCpus", SystemStats::getNumCpus());
+        d->setProperty ("time", Time::getCurrentTime().formatted ("%Y-%m-%d %H:%M:%S"));
+        d->setProperty ("repeats", options.numRepeats);
+
+        Array<var> resultList;
+        for (int i = 0; i < results.size(); ++i)
+            resultList.add (results.getUnchecked (i)->toVar());
+
+        d->setProperty ("results", resultList);
+        return var (d);
+    }
+
+private:
+    //==============================================================================
+    const BenchmarkOptions& options;
+    OwnedArray<BenchmarkResult> results;
+
+    BenchmarkResult& addResult (const String& name, const int numThreads, const int numItems)
+    {
+        BenchmarkResult* const r = new BenchmarkResult (name, numThreads, numItems);
+        results.add (r);
+        return *r;
+    }
+
+    static void checkCount (const Atomic<int>& counter, const int expected)
+    {
+        if (counter.get() != expected)
+        {
+            std::cout << "\n*** Error: " << counter.get() << " items were run, but expected " << expected << std::endl;
+            jassertfalse;
+        }
+    }
+
+    //==============================================================================
+    void benchmarkTaskGroup (ThreadPool& pool)
+    {
+        BenchmarkResult& r = addResult ("TaskGroup (added from outside)", pool.getNumThreads(), options.numTasks);
+
+        for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+        {
+            Atomic<int> counter;
+            const double startTime = getSecondsNow();
+
+            {
+                ThreadPool::TaskGroup group (pool);
+
+                for (int i = options.numTasks; --i >= 0;)
+                    group.run (EmptyTask (counter));
+
+                group.wait();
+            }
+
+            r.addRun (getSecondsNow() - startTime);
+            checkCount (counter, options.numTasks);
+        }
+
+        r.print();
+    }
+
+    void benchmarkNestedTaskGroup (ThreadPool& pool)
+    {
+        BenchmarkResult& r = addResult ("TaskGroup (added by a pool thread)", pool.getNumThreads(), options.numTasks);
+
+        for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+        {
+            Atomic<int> counter;
+            const double startTime = getSecondsNow();
+
+            {
+                ThreadPool::TaskGroup group (pool);
+                group.run (TaskSpawner (pool, counter, options.numTasks));
+                group.wait();
+            }
+
+            r.addRun (getSecondsNow() - startTime);
+            checkCount (counter, options.numTasks);
+        }
+
+        r.print();
+    }
+
+    void benchmarkParallelFor (ThreadPool& pool)
+    {
+        const int grainSizes[] = { 1, 16 };
+
+        for (int i = 0; i < numElementsInArray (grainSizes); ++i)
+        {
+            BenchmarkResult& r = addResult ("parallelFor (grain size " + String (grainSizes[i]) + ")",
+                                            pool.getNumThreads(), options.numTasks);
+
+            for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+            {
+                Atomic<int> counter;
+                const double startTime = getSecondsNow();
+
+                pool.parallelFor (0, options.numTasks, EmptyLoopBody (counter), grainSizes[i]);
+
+                r.addRun (getSecondsNow() - startTime);
+                checkCount (counter, options.numTasks);
+            }
+
+            r.print();
+        }
+    }
+
+    void benchmarkParallelReduce (ThreadPool& pool)
+    {
+        BenchmarkResult& r = addResult ("parallelReduce (grain size 1)", pool.getNumThreads(), options.numTasks);
+        const int64 expected = (options.numTasks * (int64) (options.numTasks - 1)) / 2;
+
+        for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+        {
+            const double startTime = getSecondsNow();
+
+            const int64 total = pool.parallelReduce (0, options.numTasks, (int64) 0, IndexValue(), Sum(), 1);
+
+            r.addRun (getSecondsNow() - startTime);
+
+            if (total != expected)
+            {
+                std::cout << "\n*** Error: parallelReduce returned the wrong total" << std::endl;
+                jassertfalse;
+            }
+        }
+
+        r.print();
+    }
+
+    void benchmarkJobs (ThreadPool& pool)
+    {
+        BenchmarkResult& r = addResult ("ThreadPoolJob", pool.getNumThreads(), options.numJobs);
+
+        for (int repeat = 0; repeat < options.numRepeats; ++repeat)
+        {
+            Atomic<int> counter;
+            OwnedArray<EmptyJob> jobs;
+
+            for (int i = options.numJobs; --i >= 0;)
+                jobs.add (new EmptyJob (counter));
+
+            const double startTime = getSecondsNow();
+
+            for (int i = 0; i < jobs.size(); ++i)
+                pool.addJob (jobs.getUnchecked (i), false);
+
+            while (pool.getNumJobs() > 0)
+                pool.waitForJobToFinish (jobs.getLast(), 1);
+
+            r.addRun (getSecondsNow() - startTime);
+            checkCount (counter, options.numJobs);
+        }
+
+        r.print();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (ThreadPoolBenchmark);
+};
+
+//==============================================================================
+static void printUsage()
+{
+    std::cout << " Usage: ThreadPoolBenchmark [options]\n\n"
+                 "  --json <file>      writes the results to a JSON file\n"
+                 "  --tasks <n>        the number of tasks to run in each of the task tests (default 100000)\n"
+                 "  --jobs <n>         the number of ThreadPoolJobs to run in the job test (default 10000)\n"
+                 "  --repeats <n>      the number of times to run each test - the fastest run is used (default 5)\n"
+                 "  --threads <n>      the largest pool to test - pools of 1, 2, 4.. threads are tested up to\n"
+                 "                     this size (default is the number of CPUs, or 4 if that's more)\n\n";
+}
+
+int main (int argc, char* argv[])
+{
+    std::cout << "\n ThreadPool Benchmark - measures the scheduling overhead of the ThreadPool\n\n";
+
+    BenchmarkOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const String arg (argv[i]);
+        const String value (i < argc - 1 ? String (argv [i + 1]).unquoted() : String::empty);
+
+        if (arg == "--json")            options.jsonFile = File::getCurrentWorkingDirectory().getChildFile (value);
+        else if (arg == "--tasks")      options.numTasks = jmax (1, value.getIntValue());
+        else if (arg == "--jobs")       options.numJobs = jmax (1, value.getIntValue());
+        else if (arg == "--repeats")    options.numRepeats = jmax (1, value.getIntValue());
+        else if (arg == "--threads")    options.maxThreads = jmax (1, value.getIntValue());
+        else                            { printUsage(); return 1; }
+
+        ++i;
+    }
+
+    ThreadPoolBenchmark benchmark (options);
+    benchmark.runAll();
+
+    if (options.jsonFile != File::nonexistent)
+    {
+        options.jsonFile.deleteFile();
+        FileOutputStream out (options.jsonFile);
+
+        if (out.failedToOpen())
+        {
+            std::cout << "\nCouldn't write to " << options.jsonFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        JSON::writeToStream (out, benchmark.getResultsAsVar());
+        std::cout << "\nWrote results to " << options.jsonFile.getFullPathName() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+AudioCallbackTimingStats::AudioCallbackTimingStats()
+    : sampleRate (0)
+{
+    reset();
+}
+
+AudioCallbackTimingStats::~AudioCallbackTimingStats()
+{
+}
+
+void AudioCallbackTimingStats::reset (const double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    reset();
+}
+
+void AudioCallbackTimingStats::reset()
+{
+    for (int i = 0; i < numHistogramBins; ++i)
+        histogram[i] = 0;
+
+    for (int i = 0; i < maxXRunTimesStored; ++i)
+        xrunTimes[i] = 0;
+
+    numCallbacks = 0;
+    numDeadlineMisses = 0;
+    numIntervals = 0;
+    numXRuns = 0;
+    totalDurationMicroseconds = 0;
+    maxDurationMicroseconds = 0;
+    totalJitterMicroseconds = 0;
+    maxJitterMicroseconds = 0;
+    lastCallbackStartTicks = 0;
+    lastCallbackLengthMicroseconds = 0;
+    startTicks = Time::getHighResolutionTicks();
+}
+
+int64 AudioCallbackTimingStats::ticksToMicroseconds (const int64 ticks) noexcept
+{
+    return (int64) (Time::highResolutionTicksToSeconds (ticks) * 1000000.0);
+}
+
+//==============================================================================
+void AudioCallbackTimingStats::addCallback (const int64 callbackStartTicks, const int64 callbackEndTicks,
+                                            const int numSamples) noexcept
+{
+    const int64 duration = ticksToMicroseconds (callbackEndTicks - callbackStartTicks);
+    const int64 blockLength = sampleRate > 0 ? (int64) (numSamples * 1000000.0 / sampleRate) : 0;
+
+    ++histogram [(int) jlimit ((int64) 0, (int64) numHistogramBins - 1, duration / histogramBinWidthMicroseconds)];
+    totalDurationMicroseconds += duration;
+
+    if (duration > maxDurationMicroseconds.get())
+        maxDurationMicroseconds = duration;
+
+    if (blockLength > 0 && duration > blockLength)
+        ++numDeadlineMisses;
+
+    const int64 lastStart = lastCallbackStartTicks.get();
+
+    if (lastStart != 0)
+    {
+        const int64 jitter = std::abs (ticksToMicroseconds (callbackStartTicks - lastStart)
+                                        - lastCallbackLengthMicroseconds.get());
+        totalJitterMicroseconds += jitter;
+        ++numIntervals;
+
+        if (jitter > maxJitterMicroseconds.get())
+            maxJitterMicroseconds = jitter;
+    }
+
+    lastCallbackStartTicks = callbackStartTicks;
+    lastCallbackLengthMicroseconds = blockLength;
+    ++numCallbacks;
+}
+
+void AudioCallbackTimingStats::addXRuns (int num, const int64 timeTicks) noexcept
+{
+    const int64 time = ticksToMicroseconds (timeTicks - startTicks.get());
+
+    while (--num >= 0)
+    {
+        // (the time is stored before the count is incremented, so that a reader never
+        // sees a count that includes a slot which hasn't been written yet)
+        xrunTimes [numXRuns.get() % maxXRunTimesStored] = time;
+        ++numXRuns;
+    }
+}
+
+//==============================================================================
+int AudioCallbackTimingStats::getHistogramBinCount (const int binIndex) const noexcept
+{
+    return isPositiveAndBelow (binIndex, (int) numHistogramBins) ? histogram[binIndex].get() : 0;
+}
+
+double AudioCallbackTimingStats::getMeanCallbackDurationMs() const noexcept
+{
+    const int num = numCallbacks.get();
+    return num > 0 ? totalDurationMicroseconds.get() / (1000.0 * num) : 0.0;
+}
+
+double AudioCallbackTimingStats::getMaxCallbackDurationMs() const noexcept
+{
+    return maxDurationMicroseconds.get() / 1000.0;
+}
+
+double AudioCallbackTimingStats::getMeanJitterMs() const noexcept
+{
+    const int num = numIntervals.get();
+    return num > 0 ? totalJitterMicroseconds.get() / (1000.0 * num) : 0.0;
+}
+
+double AudioCallbackTimingStats::getMaxJitterMs() const noexcept
+{
+    return maxJitterMicroseconds.get() / 1000.0;
+}
+
+Array<double> AudioCallbackTimingStats::getXRunTimes() const
+{
+    Array<double> times;
+    const int num = numXRuns.get();
+
+    for (int i = jmax (0, num - (int) maxXRunTimesStored); i < num; ++i)
+        times.add (xrunTimes [i % maxXRunTimesStored].get() / 1000000.0);
+
+    return times;
+}
+
+//==============================================================================
+String AudioCallbackTimingStats::toJSON() const
+{
+    DynamicObject* const stats = new DynamicObject();
+    var result (stats);
+
+    stats->setProperty ("sampleRate", sampleRate);
+    stats->setProperty ("numCallbacks", getNumCallbacks());
+    stats->setProperty ("numDeadlineMisses", getNumDeadlineMisses());
+    stats->setProperty ("meanDurationMs", getMeanCallbackDurationMs());
+    stats->setProperty ("maxDurationMs", getMaxCallbackDurationMs());
+    stats->setProperty ("meanJitterMs", getMeanJitterMs());
+    stats->setProperty ("maxJitterMs", getMaxJitterMs());
+    stats->setProperty ("histogramBinWidthMicroseconds", (int) histogramBinWidthMicroseconds);
+
+    Array<var> histogramBins;
+
+    for (int i = 0; i < numHistogramBins; ++i)
+        histogramBins.add (getHistogramBinCount (i));
+
+    stats->setProperty ("histogram", histogramBins);
+    stats->setProperty ("numXRuns", getNumXRuns());
+
+    const Array<double> times (getXRunTimes());
+    Array<var> xruns;
+
+    for (int i = 0; i < times.size(); ++i)
+        xruns.add (times.getUnchecked (i));
+
+    stats->setProperty ("xrunTimes", xruns);
+
+    return JSON::toString (result);
+}
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_AUDIOCALLBACKTIMINGSTATS_JUCEHEADER__
+#define __JUCE_AUDIOCALLBACKTIMINGSTATS_JUCEHEADER__
+
+
+//==============================================================================
+/**
+    Collects timing statistics about a stream of audio callbacks.
+
+    This is used by the AudioDeviceManager to measure how long each of its callbacks
+    takes, how regularly the device is calling it, and how many xruns the device has
+    reported. Unlike a smoothed CPU figure, this lets you spot the occasional slow
+    callback that causes a dropout.
+
+    The statistics are written by the audio thread and can be read from any other
+    thread without locking. Because each value is read separately, a set of values
+    read while the audio is running may be one callback out of step with each other.
+
+    @see AudioDeviceManager::getCallbackTimingStats
+*/
+class JUCE_API  AudioCallbackTimingStats
+{
+public:
+    //==============================================================================
+    /** Creates an empty set of statistics. */
+    AudioCallbackTimingStats();
+
+    /** Destructor. */
+    ~AudioCallbackTimingStats();
+
+    //==============================================================================
+    enum
+    {
+        numHistogramBins = 100,             /**< The number of bins in the callback duration histogram. */
+        histogramBinWidthMicroseconds = 100 /**< The range of durations that each histogram bin covers. */
+    };
+
+    /** Clears all the statistics, and sets the sample rate that will be used to work out
+        how long each callback is allowed to take.
+    */
+    void reset (double sampleRate);
+
+    /** Clears all the statistics, keeping the current sample rate. */
+    void reset();
+
+    //==============================================================================
+    /** Records a callback.
+
+        This should be called by the audio thread after each callback, with the values
+        that Time::getHighResolutionTicks() returned before and after it ran.
+    */
+    void addCallback (int64 startTicks, int64 endTicks, int numSamples) noexcept;
+
+    /** Records some xruns that the audio device has reported. */
+    void addXRuns (int numXRuns, int64 timeTicks) noexcept;
+
+    //==============================================================================
+    /** Returns the number of callbacks that have been recorded. */
+    int getNumCallbacks() const noexcept                { return numCallbacks.get(); }
+
+    /** Returns the number of callbacks that took longer than the audio they were producing
+        lasts for, i.e. callbacks that would have caused a dropout.
+    */
+    int getNumDeadlineMisses() const noexcept           { return numDeadlineMisses.get(); }
+
+    /** Returns the number of callbacks whose duration fell into one of the histogram bins.
+
+        Bin i counts the callbacks that took between i * histogramBinWidthMicroseconds and
+        (i + 1) * histogramBinWidthMicroseconds. The last bin also counts any callbacks that
+        took longer than that.
+    */
+    int getHistogramBinCount (int binIndex) const noexcept;
+
+    /** Returns the average duration of the callbacks, in milliseconds. */
+    double getMeanCallbackDurationMs() const noexcept;
+
+    /** Returns the longest duration of any callback, in milliseconds. */
+    double getMaxCallbackDurationMs() const noexcept;
+
+    /** Returns the average jitter between callbacks, in milliseconds.
+
+        The jitter is the difference between the time that elapsed between the starts of
+        two callbacks, and the time that the first callback's block of audio lasts for.
+    */
+    double getMeanJitterMs() const noexcept;
+
+    /** Returns the worst jitter between any two callbacks, in milliseconds.
+        @see getMeanJitterMs
+    */
+    double getMaxJitterMs() const noexcept;
+
+    /** Returns the number of xruns that the device has reported.
+
+        Not all devices can report xruns - see AudioIODevice::getXRunCount().
+    */
+    int getNumXRuns() const noexcept                    { return numXRuns.get(); }
+
+    /** Returns the times at which the most recent xruns happened, in seconds since the
+        statistics were last reset. Only the last maxXRunTimesStored xruns are kept.
+    */
+    Array<double> getXRunTimes() const;
+
+    /** The number of xrun timestamps that are kept. */
+    enum { maxXRunTimesStored = 64 };
+
+    //==============================================================================
+    /** Returns all the statistics as a JSON object. */
+    String toJSON() const;
+
+private:
+    //==============================================================================
+    Atomic<int> histogram [numHistogramBins];
+    Atomic<int> numCallbacks, numDeadlineMisses, numIntervals, numXRuns;
+    Atomic<int64> totalDurationMicroseconds, maxDurationMicroseconds;
+    Atomic<int64> totalJitterMicroseconds, maxJitterMicroseconds;
+    Atomic<int64> xrunTimes [maxXRunTimesStored];
+    Atomic<int64> startTicks, lastCallbackStartTicks, lastCallbackLengthMicroseconds;
+    double sampleRate;
+
+    static int64 ticksToMicroseconds (int64 ticks) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioCallbackTimingStats);
+};
+
+
+#endif   // __JUCE_AUDIOCALLBACKTIMINGSTATS_JUCEHEADER__
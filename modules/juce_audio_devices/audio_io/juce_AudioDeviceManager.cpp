@@ -98,7 +98,8 @@ AudioDeviceManager::AudioDeviceManager()
       inputLevel (0),
       tempBuffer (2, 2),
       cpuUsageMs (0),
-      timeToCpuScale (0)
+      timeToCpuScale (0),
+      lastXRunCount (0)
 {
     callbackHandler = new CallbackHandler (*this);
 }
@@ -134,6 +135,23 @@ const OwnedArray <AudioIODeviceType>& AudioDeviceManager::getAvailableDeviceType
     return availableDeviceTypes;
 }
 
+void AudioDeviceManager::addAudioDeviceType (AudioIODeviceType* newDeviceType)
+{
+    if (newDeviceType != nullptr)
+    {
+        createDeviceTypesIfNeeded();
+
+        jassert (lastDeviceTypeConfigs.size() == availableDeviceTypes.size());
+        availableDeviceTypes.add (newDeviceType);
+        lastDeviceTypeConfigs.add (new AudioDeviceSetup());
+
+        if (currentDeviceType.isEmpty())
+            currentDeviceType = newDeviceType->getTypeName();
+
+        newDeviceType->addListener (callbackHandler);
+    }
+}
+
 void AudioDeviceManager::audioDeviceListChanged()
 {
     sendChangeMessage();
@@ -648,6 +666,7 @@ void AudioDeviceManager::audioDeviceIOCallbackInt (const float** inputChannelDat
                                                    int numOutputChannels,
                                                    int numSamples)
 {
+    const int64 callbackStartTicks = Time::getHighResolutionTicks();
     const ScopedLock sl (audioCallbackLock);
 
     if (inputLevelMeasurementEnabledCount > 0 && numInputChannels > 0)
@@ -726,11 +745,26 @@ void AudioDeviceManager::audioDeviceIOCallbackInt (const float** inputChannelDat
         if (testSoundPosition >= testSound->getNumSamples())
             testSound = nullptr;
     }
+
+    const int64 callbackEndTicks = Time::getHighResolutionTicks();
+    callbackTimingStats.addCallback (callbackStartTicks, callbackEndTicks, numSamples);
+
+    if (currentAudioDevice != nullptr)
+    {
+        const int xruns = currentAudioDevice->getXRunCount();
+
+        if (xruns > lastXRunCount)
+            callbackTimingStats.addXRuns (xruns - lastXRunCount, callbackEndTicks);
+
+        lastXRunCount = xruns;
+    }
 }
 
 void AudioDeviceManager::audioDeviceAboutToStartInt (AudioIODevice* const device)
 {
     cpuUsageMs = 0;
+    lastXRunCount = device->getXRunCount();
+    callbackTimingStats.reset (device->getCurrentSampleRate());
 
     const double sampleRate = device->getCurrentSampleRate();
     const int blockSize = device->getCurrentBufferSizeSamples();
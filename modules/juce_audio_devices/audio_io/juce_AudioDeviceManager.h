@@ -27,6 +27,7 @@
 #define __JUCE_AUDIODEVICEMANAGER_JUCEHEADER__
 
 #include "juce_AudioIODeviceType.h"
+#include "juce_AudioCallbackTimingStats.h"
 #include "../midi_io/juce_MidiInput.h"
 #include "../midi_io/juce_MidiOutput.h"
 
@@ -308,6 +309,13 @@ public:
     */
     double getCpuUsage() const;
 
+    /** Returns detailed timing statistics about the audio callbacks.
+
+        The statistics are cleared each time the audio device starts, and can be read
+        from any thread while the audio is running.
+    */
+    AudioCallbackTimingStats& getCallbackTimingStats() noexcept     { return callbackTimingStats; }
+
     //==============================================================================
     /** Enables or disables a midi input device.
 
@@ -387,6 +395,14 @@ public:
     */
     const OwnedArray <AudioIODeviceType>& getAvailableDeviceTypes();
 
+    /** Adds a new device type to the list of types.
+
+        The manager will take ownership of the object that is passed-in. This lets you
+        use a type that createAudioDeviceTypes() doesn't know about, e.g. a
+        FileAudioIODeviceType, without needing to subclass the manager.
+    */
+    void addAudioDeviceType (AudioIODeviceType* newDeviceType);
+
     //==============================================================================
     /** Creates a list of available types.
 
@@ -470,6 +486,8 @@ private:
     CriticalSection audioCallbackLock, midiCallbackLock;
 
     double cpuUsageMs, timeToCpuScale;
+    AudioCallbackTimingStats callbackTimingStats;
+    int lastXRunCount;
 
     //==============================================================================
     class CallbackHandler;
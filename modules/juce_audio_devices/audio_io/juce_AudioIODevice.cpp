@@ -38,6 +38,11 @@ bool AudioIODevice::hasControlPanel() const
     return false;
 }
 
+int AudioIODevice::getXRunCount() const noexcept
+{
+    return -1;
+}
+
 bool AudioIODevice::showControlPanel()
 {
     jassertfalse;    // this should only be called for devices which return true from
@@ -303,6 +303,12 @@ public:
     */
     virtual int getInputLatencyInSamples() = 0;
 
+    /** Returns the number of times the device has under- or over-run since it was opened.
+
+        Devices which can't detect this will return -1.
+    */
+    virtual int getXRunCount() const noexcept;
+
 
     //==============================================================================
     /** True if this device can show a pop-up control panel for editing its settings.
@@ -0,0 +1,528 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+class FileAudioIODevice  : public AudioIODevice,
+                           private Thread
+{
+public:
+    FileAudioIODevice (const FileAudioIODeviceType::DeviceSettings& settings_)
+        : AudioIODevice (settings_.name, "File"),
+          Thread ("Juce File Audio"),
+          settings (settings_),
+          sampleRate (0),
+          bufferSize (0),
+          bitDepth (32),
+          isOpen_ (false),
+          callback (nullptr),
+          inputBuffer (1, 1),
+          outputBuffer (1, 1),
+          writerThread ("Juce File Audio Writer")
+    {
+        formatManager.registerBasicFormats();
+    }
+
+    ~FileAudioIODevice()
+    {
+        close();
+    }
+
+    //==============================================================================
+    StringArray getOutputChannelNames()     { return getChannelNames ("Output", settings.numOutputChannels); }
+    StringArray getInputChannelNames()      { return getChannelNames ("Input", settings.numInputChannels); }
+
+    int getNumSampleRates()                 { return 8; }
+
+    double getSampleRate (int index)
+    {
+        const double rates[] = { 22050.0, 32000.0, 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+        return rates [jlimit (0, getNumSampleRates() - 1, index)];
+    }
+
+    int getDefaultBufferSize()              { return 512; }
+    int getNumBufferSizesAvailable()        { return 10; }
+    int getBufferSizeSamples (int index)    { return 16 << jlimit (0, getNumBufferSizesAvailable() - 1, index); }
+
+    //==============================================================================
+    String open (const BigInteger& inputChannels, const BigInteger& outputChannels,
+                 double newSampleRate, int newBufferSize)
+    {
+        close();
+        lastError = String::empty;
+
+        if (settings.inputFile != File::nonexistent)
+        {
+            reader = formatManager.createReaderFor (settings.inputFile);
+
+            if (reader == nullptr || reader->sampleRate <= 0)
+            {
+                reader = nullptr;
+                lastError = "Couldn't read the input file";
+                return lastError;
+            }
+
+            if (newSampleRate <= 0)
+                newSampleRate = reader->sampleRate;
+        }
+
+        sampleRate = newSampleRate > 0 ? newSampleRate : 44100.0;
+        bufferSize = newBufferSize > 0 ? newBufferSize : getDefaultBufferSize();
+        bitDepth = 32;
+
+        activeInputChans = inputChannels;
+        activeInputChans.setRange (settings.numInputChannels, activeInputChans.getHighestBit() + 1, false);
+        activeOutputChans = outputChannels;
+        activeOutputChans.setRange (settings.numOutputChannels, activeOutputChans.getHighestBit() + 1, false);
+
+        inputBuffer.setSize (jmax (1, activeInputChans.getHighestBit() + 1), bufferSize);
+        inputBuffer.clear();
+        outputBuffer.setSize (jmax (1, activeOutputChans.getHighestBit() + 1), bufferSize);
+        outputBuffer.clear();
+
+        inputChannelData.clear();
+        outputChannelData.clear();
+
+        for (int i = 0; i <= activeInputChans.getHighestBit(); ++i)
+            if (activeInputChans[i])
+                inputChannelData.add (inputBuffer.getSampleData (i));
+
+        for (int i = 0; i <= activeOutputChans.getHighestBit(); ++i)
+            if (activeOutputChans[i])
+                outputChannelData.add (outputBuffer.getSampleData (i));
+
+        if (settings.outputFile != File::nonexistent && outputChannelData.size() > 0)
+        {
+            lastError = createWriter();
+
+            if (lastError.isNotEmpty())
+            {
+                reader = nullptr;
+                return lastError;
+            }
+        }
+
+        if (reader != nullptr)
+        {
+            inputSource = new InputFileSource (*reader, inputBuffer.getNumChannels(), settings.loopInputFile);
+
+            if (reader->sampleRate != sampleRate)
+            {
+                resampler = new ResamplingAudioSource (inputSource, false, inputBuffer.getNumChannels());
+                resampler->setResamplingRatio (reader->sampleRate / sampleRate);
+                resampler->prepareToPlay (bufferSize, sampleRate);
+            }
+        }
+
+        isOpen_ = true;
+        return lastError;
+    }
+
+    void close()
+    {
+        stop();
+
+        threadedWriter = nullptr;
+        writerThread.stopThread (5000);
+        writer = nullptr;
+        resampler = nullptr;
+        inputSource = nullptr;
+        reader = nullptr;
+        isOpen_ = false;
+    }
+
+    bool isOpen()                           { return isOpen_; }
+    bool isPlaying()                        { return callback != nullptr && isThreadRunning(); }
+    String getLastError()                   { return lastError; }
+
+    int getCurrentBufferSizeSamples()       { return bufferSize; }
+    double getCurrentSampleRate()           { return sampleRate; }
+    int getCurrentBitDepth()                { return bitDepth; }
+
+    BigInteger getActiveOutputChannels() const    { return activeOutputChans; }
+    BigInteger getActiveInputChannels() const     { return activeInputChans; }
+
+    int getOutputLatencyInSamples()         { return 0; }
+    int getInputLatencyInSamples()          { return 0; }
+    int getXRunCount() const noexcept       { return numXRuns.get(); }
+
+    //==============================================================================
+    void start (AudioIODeviceCallback* newCallback)
+    {
+        if (isOpen_ && newCallback != nullptr && callback == nullptr)
+        {
+            newCallback->audioDeviceAboutToStart (this);
+
+            {
+                const ScopedLock sl (callbackLock);
+                callback = newCallback;
+            }
+
+            startThread (9);
+        }
+    }
+
+    void stop()
+    {
+        stopThread (5000);
+
+        AudioIODeviceCallback* const oldCallback = callback;
+
+        {
+            const ScopedLock sl (callbackLock);
+            callback = nullptr;
+        }
+
+        if (oldCallback != nullptr)
+            oldCallback->audioDeviceStopped();
+    }
+
+private:
+    //==============================================================================
+    // Reads the input file, looping it or padding its end with silence. The channel
+    // pointers that the reader needs are allocated up-front, so that nothing has to be
+    // allocated on the device's thread.
+    class InputFileSource  : public AudioSource
+    {
+    public:
+        InputFileSource (AudioFormatReader& reader_, const int numChannels_, const bool looping_)
+            : reader (reader_),
+              numChannels (numChannels_),
+              channels ((size_t) numChannels_),
+              position (0),
+              looping (looping_)
+        {
+        }
+
+        void prepareToPlay (int, double)    {}
+        void releaseResources()             {}
+
+        bool hasFinished() const noexcept
+        {
+            return position >= reader.lengthInSamples && ! (looping && reader.lengthInSamples > 0);
+        }
+
+        void getNextAudioBlock (const AudioSourceChannelInfo& info)
+        {
+            const int64 fileLength = reader.lengthInSamples;
+            int numDone = 0;
+
+            while (numDone < info.numSamples)
+            {
+                if (position >= fileLength)
+                {
+                    if (! looping || fileLength <= 0)
+                    {
+                        // (the last block is padded with silence)
+                        info.buffer->clear (info.startSample + numDone, info.numSamples - numDone);
+                        break;
+                    }
+
+                    position = 0;
+                }
+
+                const int numToRead = (int) jmin ((int64) (info.numSamples - numDone), fileLength - position);
+                const int startSample = info.startSample + numDone;
+
+                for (int i = 0; i < numChannels; ++i)
+                    channels[i] = reinterpret_cast<int*> (info.buffer->getSampleData (i, startSample));
+
+                reader.read (channels, numChannels, position, numToRead, true);
+
+                if (! reader.usesFloatingPointData)
+                {
+                    const float multiplier = 1.0f / 0x7fffffff;
+
+                    for (int i = 0; i < numChannels; ++i)
+                    {
+                        float* const d = info.buffer->getSampleData (i, startSample);
+
+                        for (int j = 0; j < numToRead; ++j)
+                            d[j] = *reinterpret_cast<int*> (d + j) * multiplier;
+                    }
+                }
+
+                position += numToRead;
+                numDone += numToRead;
+            }
+        }
+
+    private:
+        AudioFormatReader& reader;
+        const int numChannels;
+        HeapBlock<int*> channels;
+        int64 position;
+        const bool looping;
+
+        JUCE_DECLARE_NON_COPYABLE (InputFileSource);
+    };
+
+    //==============================================================================
+    const FileAudioIODeviceType::DeviceSettings settings;
+    double sampleRate;
+    int bufferSize, bitDepth;
+    bool isOpen_;
+    String lastError;
+    BigInteger activeInputChans, activeOutputChans;
+
+    CriticalSection callbackLock;
+    AudioIODeviceCallback* callback;
+    Atomic<int> numXRuns;
+
+    AudioFormatManager formatManager;
+    ScopedPointer<AudioFormatReader> reader;
+    ScopedPointer<InputFileSource> inputSource;
+    ScopedPointer<ResamplingAudioSource> resampler;
+    ScopedPointer<AudioFormatWriter> writer;
+    ScopedPointer<AudioFormatWriter::ThreadedWriter> threadedWriter;
+
+    AudioSampleBuffer inputBuffer, outputBuffer;
+    Array<float*> inputChannelData, outputChannelData;
+    TimeSliceThread writerThread;
+
+    //==============================================================================
+    static StringArray getChannelNames (const String& prefix, const int numChannels)
+    {
+        StringArray names;
+
+        for (int i = 0; i < numChannels; ++i)
+            names.add (prefix + " " + String (i + 1));
+
+        return names;
+    }
+
+    String createWriter()
+    {
+        AudioFormat* const format = formatManager.findFormatForFileExtension (settings.outputFile.getFileExtension());
+
+        if (format == nullptr)
+            return "Unknown output file format";
+
+        settings.outputFile.deleteFile();
+        ScopedPointer<FileOutputStream> out (settings.outputFile.createOutputStream());
+
+        if (out == nullptr)
+            return "Couldn't create the output file";
+
+        writer = format->createWriterFor (out, sampleRate, (unsigned int) outputChannelData.size(),
+                                          24, StringPairArray(), 0);
+
+        if (writer == nullptr)
+            return "Couldn't create the output file";
+
+        out.release();
+        bitDepth = writer->getBitsPerSample();
+
+        // In realtime mode, the file is written by a background thread so that the disk
+        // can't hold up the callbacks. When running flat-out, there's nothing to hold up,
+        // and a FIFO would just overflow, so it's written directly.
+        if (settings.runInRealtime)
+        {
+            writerThread.startThread();
+            threadedWriter = new AudioFormatWriter::ThreadedWriter (writer.release(), writerThread,
+                                                                    jmax (bufferSize * 4, (int) sampleRate * 2));
+        }
+
+        return String::empty;
+    }
+
+    //==============================================================================
+    void run()
+    {
+        const int64 ticksPerSecond = Time::getHighResolutionTicksPerSecond();
+        const double ticksPerBlock = ticksPerSecond * bufferSize / sampleRate;
+        const int64 startTime = Time::getHighResolutionTicks();
+        double nextBlockTime = 0; // (in ticks, relative to startTime)
+
+        while (! threadShouldExit())
+        {
+            if (! readInput())
+                break;
+
+            {
+                const ScopedLock sl (callbackLock);
+
+                if (callback != nullptr)
+                    callback->audioDeviceIOCallback ((const float**) inputChannelData.getRawDataPointer(),
+                                                     inputChannelData.size(),
+                                                     outputChannelData.getRawDataPointer(),
+                                                     outputChannelData.size(),
+                                                     bufferSize);
+                else
+                    outputBuffer.clear();
+            }
+
+            writeOutput();
+
+            if (settings.runInRealtime)
+            {
+                nextBlockTime += ticksPerBlock;
+                const int64 now = Time::getHighResolutionTicks() - startTime;
+
+                if (now > nextBlockTime + ticksPerBlock)
+                {
+                    ++numXRuns;
+                    nextBlockTime = (double) now;
+                }
+                else
+                {
+                    waitUntil (startTime + (int64) nextBlockTime, ticksPerSecond);
+                }
+            }
+        }
+    }
+
+    void waitUntil (const int64 targetTime, const int64 ticksPerSecond)
+    {
+        // sleep for as much of the time as possible, then yield for the last millisecond or two,
+        // as the thread's timer probably isn't accurate enough for short buffers
+        for (;;)
+        {
+            const int64 ticksToWait = targetTime - Time::getHighResolutionTicks();
+
+            if (ticksToWait <= 0 || threadShouldExit())
+                break;
+
+            const int msToWait = (int) (ticksToWait * 1000 / ticksPerSecond);
+
+            if (msToWait > 2)
+                wait (msToWait - 2);
+            else
+                Thread::yield();
+        }
+    }
+
+    bool readInput()
+    {
+        if (inputSource == nullptr || inputChannelData.size() == 0)
+            return true;
+
+        if (inputSource->hasFinished())
+            return false;
+
+        const AudioSourceChannelInfo info (&inputBuffer, 0, bufferSize);
+
+        if (resampler != nullptr)
+            resampler->getNextAudioBlock (info);
+        else
+            inputSource->getNextAudioBlock (info);
+
+        return true;
+    }
+
+    void writeOutput()
+    {
+        if (threadedWriter != nullptr)
+        {
+            if (! threadedWriter->write ((const float**) outputChannelData.getRawDataPointer(), bufferSize))
+                ++numXRuns;  // (the disk isn't keeping up)
+        }
+        else if (writer != nullptr)
+        {
+            const AudioSampleBuffer buffer (outputChannelData.getRawDataPointer(), outputChannelData.size(), bufferSize);
+            writer->writeFromAudioSampleBuffer (buffer, 0, bufferSize);
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FileAudioIODevice);
+};
+
+//==============================================================================
+FileAudioIODeviceType::DeviceSettings::DeviceSettings()
+    : name ("Null Device"),
+      loopInputFile (true),
+      numInputChannels (2),
+      numOutputChannels (2),
+      runInRealtime (true)
+{
+}
+
+FileAudioIODeviceType::FileAudioIODeviceType()
+    : AudioIODeviceType ("File")
+{
+    devices.add (new DeviceSettings());
+}
+
+FileAudioIODeviceType::~FileAudioIODeviceType()
+{
+}
+
+void FileAudioIODeviceType::addDevice (const DeviceSettings& settings)
+{
+    const int index = indexOfDevice (settings.name);
+
+    if (index >= 0)
+        *devices.getUnchecked (index) = settings;
+    else
+        devices.add (new DeviceSettings (settings));
+
+    callDeviceChangeListeners();
+}
+
+int FileAudioIODeviceType::indexOfDevice (const String& name) const
+{
+    for (int i = 0; i < devices.size(); ++i)
+        if (devices.getUnchecked(i)->name == name)
+            return i;
+
+    return -1;
+}
+
+//==============================================================================
+void FileAudioIODeviceType::scanForDevices()
+{
+}
+
+StringArray FileAudioIODeviceType::getDeviceNames (bool /*wantInputNames*/) const
+{
+    StringArray names;
+
+    for (int i = 0; i < devices.size(); ++i)
+        names.add (devices.getUnchecked(i)->name);
+
+    return names;
+}
+
+int FileAudioIODeviceType::getDefaultDeviceIndex (bool /*forInput*/) const
+{
+    return 0;
+}
+
+int FileAudioIODeviceType::getIndexOfDevice (AudioIODevice* device, bool /*asInput*/) const
+{
+    return dynamic_cast <FileAudioIODevice*> (device) != nullptr ? indexOfDevice (device->getName()) : -1;
+}
+
+bool FileAudioIODeviceType::hasSeparateInputsAndOutputs() const
+{
+    return false;
+}
+
+AudioIODevice* FileAudioIODeviceType::createDevice (const String& outputDeviceName,
+                                                    const String& inputDeviceName)
+{
+    const int index = indexOfDevice (outputDeviceName.isNotEmpty() ? outputDeviceName
+                                                                   : inputDeviceName);
+
+    return index >= 0 ? new FileAudioIODevice (*devices.getUnchecked (index)) : nullptr;
+}
@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_FILEAUDIOIODEVICETYPE_JUCEHEADER__
+#define __JUCE_FILEAUDIOIODEVICETYPE_JUCEHEADER__
+
+#include "juce_AudioIODeviceType.h"
+
+
+//==============================================================================
+/**
+    An AudioIODeviceType whose devices read and write audio files instead of talking
+    to a sound card.
+
+    Each device runs its callbacks on its own high-priority thread, either paced at the
+    speed that a real device would run at, or as fast as the callback can go. Its input
+    comes from an audio file (or is silent), and its output is written to an audio file
+    (or discarded).
+
+    This makes it possible to run a complete audio app on a machine that has no sound
+    card, e.g. to benchmark or test the whole callback path. To use it with an
+    AudioDeviceManager, pass it to AudioDeviceManager::addAudioDeviceType(), e.g.
+    @code
+    FileAudioIODeviceType* type = new FileAudioIODeviceType();
+
+    FileAudioIODeviceType::DeviceSettings settings;
+    settings.name = "Test Input";
+    settings.inputFile = File ("~/test.wav");
+    settings.outputFile = File ("~/result.wav");
+    settings.runInRealtime = false;
+    type->addDevice (settings);
+
+    deviceManager.addAudioDeviceType (type);
+    deviceManager.setCurrentAudioDeviceType (type->getTypeName(), true);
+    @endcode
+
+    A device called "Null Device", which runs in realtime with two silent inputs and two
+    discarded outputs, is always available.
+
+    @see AudioDeviceManager::addAudioDeviceType
+*/
+class JUCE_API  FileAudioIODeviceType  : public AudioIODeviceType
+{
+public:
+    //==============================================================================
+    /** Creates the device type, which will initially just contain the "Null Device". */
+    FileAudioIODeviceType();
+
+    /** Destructor. */
+    ~FileAudioIODeviceType();
+
+    //==============================================================================
+    /**
+        Describes one of the devices that a FileAudioIODeviceType provides.
+        @see FileAudioIODeviceType::addDevice
+    */
+    struct JUCE_API  DeviceSettings
+    {
+        /** Creates a DeviceSettings object for a realtime device with two silent inputs
+            and two discarded outputs.
+        */
+        DeviceSettings();
+
+        /** The name of the device. */
+        String name;
+
+        /** The file to read the device's input from.
+
+            If this is File::nonexistent, the input channels are silent. If the file's sample
+            rate isn't the one that the device is opened with, it's resampled to match. If the
+            file has fewer channels than the device, its channels are repeated.
+        */
+        File inputFile;
+
+        /** If true, the input file is played in a loop. If false, the device stops when it
+            reaches the end of the input file.
+        */
+        bool loopInputFile;
+
+        /** The file to write the device's active output channels to.
+
+            Its format is chosen from the file's extension, and any existing file is replaced.
+            If this is File::nonexistent, the output is discarded.
+        */
+        File outputFile;
+
+        /** The number of input and output channels that the device has. */
+        int numInputChannels, numOutputChannels;
+
+        /** If true, the callbacks are paced to run at the speed a real device would. If it
+            falls behind by more than a block, the device counts an xrun and catches up.
+            If false, each callback is made as soon as the previous one has finished.
+        */
+        bool runInRealtime;
+    };
+
+    /** Adds a device to the list, replacing any existing device with the same name. */
+    void addDevice (const DeviceSettings& settings);
+
+    //==============================================================================
+    /** @internal */
+    void scanForDevices();
+    /** @internal */
+    StringArray getDeviceNames (bool wantInputNames) const;
+    /** @internal */
+    int getDefaultDeviceIndex (bool forInput) const;
+    /** @internal */
+    int getIndexOfDevice (AudioIODevice* device, bool asInput) const;
+    /** @internal */
+    bool hasSeparateInputsAndOutputs() const;
+    /** @internal */
+    AudioIODevice* createDevice (const String& outputDeviceName, const String& inputDeviceName);
+
+private:
+    //==============================================================================
+    OwnedArray<DeviceSettings> devices;
+
+    int indexOfDevice (const String& name) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FileAudioIODeviceType);
+};
+
+
+#endif   // __JUCE_FILEAUDIOIODEVICETYPE_JUCEHEADER__
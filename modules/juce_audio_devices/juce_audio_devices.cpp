@@ -141,9 +141,11 @@ namespace juce
 {
 
 // START_AUTOINCLUDE audio_io/*.cpp, midi_io/*.cpp, audio_cd/*.cpp, sources/*.cpp
+#include "audio_io/juce_AudioCallbackTimingStats.cpp"
 #include "audio_io/juce_AudioDeviceManager.cpp"
 #include "audio_io/juce_AudioIODevice.cpp"
 #include "audio_io/juce_AudioIODeviceType.cpp"
+#include "audio_io/juce_FileAudioIODeviceType.cpp"
 #include "midi_io/juce_MidiMessageCollector.cpp"
 #include "midi_io/juce_MidiOutput.cpp"
 #include "audio_cd/juce_AudioCDReader.cpp"
@@ -64,6 +64,15 @@
  #define JUCE_ALSA 1
 #endif
 
+/** Config: JUCE_ALSA_REALTIME_SCHEDULING
+    If enabled, the ALSA audio thread will try to switch itself to SCHED_FIFO and lock the
+    process's memory, so that small buffer sizes can run without dropouts. For this to work,
+    the user's rtprio and memlock limits must allow it.
+*/
+#ifndef JUCE_ALSA_REALTIME_SCHEDULING
+ #define JUCE_ALSA_REALTIME_SCHEDULING 0
+#endif
+
 /** Config: JUCE_JACK
     Enables JACK audio devices (Linux only).
 */
@@ -102,6 +111,9 @@ namespace juce
 {
 
 // START_AUTOINCLUDE audio_io, midi_io, sources, audio_cd
+#ifndef __JUCE_AUDIOCALLBACKTIMINGSTATS_JUCEHEADER__
+ #include "audio_io/juce_AudioCallbackTimingStats.h"
+#endif
 #ifndef __JUCE_AUDIODEVICEMANAGER_JUCEHEADER__
  #include "audio_io/juce_AudioDeviceManager.h"
 #endif
@@ -111,6 +123,9 @@ namespace juce
 #ifndef __JUCE_AUDIOIODEVICETYPE_JUCEHEADER__
  #include "audio_io/juce_AudioIODeviceType.h"
 #endif
+#ifndef __JUCE_FILEAUDIOIODEVICETYPE_JUCEHEADER__
+ #include "audio_io/juce_FileAudioIODeviceType.h"
+#endif
 #ifndef __JUCE_MIDIINPUT_JUCEHEADER__
  #include "midi_io/juce_MidiInput.h"
 #endif
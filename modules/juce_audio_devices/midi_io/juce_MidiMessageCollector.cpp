@@ -23,10 +23,45 @@
   ==============================================================================
 */
 
-MidiMessageCollector::MidiMessageCollector()
+namespace MidiCollectorHelpers
+{
+    struct MessageHeader
+    {
+        double timeStamp;
+        int numBytes;
+    };
+
+    // copies part of a message into the two blocks returned by AbstractFifo::prepareToWrite()
+    void copyToFifo (uint8* const fifoData, const int start1, const int size1, const int start2,
+                     int offset, const void* source, int numBytes) noexcept
+    {
+        const uint8* src = static_cast <const uint8*> (source);
+
+        if (offset < size1)
+        {
+            const int num = jmin (numBytes, size1 - offset);
+            memcpy (fifoData + start1 + offset, src, (size_t) num);
+            src += num;
+            offset += num;
+            numBytes -= num;
+        }
+
+        if (numBytes > 0)
+            memcpy (fifoData + start2 + (offset - size1), src, (size_t) numBytes);
+    }
+}
+
+MidiMessageCollector::MidiMessageCollector (const int queueSizeBytes, const bool allowMultipleProducers_)
     : lastCallbackTime (0),
+      fifo (queueSizeBytes),
+      fifoData ((size_t) queueSizeBytes),
+      messageData ((size_t) queueSizeBytes),
+      allowMultipleProducers (allowMultipleProducers_),
       sampleRate (44100.0001)
 {
+    // the buffer needs to be at least big enough to hold the messages that arrive
+    // during one audio callback..
+    incomingMessages.ensureSize ((size_t) queueSizeBytes);
 }
 
 MidiMessageCollector::~MidiMessageCollector()
@@ -38,9 +73,13 @@ void MidiMessageCollector::reset (const double sampleRate_)
 {
     jassert (sampleRate_ > 0);
 
-    const ScopedLock sl (midiCallbackLock);
+    // (the fifo is emptied by reading everything out of it, because only the
+    // producers may move its write position)
+    readMessagesFromFifo();
+
     sampleRate = sampleRate_;
     incomingMessages.clear();
+    numDroppedMessages = 0;
     lastCallbackTime = Time::getMillisecondCounterHiRes();
 }
 
@@ -53,17 +92,78 @@ void MidiMessageCollector::addMessageToQueue (const MidiMessage& message)
     // for details of what the number should be.
     jassert (message.getTimeStamp() != 0);
 
-    const ScopedLock sl (midiCallbackLock);
+    if (allowMultipleProducers)
+    {
+        const SpinLock::ScopedLockType sl (producerLock);
+        addMessageToFifo (message);
+    }
+    else
+    {
+        addMessageToFifo (message);
+    }
+}
 
-    const int sampleNumber
-        = (int) ((message.getTimeStamp() - 0.001 * lastCallbackTime) * sampleRate);
+void MidiMessageCollector::addMessageToFifo (const MidiMessage& message)
+{
+    using namespace MidiCollectorHelpers;
+
+    MessageHeader header;
+    header.timeStamp = message.getTimeStamp();
+    header.numBytes = message.getRawDataSize();
+
+    const int totalSize = (int) sizeof (header) + header.numBytes;
+
+    // (the fifo always keeps one byte free to tell a full buffer from an empty one)
+    if (fifo.getFreeSpace() <= totalSize)
+    {
+        ++numDroppedMessages;
+        return;
+    }
 
-    incomingMessages.addEvent (message, sampleNumber);
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (totalSize, start1, size1, start2, size2);
+    jassert (size1 + size2 == totalSize);
 
-    // if the messages don't get used for over a second, we'd better
-    // get rid of any old ones to avoid the queue getting too big
-    if (sampleNumber > sampleRate)
-        incomingMessages.clear (0, sampleNumber - (int) sampleRate);
+    copyToFifo (fifoData, start1, size1, start2, 0, &header, (int) sizeof (header));
+    copyToFifo (fifoData, start1, size1, start2, (int) sizeof (header), message.getRawData(), header.numBytes);
+
+    fifo.finishedWrite (totalSize);
+}
+
+void MidiMessageCollector::readFromFifo (void* const dest, const int numBytes)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (numBytes, start1, size1, start2, size2);
+    jassert (size1 + size2 == numBytes);
+
+    memcpy (dest, fifoData + start1, (size_t) size1);
+
+    if (size2 > 0)
+        memcpy (static_cast <uint8*> (dest) + size1, fifoData + start2, (size_t) size2);
+
+    fifo.finishedRead (size1 + size2);
+}
+
+void MidiMessageCollector::readMessagesFromFifo()
+{
+    using namespace MidiCollectorHelpers;
+
+    while (fifo.getNumReady() >= (int) sizeof (MessageHeader))
+    {
+        MessageHeader header;
+        readFromFifo (&header, (int) sizeof (header));
+
+        const int sampleNumber = (int) ((header.timeStamp - 0.001 * lastCallbackTime) * sampleRate);
+
+        // (any message fits in here, because it's as big as the fifo)
+        readFromFifo (messageData, header.numBytes);
+        incomingMessages.addEvent (messageData, header.numBytes, sampleNumber);
+
+        // if the messages don't get used for over a second, we'd better
+        // get rid of any old ones to avoid the queue getting too big
+        if (sampleNumber > sampleRate)
+            incomingMessages.clear (0, sampleNumber - (int) sampleRate);
+    }
 }
 
 void MidiMessageCollector::removeNextBlockOfMessages (MidiBuffer& destBuffer,
@@ -72,10 +172,10 @@ void MidiMessageCollector::removeNextBlockOfMessages (MidiBuffer& destBuffer,
     // you need to call reset() to set the correct sample rate before using this object
     jassert (sampleRate != 44100.0001);
 
+    readMessagesFromFifo();
+
     const double timeNow = Time::getMillisecondCounterHiRes();
     const double msElapsed = timeNow - lastCallbackTime;
-
-    const ScopedLock sl (midiCallbackLock);
     lastCallbackTime = timeNow;
 
     if (! incomingMessages.isEmpty())
@@ -151,3 +251,137 @@ void MidiMessageCollector::handleIncomingMidiMessage (MidiInput*, const MidiMess
 {
     addMessageToQueue (message);
 }
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class MidiMessageCollectorTests  : public UnitTest
+{
+public:
+    MidiMessageCollectorTests() : UnitTest ("MidiMessageCollector") {}
+
+    static MidiMessage createNote (const int noteNumber, const double timeStamp)
+    {
+        MidiMessage m (MidiMessage::noteOn (1, noteNumber, 0.5f));
+        m.setTimeStamp (timeStamp);
+        return m;
+    }
+
+    void runTest()
+    {
+        // (at this rate, one sample is one millisecond)
+        const double sampleRate = 1000.0;
+
+        beginTest ("Ordering and sample positions");
+        {
+            MidiMessageCollector collector;
+            collector.reset (sampleRate);
+            const double startTime = Time::getMillisecondCounterHiRes() * 0.001;
+
+            // (each time stamp is half a millisecond past a sample boundary, so that the
+            // time taken by reset() can't move the message into a different sample)
+            for (int i = 0; i < 20; ++i)
+                collector.addMessageToQueue (createNote (i, startTime + (i * 5 + 0.5) * 0.001));
+
+            Thread::sleep (200);
+
+            MidiBuffer buffer;
+            collector.removeNextBlockOfMessages (buffer, 1000);
+
+            MidiBuffer::Iterator iter (buffer);
+            MidiMessage m (0xf8);
+            int position, firstPosition = 0, num = 0;
+
+            while (iter.getNextEvent (m, position))
+            {
+                if (num == 0)
+                    firstPosition = position;
+
+                expectEquals (m.getNoteNumber(), num);
+                expectEquals (position - firstPosition, num * 5);
+                ++num;
+            }
+
+            expectEquals (num, 20);
+
+            // the messages are placed at the end of the block, at their age when it was collected
+            expect (firstPosition >= 500 && firstPosition <= 800);
+        }
+
+        beginTest ("Big sysex messages");
+        {
+            MidiMessageCollector collector (4096);
+            collector.reset (sampleRate);
+
+            uint8 sysexData [3000];
+            for (int i = 0; i < numElementsInArray (sysexData); ++i)
+                sysexData[i] = (uint8) (i & 0x7f);
+
+            MidiMessage sysex (MidiMessage::createSysExMessage (sysexData, numElementsInArray (sysexData)));
+            sysex.setTimeStamp (Time::getMillisecondCounterHiRes() * 0.001);
+            collector.addMessageToQueue (sysex);
+
+            MidiBuffer buffer;
+            collector.removeNextBlockOfMessages (buffer, 512);
+
+            MidiBuffer::Iterator iter (buffer);
+            MidiMessage m (0xf8);
+            int position;
+
+            expect (iter.getNextEvent (m, position));
+            expectEquals (m.getRawDataSize(), sysex.getRawDataSize());
+            expect (memcmp (m.getRawData(), sysex.getRawData(), (size_t) sysex.getRawDataSize()) == 0);
+            expect (! iter.getNextEvent (m, position));
+        }
+
+        beginTest ("Dropped messages");
+        {
+            MidiMessageCollector collector (256, false);
+            collector.reset (sampleRate);
+            const double startTime = Time::getMillisecondCounterHiRes() * 0.001;
+
+            for (int i = 0; i < 100; ++i)
+                collector.addMessageToQueue (createNote (i % 128, startTime));
+
+            MidiBuffer buffer;
+            collector.removeNextBlockOfMessages (buffer, 512);
+
+            const int numReceived = buffer.getNumEvents();
+            expect (numReceived > 0 && numReceived < 100);
+            expectEquals (collector.getNumDroppedMessages(), 100 - numReceived);
+
+            // once the audio thread has emptied the fifo, there's room again..
+            collector.addMessageToQueue (createNote (1, startTime));
+            expectEquals (collector.getNumDroppedMessages(), 100 - numReceived);
+
+            collector.reset (sampleRate);
+            expectEquals (collector.getNumDroppedMessages(), 0);
+        }
+
+        beginTest ("Stale messages");
+        {
+            MidiMessageCollector collector;
+            collector.reset (sampleRate);
+            const double startTime = Time::getMillisecondCounterHiRes() * 0.001;
+
+            collector.addMessageToQueue (createNote (1, startTime + 0.0005));
+            collector.addMessageToQueue (createNote (2, startTime + 1.5005));
+
+            MidiBuffer buffer;
+            collector.removeNextBlockOfMessages (buffer, 512);
+
+            MidiBuffer::Iterator iter (buffer);
+            MidiMessage m (0xf8);
+            int position;
+
+            expect (iter.getNextEvent (m, position));
+            expectEquals (m.getNoteNumber(), 2);
+            expect (! iter.getNextEvent (m, position));
+        }
+    }
+};
+
+static MidiMessageCollectorTests midiMessageCollectorTests;
+
+#endif
@@ -37,6 +37,12 @@
     The class can also be used as either a MidiKeyboardStateListener or a MidiInputCallback
     so it can easily use a midi input or keyboard component as its source.
 
+    The messages are passed to the audio thread through a lock-free FIFO, so a burst of
+    incoming messages can never block the audio callback. If the FIFO fills up, any
+    further messages are dropped until there's room for them, and counted - see
+    getNumDroppedMessages(). Messages that are more than a second older than the newest
+    one when the audio thread collects them are thrown away, too.
+
     @see MidiMessage, MidiInput
 */
 class JUCE_API  MidiMessageCollector    : public MidiKeyboardStateListener,
@@ -44,8 +50,20 @@ class JUCE_API  MidiMessageCollector    : public MidiKeyboardStateListener,
 {
 public:
     //==============================================================================
-    /** Creates a MidiMessageCollector. */
-    MidiMessageCollector();
+    /** Creates a MidiMessageCollector.
+
+        @param queueSizeBytes           the size of the FIFO that holds messages until the
+                                        audio callback collects them. Each message takes up
+                                        its own size plus about 16 bytes.
+        @param allowMultipleProducers   if true, addMessageToQueue() can be called by several
+                                        threads at once, e.g. by a number of MidiInputs and a
+                                        keyboard component. The producers serialise themselves
+                                        with a spin-lock, but the audio thread never waits for
+                                        them. If false, only one thread may ever add messages,
+                                        and adding them is wait-free.
+    */
+    explicit MidiMessageCollector (int queueSizeBytes = 32768,
+                                   bool allowMultipleProducers = true);
 
     /** Destructor. */
     ~MidiMessageCollector();
@@ -54,7 +72,8 @@ public:
     /** Clears any messages from the queue.
 
         You need to call this method before starting to use the collector, so that
-        it knows the correct sample rate to use.
+        it knows the correct sample rate to use. It must be called by the same thread
+        that calls removeNextBlockOfMessages(), or while that isn't being called.
     */
     void reset (double sampleRate);
 
@@ -64,7 +83,7 @@ public:
         of the block returned by the next call to removeNextBlockOfMessages().
 
         This method is fully thread-safe when overlapping calls are made with
-        removeNextBlockOfMessages().
+        removeNextBlockOfMessages(). If the queue is full, the message is dropped.
     */
     void addMessageToQueue (const MidiMessage& message);
 
@@ -78,10 +97,15 @@ public:
         midi event positions.
 
         This method is fully thread-safe when overlapping calls are made with
-        addMessageToQueue().
+        addMessageToQueue(), and never blocks.
     */
     void removeNextBlockOfMessages (MidiBuffer& destBuffer, int numSamples);
 
+    /** Returns the number of messages that have been dropped because the queue was full
+        since reset() was last called.
+    */
+    int getNumDroppedMessages() const noexcept          { return numDroppedMessages.get(); }
+
 
     //==============================================================================
     /** @internal */
@@ -94,10 +118,18 @@ public:
 private:
     //==============================================================================
     double lastCallbackTime;
-    CriticalSection midiCallbackLock;
+    AbstractFifo fifo;
+    HeapBlock<uint8> fifoData, messageData;
+    SpinLock producerLock;
+    const bool allowMultipleProducers;
+    Atomic<int> numDroppedMessages;
     MidiBuffer incomingMessages;
     double sampleRate;
 
+    void addMessageToFifo (const MidiMessage&);
+    void readMessagesFromFifo();
+    void readFromFifo (void* dest, int numBytes);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiMessageCollector);
 };
 
@@ -117,8 +117,12 @@ public:
           bitDepth (16),
           numChannelsRunning (0),
           latency (0),
+          numXRuns (0),
           isInput (forInput),
-          isInterleaved (true)
+          isInterleaved (true),
+          isMMap (false),
+          format (SND_PCM_FORMAT_UNKNOWN),
+          numPollDescriptors (0)
     {
         failed (snd_pcm_open (&handle, deviceID.toUTF8(),
                               forInput ? SND_PCM_STREAM_CAPTURE : SND_PCM_STREAM_PLAYBACK,
@@ -142,16 +146,26 @@ public:
         if (failed (snd_pcm_hw_params_any (handle, hwParams)))
             return false;
 
-        if (snd_pcm_hw_params_set_access (handle, hwParams, SND_PCM_ACCESS_RW_NONINTERLEAVED) >= 0)
-            isInterleaved = false;
-        else if (snd_pcm_hw_params_set_access (handle, hwParams, SND_PCM_ACCESS_RW_INTERLEAVED) >= 0)
-            isInterleaved = true;
-        else
+        // The mmap modes are preferred, because they let the samples be converted straight
+        // into the hardware's buffer..
+        const snd_pcm_access_t accessTypesToTry[] = { SND_PCM_ACCESS_MMAP_NONINTERLEAVED,
+                                                      SND_PCM_ACCESS_MMAP_INTERLEAVED,
+                                                      SND_PCM_ACCESS_RW_NONINTERLEAVED,
+                                                      SND_PCM_ACCESS_RW_INTERLEAVED };
+        int accessType = 0;
+
+        while (snd_pcm_hw_params_set_access (handle, hwParams, accessTypesToTry [accessType]) < 0)
         {
-            jassertfalse;
-            return false;
+            if (++accessType >= numElementsInArray (accessTypesToTry))
+            {
+                jassertfalse;
+                return false;
+            }
         }
 
+        isMMap = accessType < 2;
+        isInterleaved = (accessType & 1) != 0;
+
         enum { isFloatBit = 1 << 16, isLittleEndianBit = 1 << 17 };
 
         const int formatsToTry[] = { SND_PCM_FORMAT_FLOAT_LE,   32 | isFloatBit | isLittleEndianBit,
@@ -168,10 +182,11 @@ public:
         {
             if (snd_pcm_hw_params_set_format (handle, hwParams, (_snd_pcm_format) formatsToTry [i]) >= 0)
             {
+                format = (snd_pcm_format_t) formatsToTry [i];
                 bitDepth = formatsToTry [i + 1] & 255;
                 const bool isFloat = (formatsToTry [i + 1] & isFloatBit) != 0;
                 const bool isLittleEndian = (formatsToTry [i + 1] & isLittleEndianBit) != 0;
-                converter = createConverter (isInput, bitDepth, isFloat, isLittleEndian, numChannels);
+                converter = createConverter (isInput, bitDepth, isFloat, isLittleEndian, isInterleaved ? numChannels : 1);
                 break;
             }
         }
@@ -196,7 +211,10 @@ public:
             return false;
         }
 
-        snd_pcm_uframes_t frames = 0;
+        snd_pcm_uframes_t frames = 0, bufferFrames = 0;
+
+        if (failed (snd_pcm_hw_params_get_buffer_size (hwParams, &bufferFrames)))
+            return false;
 
         if (failed (snd_pcm_hw_params_get_period_size (hwParams, &frames, &dir))
              || failed (snd_pcm_hw_params_get_periods (hwParams, &periods, &dir)))
@@ -204,6 +222,8 @@ public:
         else
             latency = frames * (periods - 1); // (this is the method JACK uses to guess the latency..)
 
+        // In mmap mode, the stream is stopped by an xrun so that it can be restarted with
+        // a fresh buffer of silence, rather than carrying on with the pointers out of step.
         snd_pcm_sw_params_t* swParams;
         snd_pcm_sw_params_alloca (&swParams);
         snd_pcm_uframes_t boundary;
@@ -213,7 +233,8 @@ public:
             || failed (snd_pcm_sw_params_set_silence_threshold (handle, swParams, 0))
             || failed (snd_pcm_sw_params_set_silence_size (handle, swParams, boundary))
             || failed (snd_pcm_sw_params_set_start_threshold (handle, swParams, samplesPerPeriod))
-            || failed (snd_pcm_sw_params_set_stop_threshold (handle, swParams, boundary))
+            || failed (snd_pcm_sw_params_set_stop_threshold (handle, swParams, isMMap ? bufferFrames : boundary))
+            || failed (snd_pcm_sw_params_set_avail_min (handle, swParams, samplesPerPeriod))
             || failed (snd_pcm_sw_params (handle, swParams)))
         {
             return false;
@@ -229,14 +250,123 @@ public:
 
         numChannelsRunning = numChannels;
 
+        numPollDescriptors = jmax (0, snd_pcm_poll_descriptors_count (handle));
+        pollDescriptors.calloc ((size_t) numPollDescriptors + 1);
+
+        if (failed (snd_pcm_poll_descriptors (handle, pollDescriptors, (unsigned int) numPollDescriptors)))
+            return false;
+
         return true;
     }
 
+    /** Returns true if start() needs to be called before the device can be used. */
+    bool needsStarting() const
+    {
+        // (in read/write mode, an output stream starts itself when data is written to it)
+        return (isMMap || isInput) && snd_pcm_state (handle) != SND_PCM_STATE_RUNNING;
+    }
+
+    /** Starts the stream running. In mmap mode, the output buffer is filled with silence first. */
+    bool start()
+    {
+        if (! needsStarting())
+            return true;
+
+        if (! isInput)
+        {
+            snd_pcm_sframes_t numToFill = snd_pcm_avail_update (handle);
+
+            if (failed ((int) numToFill))
+                return false;
+
+            while (numToFill > 0)
+            {
+                const snd_pcm_channel_area_t* areas;
+                snd_pcm_uframes_t offset, frames = (snd_pcm_uframes_t) numToFill;
+
+                if (failed (snd_pcm_mmap_begin (handle, &areas, &offset, &frames)))
+                    return false;
+
+                snd_pcm_areas_silence (areas, offset, (unsigned int) numChannelsRunning, frames, format);
+
+                if (failed ((int) snd_pcm_mmap_commit (handle, offset, frames)) || frames == 0)
+                    return false;
+
+                numToFill -= (snd_pcm_sframes_t) frames;
+            }
+        }
+
+        return ! failed (snd_pcm_start (handle));
+    }
+
+    /** Returns the number of frames that can be read or written without blocking, or -1
+        if the device has failed. If there's been an xrun, the stream is prepared again
+        and this returns 0.
+    */
+    int getNumFramesAvailable()
+    {
+        const snd_pcm_sframes_t avail = snd_pcm_avail_update (handle);
+
+        if (avail >= 0)
+            return (int) avail;
+
+        return recoverFromXrun ((int) avail) ? 0 : -1;
+    }
+
+    //==============================================================================
+    int getNumPollDescriptors() const noexcept          { return numPollDescriptors; }
+    const pollfd* getPollDescriptors() const noexcept   { return pollDescriptors; }
+
+    /** Must be given the results of polling this device's descriptors. */
+    bool handlePollResults (pollfd* results)
+    {
+        unsigned short revents = 0;
+        return ! failed (snd_pcm_poll_descriptors_revents (handle, results, (unsigned int) numPollDescriptors, &revents));
+    }
+
     //==============================================================================
     bool writeToOutputDevice (AudioSampleBuffer& outputChannelBuffer, const int numSamples)
     {
         jassert (numChannelsRunning <= outputChannelBuffer.getNumChannels());
         float** const data = outputChannelBuffer.getArrayOfChannels();
+
+        if (isMMap)
+        {
+            int numDone = 0;
+
+            while (numDone < numSamples)
+            {
+                const snd_pcm_channel_area_t* areas;
+                snd_pcm_uframes_t offset, frames;
+                const int numAvailable = getNumFramesAvailable();
+
+                if (numAvailable < 0)
+                    return false;
+
+                frames = (snd_pcm_uframes_t) jmin (numAvailable, numSamples - numDone);
+
+                if (frames == 0)
+                    break; // (if there's no room after an xrun, the rest of the block is dropped)
+
+                const int err = snd_pcm_mmap_begin (handle, &areas, &offset, &frames);
+
+                if (err < 0)
+                    return recoverFromXrun (err);
+
+                for (int i = 0; i < numChannelsRunning; ++i)
+                    converter->convertSamples (getAreaAddress (areas[i], offset), 0, data[i] + numDone, 0, (int) frames);
+
+                const snd_pcm_sframes_t numCommitted = snd_pcm_mmap_commit (handle, offset, frames);
+
+                if (numCommitted < 0 || (snd_pcm_uframes_t) numCommitted != frames)
+                    return recoverFromXrun (numCommitted < 0 ? (int) numCommitted : -EPIPE);
+
+                numDone += (int) frames;
+            }
+
+            return true;
+        }
+
         snd_pcm_sframes_t numDone = 0;
 
         if (isInterleaved)
@@ -260,6 +390,8 @@ public:
         {
             if (numDone == -EPIPE)
             {
+                ++numXRuns;
+
                 if (failed (snd_pcm_prepare (handle)))
                     return false;
             }
@@ -275,6 +407,56 @@ public:
         jassert (numChannelsRunning <= inputChannelBuffer.getNumChannels());
         float** const data = inputChannelBuffer.getArrayOfChannels();
 
+        if (isMMap)
+        {
+            int numDone = 0;
+
+            while (numDone < numSamples)
+            {
+                const snd_pcm_channel_area_t* areas;
+                snd_pcm_uframes_t offset, frames;
+                const int numAvailable = getNumFramesAvailable();
+
+                if (numAvailable < 0)
+                    return false;
+
+                frames = (snd_pcm_uframes_t) jmin (numAvailable, numSamples - numDone);
+
+                if (frames == 0)
+                    break;
+
+                const int err = snd_pcm_mmap_begin (handle, &areas, &offset, &frames);
+
+                if (err < 0)
+                {
+                    if (! recoverFromXrun (err))
+                        return false;
+
+                    break;
+                }
+
+                for (int i = 0; i < numChannelsRunning; ++i)
+                    converter->convertSamples (data[i] + numDone, 0, getAreaAddress (areas[i], offset), 0, (int) frames);
+
+                const snd_pcm_sframes_t numCommitted = snd_pcm_mmap_commit (handle, offset, frames);
+                numDone += (int) frames;
+
+                if (numCommitted < 0 || (snd_pcm_uframes_t) numCommitted != frames)
+                {
+                    if (! recoverFromXrun (numCommitted < 0 ? (int) numCommitted : -EPIPE))
+                        return false;
+
+                    break;
+                }
+            }
+
+            // (after an xrun, whatever couldn't be read is replaced by silence)
+            for (int i = 0; i < numChannelsRunning; ++i)
+                zeromem (data[i] + numDone, sizeof (float) * (size_t) (numSamples - numDone));
+
+            return true;
+        }
+
         if (isInterleaved)
         {
             scratch.ensureSize (sizeof (float) * numSamples * numChannelsRunning, false);
@@ -286,6 +468,8 @@ public:
             {
                 if (num == -EPIPE)
                 {
+                    ++numXRuns;
+
                     if (failed (snd_pcm_prepare (handle)))
                         return false;
                 }
@@ -303,6 +487,9 @@ public:
             if (failed (num) && num != -EPIPE && num != -ESTRPIPE)
                 return false;
 
+            if (num == -EPIPE)
+                ++numXRuns;
+
             for (int i = 0; i < numChannelsRunning; ++i)
                 converter->convertSamples (data[i], data[i], numSamples);
         }
@@ -313,14 +500,30 @@ public:
     //==============================================================================
     snd_pcm_t* handle;
     String error;
-    int bitDepth, numChannelsRunning, latency;
+    int bitDepth, numChannelsRunning, latency, numXRuns;
 
     //==============================================================================
 private:
     const bool isInput;
-    bool isInterleaved;
+    bool isInterleaved, isMMap;
+    snd_pcm_format_t format;
     MemoryBlock scratch;
     ScopedPointer<AudioData::Converter> converter;
+    HeapBlock<pollfd> pollDescriptors;
+    int numPollDescriptors;
+
+    //==============================================================================
+    static void* getAreaAddress (const snd_pcm_channel_area_t& area, const snd_pcm_uframes_t offset) noexcept
+    {
+        return addBytesToPointer (area.addr, (area.first + area.step * offset) / 8);
+    }
+
+    bool recoverFromXrun (const int errorNum)
+    {
+        // this leaves the stream prepared - the thread will restart it with start()
+        ++numXRuns;
+        return ! failed (snd_pcm_recover (handle, errorNum, 1));
+    }
 
     //==============================================================================
     template <class SampleType>
@@ -515,6 +718,10 @@ public:
         if (outputDevice != nullptr && failed (snd_pcm_prepare (outputDevice->handle)))
             return;
 
+        // (this is big enough for both devices' descriptors, so the audio thread only has to fill it in)
+        pollDescriptors.calloc ((size_t) ((inputDevice != nullptr ? inputDevice->getNumPollDescriptors() : 0)
+                                            + (outputDevice != nullptr ? outputDevice->getNumPollDescriptors() : 0) + 1));
+
         startThread (9);
 
         int count = 1000;
@@ -542,6 +749,7 @@ public:
         outputChannelBuffer.setSize (1, 1);
 
         numCallbacks = 0;
+        numXRuns = 0;
     }
 
     void setCallback (AudioIODeviceCallback* const newCallback) noexcept
@@ -552,8 +760,21 @@ public:
 
     void run()
     {
+       #if JUCE_ALSA_REALTIME_SCHEDULING
+        enableRealtimeScheduling();
+       #endif
+
         while (! threadShouldExit())
         {
+            if (! waitForDevices())
+            {
+                DBG ("ALSA: device failure");
+                break;
+            }
+
+            if (threadShouldExit())
+                break;
+
             if (inputDevice != nullptr)
             {
                 if (! inputDevice->readFromInputDevice (inputChannelBuffer, bufferSize))
@@ -563,9 +784,6 @@ public:
                 }
             }
 
-            if (threadShouldExit())
-                break;
-
             {
                 const ScopedLock sl (callbackLock);
                 ++numCallbacks;
@@ -587,19 +805,15 @@ public:
 
             if (outputDevice != nullptr)
             {
-                failed (snd_pcm_wait (outputDevice->handle, 2000));
-
-                if (threadShouldExit())
-                    break;
-
-                failed (snd_pcm_avail_update (outputDevice->handle));
-
                 if (! outputDevice->writeToOutputDevice (outputChannelBuffer, bufferSize))
                 {
                     DBG ("ALSA: write failure");
                     break;
                 }
             }
+
+            numXRuns = (inputDevice != nullptr ? inputDevice->numXRuns : 0)
+                         + (outputDevice != nullptr ? outputDevice->numXRuns : 0);
         }
     }
 
@@ -623,6 +837,7 @@ public:
     Array <int> sampleRates;
     StringArray channelNamesOut, channelNamesIn;
     AudioIODeviceCallback* callback;
+    Atomic<int> numXRuns;
 
 private:
     //==============================================================================
@@ -634,6 +849,7 @@ private:
 
     AudioSampleBuffer inputChannelBuffer, outputChannelBuffer;
     Array<float*> inputChannelDataForCallback, outputChannelDataForCallback;
+    HeapBlock<pollfd> pollDescriptors;
 
     unsigned int minChansOut, maxChansOut;
     unsigned int minChansIn, maxChansIn;
@@ -648,6 +864,95 @@ private:
         return true;
     }
 
+    //==============================================================================
+    /** Blocks until a whole buffer can be read from the input and written to the output,
+        by polling the descriptors of whichever devices aren't ready yet.
+    */
+    bool waitForDevices()
+    {
+        while (! threadShouldExit())
+        {
+            // (the output is started first, because if the devices are linked, starting
+            // the output starts the input too, after its buffer has been filled)
+            if ((outputDevice != nullptr && ! outputDevice->start())
+                 || (inputDevice != nullptr && ! inputDevice->start()))
+                return false;
+
+            int numDescriptors = 0;
+            const int inputDescriptors = addPollDescriptorsIfNotReady (inputDevice, numDescriptors);
+            const int outputDescriptors = addPollDescriptorsIfNotReady (outputDevice, numDescriptors);
+
+            if (inputDescriptors < 0 || outputDescriptors < 0)
+                return false;
+
+            // if either device has just recovered from an xrun, it needs restarting before
+            // it can be used..
+            if ((inputDevice != nullptr && inputDevice->needsStarting())
+                 || (outputDevice != nullptr && outputDevice->needsStarting()))
+                continue;
+
+            if (numDescriptors == 0)
+                return true;
+
+            const int result = poll (pollDescriptors, (nfds_t) numDescriptors, 500);
+
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                return false;
+            }
+
+            if (result > 0)
+            {
+                if (inputDescriptors > 0 && ! inputDevice->handlePollResults (pollDescriptors))
+                    return false;
+
+                if (outputDescriptors > 0 && ! outputDevice->handlePollResults (pollDescriptors + inputDescriptors))
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    /** Adds a device's poll descriptors to the list if it can't yet transfer a whole buffer,
+        and returns the number added, or -1 if the device has failed.
+    */
+    int addPollDescriptorsIfNotReady (ALSADevice* const device, int& numDescriptors)
+    {
+        if (device == nullptr)
+            return 0;
+
+        const int numAvailable = device->getNumFramesAvailable();
+
+        if (numAvailable < 0)
+            return -1;
+
+        if (numAvailable >= bufferSize)
+            return 0;
+
+        const int num = device->getNumPollDescriptors();
+        memcpy (pollDescriptors + numDescriptors, device->getPollDescriptors(), sizeof (pollfd) * (size_t) num);
+        numDescriptors += num;
+        return num;
+    }
+
+   #if JUCE_ALSA_REALTIME_SCHEDULING
+    static void enableRealtimeScheduling()
+    {
+        struct sched_param param;
+        param.sched_priority = jmin (70, sched_get_priority_max (SCHED_FIFO));
+
+        if (pthread_setschedparam (pthread_self(), SCHED_FIFO, &param) != 0)
+            DBG ("ALSA: couldn't switch to SCHED_FIFO - check the user's rtprio limit");
+
+        if (mlockall (MCL_CURRENT | MCL_FUTURE) != 0)
+            DBG ("ALSA: couldn't lock the process's memory - check the user's memlock limit");
+    }
+   #endif
+
     void initialiseRatesAndChannels()
     {
         sampleRates.clear();
@@ -754,6 +1059,7 @@ public:
     bool isOpen()                           { return isOpen_; }
     bool isPlaying()                        { return isStarted && internal.error.isEmpty(); }
     String getLastError()                   { return internal.error; }
+    int getXRunCount() const noexcept       { return internal.numXRuns.get(); }
 
     int getCurrentBufferSizeSamples()       { return internal.bufferSize; }
     double getCurrentSampleRate()           { return internal.sampleRate; }
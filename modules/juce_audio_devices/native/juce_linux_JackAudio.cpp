@@ -63,6 +63,7 @@ JUCE_DECL_JACK_FUNCTION (jack_nframes_t, jack_port_get_total_latency, (jack_clie
 JUCE_DECL_JACK_FUNCTION (jack_port_t* , jack_port_register, (jack_client_t* client, const char* port_name, const char* port_type, unsigned long flags, unsigned long buffer_size), (client, port_name, port_type, flags, buffer_size));
 JUCE_DECL_VOID_JACK_FUNCTION (jack_set_error_function, (void (*func)(const char*)), (func));
 JUCE_DECL_JACK_FUNCTION (int, jack_set_process_callback, (jack_client_t* client, JackProcessCallback process_callback, void* arg), (client, process_callback, arg));
+JUCE_DECL_JACK_FUNCTION (int, jack_set_xrun_callback, (jack_client_t* client, JackXRunCallback xrun_callback, void* arg), (client, xrun_callback, arg));
 JUCE_DECL_JACK_FUNCTION (const char**, jack_get_ports, (jack_client_t* client, const char* port_name_pattern, const char* type_name_pattern, unsigned long flags), (client, port_name_pattern, type_name_pattern, flags));
 JUCE_DECL_JACK_FUNCTION (int, jack_connect, (jack_client_t* client, const char* source_port, const char* destination_port), (client, source_port, destination_port));
 JUCE_DECL_JACK_FUNCTION (const char*, jack_port_name, (const jack_port_t* port), (port));
@@ -213,6 +214,7 @@ public:
         close();
 
         juce::jack_set_process_callback (client, processCallback, this);
+        juce::jack_set_xrun_callback (client, xrunCallback, this);
         juce::jack_on_shutdown (client, shutdownCallback, this);
         juce::jack_activate (client);
         isOpen_ = true;
@@ -276,6 +278,7 @@ public:
         {
             juce::jack_deactivate (client);
             juce::jack_set_process_callback (client, processCallback, 0);
+            juce::jack_set_xrun_callback (client, xrunCallback, 0);
             juce::jack_on_shutdown (client, shutdownCallback, 0);
         }
 
@@ -312,6 +315,7 @@ public:
     double getCurrentSampleRate()           { return getSampleRate (0); }
     int getCurrentBitDepth()                { return 32; }
     String getLastError()                   { return lastError; }
+    int getXRunCount() const noexcept       { return numXRuns.get(); }
 
     BigInteger getActiveOutputChannels() const
     {
@@ -402,6 +406,14 @@ private:
         return 0;
     }
 
+    static int xrunCallback (void* callbackArgument)
+    {
+        if (callbackArgument != nullptr)
+            ++(((JackAudioIODevice*) callbackArgument)->numXRuns);
+
+        return 0;
+    }
+
     static void threadInitCallback (void* callbackArgument)
     {
         jack_Log ("JackAudioIODevice::initialise");
@@ -435,6 +447,7 @@ private:
     int totalNumberOfInputChannels;
     int totalNumberOfOutputChannels;
     Array<void*> inputPorts, outputPorts;
+    Atomic<int> numXRuns;
 };
 
 
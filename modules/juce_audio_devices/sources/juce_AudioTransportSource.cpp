@@ -23,6 +23,97 @@
   ==============================================================================
 */
 
+/*  Holds a source along with the buffering and resampling sources that are wrapped
+    around it. The transport's current source is kept in its own members, and swapped
+    with one of these when a queued source takes over.
+*/
+class AudioTransportSource::SourceChain
+{
+public:
+    SourceChain (PositionableAudioSource* const newSource,
+                 const int readAheadBufferSize,
+                 TimeSliceThread* const readAheadThread,
+                 const double sourceSampleRate_,
+                 const int maxNumChannels,
+                 const double crossfadeLengthSeconds_)
+        : source (newSource),
+          resamplerSource (nullptr),
+          bufferingSource (nullptr),
+          positionableSource (nullptr),
+          masterSource (nullptr),
+          sourceSampleRate (sourceSampleRate_),
+          crossfadeLengthSeconds (crossfadeLengthSeconds_)
+    {
+        if (newSource != nullptr)
+        {
+            positionableSource = newSource;
+
+            if (readAheadBufferSize > 0)
+            {
+                // If you want to use a read-ahead buffer, you must also provide a TimeSliceThread
+                // for it to use!
+                jassert (readAheadThread != nullptr);
+
+                positionableSource = bufferingSource
+                    = new BufferingAudioSource (positionableSource, *readAheadThread,
+                                                false, readAheadBufferSize, maxNumChannels);
+            }
+
+            positionableSource->setNextReadPosition (0);
+
+            if (sourceSampleRate > 0)
+                masterSource = resamplerSource
+                    = new ResamplingAudioSource (positionableSource, false, maxNumChannels);
+            else
+                masterSource = positionableSource;
+        }
+    }
+
+    ~SourceChain()
+    {
+        delete resamplerSource;
+        delete bufferingSource;
+    }
+
+    void prepareToPlay (const int blockSize, const double sampleRate)
+    {
+        if (masterSource != nullptr)
+        {
+            if (resamplerSource != nullptr && sourceSampleRate > 0 && sampleRate > 0)
+                resamplerSource->setResamplingRatio (sourceSampleRate / sampleRate);
+
+            masterSource->prepareToPlay (blockSize, sampleRate);
+        }
+    }
+
+    void releaseResources()
+    {
+        if (masterSource != nullptr)
+            masterSource->releaseResources();
+    }
+
+    void swapWith (AudioTransportSource& t) noexcept
+    {
+        std::swap (source, t.source);
+        std::swap (resamplerSource, t.resamplerSource);
+        std::swap (bufferingSource, t.bufferingSource);
+        std::swap (positionableSource, t.positionableSource);
+        std::swap (masterSource, t.masterSource);
+        std::swap (sourceSampleRate, t.sourceSampleRate);
+    }
+
+    PositionableAudioSource* source;
+    ResamplingAudioSource* resamplerSource;
+    BufferingAudioSource* bufferingSource;
+    PositionableAudioSource* positionableSource;
+    AudioSource* masterSource;
+    double sourceSampleRate, crossfadeLengthSeconds;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE (SourceChain);
+};
+
+//==============================================================================
 AudioTransportSource::AudioTransportSource()
     : source (nullptr),
       resamplerSource (nullptr),
@@ -38,7 +129,13 @@ AudioTransportSource::AudioTransportSource()
       blockSize (128),
       readAheadBufferSize (0),
       isPrepared (false),
-      inputStreamEOF (false)
+      inputStreamEOF (false),
+      playPosition (0),
+      maxNumSourceChannels (2),
+      fadeBuffer (1, 1),
+      fadeLength (0),
+      fadeSamplesRemaining (0),
+      sourceHasChanged (false)
 {
 }
 
@@ -47,6 +144,7 @@ AudioTransportSource::~AudioTransportSource()
     setSource (nullptr);
 
     releaseMasterResources();
+    cancelPendingUpdate();
 }
 
 void AudioTransportSource::setSource (PositionableAudioSource* const newSource,
@@ -58,69 +156,96 @@ void AudioTransportSource::setSource (PositionableAudioSource* const newSource,
     if (source == newSource)
     {
         if (source == nullptr)
-            return;
-
-        setSource (nullptr, 0, nullptr); // deselect and reselect to avoid releasing resources wrongly
+        {
+            if (nextSource == nullptr && fadingSource == nullptr && releasedSource == nullptr)
+                return;
+        }
+        else
+        {
+            setSource (nullptr, 0, nullptr); // deselect and reselect to avoid releasing resources wrongly
+        }
     }
 
     readAheadBufferSize = readAheadBufferSize_;
-    sourceSampleRate = sourceSampleRateToCorrectFor;
 
-    ResamplingAudioSource* newResamplerSource = nullptr;
-    BufferingAudioSource* newBufferingSource = nullptr;
-    PositionableAudioSource* newPositionableSource = nullptr;
-    AudioSource* newMasterSource = nullptr;
+    ScopedPointer<SourceChain> chain (new SourceChain (newSource, readAheadBufferSize_, readAheadThread,
+                                                       sourceSampleRateToCorrectFor, maxNumChannels, 0));
 
-    ScopedPointer <ResamplingAudioSource> oldResamplerSource (resamplerSource);
-    ScopedPointer <BufferingAudioSource> oldBufferingSource (bufferingSource);
-    AudioSource* oldMasterSource = masterSource;
+    if (isPrepared)
+        chain->prepareToPlay (blockSize, sampleRate);
+
+    ScopedPointer<SourceChain> oldNext, oldFading, oldReleased;
 
-    if (newSource != nullptr)
     {
-        newPositionableSource = newSource;
+        const ScopedLock sl (callbackLock);
 
-        if (readAheadBufferSize_ > 0)
-        {
-            // If you want to use a read-ahead buffer, you must also provide a TimeSliceThread
-            // for it to use!
-            jassert (readAheadThread != nullptr);
+        chain->swapWith (*this);
+        playing = false;
+        playPosition = 0;
+        maxNumSourceChannels = jmax (maxNumSourceChannels, maxNumChannels);
 
-            newPositionableSource = newBufferingSource
-                = new BufferingAudioSource (newPositionableSource, *readAheadThread,
-                                            false, readAheadBufferSize_, maxNumChannels);
-        }
+        oldNext = nextSource.release();
+        oldFading = fadingSource.release();
+        oldReleased = releasedSource.release();
+    }
 
-        newPositionableSource->setNextReadPosition (0);
+    // (the chain now holds the old source, so this releases it)
+    chain->releaseResources();
 
-        if (sourceSampleRateToCorrectFor > 0)
-            newMasterSource = newResamplerSource
-                = new ResamplingAudioSource (newPositionableSource, false, maxNumChannels);
-        else
-            newMasterSource = newPositionableSource;
+    if (oldNext != nullptr)     oldNext->releaseResources();
+    if (oldFading != nullptr)   oldFading->releaseResources();
+}
 
-        if (isPrepared)
-        {
-            if (newResamplerSource != nullptr && sourceSampleRate > 0 && sampleRate > 0)
-                newResamplerSource->setResamplingRatio (sourceSampleRate / sampleRate);
+void AudioTransportSource::setNextSource (PositionableAudioSource* const newSource,
+                                          const double crossfadeLengthSeconds,
+                                          int readAheadBufferSize_,
+                                          TimeSliceThread* readAheadThread,
+                                          double sourceSampleRateToCorrectFor,
+                                          int maxNumChannels)
+{
+    ScopedPointer<SourceChain> chain;
 
-            newMasterSource->prepareToPlay (blockSize, sampleRate);
-        }
+    if (newSource != nullptr)
+    {
+        chain = new SourceChain (newSource, readAheadBufferSize_, readAheadThread,
+                                 sourceSampleRateToCorrectFor, maxNumChannels,
+                                 jmax (0.0, crossfadeLengthSeconds));
+
+        if (isPrepared)
+            chain->prepareToPlay (blockSize, sampleRate);
     }
 
     {
         const ScopedLock sl (callbackLock);
+        nextSource.swapWith (chain);
+        maxNumSourceChannels = jmax (maxNumSourceChannels, maxNumChannels);
 
-        source = newSource;
-        resamplerSource = newResamplerSource;
-        bufferingSource = newBufferingSource;
-        masterSource = newMasterSource;
-        positionableSource = newPositionableSource;
-
-        playing = false;
+        // (the crossfade needs room for all the new source's channels, and this can't be
+        // left until the fade starts, because that happens on the audio thread)
+        if (maxNumChannels > fadeBuffer.getNumChannels())
+            fadeBuffer.setSize (maxNumChannels, fadeBuffer.getNumSamples());
     }
 
-    if (oldMasterSource != nullptr)
-        oldMasterSource->releaseResources();
+    // (this is now the previously queued source, if there was one)
+    if (chain != nullptr)
+        chain->releaseResources();
+}
+
+bool AudioTransportSource::hasNextSource() const
+{
+    const ScopedLock sl (callbackLock);
+    return nextSource != nullptr;
+}
+
+bool AudioTransportSource::isUsingSource (PositionableAudioSource* const s) const
+{
+    const ScopedLock sl (callbackLock);
+
+    return s != nullptr
+            && (source == s
+                 || (nextSource != nullptr && nextSource->source == s)
+                 || (fadingSource != nullptr && fadingSource->source == s)
+                 || (releasedSource != nullptr && releasedSource->source == s));
 }
 
 void AudioTransportSource::start()
@@ -178,6 +303,9 @@ void AudioTransportSource::setNextReadPosition (int64 newPosition)
 {
     if (positionableSource != nullptr)
     {
+        const ScopedLock sl (callbackLock);
+        playPosition = newPosition;
+
         if (sampleRate > 0 && sourceSampleRate > 0)
             newPosition = (int64) (newPosition * sourceSampleRate / sampleRate);
 
@@ -238,6 +366,15 @@ void AudioTransportSource::prepareToPlay (int samplesPerBlockExpected,
     if (resamplerSource != nullptr && sourceSampleRate > 0)
         resamplerSource->setResamplingRatio (sourceSampleRate / sampleRate);
 
+    if (nextSource != nullptr)
+        nextSource->prepareToPlay (samplesPerBlockExpected, sampleRate);
+
+    // (preparing the resampler empties it, so the source's own position is accurate again)
+    if (positionableSource != nullptr)
+        playPosition = (int64) (positionableSource->getNextReadPosition() * getResamplingRatio());
+
+    fadeBuffer.setSize (jmax (2, maxNumSourceChannels, fadeBuffer.getNumChannels()), samplesPerBlockExpected * 2);
+
     isPrepared = true;
 }
 
@@ -248,6 +385,9 @@ void AudioTransportSource::releaseMasterResources()
     if (masterSource != nullptr)
         masterSource->releaseResources();
 
+    if (nextSource != nullptr)
+        nextSource->releaseResources();
+
     isPrepared = false;
 }
 
@@ -264,7 +404,15 @@ void AudioTransportSource::getNextAudioBlock (const AudioSourceChannelInfo& info
 
     if (masterSource != nullptr && ! stopped)
     {
-        masterSource->getNextAudioBlock (info);
+        if (nextSource == nullptr && fadingSource == nullptr)
+        {
+            masterSource->getNextAudioBlock (info);
+            playPosition += info.numSamples;
+        }
+        else
+        {
+            renderWithQueuedSources (info);
+        }
 
         if (! playing)
         {
@@ -300,3 +448,280 @@ void AudioTransportSource::getNextAudioBlock (const AudioSourceChannelInfo& info
 
     lastGain = gain;
 }
+
+//==============================================================================
+void AudioTransportSource::renderWithQueuedSources (const AudioSourceChannelInfo& info)
+{
+    int offset = 0;
+
+    while (offset < info.numSamples)
+    {
+        int numThisTime = info.numSamples - offset;
+
+        if (fadeSamplesRemaining > 0)
+        {
+            // (the fading source is rendered in pieces that fit into the fade buffer)
+            numThisTime = jmin (numThisTime, fadeSamplesRemaining,
+                                getMaxFadeBlockSize (info.buffer->getNumChannels()));
+        }
+        else if (nextSource != nullptr && fadingSource == nullptr && ! positionableSource->isLooping())
+        {
+            const int64 samplesUntilSwitch = getNumSamplesRemaining()
+                                               - roundToInt (nextSource->crossfadeLengthSeconds * sampleRate);
+
+            if (samplesUntilSwitch <= 0)
+            {
+                switchToNextSource();
+                continue;
+            }
+
+            numThisTime = (int) jmin ((int64) numThisTime, samplesUntilSwitch);
+        }
+
+        const AudioSourceChannelInfo segment (info.buffer, info.startSample + offset, numThisTime);
+        masterSource->getNextAudioBlock (segment);
+        playPosition += numThisTime;
+
+        if (fadeSamplesRemaining > 0)
+        {
+            // the outgoing source fades out as the new one fades in..
+            const float startGain = fadeSamplesRemaining / (float) fadeLength;
+            const float endGain = (fadeSamplesRemaining - numThisTime) / (float) fadeLength;
+            const int numChans = info.buffer->getNumChannels();
+            const int numFadeChans = jmin (numChans, (int) maxFadeChannels);
+
+            // If there are more output channels than the fade buffer has, each of its channels
+            // is shared between several of them, which is why the block size was limited above.
+            float* fadeChannels [maxFadeChannels];
+
+            for (int i = 0; i < numFadeChans; ++i)
+                fadeChannels[i] = fadeBuffer.getSampleData (i % fadeBuffer.getNumChannels(),
+                                                            (i / fadeBuffer.getNumChannels()) * numThisTime);
+
+            AudioSampleBuffer fadeSection (fadeChannels, numFadeChans, numThisTime);
+            fadingSource->masterSource->getNextAudioBlock (AudioSourceChannelInfo (fadeSection));
+
+            for (int i = 0; i < numChans; ++i)
+            {
+                info.buffer->applyGainRamp (i, segment.startSample, numThisTime, 1.0f - startGain, 1.0f - endGain);
+
+                if (i < numFadeChans)
+                    info.buffer->addFromWithRamp (i, segment.startSample, fadeSection.getSampleData (i),
+                                                  numThisTime, startGain, endGain);
+            }
+
+            fadeSamplesRemaining -= numThisTime;
+
+            if (fadeSamplesRemaining <= 0)
+                finishFade();
+        }
+
+        offset += numThisTime;
+    }
+}
+
+void AudioTransportSource::switchToNextSource()
+{
+    const int numLeft = (int) jmax ((int64) 0, getNumSamplesRemaining());
+
+    nextSource->swapWith (*this);
+    fadingSource = nextSource.release();
+    playPosition = 0;
+
+    fadeLength = jmin (numLeft, roundToInt (fadingSource->crossfadeLengthSeconds * sampleRate));
+    fadeSamplesRemaining = fadeLength;
+
+    if (fadeSamplesRemaining <= 0)
+        finishFade();
+
+    sourceHasChanged = true;
+    triggerAsyncUpdate();
+}
+
+void AudioTransportSource::finishFade()
+{
+    fadeSamplesRemaining = 0;
+
+    // (if the message thread hasn't yet released the last source, this one stays where
+    // it is, and will get collected along with it)
+    if (releasedSource == nullptr)
+        releasedSource = fadingSource.release();
+
+    triggerAsyncUpdate();
+}
+
+// The source's own read position can't be used here, because a resampler reads ahead of
+// the samples that it has actually played.
+int64 AudioTransportSource::getNumSamplesRemaining() const
+{
+    return (int64) (positionableSource->getTotalLength() * getResamplingRatio()) - playPosition;
+}
+
+double AudioTransportSource::getResamplingRatio() const noexcept
+{
+    return (sampleRate > 0 && sourceSampleRate > 0) ? sampleRate / sourceSampleRate : 1.0;
+}
+
+int AudioTransportSource::getMaxFadeBlockSize (const int numOutputChannels) const noexcept
+{
+    const int numFadeChannels = jlimit (1, (int) maxFadeChannels, numOutputChannels);
+    const int numSharing = (numFadeChannels + fadeBuffer.getNumChannels() - 1) / fadeBuffer.getNumChannels();
+
+    return jmax (1, fadeBuffer.getNumSamples() / numSharing);
+}
+
+void AudioTransportSource::handleAsyncUpdate()
+{
+    ScopedPointer<SourceChain> oldReleased, oldFading;
+    bool changed;
+
+    {
+        const ScopedLock sl (callbackLock);
+
+        oldReleased = releasedSource.release();
+
+        if (fadingSource != nullptr && fadeSamplesRemaining <= 0)
+            oldFading = fadingSource.release();
+
+        changed = sourceHasChanged;
+        sourceHasChanged = false;
+    }
+
+    if (oldReleased != nullptr)     oldReleased->releaseResources();
+    if (oldFading != nullptr)       oldFading->releaseResources();
+
+    if (changed)
+        sendChangeMessage();
+}
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioTransportSourceTests  : public UnitTest
+{
+public:
+    AudioTransportSourceTests() : UnitTest ("AudioTransportSource") {}
+
+    // Plays a ramp of values into all of the buffer's channels, followed by silence.
+    class RampSource  : public PositionableAudioSource
+    {
+    public:
+        RampSource (const int64 length_, const float startValue_, const float step_)
+            : length (length_), position (0), startValue (startValue_), step (step_)
+        {
+        }
+
+        void prepareToPlay (int, double)                    {}
+        void releaseResources()                             {}
+
+        void getNextAudioBlock (const AudioSourceChannelInfo& info)
+        {
+            for (int i = 0; i < info.numSamples; ++i)
+            {
+                const int64 pos = position + i;
+                const float value = pos < length ? startValue + step * (float) pos : 0.0f;
+
+                for (int chan = 0; chan < info.buffer->getNumChannels(); ++chan)
+                    *info.buffer->getSampleData (chan, info.startSample + i) = value;
+            }
+
+            position += info.numSamples;
+        }
+
+        void setNextReadPosition (int64 newPosition)        { position = newPosition; }
+        int64 getNextReadPosition() const                   { return position; }
+        int64 getTotalLength() const                        { return length; }
+        bool isLooping() const                              { return false; }
+
+    private:
+        const int64 length;
+        int64 position;
+        const float startValue, step;
+    };
+
+    // Plays the transport in awkwardly-sized blocks, and returns everything that it produced.
+    static void render (AudioTransportSource& transport, AudioSampleBuffer& output)
+    {
+        const int blockSize = 37;
+
+        for (int pos = 0; pos < output.getNumSamples(); pos += blockSize)
+        {
+            const AudioSourceChannelInfo info (&output, pos, jmin (blockSize, output.getNumSamples() - pos));
+            transport.getNextAudioBlock (info);
+        }
+    }
+
+    // Returns the index of the first sample that came from the queued source, whose values all start at 2.0.
+    static int findSwitchSample (const AudioSampleBuffer& output)
+    {
+        for (int i = 0; i < output.getNumSamples(); ++i)
+            if (*output.getSampleData (0, i) >= 1.5f)
+                return i;
+
+        return -1;
+    }
+
+    void testSwitch (const double sourceSampleRate, const int expectedSwitchSample)
+    {
+        RampSource first (1000, 0.5f, 0.0f), second (100000, 2.0f, 0.001f);
+
+        AudioTransportSource transport;
+        transport.prepareToPlay (37, 44100.0);
+        transport.setSource (&first, 0, nullptr, sourceSampleRate);
+        transport.setNextSource (&second);
+        transport.start();
+
+        AudioSampleBuffer output (2, 3000);
+        render (transport, output);
+
+        expectEquals (findSwitchSample (output), expectedSwitchSample);
+        expectEquals (*output.getSampleData (0, expectedSwitchSample), 2.0f);
+        expect (! transport.hasNextSource());
+
+        transport.setSource (nullptr);
+    }
+
+    void runTest()
+    {
+        beginTest ("Switching to a queued source");
+        testSwitch (0.0, 1000);
+
+        beginTest ("Switching from a resampled source");
+        testSwitch (22050.0, 2000);
+
+        beginTest ("Crossfading more channels than the sources have");
+        {
+            RampSource first (1000, 1.0f, 0.0f), second (100000, 0.25f, 0.0f);
+
+            AudioTransportSource transport;
+            transport.prepareToPlay (37, 44100.0);
+            transport.setSource (&first);
+            transport.setNextSource (&second, 441 / 44100.0);
+            transport.start();
+
+            AudioSampleBuffer output (6, 1500);
+            render (transport, output);
+
+            expectEquals (*output.getSampleData (0, 558), 1.0f);
+            expectEquals (*output.getSampleData (0, 1000), 0.25f);
+
+            for (int chan = 1; chan < output.getNumChannels(); ++chan)
+            {
+                bool isSameAsFirstChannel = true;
+
+                for (int i = 0; i < output.getNumSamples(); ++i)
+                    if (*output.getSampleData (chan, i) != *output.getSampleData (0, i))
+                        isSameAsFirstChannel = false;
+
+                expect (isSameAsFirstChannel, "channel " + String (chan) + " wasn't crossfaded");
+            }
+
+            transport.setSource (nullptr);
+        }
+    }
+};
+
+static AudioTransportSourceTests audioTransportSourceTests;
+
+#endif
@@ -38,10 +38,14 @@
     You may want to use one of these along with an AudioSourcePlayer and AudioIODevice
     to control playback of an audio file.
 
+    For gapless playback of a list of sources, use setNextSource() to queue up the
+    source that should follow the current one.
+
     @see AudioSource, AudioSourcePlayer
 */
 class JUCE_API  AudioTransportSource  : public PositionableAudioSource,
-                                        public ChangeBroadcaster
+                                        public ChangeBroadcaster,
+                                        private AsyncUpdater
 {
 public:
     //==============================================================================
@@ -84,6 +88,48 @@ public:
                     double sourceSampleRateToCorrectFor = 0.0,
                     int maxNumChannels = 2);
 
+    /** Queues up a source to start playing as soon as the current one finishes.
+
+        The new source is prepared (and if you use a read-ahead buffer, starts buffering)
+        straight away, so that when the current source reaches its end, playback can
+        switch over to it at exactly the right sample, without a gap. If a crossfade
+        length is given, the new source starts that much before the end of the current
+        one, and the two are crossfaded.
+
+        Once the switch has happened, the old source is released by the message thread,
+        and a change message is sent. If a source is already queued, it's replaced by
+        this one; calling setSource() cancels the queued source.
+
+        The switch only happens if the current source isn't looping. The switch point is
+        counted in output samples, so it's exact even when the source is being resampled.
+
+        The source passed in will not be deleted by this object, so must be managed by
+        the caller - use isUsingSource() to find out when it's safe to delete it.
+
+        @param nextSource               the source to play next, or nullptr to clear the queue
+        @param crossfadeLengthSeconds   the length of the crossfade, or 0 to butt the two
+                                        sources together
+        @see setSource, hasNextSource
+    */
+    void setNextSource (PositionableAudioSource* nextSource,
+                        double crossfadeLengthSeconds = 0.0,
+                        int readAheadBufferSize = 0,
+                        TimeSliceThread* readAheadThread = nullptr,
+                        double sourceSampleRateToCorrectFor = 0.0,
+                        int maxNumChannels = 2);
+
+    /** Returns true if a source has been queued with setNextSource() and hasn't yet
+        started playing.
+    */
+    bool hasNextSource() const;
+
+    /** Returns true if the given source is currently playing, queued, or still being
+        used in a crossfade or waiting to be released.
+
+        When this returns false, the source can safely be deleted.
+    */
+    bool isUsingSource (PositionableAudioSource* source) const;
+
     //==============================================================================
     /** Changes the current playback position in the source stream.
 
@@ -165,6 +211,10 @@ public:
 
 private:
     //==============================================================================
+    class SourceChain;
+    friend class SourceChain;
+    friend class ScopedPointer<SourceChain>;
+
     PositionableAudioSource* source;
     ResamplingAudioSource* resamplerSource;
     BufferingAudioSource* bufferingSource;
@@ -178,7 +228,25 @@ private:
     int blockSize, readAheadBufferSize;
     bool isPrepared, inputStreamEOF;
 
+    int64 playPosition;     // the current source's position, in output samples
+    int maxNumSourceChannels;
+
+    ScopedPointer<SourceChain> nextSource, fadingSource, releasedSource;
+    AudioSampleBuffer fadeBuffer;
+
+    // (an AudioSampleBuffer can refer to this many channels without allocating anything)
+    enum { maxFadeChannels = 31 };
+    int fadeLength, fadeSamplesRemaining;
+    bool sourceHasChanged;
+
     void releaseMasterResources();
+    void renderWithQueuedSources (const AudioSourceChannelInfo&);
+    void switchToNextSource();
+    void finishFade();
+    int64 getNumSamplesRemaining() const;
+    double getResamplingRatio() const noexcept;
+    int getMaxFadeBlockSize (int numOutputChannels) const noexcept;
+    void handleAsyncUpdate();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioTransportSource);
 };
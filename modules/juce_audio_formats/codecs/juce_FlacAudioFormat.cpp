@@ -519,6 +519,59 @@ AudioFormatReader* FlacAudioFormat::createReaderFor (InputStream* in, const bool
     return nullptr;
 }
 
+bool FlacAudioFormat::readStreamInfo (InputStream& in, AudioStreamInfo& result)
+{
+    const int64 startPos = in.getPosition();
+    uint8 header[10];
+
+    if (in.read (header, 4) != 4)
+        return false;
+
+    if (memcmp (header, "ID3", 3) == 0)
+    {
+        // skip an ID3v2 tag, which some encoders put before the stream
+        if (in.read (header + 4, 6) != 6)
+            return false;
+
+        const int tagSize = (header[6] << 21) | (header[7] << 14) | (header[8] << 7) | header[9];
+
+        if (! in.setPosition (in.getPosition() + tagSize) || in.read (header, 4) != 4)
+            return false;
+    }
+
+    // The STREAMINFO block must be the first metadata block..
+    uint8 info[38];
+
+    if (memcmp (header, "fLaC", 4) != 0
+         || in.read (info, sizeof (info)) != (int) sizeof (info)
+         || (info[0] & 0x7f) != 0)
+        return false;
+
+    const uint8* const d = info + 4;
+    const int sampleRate = (d[10] << 12) | (d[11] << 4) | (d[12] >> 4);
+    const int64 totalSamples = (((int64) (d[13] & 0x0f)) << 32)
+                                | (((int64) d[14]) << 24) | (d[15] << 16) | (d[16] << 8) | d[17];
+
+    if (sampleRate <= 0)
+        return false;
+
+    if (totalSamples == 0)
+    {
+        // the length isn't in the header, so the whole stream will have to be scanned..
+        in.setPosition (startPos);
+        return AudioFormat::readStreamInfo (in, result);
+    }
+
+    result.formatName = getFormatName();
+    result.sampleRate = sampleRate;
+    result.numChannels = (unsigned int) (((d[12] >> 1) & 7) + 1);
+    result.bitsPerSample = (unsigned int) ((((d[12] & 1) << 4) | (d[13] >> 4)) + 1);
+    result.lengthInSamples = totalSamples;
+    result.usesFloatingPointData = false;
+    result.metadataValues.clear();
+    return true;
+}
+
 AudioFormatWriter* FlacAudioFormat::createWriterFor (OutputStream* out,
                                                      double sampleRate,
                                                      unsigned int numberOfChannels,
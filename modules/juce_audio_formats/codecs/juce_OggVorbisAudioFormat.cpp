@@ -443,6 +443,80 @@ AudioFormatReader* OggVorbisAudioFormat::createReaderFor (InputStream* in, const
     return nullptr;
 }
 
+bool OggVorbisAudioFormat::readStreamInfo (InputStream& in, AudioStreamInfo& result)
+{
+    // The first page of the stream must contain just the identification header,
+    // so we can read that directly, without setting up a decoder..
+    uint8 page[27 + 255 + 30];
+    const int64 startPos = in.getPosition();
+
+    if (in.read (page, 27) != 27 || memcmp (page, "OggS", 4) != 0)
+        return false;
+
+    const int numSegments = page[26];
+
+    if (in.read (page + 27, numSegments + 30) != numSegments + 30)
+        return false;
+
+    const uint8* const id = page + 27 + numSegments;
+
+    if (id[0] != 1 || memcmp (id + 1, "vorbis", 6) != 0)
+        return false;
+
+    const uint32 serialNumber = ByteOrder::littleEndianInt (page + 14);
+    const int numChannels = id[11];
+    const int sampleRate = (int) ByteOrder::littleEndianInt (id + 12);
+
+    if (numChannels <= 0 || sampleRate <= 0)
+        return false;
+
+    // ..and the length is the granule position of the stream's last page, which
+    // should be somewhere near the end of the file.
+    const int64 totalLength = in.getTotalLength();
+    const int tailSize = (int) jmin ((int64) 65536, totalLength - startPos);
+    int64 length = -1;
+
+    if (tailSize > 27 && in.setPosition (totalLength - tailSize))
+    {
+        HeapBlock<uint8> tail ((size_t) tailSize);
+
+        if (in.read (tail, tailSize) == tailSize)
+        {
+            for (int i = tailSize - 27; --i >= 0;)
+            {
+                const uint8* const p = tail + i;
+
+                if (memcmp (p, "OggS", 4) == 0 && ByteOrder::littleEndianInt (p + 14) == serialNumber)
+                {
+                    const int64 granule = (int64) ((((uint64) ByteOrder::littleEndianInt (p + 10)) << 32)
+                                                     | ByteOrder::littleEndianInt (p + 6));
+
+                    if (granule >= 0)
+                    {
+                        length = granule;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    if (length < 0)
+    {
+        in.setPosition (startPos);
+        return AudioFormat::readStreamInfo (in, result);
+    }
+
+    result.formatName = getFormatName();
+    result.sampleRate = sampleRate;
+    result.numChannels = (unsigned int) numChannels;
+    result.bitsPerSample = 16;
+    result.lengthInSamples = length;
+    result.usesFloatingPointData = true;
+    result.metadataValues.clear();
+    return true;
+}
+
 AudioFormatWriter* OggVorbisAudioFormat::createWriterFor (OutputStream* out,
                                                           double sampleRate,
                                                           unsigned int numChannels,
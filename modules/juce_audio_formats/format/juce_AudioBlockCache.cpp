@@ -0,0 +1,590 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+AudioBlockCache::Block::Block (const int64 key_, const int numChannels_,
+                               const int samplesPerBlock_, const int numSamples_)
+    : numSamples (numSamples_),
+      key (key_),
+      numChannels (numChannels_),
+      samplesPerBlock (samplesPerBlock_),
+      data ((size_t) (numChannels_ * samplesPerBlock_)),
+      previous (nullptr),
+      next (nullptr),
+      pinCount (0)
+{
+}
+
+//==============================================================================
+AudioBlockCache::AudioBlockCache (const int64 maxBytesToUse, const int samplesPerBlock_)
+    : blocks (4093),
+      mostRecent (nullptr),
+      leastRecent (nullptr),
+      samplesPerBlock (jmax (256, samplesPerBlock_)),
+      maxBytes (maxBytesToUse),
+      bytesUsed (0)
+{
+    zerostruct (stats);
+}
+
+AudioBlockCache::~AudioBlockCache()
+{
+    while (mostRecent != nullptr)
+        removeBlock (mostRecent);
+
+    clearSingletonInstance();
+}
+
+juce_ImplementSingleton (AudioBlockCache)
+
+//==============================================================================
+int64 AudioBlockCache::makeKey (const int sourceId, const int64 blockIndex) noexcept
+{
+    jassert (blockIndex >= 0 && blockIndex < (((int64) 1) << 40));
+    return (((int64) sourceId) << 40) | blockIndex;
+}
+
+void AudioBlockCache::unlink (Block* const b) noexcept
+{
+    if (b->previous != nullptr)   b->previous->next = b->next;
+    else                          mostRecent = b->next;
+
+    if (b->next != nullptr)       b->next->previous = b->previous;
+    else                          leastRecent = b->previous;
+
+    b->previous = nullptr;
+    b->next = nullptr;
+}
+
+void AudioBlockCache::moveToFront (Block* const b) noexcept
+{
+    if (b != mostRecent)
+    {
+        if (b->previous != nullptr)
+            unlink (b);
+
+        b->next = mostRecent;
+
+        if (mostRecent != nullptr)
+            mostRecent->previous = b;
+
+        mostRecent = b;
+
+        if (leastRecent == nullptr)
+            leastRecent = b;
+    }
+}
+
+void AudioBlockCache::removeBlock (Block* const b)
+{
+    unlink (b);
+    blocks.remove (b->key);
+    bytesUsed -= b->getSizeInBytes();
+    b->decReferenceCount();
+}
+
+void AudioBlockCache::discardBlocksIfOverBudget()
+{
+    Block* b = leastRecent;
+
+    while (bytesUsed > maxBytes && b != nullptr)
+    {
+        Block* const previous = b->previous;
+
+        if (b->pinCount == 0)
+        {
+            removeBlock (b);
+            ++stats.numEvictions;
+        }
+
+        b = previous;
+    }
+}
+
+//==============================================================================
+void AudioBlockCache::setMemoryBudget (const int64 maxBytesToUse)
+{
+    const ScopedLock sl (lock);
+    maxBytes = maxBytesToUse;
+    discardBlocksIfOverBudget();
+}
+
+void AudioBlockCache::clear()
+{
+    const ScopedLock sl (lock);
+
+    for (Block* b = leastRecent; b != nullptr;)
+    {
+        Block* const previous = b->previous;
+
+        if (b->pinCount == 0)
+            removeBlock (b);
+
+        b = previous;
+    }
+}
+
+int AudioBlockCache::getSourceIdFor (const String& sourceName)
+{
+    const ScopedLock sl (lock);
+
+    if (sourceIds.contains (sourceName))
+        return sourceIds [sourceName];
+
+    const int newId = sourceIds.size();
+    sourceIds.set (sourceName, newId);
+    return newId;
+}
+
+String AudioBlockCache::getSourceNameFor (const File& file)
+{
+    return file.getFullPathName()
+            + "|" + String (file.getLastModificationTime().toMilliseconds())
+            + "|" + String (file.getSize());
+}
+
+void AudioBlockCache::removeSource (const int sourceId)
+{
+    const ScopedLock sl (lock);
+
+    for (Block* b = leastRecent; b != nullptr;)
+    {
+        Block* const previous = b->previous;
+
+        if ((int) (b->key >> 40) == sourceId)
+            removeBlock (b);
+
+        b = previous;
+    }
+
+    for (int i = pinnedRegions.size(); --i >= 0;)
+        if (pinnedRegions.getReference (i).sourceId == sourceId)
+            pinnedRegions.remove (i);
+}
+
+//==============================================================================
+int AudioBlockCache::countPinsFor (const int64 key) const noexcept
+{
+    const int sourceId = (int) (key >> 40);
+    const int64 blockIndex = key & ((((int64) 1) << 40) - 1);
+    int num = 0;
+
+    for (int i = pinnedRegions.size(); --i >= 0;)
+    {
+        const PinnedRegion& r = pinnedRegions.getReference (i);
+
+        if (r.sourceId == sourceId && blockIndex >= r.startBlock && blockIndex < r.endBlock)
+            ++num;
+    }
+
+    return num;
+}
+
+void AudioBlockCache::changePinCounts (const int sourceId, const int64 startSample,
+                                       const int64 numSamples, const int delta)
+{
+    const int64 startBlock = jmax ((int64) 0, startSample) / samplesPerBlock;
+    const int64 endBlock = (startSample + numSamples + samplesPerBlock - 1) / samplesPerBlock;
+
+    if (delta > 0)
+    {
+        PinnedRegion r = { sourceId, startBlock, endBlock };
+        pinnedRegions.add (r);
+    }
+    else
+    {
+        for (int i = pinnedRegions.size(); --i >= 0;)
+        {
+            const PinnedRegion& r = pinnedRegions.getReference (i);
+
+            if (r.sourceId == sourceId && r.startBlock == startBlock && r.endBlock == endBlock)
+            {
+                pinnedRegions.remove (i);
+                break;
+            }
+        }
+    }
+
+    for (int64 i = startBlock; i < endBlock; ++i)
+    {
+        Block* const b = blocks [makeKey (sourceId, i)];
+
+        if (b != nullptr)
+            b->pinCount = jmax (0, b->pinCount + delta);
+    }
+}
+
+void AudioBlockCache::pinRegion (const int sourceId, const int64 startSample, const int64 numSamples)
+{
+    const ScopedLock sl (lock);
+    changePinCounts (sourceId, startSample, numSamples, 1);
+}
+
+void AudioBlockCache::unpinRegion (const int sourceId, const int64 startSample, const int64 numSamples)
+{
+    const ScopedLock sl (lock);
+    changePinCounts (sourceId, startSample, numSamples, -1);
+    discardBlocksIfOverBudget();
+}
+
+//==============================================================================
+AudioBlockCache::Block::Ptr AudioBlockCache::getBlock (const int sourceId, const int64 blockIndex,
+                                                       AudioFormatReader* const reader)
+{
+    const int64 key = makeKey (sourceId, blockIndex);
+
+    {
+        const ScopedLock sl (lock);
+        Block* const b = blocks [key];
+
+        if (b != nullptr)
+        {
+            moveToFront (b);
+            ++stats.numHits;
+            return b;
+        }
+    }
+
+    if (reader == nullptr)
+        return nullptr;
+
+    // The block isn't there, so decode it without holding the lock. If another
+    // reader is doing the same thing, whichever of us finishes last will just
+    // use the other's block.
+    const int64 startSample = blockIndex * samplesPerBlock;
+    const int numSamples = (int) jmin ((int64) samplesPerBlock, reader->lengthInSamples - startSample);
+
+    if (numSamples <= 0 || reader->numChannels == 0)
+        return nullptr;
+
+    const int numChannels = (int) reader->numChannels;
+    Block::Ptr newBlock (new Block (key, numChannels, samplesPerBlock, numSamples));
+
+    HeapBlock<int*> channels ((size_t) numChannels);
+    for (int i = 0; i < numChannels; ++i)
+        channels[i] = newBlock->data + i * samplesPerBlock;
+
+    if (! reader->read (channels, numChannels, startSample, numSamples, false))
+        return nullptr;
+
+    const ScopedLock sl (lock);
+    ++stats.numMisses;
+
+    Block* const existing = blocks [key];
+
+    if (existing != nullptr)
+    {
+        moveToFront (existing);
+        return existing;
+    }
+
+    newBlock->incReferenceCount();
+    newBlock->pinCount = countPinsFor (key);
+    blocks.set (key, newBlock);
+    moveToFront (newBlock);
+    bytesUsed += newBlock->getSizeInBytes();
+
+    discardBlocksIfOverBudget();
+    return newBlock;
+}
+
+//==============================================================================
+AudioBlockCache::Statistics AudioBlockCache::getStatistics() const
+{
+    const ScopedLock sl (lock);
+
+    Statistics s (stats);
+    s.numBlocks = blocks.size();
+    s.numPinnedBlocks = 0;
+    s.bytesUsed = bytesUsed;
+
+    for (const Block* b = mostRecent; b != nullptr; b = b->next)
+        if (b->pinCount > 0)
+            ++s.numPinnedBlocks;
+
+    return s;
+}
+
+void AudioBlockCache::resetStatistics()
+{
+    const ScopedLock sl (lock);
+    zerostruct (stats);
+}
+
+//==============================================================================
+AudioBlockCacheReader::AudioBlockCacheReader (AudioFormatReader* const source_,
+                                              const String& sourceName,
+                                              AudioBlockCache& cache_,
+                                              const bool deleteSourceWhenDeleted_)
+    : AudioFormatReader (nullptr, source_->getFormatName()),
+      source (source_),
+      cache (cache_),
+      sourceId (cache_.getSourceIdFor (sourceName)),
+      deleteSourceWhenDeleted (deleteSourceWhenDeleted_)
+{
+    sampleRate = source->sampleRate;
+    bitsPerSample = source->bitsPerSample;
+    lengthInSamples = source->lengthInSamples;
+    numChannels = source->numChannels;
+    usesFloatingPointData = source->usesFloatingPointData;
+    metadataValues = source->metadataValues;
+}
+
+AudioBlockCacheReader::~AudioBlockCacheReader()
+{
+    if (deleteSourceWhenDeleted)
+        delete source;
+}
+
+bool AudioBlockCacheReader::readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                                         int64 startSampleInFile, int numSamples)
+{
+    const int samplesPerBlock = cache.getSamplesPerBlock();
+
+    while (numSamples > 0)
+    {
+        const int64 blockIndex = startSampleInFile / samplesPerBlock;
+        const int offsetInBlock = (int) (startSampleInFile - blockIndex * samplesPerBlock);
+        const int numThisTime = jmin (numSamples, samplesPerBlock - offsetInBlock);
+
+        const AudioBlockCache::Block::Ptr block (cache.getBlock (sourceId, blockIndex, source));
+        const int numValid = block != nullptr ? jlimit (0, numThisTime, block->numSamples - offsetInBlock) : 0;
+
+        for (int i = numDestChannels; --i >= 0;)
+        {
+            if (destSamples[i] != nullptr)
+            {
+                int* const dest = destSamples[i] + startOffsetInDestBuffer;
+
+                if (numValid > 0)
+                    memcpy (dest, block->getChannel (i) + offsetInBlock, sizeof (int) * (size_t) numValid);
+
+                if (numValid < numThisTime)
+                    zeromem (dest + numValid, sizeof (int) * (size_t) (numThisTime - numValid));
+            }
+        }
+
+        startOffsetInDestBuffer += numThisTime;
+        startSampleInFile += numThisTime;
+        numSamples -= numThisTime;
+    }
+
+    return true;
+}
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioBlockCacheTests  : public UnitTest
+{
+public:
+    AudioBlockCacheTests() : UnitTest ("AudioBlockCache") {}
+
+    enum { samplesPerBlock = 256, blockBytes = samplesPerBlock * sizeof (int) };
+
+    // A mono reader whose samples are equal to their positions, and which counts how often it's used
+    class CountingReader  : public AudioFormatReader
+    {
+    public:
+        CountingReader (const int64 length)
+            : AudioFormatReader (nullptr, "test"), numReads (0)
+        {
+            sampleRate = 44100.0;
+            bitsPerSample = 32;
+            lengthInSamples = length;
+            numChannels = 1;
+            usesFloatingPointData = false;
+        }
+
+        bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                          int64 startSampleInFile, int numSamples)
+        {
+            ++numReads;
+
+            for (int chan = 0; chan < numDestChannels; ++chan)
+                if (destSamples[chan] != nullptr)
+                    for (int i = 0; i < numSamples; ++i)
+                        destSamples[chan][startOffsetInDestBuffer + i] = (int) (startSampleInFile + i);
+
+            return true;
+        }
+
+        int numReads;
+    };
+
+    static bool isCached (AudioBlockCache& cache, const int sourceId, const int64 blockIndex)
+    {
+        return cache.getBlock (sourceId, blockIndex, nullptr) != nullptr;
+    }
+
+    void runTest()
+    {
+        CountingReader reader (samplesPerBlock * 20 + 100);
+
+        beginTest ("Hits and misses");
+
+        {
+            AudioBlockCache cache (blockBytes * 4, samplesPerBlock);
+            const int sourceId = cache.getSourceIdFor ("test");
+            expectEquals (cache.getSourceIdFor ("test"), sourceId);
+            expect (cache.getSourceIdFor ("another") != sourceId);
+
+            for (int i = 0; i < 4; ++i)
+            {
+                const AudioBlockCache::Block::Ptr block (cache.getBlock (sourceId, i, &reader));
+                expect (block != nullptr && block->numSamples == samplesPerBlock
+                         && block->getChannel (0)[10] == i * samplesPerBlock + 10);
+            }
+
+            expectEquals (reader.numReads, 4);
+            expect (cache.getStatistics().numMisses == 4 && cache.getStatistics().numHits == 0);
+
+            expect (cache.getBlock (sourceId, 2, &reader) != nullptr);
+            expectEquals (reader.numReads, 4);
+            expect (cache.getStatistics().numMisses == 4 && cache.getStatistics().numHits == 1);
+
+            // (a lookup without a reader isn't a miss, because nothing gets decoded)
+            expect (! isCached (cache, sourceId, 5));
+            expect (cache.getStatistics().numMisses == 4);
+
+            const AudioBlockCache::Block::Ptr lastBlock (cache.getBlock (sourceId, 20, &reader));
+            expect (lastBlock != nullptr && lastBlock->numSamples == 100);
+            expect (cache.getBlock (sourceId, 21, &reader) == nullptr);
+
+            cache.resetStatistics();
+
+            // reading through an AudioBlockCacheReader should use the blocks that are already there
+            AudioBlockCacheReader cacheReader (new CountingReader (reader.lengthInSamples), "test", cache, true);
+            expectEquals (cacheReader.getSourceId(), sourceId);
+
+            HeapBlock<int> samples (600);
+            int* dest[] = { samples };
+            expect (cacheReader.read (dest, 1, samplesPerBlock * 20 - 500, 600, false));
+            expectEquals (samples[0], samplesPerBlock * 20 - 500);
+            expectEquals (samples[599], samplesPerBlock * 20 + 99);
+
+            const AudioBlockCache::Statistics stats (cache.getStatistics());
+            expect (stats.numHits == 1 && stats.numMisses == 2, "hits: " + String (stats.numHits) + " misses: " + String (stats.numMisses));
+        }
+
+        beginTest ("Eviction order");
+
+        {
+            AudioBlockCache cache (blockBytes * 4, samplesPerBlock);
+            const int sourceId = cache.getSourceIdFor ("test");
+
+            for (int i = 0; i < 4; ++i)
+                cache.getBlock (sourceId, i, &reader);
+
+            expect (cache.getStatistics().bytesUsed == blockBytes * 4);
+            expect (cache.getStatistics().numEvictions == 0);
+
+            // using block 0 again should leave block 1 as the least-recently-used one..
+            cache.getBlock (sourceId, 0, &reader);
+            cache.getBlock (sourceId, 4, &reader);
+
+            expect (! isCached (cache, sourceId, 1), "the least-recently-used block wasn't evicted");
+            expect (cache.getStatistics().numEvictions == 1);
+
+            // ..and now the order is 4, 0, 3, 2
+            cache.getBlock (sourceId, 5, &reader);
+            expect (! isCached (cache, sourceId, 2));
+            expect (isCached (cache, sourceId, 3));
+            expect (isCached (cache, sourceId, 0));
+            expect (isCached (cache, sourceId, 4));
+            expect (isCached (cache, sourceId, 5));
+
+            // now the order is 5, 4, 0, 3
+            cache.setMemoryBudget (blockBytes * 2);
+            expect (! isCached (cache, sourceId, 3));
+            expect (! isCached (cache, sourceId, 0));
+            expect (isCached (cache, sourceId, 4));
+            expect (isCached (cache, sourceId, 5));
+
+            const AudioBlockCache::Statistics stats (cache.getStatistics());
+            expect (stats.numEvictions == 4 && stats.numBlocks == 2 && stats.bytesUsed == blockBytes * 2);
+
+            cache.removeSource (sourceId);
+            expectEquals (cache.getStatistics().numBlocks, 0);
+        }
+
+        beginTest ("Pinned blocks");
+
+        {
+            AudioBlockCache cache (blockBytes * 4, samplesPerBlock);
+            const int sourceId = cache.getSourceIdFor ("test");
+
+            // (block 0 is pinned before it's loaded, and block 2 afterwards)
+            cache.pinRegion (sourceId, 0, 10);
+
+            for (int i = 0; i < 4; ++i)
+                cache.getBlock (sourceId, i, &reader);
+
+            cache.pinRegion (sourceId, samplesPerBlock * 2 + 10, 10);
+            expectEquals (cache.getStatistics().numPinnedBlocks, 2);
+
+            for (int i = 4; i < 12; ++i)
+                cache.getBlock (sourceId, i, &reader);
+
+            expect (isCached (cache, sourceId, 0), "a pinned block was evicted");
+            expect (isCached (cache, sourceId, 2), "a pinned block was evicted");
+            expect (! isCached (cache, sourceId, 1));
+            expect (! isCached (cache, sourceId, 3));
+            expect (cache.getStatistics().numBlocks == 4 && cache.getStatistics().numEvictions == 8);
+
+            // a budget that's too small for the pinned blocks can't evict them either
+            cache.setMemoryBudget (blockBytes);
+            expect (isCached (cache, sourceId, 0));
+            expect (isCached (cache, sourceId, 2));
+            expectEquals (cache.getStatistics().numBlocks, 2);
+
+            cache.setMemoryBudget (blockBytes * 4);
+            cache.getBlock (sourceId, 5, &reader);
+            cache.clear();
+            expectEquals (cache.getStatistics().numBlocks, 2);
+
+            // pins are counted, so block 0 stays pinned until both pins are removed
+            cache.pinRegion (sourceId, 0, 10);
+            cache.unpinRegion (sourceId, 0, 10);
+            cache.unpinRegion (sourceId, samplesPerBlock * 2 + 10, 10);
+            expectEquals (cache.getStatistics().numPinnedBlocks, 1);
+
+            cache.clear();
+            expect (isCached (cache, sourceId, 0));
+            expect (! isCached (cache, sourceId, 2));
+
+            cache.unpinRegion (sourceId, 0, 10);
+            expectEquals (cache.getStatistics().numPinnedBlocks, 0);
+
+            cache.clear();
+            expectEquals (cache.getStatistics().numBlocks, 0);
+            expect (cache.getStatistics().bytesUsed == 0);
+        }
+    }
+};
+
+static AudioBlockCacheTests audioBlockCacheUnitTests;
+
+#endif
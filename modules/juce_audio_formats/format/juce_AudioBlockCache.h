@@ -0,0 +1,255 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_AUDIOBLOCKCACHE_JUCEHEADER__
+#define __JUCE_AUDIOBLOCKCACHE_JUCEHEADER__
+
+#include "juce_AudioFormatReader.h"
+
+
+//==============================================================================
+/**
+    A memory-limited cache of decoded blocks of audio, which can be shared between
+    any number of readers.
+
+    When several readers are reading the same compressed file, each of them would
+    normally have to decode it independently. If they're wrapped in AudioBlockCacheReader
+    objects that use the same cache, the first reader to need a block will decode it,
+    and the others will be given a copy of the decoded data.
+
+    Blocks are identified by the name of their source (see getSourceIdFor()) and their
+    position. When the total size of the blocks exceeds the cache's memory budget, the
+    least-recently-used ones are discarded, unless they lie in a region that has been
+    pinned with pinRegion().
+
+    All the methods are thread-safe. The cache's lock is only held while looking up or
+    storing blocks, so decoding and copying happen without blocking other readers.
+
+    There's a process-wide instance available with getInstance(), but you can also
+    create your own.
+
+    @see AudioBlockCacheReader
+*/
+class JUCE_API  AudioBlockCache
+{
+public:
+    //==============================================================================
+    /** Creates a cache.
+
+        @param maxBytesToUse        the total size that the decoded blocks are allowed to use
+        @param samplesPerBlock      the number of samples in each block
+    */
+    AudioBlockCache (int64 maxBytesToUse = 256 * 1024 * 1024,
+                     int samplesPerBlock = 16384);
+
+    /** Destructor. */
+    ~AudioBlockCache();
+
+    juce_DeclareSingleton (AudioBlockCache, false)
+
+    //==============================================================================
+    /** Returns the number of samples in each block. */
+    int getSamplesPerBlock() const noexcept                 { return samplesPerBlock; }
+
+    /** Changes the memory budget, discarding blocks if it's now over the limit. */
+    void setMemoryBudget (int64 maxBytesToUse);
+
+    /** Returns the current memory budget. */
+    int64 getMemoryBudget() const noexcept                  { return maxBytes; }
+
+    /** Discards all the blocks that aren't pinned. */
+    void clear();
+
+    //==============================================================================
+    /** Returns an ID for a source of audio, which is used to identify its blocks.
+
+        The same name will always be given the same ID, so readers that are reading
+        the same data must use the same name.
+    */
+    int getSourceIdFor (const String& sourceName);
+
+    /** Returns a name for a file which will change if the file is modified. */
+    static String getSourceNameFor (const File& file);
+
+    /** Discards all the cached blocks for a source, e.g. because its file has changed. */
+    void removeSource (int sourceId);
+
+    //==============================================================================
+    /** Stops the blocks which overlap a region of a source from being discarded.
+
+        Pins are counted, so each call must be matched with a call to unpinRegion()
+        with the same parameters. Any blocks from the region which aren't already in
+        the cache will be pinned when they get added.
+    */
+    void pinRegion (int sourceId, int64 startSample, int64 numSamples);
+
+    /** Removes a pin that was added with pinRegion(). */
+    void unpinRegion (int sourceId, int64 startSample, int64 numSamples);
+
+    //==============================================================================
+    /** A decoded block of audio. */
+    class Block   : public ReferenceCountedObject
+    {
+    public:
+        /** Returns the sample data for one of the block's channels, in the same format
+            that the reader's readSamples() method produces.
+        */
+        const int* getChannel (int channel) const noexcept  { return data + channel * samplesPerBlock; }
+
+        /** The number of valid samples in this block. */
+        const int numSamples;
+
+        typedef ReferenceCountedObjectPtr<Block> Ptr;
+
+    private:
+        friend class AudioBlockCache;
+        Block (int64 key, int numChannels, int samplesPerBlock, int numSamples);
+
+        const int64 key;
+        const int numChannels, samplesPerBlock;
+        HeapBlock<int> data;
+        Block* previous;
+        Block* next;
+        int pinCount;
+
+        int64 getSizeInBytes() const noexcept   { return (int64) sizeof (int) * numChannels * samplesPerBlock; }
+
+        JUCE_DECLARE_NON_COPYABLE (Block);
+    };
+
+    /** Looks for a block in the cache, and if it's not there, uses a reader to decode it.
+
+        @param sourceId     the ID of the source, as returned by getSourceIdFor()
+        @param blockIndex   the index of the block, i.e. its start sample divided by getSamplesPerBlock()
+        @param reader       a reader to use to decode the block if it isn't in the cache. If this
+                            is null and the block isn't found, a null pointer is returned
+        @returns the block, or null if it couldn't be read
+    */
+    Block::Ptr getBlock (int sourceId, int64 blockIndex, AudioFormatReader* reader);
+
+    //==============================================================================
+    /** Counters that show how well the cache is doing. */
+    struct Statistics
+    {
+        int64 numHits;          /**< The number of blocks that were found in the cache. */
+        int64 numMisses;        /**< The number of blocks that had to be decoded. */
+        int64 numEvictions;     /**< The number of blocks discarded to stay within the budget. */
+        int numBlocks;          /**< The number of blocks currently held. */
+        int numPinnedBlocks;    /**< The number of blocks that are currently pinned. */
+        int64 bytesUsed;        /**< The total size of the blocks currently held. */
+    };
+
+    /** Returns the cache's current statistics. */
+    Statistics getStatistics() const;
+
+    /** Resets the hit, miss and eviction counters. */
+    void resetStatistics();
+
+private:
+    //==============================================================================
+    struct KeyHash
+    {
+        static int generateHash (const int64 key, const int upperLimit) noexcept
+        {
+            return (int) (((uint32) key ^ (uint32) (key >> 32)) % (uint32) upperLimit);
+        }
+    };
+
+    struct PinnedRegion
+    {
+        int sourceId;
+        int64 startBlock, endBlock;
+    };
+
+    CriticalSection lock;
+    HashMap<int64, Block*, KeyHash> blocks;
+    HashMap<String, int> sourceIds;
+    Array<PinnedRegion> pinnedRegions;
+    Block* mostRecent;
+    Block* leastRecent;
+    const int samplesPerBlock;
+    int64 maxBytes, bytesUsed;
+    Statistics stats;
+
+    static int64 makeKey (int sourceId, int64 blockIndex) noexcept;
+    void moveToFront (Block*) noexcept;
+    void unlink (Block*) noexcept;
+    void removeBlock (Block*);
+    void discardBlocksIfOverBudget();
+    int countPinsFor (int64 key) const noexcept;
+    void changePinCounts (int sourceId, int64 startSample, int64 numSamples, int delta);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioBlockCache);
+};
+
+
+//==============================================================================
+/**
+    An AudioFormatReader which wraps another reader, and gets its data via an
+    AudioBlockCache, so that it can share decoded blocks with other readers of the
+    same source.
+
+    @see AudioBlockCache
+*/
+class JUCE_API  AudioBlockCacheReader  : public AudioFormatReader
+{
+public:
+    //==============================================================================
+    /** Creates a reader.
+
+        @param sourceReader             the reader to use to decode any blocks that aren't in the cache
+        @param sourceName               a name that identifies the data that the source reader will
+                                        produce - for files, use AudioBlockCache::getSourceNameFor()
+        @param cache                    the cache to use - this must not be deleted while the reader exists
+        @param deleteSourceWhenDeleted  if true, the sourceReader object will be deleted when
+                                        this object is deleted.
+    */
+    AudioBlockCacheReader (AudioFormatReader* sourceReader,
+                           const String& sourceName,
+                           AudioBlockCache& cache,
+                           bool deleteSourceWhenDeleted);
+
+    /** Destructor. */
+    ~AudioBlockCacheReader();
+
+    /** Returns the ID of the source within the cache. */
+    int getSourceId() const noexcept                        { return sourceId; }
+
+    //==============================================================================
+    bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                      int64 startSampleInFile, int numSamples);
+
+private:
+    //==============================================================================
+    AudioFormatReader* const source;
+    AudioBlockCache& cache;
+    const int sourceId;
+    const bool deleteSourceWhenDeleted;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioBlockCacheReader);
+};
+
+
+#endif   // __JUCE_AUDIOBLOCKCACHE_JUCEHEADER__
@@ -0,0 +1,342 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+AudioFileInfoCache::AudioFileInfoCache()
+{
+}
+
+AudioFileInfoCache::~AudioFileInfoCache()
+{
+    clear();
+}
+
+bool AudioFileInfoCache::getCachedInfo (const File& file, const int64 fileSize, Time modificationTime,
+                                        AudioStreamInfo& result) const
+{
+    const ScopedLock sl (lock);
+    const Entry* const e = entries [file.getFullPathName()];
+
+    if (e == nullptr
+         || e->fileSize != fileSize
+         || e->modificationTime != modificationTime.toMilliseconds())
+        return false;
+
+    result = e->info;
+    return true;
+}
+
+void AudioFileInfoCache::setInfo (const File& file, const int64 fileSize, Time modificationTime,
+                                  const AudioStreamInfo& info)
+{
+    const String path (file.getFullPathName());
+    const ScopedLock sl (lock);
+
+    Entry* e = entries [path];
+
+    if (e == nullptr)
+    {
+        e = new Entry();
+        entries.set (path, e);
+    }
+
+    e->fileSize = fileSize;
+    e->modificationTime = modificationTime.toMilliseconds();
+    e->info = info;
+}
+
+void AudioFileInfoCache::removeFile (const File& file)
+{
+    const String path (file.getFullPathName());
+    const ScopedLock sl (lock);
+
+    delete entries [path];
+    entries.remove (path);
+}
+
+void AudioFileInfoCache::clear()
+{
+    const ScopedLock sl (lock);
+
+    for (HashMap<String, Entry*>::Iterator i (entries); i.next();)
+        delete i.getValue();
+
+    entries.clear();
+}
+
+int AudioFileInfoCache::getNumEntries() const
+{
+    const ScopedLock sl (lock);
+    return entries.size();
+}
+
+//==============================================================================
+namespace AudioFileInfoCacheHelpers
+{
+    static const int magicNumber = (int) ByteOrder::littleEndianInt ("jafc");
+    static const int formatVersion = 1;
+}
+
+void AudioFileInfoCache::saveTo (OutputStream& out) const
+{
+    using namespace AudioFileInfoCacheHelpers;
+    const ScopedLock sl (lock);
+
+    out.writeInt (magicNumber);
+    out.writeInt (formatVersion);
+    out.writeInt (entries.size());
+
+    for (HashMap<String, Entry*>::Iterator i (entries); i.next();)
+    {
+        const Entry& e = *i.getValue();
+        const AudioStreamInfo& info = e.info;
+
+        out.writeString (i.getKey());
+        out.writeInt64 (e.fileSize);
+        out.writeInt64 (e.modificationTime);
+        out.writeString (info.formatName);
+        out.writeDouble (info.sampleRate);
+        out.writeInt ((int) info.numChannels);
+        out.writeInt ((int) info.bitsPerSample);
+        out.writeInt64 (info.lengthInSamples);
+        out.writeBool (info.usesFloatingPointData);
+
+        const StringArray& keys = info.metadataValues.getAllKeys();
+        const StringArray& values = info.metadataValues.getAllValues();
+        out.writeInt (keys.size());
+
+        for (int j = 0; j < keys.size(); ++j)
+        {
+            out.writeString (keys[j]);
+            out.writeString (values[j]);
+        }
+    }
+}
+
+bool AudioFileInfoCache::loadFrom (InputStream& in)
+{
+    using namespace AudioFileInfoCacheHelpers;
+
+    if (in.readInt() != magicNumber || in.readInt() != formatVersion)
+        return false;
+
+    const ScopedLock sl (lock);
+    clear();
+
+    for (int numEntries = in.readInt(); --numEntries >= 0 && ! in.isExhausted();)
+    {
+        const String path (in.readString());
+        ScopedPointer<Entry> e (new Entry());
+        AudioStreamInfo& info = e->info;
+
+        e->fileSize = in.readInt64();
+        e->modificationTime = in.readInt64();
+        info.formatName = in.readString();
+        info.sampleRate = in.readDouble();
+        info.numChannels = (unsigned int) in.readInt();
+        info.bitsPerSample = (unsigned int) in.readInt();
+        info.lengthInSamples = in.readInt64();
+        info.usesFloatingPointData = in.readBool();
+
+        for (int numValues = in.readInt(); --numValues >= 0 && ! in.isExhausted();)
+        {
+            const String key (in.readString());
+            info.metadataValues.set (key, in.readString());
+        }
+
+        delete entries [path];
+        entries.set (path, e.release());
+    }
+
+    return true;
+}
+
+//==============================================================================
+class AudioFileScanner::ScanJob  : public ThreadPoolJob
+{
+public:
+    ScanJob (AudioFileScanner& owner_)
+        : ThreadPoolJob ("Audio file scan"), owner (owner_)
+    {
+    }
+
+    JobStatus runJob()
+    {
+        owner.scanNextFiles();
+        return jobHasFinished;
+    }
+
+private:
+    AudioFileScanner& owner;
+
+    JUCE_DECLARE_NON_COPYABLE (ScanJob);
+};
+
+//==============================================================================
+AudioFileScanner::AudioFileScanner (AudioFormatManager& formatManager_, AudioFileInfoCache* const cache_)
+    : formatManager (formatManager_),
+      cache (cache_),
+      shouldCancel (false)
+{
+}
+
+AudioFileScanner::~AudioFileScanner()
+{
+}
+
+int AudioFileScanner::scanDirectory (const File& directory, const bool recursive, const int numThreads)
+{
+    // DirectoryIterator can only match a single pattern, so we have to check each
+    // file against all the formats' wildcards ourselves..
+    StringArray wildcards;
+    wildcards.addTokens (formatManager.getWildcardForAllFormats(), ";", String::empty);
+
+    Array<File> files;
+    DirectoryIterator iter (directory, recursive, "*", File::findFiles);
+
+    while (iter.next() && ! shouldCancel)
+    {
+        const File& file = iter.getFile();
+        const String fileName (file.getFileName());
+
+        for (int i = 0; i < wildcards.size(); ++i)
+        {
+            if (fileName.matchesWildcard (wildcards[i], ! File::areFileNamesCaseSensitive()))
+            {
+                files.add (file);
+                break;
+            }
+        }
+    }
+
+    return scanFiles (files, numThreads);
+}
+
+int AudioFileScanner::scanFiles (const Array<File>& files, const int numThreads)
+{
+    filesToScan = files;
+    audioFiles.clearQuick();
+    audioFileInfo.clearQuick();
+    results.clearQuick();
+    results.insertMultiple (0, AudioStreamInfo(), files.size());
+    nextFileIndex = 0;
+    numFilesDone = 0;
+    numFilesToScan = files.size();
+    numCacheHits = 0;
+
+    if (! shouldCancel)
+    {
+        // The calling thread does its share of the work too..
+        const int numExtraThreads = jmin (numThreads, files.size()) - 1;
+
+        if (numExtraThreads > 0)
+        {
+            ThreadPool pool (numExtraThreads);
+            OwnedArray<ScanJob> jobs;
+
+            for (int i = 0; i < numExtraThreads; ++i)
+            {
+                ScanJob* const job = new ScanJob (*this);
+                jobs.add (job);
+                pool.addJob (job, false);
+            }
+
+            scanNextFiles();
+
+            for (int i = 0; i < jobs.size(); ++i)
+                pool.waitForJobToFinish (jobs.getUnchecked (i), -1);
+        }
+        else
+        {
+            scanNextFiles();
+        }
+    }
+
+    for (int i = 0; i < filesToScan.size(); ++i)
+    {
+        if (results.getReference (i).formatName.isNotEmpty())
+        {
+            audioFiles.add (filesToScan.getReference (i));
+            audioFileInfo.add (results.getReference (i));
+        }
+    }
+
+    filesToScan.clear();
+    results.clear();
+    shouldCancel = false;
+    return audioFiles.size();
+}
+
+void AudioFileScanner::cancel() noexcept
+{
+    shouldCancel = true;
+}
+
+float AudioFileScanner::getProgress() const noexcept
+{
+    const int numFiles = numFilesToScan.get();
+    return numFiles > 0 ? jlimit (0.0f, 1.0f, numFilesDone.get() / (float) numFiles) : 0.0f;
+}
+
+void AudioFileScanner::scanNextFiles()
+{
+    for (;;)
+    {
+        const int index = (++nextFileIndex) - 1;
+
+        if (index >= filesToScan.size() || shouldCancel)
+            break;
+
+        scanFile (index);
+        ++numFilesDone;
+    }
+}
+
+void AudioFileScanner::scanFile (const int index)
+{
+    const File& file = filesToScan.getReference (index);
+    AudioStreamInfo& result = results.getReference (index);
+
+    if (cache != nullptr)
+    {
+        const int64 size = file.getSize();
+        const Time modTime (file.getLastModificationTime());
+
+        if (cache->getCachedInfo (file, size, modTime, result))
+        {
+            ++numCacheHits;
+            return;
+        }
+
+        if (! formatManager.readStreamInfo (file, result))
+            result = AudioStreamInfo();
+
+        cache->setInfo (file, size, modTime, result);
+    }
+    else
+    {
+        if (! formatManager.readStreamInfo (file, result))
+            result = AudioStreamInfo();
+    }
+}
@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_AUDIOFILESCANNER_JUCEHEADER__
+#define __JUCE_AUDIOFILESCANNER_JUCEHEADER__
+
+#include "juce_AudioFormatManager.h"
+
+
+//==============================================================================
+/**
+    Remembers the properties of a set of audio files, so that they don't need to
+    be read again unless the files change.
+
+    Entries are keyed by the file's path, and are only used if the file's size and
+    modification time still match the ones that were stored with them. Files that
+    turned out not to be readable audio files are remembered too, with an empty
+    format name, so that they can also be skipped when a directory is rescanned.
+
+    The cache can be saved to and re-loaded from a stream. All its methods are
+    thread-safe.
+
+    @see AudioFileScanner
+*/
+class JUCE_API  AudioFileInfoCache
+{
+public:
+    //==============================================================================
+    /** Creates an empty cache. */
+    AudioFileInfoCache();
+
+    /** Destructor. */
+    ~AudioFileInfoCache();
+
+    //==============================================================================
+    /** Looks for an up-to-date entry for a file.
+
+        @returns true if there's an entry for the file whose size and modification
+                 time match the ones given, in which case its details are copied into
+                 the result. If the file wasn't a readable audio file, the result's
+                 formatName will be empty.
+    */
+    bool getCachedInfo (const File& file, int64 fileSize, Time modificationTime,
+                        AudioStreamInfo& result) const;
+
+    /** Adds or replaces the entry for a file. */
+    void setInfo (const File& file, int64 fileSize, Time modificationTime,
+                  const AudioStreamInfo& info);
+
+    /** Removes any entry for a file. */
+    void removeFile (const File& file);
+
+    /** Removes all the entries. */
+    void clear();
+
+    /** Returns the number of files in the cache. */
+    int getNumEntries() const;
+
+    //==============================================================================
+    /** Writes the contents of the cache to a stream. */
+    void saveTo (OutputStream& output) const;
+
+    /** Replaces the contents of the cache with some data that was written by saveTo().
+        @returns false if the data wasn't in the right format
+    */
+    bool loadFrom (InputStream& input);
+
+private:
+    //==============================================================================
+    struct Entry
+    {
+        int64 fileSize, modificationTime;
+        AudioStreamInfo info;
+    };
+
+    CriticalSection lock;
+    HashMap<String, Entry*> entries;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioFileInfoCache);
+};
+
+
+//==============================================================================
+/**
+    Finds the audio files in a directory and reads their properties, using
+    several threads at once.
+
+    This uses AudioFormatManager::readStreamInfo() rather than creating readers, so
+    the formats only need to parse each file's headers. If you give it an
+    AudioFileInfoCache, any files that haven't changed since they were last scanned
+    won't be opened at all, and the cache will be updated with any new or changed
+    files.
+
+    @see AudioFileInfoCache, AudioFormatManager::readStreamInfo
+*/
+class JUCE_API  AudioFileScanner
+{
+public:
+    //==============================================================================
+    /** Creates a scanner.
+
+        @param formatManager    the formats to use - this must not be deleted while the scanner exists
+        @param cache            an optional cache to use - this must not be deleted while the scanner exists
+    */
+    AudioFileScanner (AudioFormatManager& formatManager,
+                      AudioFileInfoCache* cache = nullptr);
+
+    /** Destructor. */
+    ~AudioFileScanner();
+
+    //==============================================================================
+    /** Scans all the files in a directory that have extensions which one of the
+        formats recognises.
+
+        This blocks until the scan has finished or cancel() is called, and replaces
+        the results of any previous scan.
+
+        @param directory        the directory to search
+        @param recursive        whether to search its subdirectories too
+        @param numThreads       the number of threads to read the files with, including
+                                the one that calls this method
+        @returns the number of audio files that were found
+    */
+    int scanDirectory (const File& directory, bool recursive, int numThreads);
+
+    /** Scans a list of files.
+        @see scanDirectory
+    */
+    int scanFiles (const Array<File>& files, int numThreads);
+
+    /** Stops a scan that's in progress on another thread. */
+    void cancel() noexcept;
+
+    /** Returns the proportion of the current scan that has been completed, from 0 to 1.
+        This can be called from any thread.
+    */
+    float getProgress() const noexcept;
+
+    //==============================================================================
+    /** Returns the number of audio files that the last scan found. */
+    int getNumAudioFiles() const noexcept                       { return audioFiles.size(); }
+
+    /** Returns one of the audio files that the last scan found. */
+    const File& getAudioFile (int index) const noexcept         { return audioFiles.getReference (index); }
+
+    /** Returns the properties of one of the audio files that the last scan found. */
+    const AudioStreamInfo& getAudioFileInfo (int index) const noexcept  { return audioFileInfo.getReference (index); }
+
+    /** Returns the number of files in the last scan whose details came from the cache. */
+    int getNumCacheHits() const noexcept                        { return numCacheHits.get(); }
+
+private:
+    //==============================================================================
+    class ScanJob;
+    friend class ScanJob;
+
+    AudioFormatManager& formatManager;
+    AudioFileInfoCache* const cache;
+    Array<File> filesToScan, audioFiles;
+    Array<AudioStreamInfo> results, audioFileInfo;
+    Atomic<int> nextFileIndex, numFilesDone, numFilesToScan, numCacheHits;
+    volatile bool shouldCancel;
+
+    void scanNextFiles();
+    void scanFile (int index);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioFileScanner);
+};
+
+
+#endif   // __JUCE_AUDIOFILESCANNER_JUCEHEADER__
@@ -47,3 +47,14 @@ const String& AudioFormat::getFormatName() const                { return formatN
 const StringArray& AudioFormat::getFileExtensions() const       { return fileExtensions; }
 bool AudioFormat::isCompressed()                                { return false; }
 StringArray AudioFormat::getQualityOptions()                    { return StringArray(); }
+
+bool AudioFormat::readStreamInfo (InputStream& sourceStream, AudioStreamInfo& result)
+{
+    const ScopedPointer<AudioFormatReader> reader (createReaderFor (new SubregionStream (&sourceStream, sourceStream.getPosition(),
+                                                                                         -1, false), true));
+    if (reader == nullptr)
+        return false;
+
+    result.setFrom (*reader);
+    return true;
+}
@@ -28,6 +28,7 @@
 
 #include "juce_AudioFormatReader.h"
 #include "juce_AudioFormatWriter.h"
+#include "juce_AudioStreamInfo.h"
 
 
 //==============================================================================
@@ -113,6 +114,23 @@ public:
     virtual AudioFormatReader* createReaderFor (InputStream* sourceStream,
                                                 bool deleteStreamIfOpeningFails) = 0;
 
+    /** Reads the basic properties of a stream, without preparing to decode it.
+
+        This is intended for quickly cataloguing large numbers of files. Formats whose
+        readers have to do a lot of set-up work when they're created override it to just
+        parse the stream's headers. The default implementation simply creates a reader
+        and copies its properties.
+
+        This may be called on several threads at once.
+
+        @param sourceStream     the stream to read from. This won't be deleted, and its
+                                position will be left undefined
+        @param result           if the stream is recognised, this is filled in with its details
+        @returns true if the stream could be read by this format
+        @see AudioFormatManager::readStreamInfo
+    */
+    virtual bool readStreamInfo (InputStream& sourceStream, AudioStreamInfo& result);
+
     /** Tries to create an object that can write to a stream with this audio format.
 
         The writer object that is returned can be used to write to the stream, and
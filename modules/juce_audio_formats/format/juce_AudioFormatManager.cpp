@@ -146,6 +146,36 @@ AudioFormatReader* AudioFormatManager::createReaderFor (const File& file)
     return nullptr;
 }
 
+bool AudioFormatManager::readStreamInfo (const File& file, AudioStreamInfo& result)
+{
+    // you need to actually register some formats before the manager can
+    // use them to open a file!
+    jassert (getNumKnownFormats() > 0);
+
+    ScopedPointer<InputStream> in;
+
+    for (int i = 0; i < getNumKnownFormats(); ++i)
+    {
+        AudioFormat* const af = getKnownFormat(i);
+
+        if (af->canHandleFile (file))
+        {
+            if (in == nullptr)
+                in = file.createInputStream();
+            else
+                in->setPosition (0);
+
+            if (in == nullptr)
+                return false;
+
+            if (af->readStreamInfo (*in, result))
+                return true;
+        }
+    }
+
+    return false;
+}
+
 AudioFormatReader* AudioFormatManager::createReaderFor (InputStream* audioFileStream)
 {
     // you need to actually register some formats before the manager can
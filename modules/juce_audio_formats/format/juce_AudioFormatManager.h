@@ -128,6 +128,17 @@ public:
     */
     AudioFormatReader* createReaderFor (InputStream* audioFileStream);
 
+    /** Searches through the known formats for one that can read the properties
+        of this file.
+
+        This is much quicker than creating a reader for formats whose decoders have
+        a lot of set-up work to do, and is safe to call on several threads at once.
+
+        @returns true if one of the formats recognised the file
+        @see AudioFormat::readStreamInfo, AudioFileScanner
+    */
+    bool readStreamInfo (const File& audioFile, AudioStreamInfo& result);
+
 private:
     //==============================================================================
     OwnedArray<AudioFormat> knownFormats;
@@ -0,0 +1,788 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+namespace AudioPeakFileHelpers
+{
+    /*  File layout (all values little-endian):
+
+        int32   magic number
+        int32   version
+        int32   number of channels
+        int32   number of levels
+        double  sample rate
+        int64   length in samples
+        for each level:
+            int32   decimation factor
+            int32   (reserved)
+            int64   number of entries
+            int64   offset of the level's first entry from the start of the file
+
+        Each entry holds three 16-bit values for each channel: the minimum and maximum
+        levels (signed, where 32767 = 1.0), and the RMS level (unsigned, where 65535 = 1.0).
+    */
+    static const int magicNumber = (int) ByteOrder::littleEndianInt ("jpk1");
+    static const int currentVersion = 1;
+    static const int headerSize = 32;
+    static const int levelHeaderSize = 24;
+    static const int bytesPerChannelEntry = 6;
+
+    static int16 toMinimumValue (const float v) noexcept   { return (int16) jlimit (-32768, 32767, (int) std::floor (v * 32767.0f)); }
+    static int16 toMaximumValue (const float v) noexcept   { return (int16) jlimit (-32768, 32767, (int) std::ceil (v * 32767.0f)); }
+    static uint16 toRMSValue (const double v) noexcept     { return (uint16) jlimit (0, 65535, roundToInt (v * 65535.0)); }
+
+    static Array<int> sanitiseFactors (const Array<int>& requested)
+    {
+        SortedSet<int> sorted;
+
+        for (int i = 0; i < requested.size(); ++i)
+            if (requested.getUnchecked (i) > 0)
+                sorted.add (requested.getUnchecked (i));
+
+        Array<int> factors;
+
+        for (int i = 0; i < sorted.size(); ++i)
+        {
+            // all the factors must be multiples of the smallest one!
+            jassert (i == 0 || sorted.getUnchecked (i) % sorted.getUnchecked (0) == 0);
+
+            if (i == 0 || sorted.getUnchecked (i) % sorted.getUnchecked (0) == 0)
+                factors.add (sorted.getUnchecked (i));
+        }
+
+        return factors;
+    }
+
+    //==============================================================================
+    /** Accumulates blocks of levels into entries, and writes them to the level's
+        region of the output stream when enough have built up.
+    */
+    class LevelWriter
+    {
+    public:
+        LevelWriter (OutputStream& out_, const int decimationFactor_,
+                     const int numChannels_, const int64 fileOffset_)
+            : out (out_), decimationFactor (decimationFactor_), numChannels (numChannels_),
+              fileOffset (fileOffset_), numSamplesInEntry (0),
+              mins ((size_t) numChannels_), maxs ((size_t) numChannels_), sums ((size_t) numChannels_)
+        {
+            pending.preallocate (pendingLimit + 256);
+            resetEntry();
+        }
+
+        bool addBlock (const float* blockMins, const float* blockMaxs,
+                       const double* blockSums, const int numSamples)
+        {
+            for (int i = 0; i < numChannels; ++i)
+            {
+                mins[i] = jmin (mins[i], blockMins[i]);
+                maxs[i] = jmax (maxs[i], blockMaxs[i]);
+                sums[i] += blockSums[i];
+            }
+
+            numSamplesInEntry += numSamples;
+
+            return numSamplesInEntry < decimationFactor || writeEntry();
+        }
+
+        bool finish()
+        {
+            return (numSamplesInEntry == 0 || writeEntry()) && flush();
+        }
+
+    private:
+        OutputStream& out;
+        const int decimationFactor, numChannels;
+        int64 fileOffset;
+        int numSamplesInEntry;
+        HeapBlock<float> mins, maxs;
+        HeapBlock<double> sums;
+        MemoryOutputStream pending;
+
+        enum { pendingLimit = 65536 };
+
+        void resetEntry() noexcept
+        {
+            for (int i = 0; i < numChannels; ++i)
+            {
+                mins[i] = 1.0e6f;
+                maxs[i] = -1.0e6f;
+                sums[i] = 0;
+            }
+
+            numSamplesInEntry = 0;
+        }
+
+        bool writeEntry()
+        {
+            for (int i = 0; i < numChannels; ++i)
+            {
+                pending.writeShort (toMinimumValue (mins[i]));
+                pending.writeShort (toMaximumValue (maxs[i]));
+                pending.writeShort ((short) toRMSValue (std::sqrt (sums[i] / numSamplesInEntry)));
+            }
+
+            resetEntry();
+
+            return pending.getDataSize() < (size_t) pendingLimit || flush();
+        }
+
+        bool flush()
+        {
+            const int numBytes = (int) pending.getDataSize();
+
+            if (numBytes > 0)
+            {
+                if (! (out.setPosition (fileOffset) && out.write (pending.getData(), numBytes)))
+                    return false;
+
+                fileOffset += numBytes;
+                pending.reset();
+            }
+
+            return true;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (LevelWriter);
+    };
+}
+
+//==============================================================================
+AudioPeakFile::AudioPeakFile()
+    : data (nullptr),
+      numChannels (0),
+      lengthInSamples (0),
+      sampleRate (0)
+{
+}
+
+AudioPeakFile::~AudioPeakFile()
+{
+}
+
+Array<int> AudioPeakFile::getDefaultDecimationFactors()
+{
+    Array<int> factors;
+    factors.add (64);
+    factors.add (512);
+    factors.add (4096);
+    factors.add (32768);
+    return factors;
+}
+
+File AudioPeakFile::getPeakFileFor (const File& audioFile)
+{
+    return audioFile.getSiblingFile (audioFile.getFileName() + ".peaks");
+}
+
+bool AudioPeakFile::isPeakFileUpToDate (const File& audioFile, const File& peakFile)
+{
+    return peakFile.existsAsFile()
+            && peakFile.getLastModificationTime() >= audioFile.getLastModificationTime();
+}
+
+//==============================================================================
+bool AudioPeakFile::createPeakFile (AudioFormatReader& source, OutputStream& out,
+                                    const Array<int>& requestedFactors)
+{
+    using namespace AudioPeakFileHelpers;
+
+    const Array<int> factors (sanitiseFactors (requestedFactors.size() > 0 ? requestedFactors
+                                                                            : getDefaultDecimationFactors()));
+    const int numChannels = (int) source.numChannels;
+    const int64 length = source.lengthInSamples;
+
+    if (factors.size() == 0 || numChannels <= 0 || length < 0)
+        return false;
+
+    const int64 startOfFile = out.getPosition();
+    int64 levelOffset = startOfFile + headerSize + levelHeaderSize * factors.size();
+
+    out.writeInt (magicNumber);
+    out.writeInt (currentVersion);
+    out.writeInt (numChannels);
+    out.writeInt (factors.size());
+    out.writeDouble (source.sampleRate);
+    out.writeInt64 (length);
+
+    OwnedArray<LevelWriter> writers;
+
+    for (int i = 0; i < factors.size(); ++i)
+    {
+        const int64 numEntries = (length + factors.getUnchecked (i) - 1) / factors.getUnchecked (i);
+
+        out.writeInt (factors.getUnchecked (i));
+        out.writeInt (0);
+        out.writeInt64 (numEntries);
+        out.writeInt64 (levelOffset - startOfFile);
+
+        writers.add (new LevelWriter (out, factors.getUnchecked (i), numChannels, levelOffset));
+        levelOffset += numEntries * numChannels * bytesPerChannelEntry;
+    }
+
+    const int blockSize = factors.getFirst();
+    const int readSize = blockSize * jmax (1, 16384 / blockSize);
+
+    AudioSampleBuffer tempBuffer (numChannels, readSize);
+    float** const floatData = tempBuffer.getArrayOfChannels();
+    HeapBlock<float> mins ((size_t) numChannels), maxs ((size_t) numChannels);
+    HeapBlock<double> sums ((size_t) numChannels);
+
+    for (int64 pos = 0; pos < length;)
+    {
+        const int numToRead = (int) jmin ((int64) readSize, length - pos);
+
+        if (! source.read (reinterpret_cast<int* const*> (floatData), numChannels, pos, numToRead, false))
+            return false;
+
+        if (! source.usesFloatingPointData)
+        {
+            const float multiplier = 1.0f / 0x7fffffff;
+
+            for (int chan = 0; chan < numChannels; ++chan)
+            {
+                float* const d = floatData[chan];
+
+                for (int i = 0; i < numToRead; ++i)
+                    d[i] = *reinterpret_cast<int*> (d + i) * multiplier;
+            }
+        }
+
+        for (int blockStart = 0; blockStart < numToRead; blockStart += blockSize)
+        {
+            const int numInBlock = jmin (blockSize, numToRead - blockStart);
+
+            for (int chan = 0; chan < numChannels; ++chan)
+            {
+                const float* const d = floatData[chan] + blockStart;
+                findMinAndMax (d, numInBlock, mins[chan], maxs[chan]);
+
+                double sum = 0;
+                for (int i = 0; i < numInBlock; ++i)
+                    sum += d[i] * (double) d[i];
+
+                sums[chan] = sum;
+            }
+
+            for (int i = 0; i < writers.size(); ++i)
+                if (! writers.getUnchecked (i)->addBlock (mins, maxs, sums, numInBlock))
+                    return false;
+        }
+
+        pos += numToRead;
+    }
+
+    for (int i = 0; i < writers.size(); ++i)
+        if (! writers.getUnchecked (i)->finish())
+            return false;
+
+    out.flush();
+    return out.setPosition (levelOffset);
+}
+
+bool AudioPeakFile::createPeakFile (AudioFormatReader& source, const File& peakFile,
+                                    const Array<int>& decimationFactors)
+{
+    if (! peakFile.deleteFile())
+        return false;
+
+    bool ok = false;
+
+    {
+        FileOutputStream out (peakFile);
+
+        if (out.openedOk())
+            ok = createPeakFile (source, out, decimationFactors);
+    }
+
+    if (! ok)
+        peakFile.deleteFile();
+
+    return ok;
+}
+
+//==============================================================================
+bool AudioPeakFile::loadFrom (const File& peakFile)
+{
+    clear();
+
+    ScopedPointer<MemoryMappedFile> mmf (new MemoryMappedFile (peakFile, MemoryMappedFile::readOnly));
+
+    if (mmf->getData() == nullptr || ! parse (mmf->getData(), mmf->getSize()))
+        return false;
+
+    mappedFile = mmf;
+    return true;
+}
+
+bool AudioPeakFile::loadFrom (const void* const sourceData, const size_t numBytes)
+{
+    clear();
+
+    ownedData.replaceWith (sourceData, numBytes);
+
+    if (parse (ownedData.getData(), ownedData.getSize()))
+        return true;
+
+    ownedData.setSize (0);
+    return false;
+}
+
+void AudioPeakFile::clear()
+{
+    levels.clear();
+    data = nullptr;
+    numChannels = 0;
+    lengthInSamples = 0;
+    sampleRate = 0;
+    mappedFile = nullptr;
+    ownedData.setSize (0);
+}
+
+bool AudioPeakFile::parse (const void* const sourceData, const size_t numBytes)
+{
+    using namespace AudioPeakFileHelpers;
+
+    MemoryInputStream in (sourceData, numBytes, false);
+
+    if (numBytes < (size_t) headerSize
+         || in.readInt() != magicNumber
+         || in.readInt() != currentVersion)
+        return false;
+
+    const int numChans = in.readInt();
+    const int numLevels = in.readInt();
+    const double rate = in.readDouble();
+    const int64 length = in.readInt64();
+
+    if (numChans <= 0 || numLevels <= 0 || length < 0
+         || numBytes < (size_t) (headerSize + levelHeaderSize * numLevels))
+        return false;
+
+    Array<Level> newLevels;
+
+    for (int i = 0; i < numLevels; ++i)
+    {
+        Level level;
+        level.decimationFactor = in.readInt();
+        in.readInt();
+        level.numEntries = in.readInt64();
+        const int64 offset = in.readInt64();
+
+        if (level.decimationFactor <= 0
+             || level.numEntries != (length + level.decimationFactor - 1) / level.decimationFactor
+             || (i > 0 && level.decimationFactor <= newLevels.getReference (i - 1).decimationFactor)
+             || offset < 0
+             || (uint64) (offset + level.numEntries * numChans * bytesPerChannelEntry) > (uint64) numBytes)
+            return false;
+
+        level.entries = static_cast<const uint8*> (sourceData) + offset;
+        newLevels.add (level);
+    }
+
+    levels.swapWithArray (newLevels);
+    data = static_cast<const uint8*> (sourceData);
+    numChannels = numChans;
+    lengthInSamples = length;
+    sampleRate = rate;
+    return true;
+}
+
+bool AudioPeakFile::matches (const AudioFormatReader& reader) const noexcept
+{
+    return isLoaded()
+            && numChannels == (int) reader.numChannels
+            && lengthInSamples == reader.lengthInSamples
+            && sampleRate == reader.sampleRate;
+}
+
+//==============================================================================
+void AudioPeakFile::scanLevel (const int levelIndex, const int channel, const int64 start, const int64 end,
+                               int& lowest, int& highest, double& sumOfSquares, int64& count) const noexcept
+{
+    using namespace AudioPeakFileHelpers;
+
+    const Level& level = levels.getReference (levelIndex);
+    const int64 factor = level.decimationFactor;
+
+    int64 firstEntry, endEntry;
+
+    if (levelIndex == 0)
+    {
+        // the finest level has to be used for everything that's left, even if
+        // its entries overlap the ends of the range..
+        firstEntry = start / factor;
+        endEntry = (end + factor - 1) / factor;
+    }
+    else
+    {
+        firstEntry = (start + factor - 1) / factor;
+        endEntry = end / factor;
+
+        if (firstEntry >= endEntry)
+        {
+            scanLevel (levelIndex - 1, channel, start, end, lowest, highest, sumOfSquares, count);
+            return;
+        }
+
+        if (start < firstEntry * factor)
+            scanLevel (levelIndex - 1, channel, start, firstEntry * factor, lowest, highest, sumOfSquares, count);
+
+        if (endEntry * factor < end)
+            scanLevel (levelIndex - 1, channel, endEntry * factor, end, lowest, highest, sumOfSquares, count);
+    }
+
+    const int entrySize = numChannels * bytesPerChannelEntry;
+    const uint8* e = level.entries + firstEntry * entrySize + channel * bytesPerChannelEntry;
+
+    for (int64 i = firstEntry; i < endEntry; ++i)
+    {
+        const int numInEntry = (int) jmin (factor, lengthInSamples - i * factor);
+        const double rms = ByteOrder::littleEndianShort (e + 4) / 65535.0;
+
+        lowest  = jmin (lowest,  (int) (int16) ByteOrder::littleEndianShort (e));
+        highest = jmax (highest, (int) (int16) ByteOrder::littleEndianShort (e + 2));
+        sumOfSquares += rms * rms * numInEntry;
+        count += numInEntry;
+
+        e += entrySize;
+    }
+}
+
+bool AudioPeakFile::getLevels (const int channel, int64 startSample, int64 numSamples,
+                               float& lowestLevel, float& highestLevel, float& rmsLevel) const noexcept
+{
+    const int64 endSample = jmin (lengthInSamples, startSample + numSamples);
+    startSample = jmax ((int64) 0, startSample);
+
+    if (! (isLoaded() && isPositiveAndBelow (channel, numChannels) && startSample < endSample))
+        return false;
+
+    int levelIndex = 0;
+    while (levelIndex < levels.size() - 1
+            && levels.getReference (levelIndex + 1).decimationFactor <= endSample - startSample)
+        ++levelIndex;
+
+    int lowest = 32767, highest = -32768;
+    double sumOfSquares = 0;
+    int64 count = 0;
+
+    scanLevel (levelIndex, channel, startSample, endSample, lowest, highest, sumOfSquares, count);
+
+    lowestLevel  = lowest  / 32767.0f;
+    highestLevel = highest / 32767.0f;
+    rmsLevel = count > 0 ? (float) std::sqrt (sumOfSquares / count) : 0.0f;
+    return true;
+}
+
+//==============================================================================
+AudioPeakFileReader::AudioPeakFileReader (AudioFormatReader* const source_,
+                                          AudioPeakFile* const peakFile,
+                                          const bool deleteSourceWhenDeleted_)
+    : AudioFormatReader (nullptr, source_->getFormatName()),
+      source (source_),
+      peaks (peakFile),
+      deleteSourceWhenDeleted (deleteSourceWhenDeleted_)
+{
+    copySourceProperties();
+}
+
+AudioPeakFileReader::AudioPeakFileReader (AudioFormatReader* const source_,
+                                          const File& peakFile,
+                                          const bool deleteSourceWhenDeleted_)
+    : AudioFormatReader (nullptr, source_->getFormatName()),
+      source (source_),
+      peaks (new AudioPeakFile()),
+      deleteSourceWhenDeleted (deleteSourceWhenDeleted_)
+{
+    peaks->loadFrom (peakFile);
+    copySourceProperties();
+}
+
+AudioPeakFileReader::~AudioPeakFileReader()
+{
+    if (deleteSourceWhenDeleted)
+        delete source;
+}
+
+void AudioPeakFileReader::copySourceProperties()
+{
+    sampleRate = source->sampleRate;
+    bitsPerSample = source->bitsPerSample;
+    lengthInSamples = source->lengthInSamples;
+    numChannels = source->numChannels;
+    usesFloatingPointData = source->usesFloatingPointData;
+    metadataValues = source->metadataValues;
+
+    // A table that was made for a different version of the audio is no use to us..
+    if (peaks != nullptr && ! peaks->matches (*source))
+        peaks = nullptr;
+}
+
+bool AudioPeakFileReader::isUsingPeakFile() const noexcept
+{
+    return peaks != nullptr;
+}
+
+//==============================================================================
+bool AudioPeakFileReader::readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                                       int64 startSampleInFile, int numSamples)
+{
+    return source->readSamples (destSamples, numDestChannels, startOffsetInDestBuffer,
+                                startSampleInFile, numSamples);
+}
+
+void AudioPeakFileReader::readMaxLevels (int64 startSampleInFile, int64 numSamples,
+                                         float& lowestLeft, float& highestLeft,
+                                         float& lowestRight, float& highestRight)
+{
+    if (peaks == nullptr || numSamples < peaks->getFinestDecimationFactor())
+    {
+        source->readMaxLevels (startSampleInFile, numSamples,
+                               lowestLeft, highestLeft, lowestRight, highestRight);
+        return;
+    }
+
+    float rms;
+
+    if (! peaks->getLevels (0, startSampleInFile, numSamples, lowestLeft, highestLeft, rms))
+    {
+        lowestLeft = 0;
+        highestLeft = 0;
+        lowestRight = 0;
+        highestRight = 0;
+        return;
+    }
+
+    if (numChannels < 2 || ! peaks->getLevels (1, startSampleInFile, numSamples, lowestRight, highestRight, rms))
+    {
+        lowestRight = lowestLeft;
+        highestRight = highestLeft;
+    }
+}
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioPeakFileTests  : public UnitTest
+{
+public:
+    AudioPeakFileTests() : UnitTest ("AudioPeakFile") {}
+
+    enum { testLength = 100000 };
+
+    // A sine wave with a spike on the left, and a constant level with a negative spike on the right
+    static AudioSampleBuffer createSignal (const int numSamples)
+    {
+        AudioSampleBuffer buffer (2, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            *buffer.getSampleData (0, i) = (float) (0.5 * std::sin (2.0 * double_Pi * i / 1000.0));
+            *buffer.getSampleData (1, i) = -0.25f;
+        }
+
+        *buffer.getSampleData (0, jmin (54321, numSamples - 1)) = 0.9f;
+        *buffer.getSampleData (1, jmin (70001, numSamples - 1)) = -0.75f;
+        return buffer;
+    }
+
+    static bool writeWavFile (const File& file, const int numSamples)
+    {
+        const AudioSampleBuffer buffer (createSignal (numSamples));
+
+        if (! file.deleteFile())
+            return false;
+
+        WavAudioFormat wav;
+        ScopedPointer<AudioFormatWriter> writer (wav.createWriterFor (new FileOutputStream (file),
+                                                                      44100.0, 2, 24, StringPairArray(), 0));
+
+        return writer != nullptr && writer->writeFromAudioSampleBuffer (buffer, 0, numSamples);
+    }
+
+    static AudioFormatReader* createReaderFor (const File& file)
+    {
+        WavAudioFormat wav;
+        return wav.createReaderFor (new FileInputStream (file), true);
+    }
+
+    static void findExactLevels (const AudioSampleBuffer& audio, const int channel, const int start, const int end,
+                                 float& lowest, float& highest, float& rms)
+    {
+        const float* const d = audio.getSampleData (channel, start);
+        findMinAndMax (d, end - start, lowest, highest);
+
+        double sum = 0;
+        for (int i = 0; i < end - start; ++i)
+            sum += d[i] * (double) d[i];
+
+        rms = (float) std::sqrt (sum / (end - start));
+    }
+
+    // The table may look at up to one entry beyond each end of the range, and rounds its
+    // levels outwards, so its results must lie between the exact levels of the range and
+    // those of the range rounded out to the finest entries.
+    void checkLevels (const AudioPeakFile& peaks, const AudioSampleBuffer& audio, const int start, const int num)
+    {
+        const int factor = peaks.getFinestDecimationFactor();
+        const int end = jmin (start + num, audio.getNumSamples());
+        const int outerStart = (start / factor) * factor;
+        const int outerEnd = jmin (((end + factor - 1) / factor) * factor, audio.getNumSamples());
+        const float step = 1.0f / 32767.0f + 1.0e-6f;
+
+        for (int chan = 0; chan < audio.getNumChannels(); ++chan)
+        {
+            float lowest, highest, rms, exactLowest, exactHighest, exactRMS, outerLowest, outerHighest, outerRMS;
+            findExactLevels (audio, chan, start, end, exactLowest, exactHighest, exactRMS);
+            findExactLevels (audio, chan, outerStart, outerEnd, outerLowest, outerHighest, outerRMS);
+
+            expect (peaks.getLevels (chan, start, num, lowest, highest, rms));
+            expect (lowest <= exactLowest && lowest >= outerLowest - step,
+                    "lowest level " + String (lowest) + " for " + String (start) + " to " + String (end));
+            expect (highest >= exactHighest && highest <= outerHighest + step,
+                    "highest level " + String (highest) + " for " + String (start) + " to " + String (end));
+
+            if (start == outerStart && end == outerEnd)
+                expect (std::abs (rms - exactRMS) < 0.001f,
+                        "RMS level " + String (rms) + " for " + String (start) + " to " + String (end));
+        }
+    }
+
+    void runTest()
+    {
+        const File audioFile (File::createTempFile (".wav"));
+        const File peakFile (AudioPeakFile::getPeakFileFor (audioFile));
+
+        beginTest ("Peak levels");
+
+        {
+            expect (writeWavFile (audioFile, testLength));
+            ScopedPointer<AudioFormatReader> reader (createReaderFor (audioFile));
+            expect (reader != nullptr && reader->lengthInSamples == testLength);
+
+            // (compare against the samples as they come back from the file, after being quantised)
+            AudioSampleBuffer audio (2, testLength);
+            reader->read (&audio, 0, testLength, 0, true, true);
+
+            expect (AudioPeakFile::createPeakFile (*reader, peakFile));
+
+            AudioPeakFile peaks;
+            expect (peaks.loadFrom (peakFile));
+            expect (peaks.matches (*reader));
+            expectEquals (peaks.getNumChannels(), 2);
+            expectEquals (peaks.getNumLevels(), 4);
+            expectEquals (peaks.getFinestDecimationFactor(), 64);
+            expect (peaks.getLengthInSamples() == testLength);
+
+            checkLevels (peaks, audio, 0, testLength);
+            checkLevels (peaks, audio, 640, 64000);
+            checkLevels (peaks, audio, 32768, 32768);
+            checkLevels (peaks, audio, 54272, 64);
+            checkLevels (peaks, audio, 99968, 32);
+            checkLevels (peaks, audio, 1000, 50000);
+            checkLevels (peaks, audio, 54300, 10);
+            checkLevels (peaks, audio, 65537, 33000);
+
+            float lowest, highest, rms;
+            expect (peaks.getLevels (0, 54272, 64, lowest, highest, rms));
+            expect (std::abs (highest - 0.9f) < 0.0001f, "the spike was lost");
+            expect (peaks.getLevels (1, 0, testLength, lowest, highest, rms));
+            expect (std::abs (lowest + 0.75f) < 0.0001f, "the spike was lost");
+
+            expect (! peaks.getLevels (2, 0, 100, lowest, highest, rms));
+            expect (! peaks.getLevels (0, testLength, 100, lowest, highest, rms));
+
+            beginTest ("Peak file reader");
+
+            AudioPeakFileReader peakReader (createReaderFor (audioFile), peakFile, true);
+            expect (peakReader.isUsingPeakFile());
+            expect (peakReader.lengthInSamples == testLength);
+
+            float l1, h1, l2, h2, exactL1, exactH1, exactL2, exactH2;
+            peakReader.readMaxLevels (32768, 32768, l1, h1, l2, h2);
+            reader->readMaxLevels (32768, 32768, exactL1, exactH1, exactL2, exactH2);
+
+            const float step = 1.0f / 32767.0f + 1.0e-6f;
+            expect (l1 <= exactL1 && l1 >= exactL1 - step);
+            expect (h1 >= exactH1 && h1 <= exactH1 + step);
+            expect (l2 <= exactL2 && l2 >= exactL2 - step);
+            expect (h2 >= exactH2 && h2 <= exactH2 + step);
+
+            // (regions shorter than the finest entries are read from the audio)
+            peakReader.readMaxLevels (54300, 10, l1, h1, l2, h2);
+            reader->readMaxLevels (54300, 10, exactL1, exactH1, exactL2, exactH2);
+            expect (l1 == exactL1 && h1 == exactH1 && l2 == exactL2 && h2 == exactH2);
+        }
+
+        beginTest ("Invalidation");
+
+        {
+            expect (AudioPeakFile::isPeakFileUpToDate (audioFile, peakFile));
+
+            audioFile.setLastModificationTime (peakFile.getLastModificationTime() + RelativeTime (10.0));
+            expect (! AudioPeakFile::isPeakFileUpToDate (audioFile, peakFile), "a peak file older than its audio was accepted");
+
+            // rewrite the audio with a different length, so the old table no longer describes it
+            expect (writeWavFile (audioFile, testLength / 2));
+
+            {
+                AudioPeakFileReader peakReader (createReaderFor (audioFile), peakFile, true);
+                expect (! peakReader.isUsingPeakFile(), "a table for a different length was used");
+                expect (peakReader.lengthInSamples == testLength / 2);
+
+                float l1, h1, l2, h2;
+                peakReader.readMaxLevels (0, testLength / 2, l1, h1, l2, h2);
+                expect (std::abs (h1 - 0.9f) < 0.0001f && std::abs (l2 + 0.75f) < 0.0001f);
+            }
+
+            MemoryBlock peakData;
+            expect (peakFile.loadFileAsData (peakData));
+
+            AudioPeakFile peaks;
+            expect (peaks.loadFrom (peakData.getData(), peakData.getSize()));
+
+            expect (! peaks.loadFrom (peakData.getData(), peakData.getSize() - 1), "a truncated table was loaded");
+            expect (! peaks.isLoaded());
+
+            peakData[0] = (char) (peakData[0] + 1);
+            expect (! peaks.loadFrom (peakData.getData(), peakData.getSize()), "a table with a bad header was loaded");
+
+            peakFile.deleteFile();
+            expect (! AudioPeakFile::isPeakFileUpToDate (audioFile, peakFile));
+            expect (! peaks.loadFrom (peakFile));
+
+            AudioPeakFileReader peakReader (createReaderFor (audioFile), peakFile, true);
+            expect (! peakReader.isUsingPeakFile());
+        }
+
+        audioFile.deleteFile();
+        peakFile.deleteFile();
+    }
+};
+
+static AudioPeakFileTests audioPeakFileUnitTests;
+
+#endif
@@ -0,0 +1,251 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_AUDIOPEAKFILE_JUCEHEADER__
+#define __JUCE_AUDIOPEAKFILE_JUCEHEADER__
+
+#include "juce_AudioFormatReader.h"
+
+
+//==============================================================================
+/**
+    A multi-resolution table of min/max/RMS levels for an audio stream, which can
+    be stored in a compact sidecar file next to the audio.
+
+    The table holds several "levels", each of which summarises the audio in blocks
+    of a fixed number of samples (the decimation factor). Once a peak file has been
+    created, the levels for any region can be found by looking at a handful of
+    entries from the most suitable level, without needing to read or decode any of
+    the audio itself.
+
+    Use createPeakFile() to scan a reader and write the table, and then load it with
+    loadFrom() (which memory-maps the file) to query it. The easiest way to use one
+    is with an AudioPeakFileReader, which will answer readMaxLevels() calls using
+    the table.
+
+    Each entry stores its levels as 16-bit values, so samples with a magnitude
+    beyond 1.0 are clipped in the table.
+
+    @see AudioPeakFileReader
+*/
+class JUCE_API  AudioPeakFile
+{
+public:
+    //==============================================================================
+    /** Creates an empty peak table - use loadFrom() to give it some data. */
+    AudioPeakFile();
+
+    /** Destructor. */
+    ~AudioPeakFile();
+
+    //==============================================================================
+    /** Scans the whole of a reader and writes its peak table to a stream.
+
+        The stream must support setPosition(), because the levels are written
+        into their own regions of the file as the audio is scanned.
+
+        @param source               the reader to scan
+        @param destStream           the stream to write to
+        @param decimationFactors    the block sizes to use for each level. Each of these must
+                                    be a multiple of the smallest one. If the array is empty,
+                                    the factors returned by getDefaultDecimationFactors() are used
+        @returns true if the whole table was successfully written
+    */
+    static bool createPeakFile (AudioFormatReader& source,
+                                OutputStream& destStream,
+                                const Array<int>& decimationFactors = Array<int>());
+
+    /** Scans the whole of a reader and writes its peak table to a file.
+        If the file already exists, it'll be overwritten. If the operation fails,
+        the partially-written file is deleted.
+        @see createPeakFile
+    */
+    static bool createPeakFile (AudioFormatReader& source,
+                                const File& peakFile,
+                                const Array<int>& decimationFactors = Array<int>());
+
+    /** Returns the set of decimation factors used if none are specified: 64, 512, 4096 and 32768. */
+    static Array<int> getDefaultDecimationFactors();
+
+    /** Returns the conventional location of the peak file for an audio file.
+        This is the same file with ".peaks" appended to its name.
+    */
+    static File getPeakFileFor (const File& audioFile);
+
+    /** Returns true if the peak file exists and is newer than the audio file it describes. */
+    static bool isPeakFileUpToDate (const File& audioFile, const File& peakFile);
+
+    //==============================================================================
+    /** Memory-maps a peak file and prepares it for reading.
+        Returns false if the file doesn't exist or isn't a valid peak file.
+    */
+    bool loadFrom (const File& peakFile);
+
+    /** Loads a peak table from a block of data which was written by createPeakFile().
+        The data is copied, so the caller needn't keep it around.
+        Returns false if the data isn't a valid peak table.
+    */
+    bool loadFrom (const void* data, size_t numBytes);
+
+    /** Clears any data that has been loaded. */
+    void clear();
+
+    /** Returns true if a valid table has been loaded. */
+    bool isLoaded() const noexcept                      { return data != nullptr; }
+
+    /** Returns true if the loaded table matches the length, channel count and
+        sample rate of the given reader.
+    */
+    bool matches (const AudioFormatReader& reader) const noexcept;
+
+    //==============================================================================
+    /** Returns the number of channels that the table describes. */
+    int getNumChannels() const noexcept                 { return numChannels; }
+
+    /** Returns the length of the audio that the table describes. */
+    int64 getLengthInSamples() const noexcept           { return lengthInSamples; }
+
+    /** Returns the sample rate of the audio that the table describes. */
+    double getSampleRate() const noexcept               { return sampleRate; }
+
+    /** Returns the number of levels in the table. */
+    int getNumLevels() const noexcept                   { return levels.size(); }
+
+    /** Returns the number of samples that each entry in one of the levels summarises. */
+    int getDecimationFactor (int level) const noexcept  { return levels [level].decimationFactor; }
+
+    /** Returns the smallest number of samples that the table can describe. */
+    int getFinestDecimationFactor() const noexcept      { return levels.size() > 0 ? levels.getReference (0).decimationFactor : 0; }
+
+    //==============================================================================
+    /** Finds the levels of one channel for a range of samples.
+
+        This picks the coarsest level that has entries smaller than the range, and only
+        drops down to the finer levels to fill in the edges, so the number of entries
+        that are examined stays small, regardless of the length of the range.
+
+        Because the finest level can't resolve anything shorter than its decimation factor,
+        the region examined may be up to one entry larger at each end than the range requested.
+
+        @returns false if the table isn't loaded, or if the range lies outside the audio
+    */
+    bool getLevels (int channel, int64 startSample, int64 numSamples,
+                    float& lowest, float& highest, float& rms) const noexcept;
+
+private:
+    //==============================================================================
+    struct Level
+    {
+        int decimationFactor;
+        int64 numEntries;
+        const uint8* entries;
+    };
+
+    ScopedPointer<MemoryMappedFile> mappedFile;
+    MemoryBlock ownedData;
+    const uint8* data;
+    Array<Level> levels;
+    int numChannels;
+    int64 lengthInSamples;
+    double sampleRate;
+
+    bool parse (const void* data, size_t numBytes);
+    void scanLevel (int level, int channel, int64 start, int64 end,
+                    int& lowest, int& highest, double& sumOfSquares, int64& count) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPeakFile);
+};
+
+
+//==============================================================================
+/**
+    An AudioFormatReader which wraps another reader, and uses an AudioPeakFile to
+    answer calls to readMaxLevels() without reading any of the audio.
+
+    All calls to read samples are passed straight through to the source reader, so
+    this can be used as a drop-in replacement for it - e.g. when giving a reader to
+    an AudioThumbnail, which will then be able to generate its data almost instantly.
+
+    If the peak file doesn't match the source reader, or if a region is too short to
+    be described by the table, the source reader is used instead.
+
+    @see AudioPeakFile
+*/
+class JUCE_API  AudioPeakFileReader  : public AudioFormatReader
+{
+public:
+    //==============================================================================
+    /** Creates a reader which uses a peak table that has already been loaded.
+
+        @param sourceReader             the reader from which any samples will be read
+        @param peakFile                 the table to use - this will be deleted by this object
+                                        when no longer needed
+        @param deleteSourceWhenDeleted  if true, the sourceReader object will be deleted when
+                                        this object is deleted.
+    */
+    AudioPeakFileReader (AudioFormatReader* sourceReader,
+                         AudioPeakFile* peakFile,
+                         bool deleteSourceWhenDeleted);
+
+    /** Creates a reader which loads the given peak file.
+
+        If the peak file is missing or out-of-date, this will simply pass all calls
+        through to the source reader - you can use AudioPeakFile::createPeakFile() to
+        generate it, e.g. on a background thread.
+    */
+    AudioPeakFileReader (AudioFormatReader* sourceReader,
+                         const File& peakFile,
+                         bool deleteSourceWhenDeleted);
+
+    /** Destructor. */
+    ~AudioPeakFileReader();
+
+    /** Returns true if the peak table is being used to answer readMaxLevels() calls. */
+    bool isUsingPeakFile() const noexcept;
+
+    //==============================================================================
+    bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                      int64 startSampleInFile, int numSamples);
+
+    void readMaxLevels (int64 startSample,
+                        int64 numSamples,
+                        float& lowestLeft,
+                        float& highestLeft,
+                        float& lowestRight,
+                        float& highestRight);
+
+private:
+    //==============================================================================
+    AudioFormatReader* const source;
+    ScopedPointer<AudioPeakFile> peaks;
+    const bool deleteSourceWhenDeleted;
+
+    void copySourceProperties();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPeakFileReader);
+};
+
+
+#endif   // __JUCE_AUDIOPEAKFILE_JUCEHEADER__
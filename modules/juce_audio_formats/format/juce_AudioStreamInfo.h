@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_AUDIOSTREAMINFO_JUCEHEADER__
+#define __JUCE_AUDIOSTREAMINFO_JUCEHEADER__
+
+#include "juce_AudioFormatReader.h"
+
+
+//==============================================================================
+/**
+    Describes the basic properties of a stream of audio data.
+
+    This holds the same information that an AudioFormatReader would report about
+    a stream, but it can be found much more cheaply with AudioFormat::readStreamInfo(),
+    which doesn't need to get a decoder ready.
+
+    @see AudioFormat::readStreamInfo, AudioFormatManager::readStreamInfo
+*/
+struct JUCE_API  AudioStreamInfo
+{
+    /** Creates an empty info object. */
+    AudioStreamInfo() noexcept
+        : sampleRate (0), numChannels (0), bitsPerSample (0),
+          lengthInSamples (0), usesFloatingPointData (false)
+    {
+    }
+
+    /** Copies the properties of a reader. */
+    void setFrom (const AudioFormatReader& reader)
+    {
+        formatName              = reader.getFormatName();
+        sampleRate              = reader.sampleRate;
+        numChannels             = reader.numChannels;
+        bitsPerSample           = reader.bitsPerSample;
+        lengthInSamples         = reader.lengthInSamples;
+        usesFloatingPointData   = reader.usesFloatingPointData;
+        metadataValues          = reader.metadataValues;
+    }
+
+    //==============================================================================
+    /** The name of the format that the stream uses. */
+    String formatName;
+
+    /** The sample rate of the stream. */
+    double sampleRate;
+
+    /** The number of channels in the stream. */
+    unsigned int numChannels;
+
+    /** The number of bits per sample, for formats that store integer samples. */
+    unsigned int bitsPerSample;
+
+    /** The total number of samples in the stream. */
+    int64 lengthInSamples;
+
+    /** True if the format decodes to floating-point data. */
+    bool usesFloatingPointData;
+
+    /** Any metadata that the format found in the stream's headers.
+        @see AudioFormatReader::metadataValues
+    */
+    StringPairArray metadataValues;
+};
+
+
+#endif   // __JUCE_AUDIOSTREAMINFO_JUCEHEADER__
@@ -0,0 +1,450 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+class MultiTrackRecorder::Track  : public AbstractFifo
+{
+public:
+    Track (AudioFormatWriter* w, const int bufferSize)
+        : AbstractFifo (bufferSize),
+          buffer ((int) w->getNumChannels(), bufferSize),
+          writer (w),
+          maxBacklog (0),
+          hasWriteError (false)
+    {
+    }
+
+    bool write (const float** data, const int numSamples) noexcept
+    {
+        int start1, size1, start2, size2;
+        prepareToWrite (numSamples, start1, size1, start2, size2);
+
+        if (size1 + size2 < numSamples)
+        {
+            ++numOverruns;
+            samplesDropped += numSamples;
+            return false;
+        }
+
+        for (int i = buffer.getNumChannels(); --i >= 0;)
+        {
+            buffer.copyFrom (i, start1, data[i], size1);
+            buffer.copyFrom (i, start2, data[i] + size1, size2);
+        }
+
+        finishedWrite (size1 + size2);
+
+        const int backlog = getNumReady();
+        if (backlog > maxBacklog.get())
+            maxBacklog = backlog;
+
+        return true;
+    }
+
+    // Called on the writer thread: writes up to numSamples from the FIFO.
+    void writeData (const int numSamples)
+    {
+        int start1, size1, start2, size2;
+        prepareToRead (numSamples, start1, size1, start2, size2);
+
+        if (! hasWriteError)
+        {
+            if ((size1 > 0 && ! writer->writeFromAudioSampleBuffer (buffer, start1, size1))
+                 || (size2 > 0 && ! writer->writeFromAudioSampleBuffer (buffer, start2, size2)))
+                hasWriteError = true;
+        }
+
+        samplesWritten += size1 + size2;
+        finishedRead (size1 + size2);
+    }
+
+    void resetStatistics() noexcept
+    {
+        numOverruns = 0;
+        samplesDropped = 0;
+        maxBacklog = getNumReady();
+    }
+
+    AudioSampleBuffer buffer;
+    ScopedPointer<AudioFormatWriter> writer;
+    Atomic<int> numOverruns, maxBacklog;
+    Atomic<int64> samplesDropped, samplesWritten;
+    volatile bool hasWriteError;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE (Track);
+};
+
+//==============================================================================
+MultiTrackRecorder::MultiTrackRecorder (const int numSamplesToBufferPerTrack, const int writeChunkSize)
+    : Thread ("Multi-track recorder"),
+      bufferSize (jmax (4096, numSamplesToBufferPerTrack)),
+      chunkSize (jmin (bufferSize / 2, ((jmax (1, writeChunkSize) + 4095) / 4096) * 4096))
+{
+}
+
+MultiTrackRecorder::~MultiTrackRecorder()
+{
+    stop();
+    clearTracks();
+}
+
+//==============================================================================
+int MultiTrackRecorder::addTrack (AudioFormatWriter* const writer)
+{
+    // you can't add tracks while recording!
+    jassert (! isRecording());
+
+    if (writer == nullptr || isRecording())
+    {
+        delete writer;
+        return -1;
+    }
+
+    tracks.add (new Track (writer, bufferSize));
+    return tracks.size() - 1;
+}
+
+int MultiTrackRecorder::addTrack (AudioFormat& format, const File& file,
+                                  double sampleRate, unsigned int numChannels, int bitsPerSample,
+                                  const StringPairArray& metadataValues, int qualityOptionIndex,
+                                  const int64 samplesToPreallocate)
+{
+    if (! file.deleteFile())
+        return -1;
+
+    // Make the stream's buffer big enough to hold a whole chunk, so that each chunk
+    // reaches the disk in a single write..
+    const int bytesPerChunk = chunkSize * (int) numChannels * jmax (1, bitsPerSample / 8);
+    ScopedPointer<FileOutputStream> out (new FileOutputStream (file, bytesPerChunk + 4096));
+
+    if (out->failedToOpen())
+        return -1;
+
+    if (samplesToPreallocate > 0)
+        out->preallocate (samplesToPreallocate * numChannels * jmax (1, bitsPerSample / 8));
+
+    AudioFormatWriter* const writer = format.createWriterFor (out, sampleRate, numChannels, bitsPerSample,
+                                                              metadataValues, qualityOptionIndex);
+    if (writer == nullptr)
+        return -1;
+
+    out.release();
+    return addTrack (writer);
+}
+
+void MultiTrackRecorder::clearTracks()
+{
+    // you can't remove tracks while recording!
+    jassert (! isRecording());
+
+    if (! isRecording())
+        tracks.clear();
+}
+
+//==============================================================================
+void MultiTrackRecorder::start()
+{
+    if (! isRecording())
+    {
+        isAcceptingData = 1;
+        startThread (8);
+    }
+}
+
+void MultiTrackRecorder::stop()
+{
+    isAcceptingData = 0;
+    numWritesInProgress.memoryBarrier();
+
+    // a write() that saw the flag before it was cleared may still be pushing data into
+    // a FIFO, so wait for it to finish before the final flush..
+    while (numWritesInProgress.get() != 0)
+        Thread::yield();
+
+    stopThread (-1);
+
+    // ..which happens here, once the writer thread has stopped, so that nothing can be
+    // left behind in the FIFOs.
+    while (writeNextChunks (true))
+    {}
+}
+
+bool MultiTrackRecorder::write (const int trackIndex, const float** data, const int numSamples) noexcept
+{
+    jassert (isPositiveAndBelow (trackIndex, tracks.size()));
+    jassert (numSamples <= bufferSize); // this block can never fit in the FIFO!
+
+    if (numSamples <= 0)
+        return true;
+
+    ++numWritesInProgress;
+    const bool ok = isAcceptingData.get() == 0 || tracks.getUnchecked (trackIndex)->write (data, numSamples);
+    --numWritesInProgress;
+
+    return ok;
+}
+
+//==============================================================================
+void MultiTrackRecorder::run()
+{
+    // The audio thread never signals us, so that it can't get held up by the OS -
+    // instead, we poll the tracks often enough to stay well ahead of the FIFOs.
+    while (! threadShouldExit())
+        if (! writeNextChunks (false))
+            wait (5);
+}
+
+bool MultiTrackRecorder::writeNextChunks (const bool flushEverything)
+{
+    bool anythingWritten = false;
+
+    for (int i = 0; i < tracks.size(); ++i)
+    {
+        Track& track = *tracks.getUnchecked (i);
+        const int numReady = track.getNumReady();
+
+        if (numReady >= chunkSize || (flushEverything && numReady > 0))
+        {
+            track.writeData (jmin (numReady, chunkSize));
+            anythingWritten = true;
+        }
+    }
+
+    return anythingWritten;
+}
+
+//==============================================================================
+int MultiTrackRecorder::getBacklog (const int trackIndex) const noexcept
+{
+    const Track* const t = tracks [trackIndex];
+    return t != nullptr ? t->getNumReady() : 0;
+}
+
+int MultiTrackRecorder::getMaximumBacklog (const int trackIndex) const noexcept
+{
+    const Track* const t = tracks [trackIndex];
+    return t != nullptr ? t->maxBacklog.get() : 0;
+}
+
+int MultiTrackRecorder::getNumOverruns (const int trackIndex) const noexcept
+{
+    const Track* const t = tracks [trackIndex];
+    return t != nullptr ? t->numOverruns.get() : 0;
+}
+
+int64 MultiTrackRecorder::getNumSamplesDropped (const int trackIndex) const noexcept
+{
+    const Track* const t = tracks [trackIndex];
+    return t != nullptr ? t->samplesDropped.get() : 0;
+}
+
+int64 MultiTrackRecorder::getNumSamplesWritten (const int trackIndex) const noexcept
+{
+    const Track* const t = tracks [trackIndex];
+    return t != nullptr ? t->samplesWritten.get() : 0;
+}
+
+bool MultiTrackRecorder::hasWriteErrorOccurred (const int trackIndex) const noexcept
+{
+    const Track* const t = tracks [trackIndex];
+    return t != nullptr && t->hasWriteError;
+}
+
+void MultiTrackRecorder::resetStatistics() noexcept
+{
+    for (int i = tracks.size(); --i >= 0;)
+        tracks.getUnchecked (i)->resetStatistics();
+}
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class MultiTrackRecorderTests  : public UnitTest
+{
+public:
+    MultiTrackRecorderTests() : UnitTest ("MultiTrackRecorder") {}
+
+    // A stream which makes its writer wait until the test lets it carry on, so that
+    // the recorder's FIFOs can be filled up.
+    class GatedMemoryOutputStream  : public MemoryOutputStream
+    {
+    public:
+        GatedMemoryOutputStream (MemoryBlock& destData, WaitableEvent& gate_)
+            : MemoryOutputStream (destData, false), gate (gate_)
+        {
+        }
+
+        bool write (const void* buffer, int howMany)
+        {
+            gate.wait();
+            return MemoryOutputStream::write (buffer, howMany);
+        }
+
+    private:
+        WaitableEvent& gate;
+
+        JUCE_DECLARE_NON_COPYABLE (GatedMemoryOutputStream);
+    };
+
+    static int getNumChannels (const int trackIndex) noexcept     { return trackIndex % 2 + 1; }
+
+    static AudioFormatWriter* createWriter (OutputStream* const out, const int numChannels)
+    {
+        WavAudioFormat wav;
+        return wav.createWriterFor (out, 44100.0, (unsigned int) numChannels, 24, StringPairArray(), 0);
+    }
+
+    static bool writeBlock (MultiTrackRecorder& recorder, const int trackIndex,
+                            const int numChannels, const float value, const int numSamples)
+    {
+        AudioSampleBuffer block (numChannels, numSamples);
+
+        for (int i = 0; i < numChannels; ++i)
+            for (int j = 0; j < numSamples; ++j)
+                *block.getSampleData (i, j) = value;
+
+        return recorder.write (trackIndex, (const float**) block.getArrayOfChannels(), numSamples);
+    }
+
+    // Reads back a whole WAV file, and checks that every sample has the given value.
+    void checkTrackData (const MemoryBlock& data, const int expectedLength, const float expectedValue)
+    {
+        WavAudioFormat wav;
+        ScopedPointer<AudioFormatReader> reader (wav.createReaderFor (new MemoryInputStream (data, false), true));
+
+        expect (reader != nullptr);
+
+        if (reader != nullptr)
+        {
+            expectEquals ((int) reader->lengthInSamples, expectedLength);
+
+            AudioSampleBuffer buffer ((int) reader->numChannels, expectedLength);
+            reader->read (&buffer, 0, expectedLength, 0, true, true);
+
+            bool allCorrect = true;
+
+            for (int i = 0; i < buffer.getNumChannels(); ++i)
+                for (int j = 0; j < expectedLength; ++j)
+                    if (std::abs (*buffer.getSampleData (i, j) - expectedValue) > 0.0001f)
+                        allCorrect = false;
+
+            expect (allCorrect, "the track's data is wrong");
+        }
+    }
+
+    void runTest()
+    {
+        beginTest ("Flushing partial chunks");
+
+        OwnedArray<MemoryBlock> trackData;
+
+        {
+            MultiTrackRecorder recorder (8192, 4096);
+
+            for (int i = 0; i < 3; ++i)
+            {
+                MemoryBlock* const data = new MemoryBlock();
+                trackData.add (data);
+                expectEquals (recorder.addTrack (createWriter (new MemoryOutputStream (*data, false), getNumChannels (i))), i);
+            }
+
+            recorder.start();
+
+            // (none of the tracks ever gets a whole chunk, so only stop() can write them)
+            for (int block = 0; block < 4; ++block)
+                for (int i = 0; i < recorder.getNumTracks(); ++i)
+                    expect (writeBlock (recorder, i, getNumChannels (i), 0.25f * (i + 1), 250));
+
+            recorder.stop();
+
+            for (int i = 0; i < recorder.getNumTracks(); ++i)
+            {
+                expectEquals ((int) recorder.getNumSamplesWritten (i), 1000);
+                expectEquals (recorder.getBacklog (i), 0);
+                expectEquals (recorder.getNumOverruns (i), 0);
+                expect (! recorder.hasWriteErrorOccurred (i));
+            }
+
+            beginTest ("Writing after stopping");
+
+            for (int i = 0; i < recorder.getNumTracks(); ++i)
+            {
+                writeBlock (recorder, i, getNumChannels (i), 0.9f, 500);
+
+                expectEquals (recorder.getBacklog (i), 0);
+                expectEquals ((int) recorder.getNumSamplesWritten (i), 1000);
+                expectEquals (recorder.getNumOverruns (i), 0);
+            }
+
+            recorder.clearTracks();
+        }
+
+        for (int i = 0; i < trackData.size(); ++i)
+            checkTrackData (*trackData.getUnchecked (i), 1000, 0.25f * (i + 1));
+
+        beginTest ("Overruns");
+        {
+            MemoryBlock data;
+            WaitableEvent gate (true);
+            gate.signal();
+
+            MultiTrackRecorder recorder (8192, 4096);
+            recorder.addTrack (createWriter (new GatedMemoryOutputStream (data, gate), 2));
+            recorder.start();
+
+            // While the writer is held up, nothing leaves the FIFO, which can hold 8191 samples..
+            gate.reset();
+
+            for (int i = 0; i < 8; ++i)
+                expect (writeBlock (recorder, 0, 2, 0.5f, 1000));
+
+            expectEquals (recorder.getNumOverruns (0), 0);
+            expectEquals (recorder.getMaximumBacklog (0), 8000);
+
+            expect (! writeBlock (recorder, 0, 2, 0.5f, 1000));
+            expectEquals (recorder.getNumOverruns (0), 1);
+            expectEquals ((int) recorder.getNumSamplesDropped (0), 1000);
+
+            expect (! writeBlock (recorder, 0, 2, 0.5f, 500));
+            expectEquals (recorder.getNumOverruns (0), 2);
+            expectEquals ((int) recorder.getNumSamplesDropped (0), 1500);
+
+            // ..but everything that was accepted still gets written once it's let through.
+            gate.signal();
+            recorder.stop();
+
+            expectEquals ((int) recorder.getNumSamplesWritten (0), 8000);
+            expectEquals (recorder.getBacklog (0), 0);
+
+            recorder.clearTracks();
+            checkTrackData (data, 8000, 0.5f);
+        }
+    }
+};
+
+static MultiTrackRecorderTests multiTrackRecorderTests;
+
+#endif
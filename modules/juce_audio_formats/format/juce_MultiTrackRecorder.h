@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_MULTITRACKRECORDER_JUCEHEADER__
+#define __JUCE_MULTITRACKRECORDER_JUCEHEADER__
+
+#include "juce_AudioFormat.h"
+
+
+//==============================================================================
+/**
+    Records many tracks at once, using a single background thread to write all of
+    them to disk.
+
+    This does the same job as a set of AudioFormatWriter::ThreadedWriter objects,
+    but is designed for recording large numbers of inputs. Each track has its own
+    lock-free FIFO, so the audio thread can push data into it without ever blocking
+    or signalling another thread. The writer thread polls the FIFOs and only writes
+    a track when it has accumulated a whole chunk of data, so the disk sees a small
+    number of large writes rather than lots of small ones.
+
+    To use it, add all your tracks, call start(), and then call write() from your
+    audio callback. When you've finished, call stop() to flush the remaining data
+    to disk, and clearTracks() (or delete the recorder) to close the files.
+
+    @see AudioFormatWriter::ThreadedWriter
+*/
+class JUCE_API  MultiTrackRecorder  : private Thread
+{
+public:
+    //==============================================================================
+    /** Creates an empty recorder.
+
+        @param numSamplesToBufferPerTrack   the size of each track's FIFO. This needs to be
+                                            big enough to cover the longest delay that you
+                                            expect the disk to cause
+        @param writeChunkSize               the number of samples that will be written to a
+                                            track in one go. This is rounded up to a multiple
+                                            of 4096, and bigger chunks mean fewer, larger writes
+    */
+    MultiTrackRecorder (int numSamplesToBufferPerTrack = 192000,
+                        int writeChunkSize = 16384);
+
+    /** Destructor.
+        This will stop the recorder, flushing any buffered data, and close all the tracks.
+    */
+    ~MultiTrackRecorder();
+
+    //==============================================================================
+    /** Adds a track which will be written with the given writer.
+
+        The writer will be owned and deleted by the recorder. Tracks can only be added
+        while the recorder is stopped.
+
+        @returns the index of the new track, or -1 if it couldn't be added
+    */
+    int addTrack (AudioFormatWriter* writer);
+
+    /** Creates a file and adds a track which will write to it.
+
+        If the file already exists, it'll be overwritten. If samplesToPreallocate is
+        greater than zero, the filesystem will be asked to reserve enough space for this
+        many samples, which helps to keep long recordings unfragmented.
+
+        @returns the index of the new track, or -1 if the file couldn't be created
+    */
+    int addTrack (AudioFormat& format,
+                  const File& file,
+                  double sampleRate,
+                  unsigned int numChannels,
+                  int bitsPerSample,
+                  const StringPairArray& metadataValues,
+                  int qualityOptionIndex,
+                  int64 samplesToPreallocate);
+
+    /** Deletes all the tracks, which closes their writers.
+        This can only be called while the recorder is stopped.
+    */
+    void clearTracks();
+
+    /** Returns the number of tracks that have been added. */
+    int getNumTracks() const noexcept                   { return tracks.size(); }
+
+    //==============================================================================
+    /** Starts the background thread. */
+    void start();
+
+    /** Stops the background thread, and writes all the data that's still buffered.
+        Any calls to write() that begin after this has been called will be ignored, and
+        any that are already in progress will be finished and flushed before it returns.
+    */
+    void stop();
+
+    /** Returns true if the recorder has been started. */
+    bool isRecording() const noexcept                   { return isThreadRunning(); }
+
+    //==============================================================================
+    /** Pushes some incoming audio data into one of the tracks.
+
+        This is safe to call from the audio thread - it never blocks, and if there's not
+        enough space in the track's FIFO for all of the data, the block is discarded,
+        the track's overrun counter is incremented, and the method returns false.
+
+        Each track must only be written to by one thread at a time, but different
+        tracks can be written to from different threads.
+
+        The data must be an array containing the same number of channels as the track's
+        writer is using. None of these channels can be null.
+    */
+    bool write (int trackIndex, const float** data, int numSamples) noexcept;
+
+    //==============================================================================
+    /** Returns the number of samples that are waiting in a track's FIFO to be written. */
+    int getBacklog (int trackIndex) const noexcept;
+
+    /** Returns the largest backlog that a track has had since the statistics were last reset. */
+    int getMaximumBacklog (int trackIndex) const noexcept;
+
+    /** Returns the number of blocks that were dropped from a track because its FIFO was full. */
+    int getNumOverruns (int trackIndex) const noexcept;
+
+    /** Returns the total number of samples that were dropped from a track because its FIFO was full. */
+    int64 getNumSamplesDropped (int trackIndex) const noexcept;
+
+    /** Returns the number of samples that have been passed to a track's writer. */
+    int64 getNumSamplesWritten (int trackIndex) const noexcept;
+
+    /** Returns true if a track's writer has reported an error. */
+    bool hasWriteErrorOccurred (int trackIndex) const noexcept;
+
+    /** Clears the overrun counters and maximum backlog values of all the tracks. */
+    void resetStatistics() noexcept;
+
+private:
+    //==============================================================================
+    class Track;
+    OwnedArray<Track> tracks;
+    const int bufferSize, chunkSize;
+    Atomic<int> isAcceptingData, numWritesInProgress;
+
+    void run();
+    bool writeNextChunks (bool flushEverything);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultiTrackRecorder);
+};
+
+
+#endif   // __JUCE_MULTITRACKRECORDER_JUCEHEADER__
@@ -99,12 +99,17 @@ namespace juce
 #endif
 
 #include "format/juce_AudioFormat.cpp"
+#include "format/juce_AudioBlockCache.cpp"
+#include "format/juce_AudioFileScanner.cpp"
 #include "format/juce_AudioFormatManager.cpp"
 #include "format/juce_AudioFormatReader.cpp"
 #include "format/juce_AudioFormatReaderSource.cpp"
 #include "format/juce_AudioFormatWriter.cpp"
+#include "format/juce_AudioPeakFile.cpp"
 #include "format/juce_AudioSubsectionReader.cpp"
+#include "format/juce_MultiTrackRecorder.cpp"
 #include "sampler/juce_Sampler.cpp"
+#include "sampler/juce_StreamingSampler.cpp"
 #include "codecs/juce_AiffAudioFormat.cpp"
 #include "codecs/juce_CoreAudioFormat.cpp"
 #include "codecs/juce_FlacAudioFormat.cpp"
@@ -80,6 +80,12 @@ namespace juce
 {
 
 // START_AUTOINCLUDE format, codecs, sampler
+#ifndef __JUCE_AUDIOBLOCKCACHE_JUCEHEADER__
+ #include "format/juce_AudioBlockCache.h"
+#endif
+#ifndef __JUCE_AUDIOFILESCANNER_JUCEHEADER__
+ #include "format/juce_AudioFileScanner.h"
+#endif
 #ifndef __JUCE_AUDIOFORMAT_JUCEHEADER__
  #include "format/juce_AudioFormat.h"
 #endif
@@ -95,9 +101,18 @@ namespace juce
 #ifndef __JUCE_AUDIOFORMATWRITER_JUCEHEADER__
  #include "format/juce_AudioFormatWriter.h"
 #endif
+#ifndef __JUCE_AUDIOPEAKFILE_JUCEHEADER__
+ #include "format/juce_AudioPeakFile.h"
+#endif
+#ifndef __JUCE_AUDIOSTREAMINFO_JUCEHEADER__
+ #include "format/juce_AudioStreamInfo.h"
+#endif
 #ifndef __JUCE_AUDIOSUBSECTIONREADER_JUCEHEADER__
  #include "format/juce_AudioSubsectionReader.h"
 #endif
+#ifndef __JUCE_MULTITRACKRECORDER_JUCEHEADER__
+ #include "format/juce_MultiTrackRecorder.h"
+#endif
 #include "codecs/juce_AiffAudioFormat.h"
 #include "codecs/juce_CoreAudioFormat.h"
 #include "codecs/juce_FlacAudioFormat.h"
@@ -109,6 +124,9 @@ namespace juce
 #ifndef __JUCE_SAMPLER_JUCEHEADER__
  #include "sampler/juce_Sampler.h"
 #endif
+#ifndef __JUCE_STREAMINGSAMPLER_JUCEHEADER__
+ #include "sampler/juce_StreamingSampler.h"
+#endif
 // END_AUTOINCLUDE
 
 }
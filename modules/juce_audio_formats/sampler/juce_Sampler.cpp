@@ -23,6 +23,150 @@
   ==============================================================================
 */
 
+namespace SamplerHelpers
+{
+    enum { blockSize = 256 };
+
+    // A Blackman-windowed sinc, tabulated so that it can be evaluated at any position
+    struct WindowedSincKernel
+    {
+        enum { halfWidth = 8, resolution = 512, tableSize = halfWidth * resolution };
+
+        WindowedSincKernel()
+        {
+            table[0] = 1.0f;
+
+            for (int i = 1; i < tableSize; ++i)
+            {
+                const double x = i / (double) resolution;
+                const double w = 0.42 + 0.5 * std::cos (double_Pi * x / halfWidth)
+                                      + 0.08 * std::cos (2.0 * double_Pi * x / halfWidth);
+
+                table[i] = (float) (w * std::sin (double_Pi * x) / (double_Pi * x));
+            }
+
+            table [tableSize] = 0.0f;
+            table [tableSize + 1] = 0.0f;
+        }
+
+        inline float valueAt (const float x) const noexcept
+        {
+            const float pos = std::abs (x) * (float) resolution;
+            const int index = (int) pos;
+
+            if (index >= tableSize)
+                return 0.0f;
+
+            return table [index] + (pos - index) * (table [index + 1] - table [index]);
+        }
+
+        float table [tableSize + 2];
+    };
+
+    static const WindowedSincKernel& getSincKernel()
+    {
+        static const WindowedSincKernel kernel;
+        return kernel;
+    }
+
+    //==============================================================================
+    struct LinearInterpolator
+    {
+        inline float valueAt (const float* in, int, const int pos, const float alpha) const noexcept
+        {
+            return in [pos] * (1.0f - alpha) + in [pos + 1] * alpha;
+        }
+    };
+
+    struct CubicInterpolator
+    {
+        inline float valueAt (const float* in, int, const int pos, const float alpha) const noexcept
+        {
+            const float xm1 = pos > 0 ? in [pos - 1] : 0.0f;
+            const float x0 = in [pos];
+            const float x1 = in [pos + 1];
+            const float x2 = in [pos + 2];
+
+            const float c1 = 0.5f * (x1 - xm1);
+            const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+            const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+
+            return ((c3 * alpha + c2) * alpha + c1) * alpha + x0;
+        }
+    };
+
+    struct SincInterpolator
+    {
+        // When reading faster than the source rate, the kernel is stretched so that
+        // its cut-off moves down to the output's Nyquist frequency.
+        SincInterpolator (const double pitchRatio)
+            : kernel (getSincKernel()),
+              step (1.0f / (float) jmax (1.0, pitchRatio)),
+              numTaps ((int) std::ceil (WindowedSincKernel::halfWidth / step))
+        {
+        }
+
+        inline float valueAt (const float* in, const int numIn, const int pos, const float alpha) const noexcept
+        {
+            const int first = pos - numTaps + 1;
+            const int last = pos + numTaps;
+            float x = (first - pos - alpha) * step;
+            float total = 0.0f;
+
+            if (first >= 0 && last < numIn)
+            {
+                for (int i = first; i <= last; ++i)
+                {
+                    total += in[i] * kernel.valueAt (x);
+                    x += step;
+                }
+            }
+            else
+            {
+                for (int i = first; i <= last; ++i)
+                {
+                    if (isPositiveAndBelow (i, numIn))
+                        total += in[i] * kernel.valueAt (x);
+
+                    x += step;
+                }
+            }
+
+            return total * step;
+        }
+
+        const WindowedSincKernel& kernel;
+        const float step;
+        const int numTaps;
+    };
+
+    //==============================================================================
+    // Fills a block with interpolated samples, stopping early if the position goes
+    // past the end of the sound.
+    template <class InterpolatorType>
+    static int interpolate (const InterpolatorType& interpolator,
+                            const float* const source, const int numSourceSamples,
+                            float* const dest, const int numSamples,
+                            double& position, const double delta, const double endPosition) noexcept
+    {
+        double pos = position;
+        int num = 0;
+
+        while (num < numSamples)
+        {
+            const int index = (int) pos;
+            dest [num++] = interpolator.valueAt (source, numSourceSamples, index, (float) (pos - index));
+            pos += delta;
+
+            if (pos > endPosition)
+                break;
+        }
+
+        position = pos;
+        return num;
+    }
+}
+
 //==============================================================================
 SamplerSound::SamplerSound (const String& name_,
                             AudioFormatReader& source,
@@ -61,6 +205,58 @@ SamplerSound::~SamplerSound()
 {
 }
 
+void SamplerSound::createMipMaps (const int maxNumLevels)
+{
+    using namespace SamplerHelpers;
+    const WindowedSincKernel& kernel = getSincKernel();
+    const int halfWidth = 2 * WindowedSincKernel::halfWidth;
+
+    mipMaps.clear();
+
+    if (data == nullptr)
+        return;
+
+    const AudioSampleBuffer* source = data;
+    int sourceLength = length;
+
+    while (mipMaps.size() < maxNumLevels && sourceLength > 1)
+    {
+        // Each level is low-pass filtered at half the Nyquist frequency of the level
+        // above, and then has every other sample removed.
+        const int newLength = (sourceLength + 1) / 2;
+        AudioSampleBuffer* const level = new AudioSampleBuffer (source->getNumChannels(), newLength + 4);
+        level->clear();
+
+        for (int chan = 0; chan < source->getNumChannels(); ++chan)
+        {
+            const float* const in = source->getSampleData (chan);
+            float* const out = level->getSampleData (chan);
+
+            for (int i = 0; i < newLength; ++i)
+            {
+                const int centre = i * 2;
+                const int first = jmax (0, centre - halfWidth + 1);
+                const int last = jmin (sourceLength - 1, centre + halfWidth - 1);
+                float total = 0.0f;
+
+                for (int j = first; j <= last; ++j)
+                    total += in[j] * kernel.valueAt ((j - centre) * 0.5f);
+
+                out[i] = total * 0.5f;
+            }
+        }
+
+        mipMaps.add (level);
+        source = level;
+        sourceLength = newLength;
+    }
+}
+
+const AudioSampleBuffer* SamplerSound::getDataForLevel (const int level) const noexcept
+{
+    return level > 0 ? mipMaps [level - 1] : data.get();
+}
+
 //==============================================================================
 bool SamplerSound::appliesToNote (const int midiNoteNumber)
 {
@@ -74,20 +270,33 @@ bool SamplerSound::appliesToChannel (const int /*midiChannel*/)
 
 
 //==============================================================================
-SamplerVoice::SamplerVoice()
-    : pitchRatio (0.0),
+SamplerVoice::SamplerVoice (const InterpolationQuality quality_)
+    : quality (quality_),
+      currentQuality (quality_),
+      pitchRatio (0.0),
+      levelPitchRatio (0.0),
       sourceSamplePosition (0.0),
+      levelLength (0.0),
       lgain (0.0f),
       rgain (0.0f),
+      mipMapLevel (0),
       isInAttack (false),
-      isInRelease (false)
+      isInRelease (false),
+      interpolatedData (2 * SamplerHelpers::blockSize)
 {
+    // make sure the shared table gets built here rather than on the audio thread
+    SamplerHelpers::getSincKernel();
 }
 
 SamplerVoice::~SamplerVoice()
 {
 }
 
+void SamplerVoice::setInterpolationQuality (const InterpolationQuality newQuality) noexcept
+{
+    quality = newQuality;
+}
+
 bool SamplerVoice::canPlaySound (SynthesiserSound* sound)
 {
     return dynamic_cast <const SamplerSound*> (sound) != nullptr;
@@ -108,6 +317,20 @@ void SamplerVoice::startNote (const int midiNoteNumber,
 
         pitchRatio = (targetFreq * sound->sourceSampleRate) / (naturalFreq * getSampleRate());
 
+        // When the sound is pitched up by an octave or more, read from one of its
+        // decimated levels (if it has any), so that fewer samples need to be skipped.
+        mipMapLevel = 0;
+        levelPitchRatio = pitchRatio;
+
+        while (levelPitchRatio >= 2.0 && mipMapLevel < sound->getNumMipMapLevels())
+        {
+            levelPitchRatio *= 0.5;
+            ++mipMapLevel;
+        }
+
+        levelLength = sound->length / (double) (1 << mipMapLevel);
+        currentQuality = quality;
+
         sourceSamplePosition = 0.0;
         lgain = velocity;
         rgain = velocity;
@@ -160,73 +383,109 @@ void SamplerVoice::controllerMoved (const int /*controllerNumber*/,
 }
 
 //==============================================================================
+int SamplerVoice::interpolateBlock (const float* const source, const int numSourceSamples,
+                                    float* const dest, const int numSamples, double& position) const noexcept
+{
+    using namespace SamplerHelpers;
+
+    switch (currentQuality)
+    {
+        case cubicInterpolation:
+            return interpolate (CubicInterpolator(), source, numSourceSamples, dest, numSamples,
+                                position, levelPitchRatio, levelLength);
+
+        case sincInterpolation:
+            return interpolate (SincInterpolator (levelPitchRatio), source, numSourceSamples, dest, numSamples,
+                                position, levelPitchRatio, levelLength);
+
+        default:
+            return interpolate (LinearInterpolator(), source, numSourceSamples, dest, numSamples,
+                                position, levelPitchRatio, levelLength);
+    }
+}
+
 void SamplerVoice::renderNextBlock (AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
 {
     const SamplerSound* const playingSound = static_cast <SamplerSound*> (getCurrentlyPlayingSound().get());
 
     if (playingSound != nullptr)
     {
-        const float* const inL = playingSound->data->getSampleData (0, 0);
-        const float* const inR = playingSound->data->getNumChannels() > 1
-                                    ? playingSound->data->getSampleData (1, 0) : nullptr;
+        const AudioSampleBuffer* const data = playingSound->getDataForLevel (mipMapLevel);
+        const int numSourceSamples = data->getNumSamples();
+        const float* const inL = data->getSampleData (0, 0);
+        const float* const inR = data->getNumChannels() > 1 ? data->getSampleData (1, 0) : nullptr;
 
         float* outL = outputBuffer.getSampleData (0, startSample);
         float* outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getSampleData (1, startSample) : nullptr;
 
-        while (--numSamples >= 0)
+        float* const interpolatedL = interpolatedData;
+        float* const interpolatedR = interpolatedData + SamplerHelpers::blockSize;
+
+        while (numSamples > 0)
         {
-            const int pos = (int) sourceSamplePosition;
-            const float alpha = (float) (sourceSamplePosition - pos);
-            const float invAlpha = 1.0f - alpha;
+            // Interpolate a whole block of each channel in one go, then apply the envelope..
+            double endPosition = sourceSamplePosition;
+            const int numThisTime = interpolateBlock (inL, numSourceSamples, interpolatedL,
+                                                      jmin (numSamples, (int) SamplerHelpers::blockSize),
+                                                      endPosition);
 
-            // just using a very simple linear interpolation here..
-            float l = (inL [pos] * invAlpha + inL [pos + 1] * alpha);
-            float r = (inR != nullptr) ? (inR [pos] * invAlpha + inR [pos + 1] * alpha)
-                                       : l;
+            if (inR != nullptr)
+            {
+                double pos = sourceSamplePosition;
+                interpolateBlock (inR, numSourceSamples, interpolatedR, numThisTime, pos);
+            }
 
-            l *= lgain;
-            r *= rgain;
+            sourceSamplePosition = endPosition;
 
-            if (isInAttack)
+            for (int i = 0; i < numThisTime; ++i)
             {
-                l *= attackReleaseLevel;
-                r *= attackReleaseLevel;
+                float l = interpolatedL[i];
+                float r = (inR != nullptr) ? interpolatedR[i] : l;
 
-                attackReleaseLevel += attackDelta;
+                l *= lgain;
+                r *= rgain;
 
-                if (attackReleaseLevel >= 1.0f)
+                if (isInAttack)
                 {
-                    attackReleaseLevel = 1.0f;
-                    isInAttack = false;
-                }
-            }
-            else if (isInRelease)
-            {
-                l *= attackReleaseLevel;
-                r *= attackReleaseLevel;
+                    l *= attackReleaseLevel;
+                    r *= attackReleaseLevel;
 
-                attackReleaseLevel += releaseDelta;
+                    attackReleaseLevel += attackDelta;
 
-                if (attackReleaseLevel <= 0.0f)
+                    if (attackReleaseLevel >= 1.0f)
+                    {
+                        attackReleaseLevel = 1.0f;
+                        isInAttack = false;
+                    }
+                }
+                else if (isInRelease)
                 {
-                    stopNote (false);
-                    break;
+                    l *= attackReleaseLevel;
+                    r *= attackReleaseLevel;
+
+                    attackReleaseLevel += releaseDelta;
+
+                    if (attackReleaseLevel <= 0.0f)
+                    {
+                        stopNote (false);
+                        return;
+                    }
                 }
-            }
 
-            if (outR != nullptr)
-            {
-                *outL++ += l;
-                *outR++ += r;
-            }
-            else
-            {
-                *outL++ += (l + r) * 0.5f;
+                if (outR != nullptr)
+                {
+                    *outL++ += l;
+                    *outR++ += r;
+                }
+                else
+                {
+                    *outL++ += (l + r) * 0.5f;
+                }
             }
 
-            sourceSamplePosition += pitchRatio;
+            numSamples -= numThisTime;
 
-            if (sourceSamplePosition > playingSound->length)
+            if (sourceSamplePosition > levelLength)
             {
                 stopNote (false);
                 break;
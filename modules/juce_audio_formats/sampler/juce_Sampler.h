@@ -81,6 +81,27 @@ public:
     */
     AudioSampleBuffer* getAudioData() const                 { return data; }
 
+    //==============================================================================
+    /** Creates a set of progressively decimated copies of the sample data.
+
+        Each level is half the sample rate of the one before it, and has been low-pass
+        filtered to remove anything above its new Nyquist frequency. When a SamplerVoice
+        plays the sound pitched up by an octave or more, it reads from the level whose
+        rate is closest to what it needs, which removes most of the aliasing that
+        large upward transpositions would otherwise cause, and reduces the number of
+        samples it has to read.
+
+        The extra levels use up to the same amount of memory again as the original
+        data. This must be called before the sound is given to a Synthesiser.
+
+        @param maxNumLevels     the maximum number of decimated levels to create
+        @see getNumMipMapLevels
+    */
+    void createMipMaps (int maxNumLevels = 4);
+
+    /** Returns the number of decimated levels that createMipMaps() has created. */
+    int getNumMipMapLevels() const noexcept                 { return mipMaps.size(); }
+
 
     //==============================================================================
     bool appliesToNote (const int midiNoteNumber);
@@ -93,11 +114,14 @@ private:
 
     String name;
     ScopedPointer <AudioSampleBuffer> data;
+    OwnedArray <AudioSampleBuffer> mipMaps;
     double sourceSampleRate;
     BigInteger midiNotes;
     int length, attackSamples, releaseSamples;
     int midiRootNote;
 
+    const AudioSampleBuffer* getDataForLevel (int level) const noexcept;
+
     JUCE_LEAK_DETECTOR (SamplerSound);
 };
 
@@ -114,14 +138,39 @@ private:
 class JUCE_API  SamplerVoice    : public SynthesiserVoice
 {
 public:
+    //==============================================================================
+    /** The methods that a SamplerVoice can use to interpolate between the samples
+        of its sound.
+    */
+    enum InterpolationQuality
+    {
+        linearInterpolation,    /**< Interpolates linearly between adjacent samples. This is the
+                                     cheapest method, but the least accurate. */
+        cubicInterpolation,     /**< Uses a 4-point cubic Hermite interpolator. This costs roughly
+                                     twice as much as linear interpolation, but has much less
+                                     high-frequency loss and aliasing. */
+        sincInterpolation       /**< Uses a 16-point windowed-sinc interpolator, which is stretched
+                                     to filter out aliasing when the sound is pitched upwards. This
+                                     gives the best quality, but is much more expensive. */
+    };
+
     //==============================================================================
     /** Creates a SamplerVoice.
     */
-    SamplerVoice();
+    SamplerVoice (InterpolationQuality quality = linearInterpolation);
 
     /** Destructor. */
     ~SamplerVoice();
 
+    //==============================================================================
+    /** Changes the interpolation method.
+        This will take effect from the next note that the voice starts playing.
+    */
+    void setInterpolationQuality (InterpolationQuality newQuality) noexcept;
+
+    /** Returns the interpolation method that the voice is using. */
+    InterpolationQuality getInterpolationQuality() const noexcept   { return quality; }
+
 
     //==============================================================================
     bool canPlaySound (SynthesiserSound* sound);
@@ -142,10 +191,15 @@ public:
 
 private:
     //==============================================================================
-    double pitchRatio;
-    double sourceSamplePosition;
+    InterpolationQuality quality, currentQuality;
+    double pitchRatio, levelPitchRatio;
+    double sourceSamplePosition, levelLength;
     float lgain, rgain, attackReleaseLevel, attackDelta, releaseDelta;
+    int mipMapLevel;
     bool isInAttack, isInRelease;
+    HeapBlock<float> interpolatedData;
+
+    int interpolateBlock (const float* source, int numSourceSamples, float* dest, int numSamples, double& position) const noexcept;
 
     JUCE_LEAK_DETECTOR (SamplerVoice);
 };
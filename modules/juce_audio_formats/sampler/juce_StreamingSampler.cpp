@@ -0,0 +1,671 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+StreamingSamplerSound::StreamingSamplerSound (const String& name_,
+                                              AudioFormatReader* const source,
+                                              const BigInteger& midiNotes_,
+                                              const int midiNoteForNormalPitch,
+                                              const double attackTimeSecs,
+                                              const double releaseTimeSecs,
+                                              const double preloadTimeSecs)
+    : name (name_),
+      reader (source),
+      preloadedData (2, 1),
+      sourceSampleRate (0),
+      midiNotes (midiNotes_),
+      length (0),
+      preloadLength (0),
+      attackSamples (0),
+      releaseSamples (0),
+      midiRootNote (midiNoteForNormalPitch)
+{
+    if (reader != nullptr && reader->sampleRate > 0 && reader->lengthInSamples > 0)
+    {
+        sourceSampleRate = reader->sampleRate;
+        length = reader->lengthInSamples;
+        preloadLength = (int) jmin (length, (int64) roundToInt (jmax (0.0, preloadTimeSecs) * sourceSampleRate));
+
+        // (the extra samples are there so the interpolator can look ahead at the end)
+        preloadedData.setSize (2, preloadLength + 4);
+        preloadedData.clear();
+        reader->read (&preloadedData, 0, preloadLength, 0, true, true);
+
+        attackSamples = roundToInt (attackTimeSecs * sourceSampleRate);
+        releaseSamples = roundToInt (releaseTimeSecs * sourceSampleRate);
+    }
+}
+
+StreamingSamplerSound::~StreamingSamplerSound()
+{
+}
+
+bool StreamingSamplerSound::appliesToNote (const int midiNoteNumber)
+{
+    return midiNotes [midiNoteNumber];
+}
+
+bool StreamingSamplerSound::appliesToChannel (const int /*midiChannel*/)
+{
+    return true;
+}
+
+void StreamingSamplerSound::readFromSource (AudioSampleBuffer& dest, const int destStart,
+                                            const int64 sourceStart, const int numSamples)
+{
+    const ScopedLock sl (readerLock);
+    reader->read (&dest, destStart, numSamples, sourceStart, true, true);
+}
+
+//==============================================================================
+SampleStreamingThread::SampleStreamingThread (const int samplesPerRead_)
+    : Thread ("Sample streaming"),
+      samplesPerRead (jmax (256, samplesPerRead_))
+{
+    startThread (7);
+}
+
+SampleStreamingThread::~SampleStreamingThread()
+{
+    // You need to delete all the voices that use this thread before deleting it!
+    jassert (voices.size() == 0);
+
+    stopThread (4000);
+}
+
+void SampleStreamingThread::addVoice (StreamingSamplerVoice* const v)
+{
+    const ScopedLock sl (voiceListLock);
+    voices.add (v);
+}
+
+void SampleStreamingThread::removeVoice (StreamingSamplerVoice* const v)
+{
+    const ScopedLock sl (voiceListLock);
+    voices.removeFirstMatchingValue (v);
+}
+
+void SampleStreamingThread::resetStatistics() noexcept
+{
+    numStarvationEvents = 0;
+    numStarvedSamples = 0;
+    numSamplesRead = 0;
+}
+
+void SampleStreamingThread::run()
+{
+    // The voices never signal this thread, so it needs to poll them often enough
+    // to stay ahead of a voice that has just started..
+    while (! threadShouldExit())
+        if (! serviceVoices())
+            wait (1);
+}
+
+namespace StreamingSamplerHelpers
+{
+    struct VoiceToService
+    {
+        StreamingSamplerVoice* voice;
+        int64 headroom;
+    };
+
+    struct HeadroomComparator
+    {
+        static int compareElements (const VoiceToService& first, const VoiceToService& second) noexcept
+        {
+            return first.headroom < second.headroom ? -1 : (second.headroom < first.headroom ? 1 : 0);
+        }
+    };
+}
+
+bool SampleStreamingThread::serviceVoices()
+{
+    using namespace StreamingSamplerHelpers;
+
+    const ScopedLock sl (voiceListLock);
+
+    Array<VoiceToService> needy;
+    int numStreaming = 0;
+    int64 lowestHeadroom = std::numeric_limits<int>::max();
+
+    for (int i = voices.size(); --i >= 0;)
+    {
+        StreamingSamplerVoice* const v = voices.getUnchecked (i);
+        v->releaseQueuedSounds();
+
+        if (v->isStreaming.get() != 0)
+        {
+            ++numStreaming;
+
+            const int64 headroom = v->readyEnd.get() - v->playPosition.get();
+            lowestHeadroom = jmin (lowestHeadroom, headroom);
+
+            if (headroom < v->ringBuffer.getNumSamples() - getReadSize (*v))
+            {
+                VoiceToService vs = { v, headroom };
+                needy.add (vs);
+            }
+        }
+        else if (v->isActive.get() == 0 && v->streamSound != nullptr)
+        {
+            // The voice has stopped, so we can drop its sound here rather than on the audio thread
+            SynthesiserSound::Ptr oldSound;
+
+            {
+                const SpinLock::ScopedLockType lock (v->streamLock);
+
+                if (v->isActive.get() == 0)
+                {
+                    oldSound = v->streamSound;
+                    v->streamSound = nullptr;
+                }
+            }
+        }
+    }
+
+    numStreamingVoices = numStreaming;
+    minimumHeadroom = numStreaming > 0 ? (int) jmax ((int64) 0, lowestHeadroom) : 0;
+
+    // serve the voices that are closest to running out first..
+    HeadroomComparator comparator;
+    needy.sort (comparator);
+
+    bool anythingRead = false;
+
+    for (int i = 0; i < needy.size() && ! threadShouldExit(); ++i)
+    {
+        StreamingSamplerVoice& v = *needy.getReference (i).voice;
+
+        SynthesiserSound::Ptr soundPtr;
+        int generation;
+        int64 start;
+
+        {
+            const SpinLock::ScopedLockType lock (v.streamLock);
+
+            if (v.isStreaming.get() == 0)
+                continue;
+
+            soundPtr = v.streamSound;
+            generation = v.streamGeneration;
+            start = v.readyEnd.get();
+        }
+
+        StreamingSamplerSound* const sound = static_cast <StreamingSamplerSound*> (soundPtr.getObject());
+        const int ringSize = v.ringBuffer.getNumSamples();
+        const int64 playPosition = v.playPosition.get();
+
+        // If the voice has starved and played on past the data we've read, there's no
+        // point reading the part that it's skipped..
+        start = jmax (start, playPosition);
+
+        // leave a few samples behind the play position untouched for the interpolator
+        const int64 limit = jmin (sound->length, playPosition + ringSize - 4);
+        const int numToRead = (int) jmin ((int64) getReadSize (v), limit - start);
+
+        if (numToRead <= 0)
+            continue;
+
+        const int ringPos = (int) ((start - sound->preloadLength) % ringSize);
+        const int num1 = jmin (numToRead, ringSize - ringPos);
+
+        sound->readFromSource (v.ringBuffer, ringPos, start, num1);
+
+        if (num1 < numToRead)
+            sound->readFromSource (v.ringBuffer, 0, start + num1, numToRead - num1);
+
+        {
+            const SpinLock::ScopedLockType lock (v.streamLock);
+
+            // If the voice was restarted while we were reading, the data is no use..
+            if (v.streamGeneration == generation && v.isStreaming.get() != 0)
+                v.readyEnd = start + numToRead;
+        }
+
+        numSamplesRead += numToRead;
+        anythingRead = true;
+    }
+
+    return anythingRead;
+}
+
+int SampleStreamingThread::getReadSize (const StreamingSamplerVoice& v) const noexcept
+{
+    // (a voice with a small buffer is topped up in smaller reads, so that it's never left
+    // without enough room for a whole read)
+    return jmin (samplesPerRead, v.ringBuffer.getNumSamples() / 2);
+}
+
+//==============================================================================
+StreamingSamplerVoice::StreamingSamplerVoice (SampleStreamingThread& streamingThread_,
+                                              const int bufferSizeSamples)
+    : streamingThread (streamingThread_),
+      ringBuffer (2, jmax (1024, bufferSizeSamples)),
+      streamGeneration (0),
+      releaseQueue (maxSoundsToRelease),
+      pitchRatio (0.0),
+      sourceSamplePosition (0.0),
+      lgain (0.0f),
+      rgain (0.0f),
+      attackReleaseLevel (0.0f),
+      attackDelta (0.0f),
+      releaseDelta (0.0f),
+      isInAttack (false),
+      isInRelease (false)
+{
+    ringBuffer.clear();
+    streamingThread.addVoice (this);
+}
+
+StreamingSamplerVoice::~StreamingSamplerVoice()
+{
+    streamingThread.removeVoice (this);
+}
+
+bool StreamingSamplerVoice::canPlaySound (SynthesiserSound* sound)
+{
+    return dynamic_cast <const StreamingSamplerSound*> (sound) != nullptr;
+}
+
+void StreamingSamplerVoice::startStreaming (StreamingSamplerSound* const sound)
+{
+    SynthesiserSound::Ptr overflowedSound;
+
+    {
+        const SpinLock::ScopedLockType lock (streamLock);
+
+        if (streamSound != sound)
+        {
+            // The old sound is handed over to the streaming thread, which will release it
+            int start1, size1, start2, size2;
+            releaseQueue.prepareToWrite (1, start1, size1, start2, size2);
+
+            if (size1 > 0)
+            {
+                soundsToRelease [start1] = streamSound;
+                releaseQueue.finishedWrite (1);
+            }
+            else
+            {
+                // The streaming thread hasn't run for a long time, and the queue is full.
+                // The sound will have to be released here, which deletes it if nothing
+                // else is using it..
+                jassertfalse;
+                overflowedSound = streamSound;
+            }
+
+            streamSound = sound;
+        }
+
+        ++streamGeneration;
+        isStreaming = sound->length > sound->preloadLength ? 1 : 0;
+        isActive = 1;
+        playPosition = 0;
+        readyEnd = sound->preloadLength;
+    }
+}
+
+void StreamingSamplerVoice::stopStreaming() noexcept
+{
+    // The streaming thread will notice this and release the sound. Any read that's in
+    // progress is discarded, because it'll see that we've stopped when it finishes.
+    isStreaming = 0;
+    isActive = 0;
+}
+
+void StreamingSamplerVoice::releaseQueuedSounds()
+{
+    int start1, size1, start2, size2;
+    releaseQueue.prepareToRead (releaseQueue.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)
+        soundsToRelease [start1 + i] = nullptr;
+
+    for (int i = 0; i < size2; ++i)
+        soundsToRelease [start2 + i] = nullptr;
+
+    releaseQueue.finishedRead (size1 + size2);
+}
+
+void StreamingSamplerVoice::startNote (const int midiNoteNumber,
+                                       const float velocity,
+                                       SynthesiserSound* s,
+                                       const int /*currentPitchWheelPosition*/)
+{
+    StreamingSamplerSound* const sound = dynamic_cast <StreamingSamplerSound*> (s);
+    jassert (sound != nullptr); // this object can only play StreamingSamplerSounds!
+
+    if (sound != nullptr)
+    {
+        const double targetFreq = MidiMessage::getMidiNoteInHertz (midiNoteNumber);
+        const double naturalFreq = MidiMessage::getMidiNoteInHertz (sound->midiRootNote);
+
+        pitchRatio = (targetFreq * sound->sourceSampleRate) / (naturalFreq * getSampleRate());
+
+        sourceSamplePosition = 0.0;
+        lgain = velocity;
+        rgain = velocity;
+
+        isInAttack = (sound->attackSamples > 0);
+        isInRelease = false;
+
+        if (isInAttack)
+        {
+            attackReleaseLevel = 0.0f;
+            attackDelta = (float) (pitchRatio / sound->attackSamples);
+        }
+        else
+        {
+            attackReleaseLevel = 1.0f;
+            attackDelta = 0.0f;
+        }
+
+        if (sound->releaseSamples > 0)
+            releaseDelta = (float) (-pitchRatio / sound->releaseSamples);
+        else
+            releaseDelta = 0.0f;
+
+        startStreaming (sound);
+    }
+}
+
+void StreamingSamplerVoice::stopNote (const bool allowTailOff)
+{
+    if (allowTailOff)
+    {
+        isInAttack = false;
+        isInRelease = true;
+    }
+    else
+    {
+        // (the sound must be cleared before we stop streaming, because our own reference
+        // is what stops this from being the last one)
+        clearCurrentNote();
+        stopStreaming();
+    }
+}
+
+void StreamingSamplerVoice::pitchWheelMoved (const int /*newValue*/)
+{
+}
+
+void StreamingSamplerVoice::controllerMoved (const int /*controllerNumber*/,
+                                             const int /*newValue*/)
+{
+}
+
+//==============================================================================
+void StreamingSamplerVoice::renderNextBlock (AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
+{
+    const StreamingSamplerSound* const playingSound = static_cast <StreamingSamplerSound*> (getCurrentlyPlayingSound().get());
+
+    if (playingSound != nullptr)
+    {
+        const float* const preL = playingSound->preloadedData.getSampleData (0, 0);
+        const float* const preR = playingSound->preloadedData.getSampleData (1, 0);
+        const float* const ringL = ringBuffer.getSampleData (0, 0);
+        const float* const ringR = ringBuffer.getSampleData (1, 0);
+        const int ringSize = ringBuffer.getNumSamples();
+        const int64 preloadLength = playingSound->preloadLength;
+        const int64 available = jmax (preloadLength, readyEnd.get());
+        const int64 length = playingSound->length;
+        int numStarved = 0;
+
+        float* outL = outputBuffer.getSampleData (0, startSample);
+        float* outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getSampleData (1, startSample) : nullptr;
+
+        while (--numSamples >= 0)
+        {
+            const int64 pos = (int64) sourceSamplePosition;
+            const float alpha = (float) (sourceSamplePosition - pos);
+            const float invAlpha = 1.0f - alpha;
+
+            float l0 = 0, r0 = 0, l1 = 0, r1 = 0;
+
+            if (pos + 1 < preloadLength)
+            {
+                l0 = preL [pos];      r0 = preR [pos];
+                l1 = preL [pos + 1];  r1 = preR [pos + 1];
+            }
+            else if (pos + 1 < available || pos + 1 >= length)
+            {
+                for (int i = 0; i < 2; ++i)
+                {
+                    const int64 p = pos + i;
+                    float l = 0, r = 0;
+
+                    if (p < preloadLength)
+                    {
+                        l = preL [p];
+                        r = preR [p];
+                    }
+                    else if (p < jmin (available, length))
+                    {
+                        const int ringPos = (int) ((p - preloadLength) % ringSize);
+                        l = ringL [ringPos];
+                        r = ringR [ringPos];
+                    }
+
+                    if (i == 0)  { l0 = l; r0 = r; }
+                    else         { l1 = l; r1 = r; }
+                }
+            }
+            else
+            {
+                // the streaming thread hasn't caught up with us, so this sample is lost..
+                ++numStarved;
+            }
+
+            float l = (l0 * invAlpha + l1 * alpha) * lgain;
+            float r = (r0 * invAlpha + r1 * alpha) * rgain;
+
+            if (isInAttack)
+            {
+                l *= attackReleaseLevel;
+                r *= attackReleaseLevel;
+
+                attackReleaseLevel += attackDelta;
+
+                if (attackReleaseLevel >= 1.0f)
+                {
+                    attackReleaseLevel = 1.0f;
+                    isInAttack = false;
+                }
+            }
+            else if (isInRelease)
+            {
+                l *= attackReleaseLevel;
+                r *= attackReleaseLevel;
+
+                attackReleaseLevel += releaseDelta;
+
+                if (attackReleaseLevel <= 0.0f)
+                {
+                    stopNote (false);
+                    break;
+                }
+            }
+
+            if (outR != nullptr)
+            {
+                *outL++ += l;
+                *outR++ += r;
+            }
+            else
+            {
+                *outL++ += (l + r) * 0.5f;
+            }
+
+            sourceSamplePosition += pitchRatio;
+
+            if (sourceSamplePosition > length)
+            {
+                stopNote (false);
+                break;
+            }
+        }
+
+        playPosition = (int64) sourceSamplePosition;
+
+        if (numStarved > 0)
+        {
+            ++(streamingThread.numStarvationEvents);
+            streamingThread.numStarvedSamples += numStarved;
+        }
+    }
+}
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class StreamingSamplerTests  : public UnitTest
+{
+public:
+    StreamingSamplerTests() : UnitTest ("StreamingSampler") {}
+
+    struct DeletionRecord
+    {
+        DeletionRecord() : deletingThread (nullptr) {}
+
+        Atomic<int> isDeleted;
+        Thread::ThreadID deletingThread;
+    };
+
+    // A sound that records which thread deleted it
+    class TestSound  : public StreamingSamplerSound
+    {
+    public:
+        TestSound (AudioFormatReader* reader, const int note, DeletionRecord& record_)
+            : StreamingSamplerSound ("test", reader, getNoteSet (note), note, 0.0, 0.0, 0.05),
+              record (record_)
+        {
+        }
+
+        ~TestSound()
+        {
+            record.deletingThread = Thread::getCurrentThreadId();
+            record.isDeleted = 1;
+        }
+
+    private:
+        DeletionRecord& record;
+
+        static BigInteger getNoteSet (const int note)
+        {
+            BigInteger notes;
+            notes.setBit (note);
+            return notes;
+        }
+    };
+
+    static AudioFormatReader* createReader (const float value, const int numSamples)
+    {
+        AudioSampleBuffer buffer (2, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            *buffer.getSampleData (0, i) = value;
+            *buffer.getSampleData (1, i) = value;
+        }
+
+        MemoryBlock wavData;
+
+        {
+            WavAudioFormat wav;
+            ScopedPointer<AudioFormatWriter> writer (wav.createWriterFor (new MemoryOutputStream (wavData, false),
+                                                                          44100.0, 2, 24, StringPairArray(), 0));
+            writer->writeFromAudioSampleBuffer (buffer, 0, numSamples);
+        }
+
+        WavAudioFormat wav;
+        return wav.createReaderFor (new MemoryInputStream (wavData, true), true);
+    }
+
+    // Renders a few blocks, giving the streaming thread time to keep up, and returns the last sample
+    float renderBlocks (Synthesiser& synth, MidiBuffer& midi, const int numBlocks)
+    {
+        AudioSampleBuffer buffer (2, 512);
+
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            buffer.clear();
+            synth.renderNextBlock (buffer, midi, 0, buffer.getNumSamples());
+            midi.clear();
+            Thread::sleep (5);
+        }
+
+        return *buffer.getSampleData (0, buffer.getNumSamples() - 1);
+    }
+
+    void runTest()
+    {
+        SampleStreamingThread streamingThread (4096);
+        DeletionRecord recordA, recordB;
+
+        {
+            Synthesiser synth;
+            synth.setCurrentPlaybackSampleRate (44100.0);
+            synth.addVoice (new StreamingSamplerVoice (streamingThread, 8192));
+            synth.addSound (new TestSound (createReader (0.5f, 88200), 60, recordA));
+            synth.addSound (new TestSound (createReader (0.25f, 88200), 72, recordB));
+
+            beginTest ("Streaming");
+
+            MidiBuffer midi;
+            midi.addEvent (MidiMessage::noteOn (1, 60, 1.0f), 0);
+
+            // (this plays well past the preloaded section)
+            expect (std::abs (renderBlocks (synth, midi, 20) - 0.5f) < 0.001f, "the first sound wasn't played");
+            expectEquals (streamingThread.getNumStreamingVoices(), 1);
+            expectEquals (streamingThread.getNumStarvationEvents(), 0);
+
+            beginTest ("Retriggering with a different sound");
+
+            // now the voice holds the only references to the first sound..
+            synth.removeSound (0);
+            expect (recordA.isDeleted.get() == 0);
+
+            // ..so when it's stolen for a note that uses the other sound, the first one
+            // must be deleted by the streaming thread rather than this one
+            midi.addEvent (MidiMessage::noteOn (1, 72, 1.0f), 0);
+            expect (std::abs (renderBlocks (synth, midi, 20) - 0.25f) < 0.001f, "the second sound wasn't played");
+            expectEquals (streamingThread.getNumStreamingVoices(), 1);
+            expectEquals (streamingThread.getNumStarvationEvents(), 0);
+
+            for (int i = 200; --i >= 0 && recordA.isDeleted.get() == 0;)
+                Thread::sleep (5);
+
+            expect (recordA.isDeleted.get() != 0, "the old sound was never released");
+            expect (recordA.deletingThread != Thread::getCurrentThreadId(), "the old sound was deleted on the audio thread");
+            expect (recordB.isDeleted.get() == 0);
+        }
+
+        expect (recordB.isDeleted.get() != 0);
+    }
+};
+
+static StreamingSamplerTests streamingSamplerUnitTests;
+
+#endif
@@ -0,0 +1,269 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_STREAMINGSAMPLER_JUCEHEADER__
+#define __JUCE_STREAMINGSAMPLER_JUCEHEADER__
+
+#include "juce_Sampler.h"
+
+class StreamingSamplerVoice;
+
+
+//==============================================================================
+/**
+    A SynthesiserSound which plays a sample directly from disk.
+
+    Unlike a SamplerSound, this only keeps the start of the sample in memory. When a
+    StreamingSamplerVoice starts playing it, the voice plays this preloaded section
+    while a SampleStreamingThread reads the rest of the sample from the reader in the
+    background.
+
+    The preloaded section needs to be long enough to cover the time it takes the
+    streaming thread to start delivering data for a new voice - a few tenths of a
+    second is usually plenty for local disks.
+
+    @see StreamingSamplerVoice, SampleStreamingThread, SamplerSound
+*/
+class JUCE_API  StreamingSamplerSound    : public SynthesiserSound
+{
+public:
+    //==============================================================================
+    /** Creates a streamed sound from an audio reader.
+
+        @param name         a name for the sample
+        @param source       the reader from which the audio will be streamed. This will be
+                            owned and deleted by this object, and will only be used by the
+                            streaming thread after this constructor returns
+        @param midiNotes    the set of midi keys that this sound should be played on
+        @param midiNoteForNormalPitch   the midi note at which the sample should be played
+                                        with its natural rate
+        @param attackTimeSecs   the attack (fade-in) time, in seconds
+        @param releaseTimeSecs  the decay (fade-out) time, in seconds
+        @param preloadTimeSecs  the length of the section at the start of the sample which
+                                will be kept in memory
+    */
+    StreamingSamplerSound (const String& name,
+                           AudioFormatReader* source,
+                           const BigInteger& midiNotes,
+                           int midiNoteForNormalPitch,
+                           double attackTimeSecs,
+                           double releaseTimeSecs,
+                           double preloadTimeSecs);
+
+    /** Destructor. */
+    ~StreamingSamplerSound();
+
+    //==============================================================================
+    /** Returns the sample's name */
+    const String& getName() const                           { return name; }
+
+    /** Returns the total length of the sample. */
+    int64 getLengthInSamples() const noexcept               { return length; }
+
+    /** Returns the number of samples that are kept in memory. */
+    int getNumPreloadedSamples() const noexcept             { return preloadLength; }
+
+    //==============================================================================
+    bool appliesToNote (const int midiNoteNumber);
+    bool appliesToChannel (const int midiChannel);
+
+private:
+    //==============================================================================
+    friend class StreamingSamplerVoice;
+    friend class SampleStreamingThread;
+
+    String name;
+    ScopedPointer<AudioFormatReader> reader;
+    CriticalSection readerLock;
+    AudioSampleBuffer preloadedData;
+    double sourceSampleRate;
+    BigInteger midiNotes;
+    int64 length;
+    int preloadLength, attackSamples, releaseSamples;
+    int midiRootNote;
+
+    void readFromSource (AudioSampleBuffer& dest, int destStart, int64 sourceStart, int numSamples);
+
+    JUCE_LEAK_DETECTOR (StreamingSamplerSound);
+};
+
+
+//==============================================================================
+/**
+    A background thread that reads ahead from disk for a set of StreamingSamplerVoice
+    objects.
+
+    Each voice registers itself with one of these when it's created. Whenever a voice
+    is playing beyond the preloaded section of its sound, this thread keeps its
+    buffer filled, always serving the voices that are closest to running out first.
+
+    The audio thread never waits for this thread or signals it - if a voice catches up
+    with the data that has been read, it outputs silence for the missing samples, and
+    the event is counted in the starvation statistics, which can be used to tune the
+    preload and buffer sizes.
+
+    @see StreamingSamplerVoice, StreamingSamplerSound
+*/
+class JUCE_API  SampleStreamingThread  : private Thread
+{
+public:
+    //==============================================================================
+    /** Creates a streaming thread.
+
+        @param samplesPerRead   the number of samples that will be read for a voice in one go
+    */
+    explicit SampleStreamingThread (int samplesPerRead = 8192);
+
+    /** Destructor.
+        All the voices that use this thread must be deleted before it is.
+    */
+    ~SampleStreamingThread();
+
+    //==============================================================================
+    /** Returns the number of voices that are currently streaming from disk. */
+    int getNumStreamingVoices() const noexcept              { return numStreamingVoices.get(); }
+
+    /** Returns the number of blocks in which a voice ran out of data. */
+    int getNumStarvationEvents() const noexcept             { return numStarvationEvents.get(); }
+
+    /** Returns the total number of samples that were output as silence because a voice ran out of data. */
+    int64 getNumStarvedSamples() const noexcept             { return numStarvedSamples.get(); }
+
+    /** Returns the smallest amount of data that any voice had buffered ahead of its
+        play position when the thread last serviced it, in samples.
+        A value close to zero means the voices are close to starving.
+    */
+    int getMinimumHeadroom() const noexcept                 { return minimumHeadroom.get(); }
+
+    /** Returns the total number of samples that have been read from disk. */
+    int64 getNumSamplesRead() const noexcept                { return numSamplesRead.get(); }
+
+    /** Resets the starvation counters. */
+    void resetStatistics() noexcept;
+
+private:
+    //==============================================================================
+    friend class StreamingSamplerVoice;
+
+    CriticalSection voiceListLock;
+    Array<StreamingSamplerVoice*> voices;
+    const int samplesPerRead;
+    Atomic<int> numStreamingVoices, numStarvationEvents, minimumHeadroom;
+    Atomic<int64> numStarvedSamples, numSamplesRead;
+
+    void addVoice (StreamingSamplerVoice*);
+    void removeVoice (StreamingSamplerVoice*);
+    void run();
+    bool serviceVoices();
+    int getReadSize (const StreamingSamplerVoice&) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleStreamingThread);
+};
+
+
+//==============================================================================
+/**
+    A SynthesiserVoice that plays a StreamingSamplerSound.
+
+    Each voice has a fixed-size buffer which is filled by a SampleStreamingThread,
+    so the memory used doesn't depend on the length of the samples.
+
+    @see StreamingSamplerSound, SampleStreamingThread
+*/
+class JUCE_API  StreamingSamplerVoice    : public SynthesiserVoice
+{
+public:
+    //==============================================================================
+    /** Creates a voice.
+
+        @param streamingThread      the thread that will read from disk for this voice. This
+                                    must not be deleted before the voice is
+        @param bufferSizeSamples    the number of samples that can be read ahead of the
+                                    play position. If this is less than twice the streaming
+                                    thread's samplesPerRead, the voice will be topped up in
+                                    smaller reads
+    */
+    StreamingSamplerVoice (SampleStreamingThread& streamingThread,
+                           int bufferSizeSamples = 32768);
+
+    /** Destructor. */
+    ~StreamingSamplerVoice();
+
+    //==============================================================================
+    bool canPlaySound (SynthesiserSound* sound);
+
+    void startNote (const int midiNoteNumber,
+                    const float velocity,
+                    SynthesiserSound* sound,
+                    const int currentPitchWheelPosition);
+
+    void stopNote (const bool allowTailOff);
+
+    void pitchWheelMoved (const int newValue);
+    void controllerMoved (const int controllerNumber,
+                          const int newValue);
+
+    void renderNextBlock (AudioSampleBuffer& outputBuffer, int startSample, int numSamples);
+
+private:
+    //==============================================================================
+    friend class SampleStreamingThread;
+
+    SampleStreamingThread& streamingThread;
+    AudioSampleBuffer ringBuffer;
+
+    // These are shared with the streaming thread, and protected by streamLock, except that
+    // the audio thread can clear isStreaming and isActive without taking the lock. The voice
+    // keeps its own reference to the sound it's playing, and it's the streaming thread that
+    // lets go of it - either once the voice has stopped, or, if the voice is restarted with a
+    // different sound, after the old one has been passed over in soundsToRelease. That way,
+    // the audio thread never drops the last reference to a sound and has to delete it.
+    SpinLock streamLock;
+    SynthesiserSound::Ptr streamSound;
+    int streamGeneration;
+    Atomic<int> isStreaming, isActive;
+
+    enum { maxSoundsToRelease = 16 };
+    AbstractFifo releaseQueue;
+    SynthesiserSound::Ptr soundsToRelease [maxSoundsToRelease];
+
+    // Atomic positions, in source samples: the streaming thread publishes the end
+    // of the data it has read, and the voice publishes the position it has reached.
+    Atomic<int64> readyEnd, playPosition;
+
+    double pitchRatio;
+    double sourceSamplePosition;
+    float lgain, rgain, attackReleaseLevel, attackDelta, releaseDelta;
+    bool isInAttack, isInRelease;
+
+    void startStreaming (StreamingSamplerSound*);
+    void stopStreaming() noexcept;
+    void releaseQueuedSounds();
+
+    JUCE_LEAK_DETECTOR (StreamingSamplerVoice);
+};
+
+
+#endif   // __JUCE_STREAMINGSAMPLER_JUCEHEADER__
@@ -67,6 +67,16 @@ public:
     */
     virtual AudioPluginInstance* createInstanceFromDescription (const PluginDescription& desc) = 0;
 
+    /** Returns true if instances of this plugin must be created, and have their state
+        restored, on the message thread.
+
+        This is used by PluginInstanceLoader to decide which plugins it can load on its
+        background threads. Most plugin formats make no promises about being thread-safe,
+        so by default this returns true - only override it if your format can create
+        instances on any thread, and on several threads at once.
+    */
+    virtual bool requiresMessageThreadForCreation (const PluginDescription&) const     { return true; }
+
     /** Should do a quick check to see if this file or directory might be a plugin of
         this format.
 
@@ -0,0 +1,216 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+//==============================================================================
+struct PluginInstanceLoader::Request
+{
+    Request (int index_, const PluginDescription& description_, const MemoryBlock& state_)
+        : index (index_), description (description_), state (state_)
+    {
+    }
+
+    const int index;
+    const PluginDescription description;
+    const MemoryBlock state;
+    ScopedPointer<AudioPluginInstance> instance;
+    String errorMessage;
+
+    JUCE_DECLARE_NON_COPYABLE (Request);
+};
+
+//==============================================================================
+class PluginInstanceLoader::LoadJob  : public ThreadPoolJob
+{
+public:
+    LoadJob (PluginInstanceLoader& owner_, Request& request_)
+        : ThreadPoolJob ("Plugin loader: " + request_.description.name),
+          owner (owner_), request (request_)
+    {
+    }
+
+    JobStatus runJob()
+    {
+        owner.loadPlugin (request);
+
+        {
+            const ScopedLock sl (owner.lock);
+            owner.finishedRequests.add (&request);
+        }
+
+        owner.triggerAsyncUpdate();
+        return jobHasFinished;
+    }
+
+private:
+    PluginInstanceLoader& owner;
+    Request& request;
+
+    JUCE_DECLARE_NON_COPYABLE (LoadJob);
+};
+
+//==============================================================================
+PluginInstanceLoader::PluginInstanceLoader (AudioPluginFormatManager& formatManager_,
+                                            Listener& listener_,
+                                            const int numThreads)
+    : formatManager (formatManager_),
+      listener (listener_),
+      threadPool (numThreads > 0 ? numThreads : SystemStats::getNumCpus()),
+      numDelivered (0),
+      started (false)
+{
+}
+
+PluginInstanceLoader::~PluginInstanceLoader()
+{
+    // Any jobs that are still running have to be allowed to finish, because a
+    // plugin's constructor can't be interrupted.
+    threadPool.removeAllJobs (true, -1);
+    cancelPendingUpdate();
+}
+
+//==============================================================================
+int PluginInstanceLoader::addPlugin (const PluginDescription& description, const MemoryBlock& stateToRestore)
+{
+    // plugins must be added before calling start()
+    jassert (! started);
+
+    const int index = requests.size();
+    requests.add (new Request (index, description, stateToRestore));
+    return index;
+}
+
+void PluginInstanceLoader::useBridgeServer (const StringArray& serverCommand)
+{
+    jassert (! started);
+    bridgeServerCommand = serverCommand;
+}
+
+int PluginInstanceLoader::getNumPluginsRemaining() const noexcept
+{
+    return requests.size() - numDelivered;
+}
+
+void PluginInstanceLoader::start()
+{
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+    jassert (! started);
+    started = true;
+
+    for (int i = 0; i < requests.size(); ++i)
+    {
+        Request* const r = requests.getUnchecked (i);
+
+        if (mustBeLoadedOnMessageThread (*r))
+            messageThreadRequests.add (r);
+        else
+            threadPool.addJob (new LoadJob (*this, *r), true);
+    }
+
+    triggerAsyncUpdate();
+}
+
+//==============================================================================
+bool PluginInstanceLoader::mustBeLoadedOnMessageThread (const Request& r)
+{
+    if (bridgeServerCommand.size() > 0)
+        return false;
+
+    for (int i = 0; i < formatManager.getNumFormats(); ++i)
+    {
+        AudioPluginFormat* const format = formatManager.getFormat (i);
+
+        if (format->getName() == r.description.pluginFormatName)
+            return format->requiresMessageThreadForCreation (r.description);
+    }
+
+    return true;
+}
+
+void PluginInstanceLoader::loadPlugin (Request& r)
+{
+    if (bridgeServerCommand.size() > 0)
+    {
+        r.instance = PluginBridge::createBridgedInstance (r.description, bridgeServerCommand, r.errorMessage);
+    }
+    else
+    {
+        for (int i = 0; i < formatManager.getNumFormats(); ++i)
+        {
+            AudioPluginFormat* const format = formatManager.getFormat (i);
+
+            if (format->getName() == r.description.pluginFormatName)
+            {
+                r.instance = format->createInstanceFromDescription (r.description);
+
+                if (r.instance == nullptr)
+                    r.errorMessage = format->doesPluginStillExist (r.description)
+                                        ? TRANS ("This plug-in failed to load correctly")
+                                        : TRANS ("This plug-in file no longer exists");
+                break;
+            }
+        }
+
+        if (r.instance == nullptr && r.errorMessage.isEmpty())
+            r.instance = formatManager.createPluginInstance (r.description, r.errorMessage);
+    }
+
+    if (r.instance != nullptr && r.state.getSize() > 0)
+        r.instance->setStateInformation (r.state.getData(), (int) r.state.getSize());
+}
+
+void PluginInstanceLoader::handleAsyncUpdate()
+{
+    Array<Request*> finished;
+
+    {
+        const ScopedLock sl (lock);
+        finished.swapWithArray (finishedRequests);
+    }
+
+    // Only one message-thread plugin is created per callback, so that the ones
+    // which have finished on the background threads don't have to wait for them all.
+    if (messageThreadRequests.size() > 0)
+    {
+        Request* const r = messageThreadRequests.remove (0);
+        loadPlugin (*r);
+        finished.add (r);
+
+        if (messageThreadRequests.size() > 0)
+            triggerAsyncUpdate();
+    }
+
+    for (int i = 0; i < finished.size(); ++i)
+    {
+        Request* const r = finished.getUnchecked (i);
+        ++numDelivered;
+        listener.pluginInstanceLoaded (*this, r->index, r->instance.release(), r->errorMessage);
+    }
+
+    if (finished.size() > 0 && numDelivered == requests.size())
+        listener.allPluginInstancesLoaded (*this);
+}
+
+//==============================================================================
+void PluginInstanceLoader::Listener::allPluginInstancesLoaded (PluginInstanceLoader&) {}
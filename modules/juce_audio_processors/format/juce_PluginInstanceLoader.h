@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_PLUGININSTANCELOADER_JUCEHEADER__
+#define __JUCE_PLUGININSTANCELOADER_JUCEHEADER__
+
+#include "juce_AudioPluginFormatManager.h"
+
+
+//==============================================================================
+/**
+    Creates a batch of plugin instances in the background, and restores their states.
+
+    Loading a big session one plugin at a time can take a long time, so this class
+    creates the instances concurrently on a pool of threads, and hands each one back
+    to a listener as soon as it's ready, so that a host can start using the ones that
+    have already loaded.
+
+    Plugins whose format says that they must be created on the message thread (see
+    AudioPluginFormat::requiresMessageThreadForCreation()) are created one at a time
+    on the message thread instead, in between delivering the other results. If you
+    call useBridgeServer(), every plugin is loaded in its own PluginBridge server
+    process, which means that they can all be loaded in parallel.
+
+    E.g.
+    @code
+    loader = new PluginInstanceLoader (formatManager, *this);
+
+    for (int i = 0; i < descriptions.size(); ++i)
+        loader->addPlugin (*descriptions[i], states[i]);
+
+    loader->start();
+
+    ...
+
+    void pluginInstanceLoaded (PluginInstanceLoader&, int index,
+                               AudioPluginInstance* instance, const String& error)
+    {
+        if (instance != nullptr)
+            graph.addNode (instance);
+    }
+    @endcode
+*/
+class JUCE_API  PluginInstanceLoader  : private AsyncUpdater
+{
+public:
+    //==============================================================================
+    /** Receives the instances that a PluginInstanceLoader creates. */
+    class JUCE_API  Listener
+    {
+    public:
+        /** Destructor. */
+        virtual ~Listener() {}
+
+        /** Called on the message thread when one of the plugins has been loaded, or has
+            failed to load.
+
+            The index is the value that was returned by addPlugin() for this plugin. The
+            plugins may arrive in any order.
+
+            If the instance isn't nullptr, the listener becomes responsible for deleting it.
+            If it is nullptr, the errorMessage will say what went wrong.
+        */
+        virtual void pluginInstanceLoaded (PluginInstanceLoader& loader, int index,
+                                           AudioPluginInstance* newInstance,
+                                           const String& errorMessage) = 0;
+
+        /** Called on the message thread after the last plugin has been delivered. */
+        virtual void allPluginInstancesLoaded (PluginInstanceLoader& loader);
+    };
+
+    //==============================================================================
+    /** Creates a loader.
+
+        @param formatManager    the formats to use to create the instances - this must
+                                not be deleted while the loader exists
+        @param listener         the listener that will receive the instances
+        @param numThreads       the number of background threads to use - if this is 0
+                                or less, one will be used for each CPU core
+    */
+    PluginInstanceLoader (AudioPluginFormatManager& formatManager,
+                          Listener& listener,
+                          int numThreads = 0);
+
+    /** Destructor.
+        If any plugins are still being loaded, this will wait for them to finish, and
+        delete any instances that haven't been delivered to the listener.
+    */
+    ~PluginInstanceLoader();
+
+    //==============================================================================
+    /** Adds a plugin to the list that will be loaded.
+
+        If the state block isn't empty, it'll be passed to the instance's
+        setStateInformation() method after it has been created.
+
+        This must be called before start(). It returns an index that will be passed
+        back to the listener along with this plugin's instance.
+    */
+    int addPlugin (const PluginDescription& description,
+                   const MemoryBlock& stateToRestore = MemoryBlock());
+
+    /** Makes the loader create each plugin inside a PluginBridge server process.
+        @see PluginBridge::createBridgedInstance
+    */
+    void useBridgeServer (const StringArray& serverCommand);
+
+    /** Starts loading the plugins. */
+    void start();
+
+    /** Returns the number of plugins that haven't yet been delivered to the listener. */
+    int getNumPluginsRemaining() const noexcept;
+
+private:
+    //==============================================================================
+    struct Request;
+    class LoadJob;
+    friend class LoadJob;
+
+    AudioPluginFormatManager& formatManager;
+    Listener& listener;
+    ThreadPool threadPool;
+    OwnedArray<Request> requests;
+    Array<Request*> messageThreadRequests, finishedRequests;
+    CriticalSection lock;
+    StringArray bridgeServerCommand;
+    int numDelivered;
+    bool started;
+
+    void loadPlugin (Request&);
+    bool mustBeLoadedOnMessageThread (const Request&);
+    void handleAsyncUpdate();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginInstanceLoader);
+};
+
+
+#endif   // __JUCE_PLUGININSTANCELOADER_JUCEHEADER__
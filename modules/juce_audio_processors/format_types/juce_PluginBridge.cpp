@@ -0,0 +1,1156 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+namespace PluginBridgeHelpers
+{
+    const char* const commandLineFlag = "--juce-plugin-bridge";
+
+    enum
+    {
+        magicNumber         = 0x4a504231,
+        maxChannels         = 32,
+        maxBlockSize        = 4096,
+        midiBufferSize      = 65536,
+        dataBufferSize      = 262144,
+        maxParameterChanges = 128,
+
+        processTimeoutMs    = 2000,
+        commandTimeoutMs    = 30000
+    };
+
+    enum Command
+    {
+        cmdCreate = 1,
+        cmdQuit,
+        cmdPrepare,
+        cmdRelease,
+        cmdReset,
+        cmdGetParameter,
+        cmdSetParameter,
+        cmdGetInt,
+        cmdGetString,
+        cmdSetCurrentProgram,
+        cmdChangeProgramName,
+        cmdGetState,
+        cmdReadStateChunk,
+        cmdWriteStateChunk,
+        cmdSetState
+    };
+
+    enum Query
+    {
+        queryNumParameters = 1,
+        queryNumPrograms,
+        queryCurrentProgram,
+        queryInputIsStereoPair,
+        queryOutputIsStereoPair,
+        queryParameterAutomatable,
+        queryParameterName,
+        queryParameterText,
+        queryParameterLabel,
+        queryProgramName,
+        queryInputChannelName,
+        queryOutputChannelName
+    };
+
+    /* This is the layout of the block of memory that the host and server share.
+
+       It contains two channels: one that's only used by the host's audio thread to run
+       processBlock(), and one for all the other calls, so that the audio thread never has
+       to queue up behind a slow query or a state transfer.
+
+       To send a request on a channel, the host fills in its arguments, then increments
+       requestCount. The server handles it, fills in the results, and sets replyCount to the
+       same value. Both counters are used as futexes on Linux, so that each side can sleep
+       until the other has finished, without any system calls when it doesn't need to wait.
+    */
+    struct ParameterChanges
+    {
+        int32 numChanges, processorChanged;
+        int32 indexes [maxParameterChanges];
+        float values [maxParameterChanges];
+    };
+
+    struct ControlChannel
+    {
+        Atomic<int> requestCount, replyCount;
+
+        int32 command, intArg1, intArg2, result;
+        double doubleArg;
+        float floatArg;
+        int32 dataSize;
+
+        ParameterChanges changes;
+        char data [dataBufferSize];
+    };
+
+    struct AudioChannel
+    {
+        Atomic<int> requestCount, replyCount;
+
+        int32 numSamples, numChannels, numMidiBytes, latency;
+        int32 hasPositionInfo;
+        AudioPlayHead::CurrentPositionInfo positionInfo;
+
+        ParameterChanges changes;
+        float audio [maxChannels * maxBlockSize];
+        uint8 midi [midiBufferSize];
+    };
+
+    struct SharedData
+    {
+        int32 magic;
+        int32 hostProcessId;
+
+        ControlChannel control;
+        AudioChannel audio;
+    };
+
+    //==============================================================================
+    // Waits until the value is no longer oldValue, or the timeout expires
+    void waitForValueToChange (Atomic<int>& value, const int oldValue, const int timeoutMs)
+    {
+       #if JUCE_LINUX
+        struct timespec timeout;
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = (timeoutMs % 1000) * 1000000;
+
+        syscall (SYS_futex, &(value.value), FUTEX_WAIT, oldValue, &timeout, 0, 0);
+       #else
+        // Without a futex, all we can do is poll..
+        const uint32 endTime = Time::getMillisecondCounter() + (uint32) timeoutMs;
+
+        while (value.get() == oldValue && Time::getMillisecondCounter() < endTime)
+            Thread::sleep (1);
+       #endif
+    }
+
+    void wakeWaiters (Atomic<int>& value)
+    {
+       #if JUCE_LINUX
+        syscall (SYS_futex, &(value.value), FUTEX_WAKE, std::numeric_limits<int>::max(), 0, 0, 0);
+       #else
+        (void) value;
+       #endif
+    }
+
+    // Spins very briefly before going to sleep, because the other side will often
+    // have finished within a few microseconds
+    bool waitForValue (Atomic<int>& value, const int target, const int timeoutMs)
+    {
+        for (int i = 0; i < 256; ++i)
+            if (value.get() == target)
+                return true;
+
+        const int current = value.get();
+
+        if (current != target)
+            waitForValueToChange (value, current, timeoutMs);
+
+        return value.get() == target;
+    }
+
+    int getCurrentProcessId()
+    {
+       #if JUCE_WINDOWS
+        return (int) GetCurrentProcessId();
+       #else
+        return (int) getpid();
+       #endif
+    }
+
+    bool isProcessAlive (const int processId)
+    {
+       #if JUCE_WINDOWS
+        HANDLE h = OpenProcess (SYNCHRONIZE, FALSE, (DWORD) processId);
+
+        if (h == 0)
+            return false;
+
+        const bool alive = WaitForSingleObject (h, 0) == WAIT_TIMEOUT;
+        CloseHandle (h);
+        return alive;
+       #else
+        return kill ((pid_t) processId, 0) == 0;
+       #endif
+    }
+
+    //==============================================================================
+    void writeString (ControlChannel& channel, const String& s)
+    {
+        const int numBytes = jmin ((int) dataBufferSize, s.getNumBytesAsUTF8());
+        memcpy (channel.data, s.toUTF8().getAddress(), (size_t) numBytes);
+        channel.dataSize = numBytes;
+    }
+
+    String readString (const ControlChannel& channel)
+    {
+        return String::fromUTF8 (channel.data, jlimit (0, (int) dataBufferSize, channel.dataSize));
+    }
+
+    // Each event is stored as its sample position, its size, and then its data
+    int writeMidi (uint8* dest, const MidiBuffer& midi, const int startSample, const int numSamples)
+    {
+        int numBytesUsed = 0;
+        MidiBuffer::Iterator iter (midi);
+        iter.setNextSamplePosition (startSample);
+
+        const uint8* data;
+        int numBytes, samplePos;
+
+        while (iter.getNextEvent (data, numBytes, samplePos) && samplePos < startSample + numSamples)
+        {
+            if (numBytesUsed + 8 + numBytes > (int) midiBufferSize)
+            {
+                jassertfalse; // too many events to fit into the shared memory!
+                break;
+            }
+
+            const int32 header[2] = { samplePos - startSample, numBytes };
+            memcpy (dest + numBytesUsed, header, sizeof (header));
+            memcpy (dest + numBytesUsed + 8, data, (size_t) numBytes);
+            numBytesUsed += 8 + numBytes;
+        }
+
+        return numBytesUsed;
+    }
+
+    void readMidi (MidiBuffer& midi, const uint8* source, const int numBytesUsed, const int sampleOffset)
+    {
+        for (int pos = 0; pos + 8 <= numBytesUsed;)
+        {
+            int32 header[2];
+            memcpy (header, source + pos, sizeof (header));
+            pos += 8;
+
+            if (header[1] <= 0 || pos + header[1] > numBytesUsed)
+                break;
+
+            midi.addEvent (source + pos, header[1], header[0] + sampleOffset);
+            pos += header[1];
+        }
+    }
+}
+
+//==============================================================================
+class BridgedPluginInstance   : public AudioPluginInstance
+{
+public:
+    BridgedPluginInstance()
+        : shared (nullptr),
+          lastControlRequest (0),
+          lastAudioRequest (0),
+          tailLengthSeconds (0),
+          pluginAcceptsMidi (false),
+          pluginProducesMidi (false)
+    {
+    }
+
+    ~BridgedPluginInstance()
+    {
+        if (shared != nullptr)
+        {
+            const ScopedLock sl (controlLock);
+
+            if (sendCommand (PluginBridgeHelpers::cmdQuit, 1000))
+                process.waitForProcessToFinish (1000);
+        }
+
+        if (process.isRunning())
+            process.kill();
+
+        mappedFile = nullptr;
+        sharedFile.deleteFile();
+    }
+
+    bool launch (const PluginDescription& desc, const StringArray& serverCommand, String& errorMessage)
+    {
+        using namespace PluginBridgeHelpers;
+
+       #if JUCE_LINUX
+        // (a tmpfs file avoids the kernel ever bothering to write our pages back to disk)
+        const File shmDir ("/dev/shm");
+        const File tempDir (shmDir.isDirectory() ? shmDir : File::getSpecialLocation (File::tempDirectory));
+       #else
+        const File tempDir (File::getSpecialLocation (File::tempDirectory));
+       #endif
+
+        sharedFile = tempDir.getNonexistentChildFile ("juce_plugin_bridge", ".tmp", false);
+
+        {
+            FileOutputStream out (sharedFile);
+
+            if (out.failedToOpen())
+            {
+                errorMessage = TRANS ("Couldn't create the plugin bridge's shared memory");
+                return false;
+            }
+
+            out.writeRepeatedByte (0, (int) sizeof (SharedData));
+        }
+
+        mappedFile = new MemoryMappedFile (sharedFile, MemoryMappedFile::readWrite);
+        shared = static_cast <SharedData*> (mappedFile->getData());
+
+        if (shared == nullptr || mappedFile->getSize() < sizeof (SharedData))
+        {
+            shared = nullptr;
+            errorMessage = TRANS ("Couldn't create the plugin bridge's shared memory");
+            return false;
+        }
+
+        shared->magic = magicNumber;
+        shared->hostProcessId = getCurrentProcessId();
+
+        ControlChannel& control = shared->control;
+        const ScopedPointer <XmlElement> descXml (desc.createXml());
+        writeString (control, descXml->createDocument (String::empty, true, false));
+
+        StringArray args (serverCommand);
+        args.add (commandLineFlag);
+        args.add (sharedFile.getFullPathName());
+
+        // The server will pick up this request as soon as it starts..
+        const ScopedLock sl (controlLock);
+        control.command = cmdCreate;
+        control.requestCount.set (++lastControlRequest);
+
+        if (! process.start (args))
+        {
+            errorMessage = TRANS ("Couldn't launch the plugin bridge process");
+            return false;
+        }
+
+        if (! waitForControlReply (commandTimeoutMs))
+        {
+            errorMessage = TRANS ("The plugin bridge process failed to start");
+            return false;
+        }
+
+        if (control.result == 0)
+        {
+            errorMessage = readString (control);
+            return false;
+        }
+
+        XmlDocument doc (readString (control));
+        const ScopedPointer <XmlElement> info (doc.getDocumentElement());
+
+        if (info == nullptr || ! info->hasTagName ("BRIDGEDPLUGIN")
+             || info->getFirstChildElement() == nullptr
+             || ! description.loadFromXml (*info->getFirstChildElement()))
+        {
+            errorMessage = TRANS ("The plugin bridge process sent an invalid response");
+            return false;
+        }
+
+        pluginName          = info->getStringAttribute ("name");
+        tailLengthSeconds   = info->getDoubleAttribute ("tailLength");
+        pluginAcceptsMidi   = info->getBoolAttribute ("acceptsMidi");
+        pluginProducesMidi  = info->getBoolAttribute ("producesMidi");
+
+        setPlayConfigDetails (info->getIntAttribute ("numInputs"),
+                              info->getIntAttribute ("numOutputs"), 0, 0);
+
+        setLatencySamples (info->getIntAttribute ("latency"));
+        return true;
+    }
+
+    /** Returns true if the server process has crashed or stopped responding. */
+    bool hasServerCrashed() const noexcept          { return hasCrashed.get() != 0; }
+
+    //==============================================================================
+    const String getName() const                    { return pluginName; }
+    void fillInPluginDescription (PluginDescription& desc) const      { desc = description; }
+
+    void prepareToPlay (double sampleRate, int estimatedSamplesPerBlock)
+    {
+        const ScopedLock sl (controlLock);
+
+        if (shared != nullptr)
+        {
+            shared->control.doubleArg = sampleRate;
+            shared->control.intArg1 = estimatedSamplesPerBlock;
+            sendCommand (PluginBridgeHelpers::cmdPrepare);
+        }
+
+        setPlayConfigDetails (getNumInputChannels(), getNumOutputChannels(),
+                              sampleRate, estimatedSamplesPerBlock);
+    }
+
+    void releaseResources()     { sendSimpleCommand (PluginBridgeHelpers::cmdRelease); }
+    void reset()                { sendSimpleCommand (PluginBridgeHelpers::cmdReset); }
+
+    // This only ever touches the audio channel, so it doesn't need any locks, and it
+    // won't be held up by any of the other calls, which all go through the control channel.
+    void processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+    {
+        using namespace PluginBridgeHelpers;
+
+        const int numSamples = buffer.getNumSamples();
+        const int numChannels = jmin (buffer.getNumChannels(), (int) maxChannels);
+        jassert (buffer.getNumChannels() <= maxChannels);
+
+        AudioPlayHead::CurrentPositionInfo position;
+        const bool hasPosition = getPlayHead() != nullptr && getPlayHead()->getCurrentPosition (position);
+
+        midiOut.clear();
+
+        // If the block's bigger than the shared buffer, it gets sent in several chunks..
+        for (int start = 0; start < numSamples; start += maxBlockSize)
+        {
+            const int num = jmin ((int) maxBlockSize, numSamples - start);
+
+            if (shared == nullptr || hasServerCrashed())
+            {
+                buffer.clear (start, num);
+                continue;
+            }
+
+            AudioChannel& audio = shared->audio;
+
+            for (int i = 0; i < numChannels; ++i)
+                memcpy (audio.audio + i * maxBlockSize, buffer.getSampleData (i, start), sizeof (float) * (size_t) num);
+
+            audio.numSamples = num;
+            audio.numChannels = numChannels;
+            audio.numMidiBytes = writeMidi (audio.midi, midiMessages, start, num);
+            audio.hasPositionInfo = hasPosition ? 1 : 0;
+
+            if (hasPosition)
+                audio.positionInfo = position;
+
+            audio.requestCount.set (++lastAudioRequest);
+            wakeWaiters (audio.requestCount);
+
+            if (! waitForAudioReply())
+            {
+                buffer.clear (start, num);
+                continue;
+            }
+
+            for (int i = 0; i < numChannels; ++i)
+                memcpy (buffer.getSampleData (i, start), audio.audio + i * maxBlockSize, sizeof (float) * (size_t) num);
+
+            readMidi (midiOut, audio.midi, jlimit (0, (int) midiBufferSize, audio.numMidiBytes), start);
+
+            if (audio.latency != getLatencySamples())
+                setLatencySamples (audio.latency);
+
+            handleParameterChanges (audio.changes);
+
+            if (hasPosition)
+                position.timeInSamples += num;
+        }
+
+        midiMessages.swapWith (midiOut);
+    }
+
+    //==============================================================================
+    const String getInputChannelName (int index) const      { return getString (PluginBridgeHelpers::queryInputChannelName, index); }
+    const String getOutputChannelName (int index) const     { return getString (PluginBridgeHelpers::queryOutputChannelName, index); }
+    bool isInputChannelStereoPair (int index) const         { return getInt (PluginBridgeHelpers::queryInputIsStereoPair, index) != 0; }
+    bool isOutputChannelStereoPair (int index) const        { return getInt (PluginBridgeHelpers::queryOutputIsStereoPair, index) != 0; }
+
+    double getTailLengthSeconds() const                     { return tailLengthSeconds; }
+    bool acceptsMidi() const                                { return pluginAcceptsMidi; }
+    bool producesMidi() const                               { return pluginProducesMidi; }
+
+    bool hasEditor() const                                  { return false; }
+    AudioProcessorEditor* createEditor()                    { return nullptr; }
+
+    //==============================================================================
+    int getNumParameters()                                  { return getInt (PluginBridgeHelpers::queryNumParameters, 0); }
+    const String getParameterName (int index)               { return getString (PluginBridgeHelpers::queryParameterName, index); }
+    const String getParameterText (int index)               { return getString (PluginBridgeHelpers::queryParameterText, index); }
+    String getParameterLabel (int index) const              { return getString (PluginBridgeHelpers::queryParameterLabel, index); }
+    bool isParameterAutomatable (int index) const           { return getInt (PluginBridgeHelpers::queryParameterAutomatable, index) != 0; }
+
+    float getParameter (int index)
+    {
+        const ScopedLock sl (controlLock);
+
+        if (shared == nullptr)
+            return 0;
+
+        shared->control.intArg1 = index;
+        return sendCommand (PluginBridgeHelpers::cmdGetParameter) ? shared->control.floatArg : 0.0f;
+    }
+
+    void setParameter (int index, float newValue)
+    {
+        const ScopedLock sl (controlLock);
+
+        if (shared != nullptr)
+        {
+            shared->control.intArg1 = index;
+            shared->control.floatArg = newValue;
+            sendCommand (PluginBridgeHelpers::cmdSetParameter);
+        }
+    }
+
+    //==============================================================================
+    int getNumPrograms()                                    { return getInt (PluginBridgeHelpers::queryNumPrograms, 0); }
+    int getCurrentProgram()                                 { return getInt (PluginBridgeHelpers::queryCurrentProgram, 0); }
+    const String getProgramName (int index)                 { return getString (PluginBridgeHelpers::queryProgramName, index); }
+
+    void setCurrentProgram (int index)
+    {
+        const ScopedLock sl (controlLock);
+
+        if (shared != nullptr)
+        {
+            shared->control.intArg1 = index;
+            sendCommand (PluginBridgeHelpers::cmdSetCurrentProgram);
+        }
+    }
+
+    void changeProgramName (int index, const String& newName)
+    {
+        const ScopedLock sl (controlLock);
+
+        if (shared != nullptr)
+        {
+            shared->control.intArg1 = index;
+            PluginBridgeHelpers::writeString (shared->control, newName);
+            sendCommand (PluginBridgeHelpers::cmdChangeProgramName);
+        }
+    }
+
+    //==============================================================================
+    void getStateInformation (MemoryBlock& destData)                    { getState (destData, false); }
+    void getCurrentProgramStateInformation (MemoryBlock& destData)      { getState (destData, true); }
+    void setStateInformation (const void* data, int size)               { setState (data, size, false); }
+    void setCurrentProgramStateInformation (const void* data, int size) { setState (data, size, true); }
+
+private:
+    //==============================================================================
+    PluginDescription description;
+    ChildProcess process;
+    File sharedFile;
+    ScopedPointer <MemoryMappedFile> mappedFile;
+    PluginBridgeHelpers::SharedData* shared;
+    CriticalSection controlLock;
+    int lastControlRequest, lastAudioRequest;
+    Atomic<int> hasCrashed;
+    MidiBuffer midiOut;
+
+    String pluginName;
+    double tailLengthSeconds;
+    bool pluginAcceptsMidi, pluginProducesMidi;
+
+    //==============================================================================
+    // The caller must hold the controlLock, and have filled in the command's arguments
+    bool sendCommand (const int command, const int timeoutMs = PluginBridgeHelpers::commandTimeoutMs)
+    {
+        PluginBridgeHelpers::ControlChannel& control = shared->control;
+
+        if (hasServerCrashed())
+        {
+            // (if it was the audio thread that noticed, the process won't have been killed yet)
+            killServer();
+            return false;
+        }
+
+        control.command = command;
+        control.requestCount.set (++lastControlRequest);
+        PluginBridgeHelpers::wakeWaiters (control.requestCount);
+
+        if (! waitForControlReply (timeoutMs))
+        {
+            // The server has crashed or hung, so from now on, we'll just be a dummy plugin..
+            hasCrashed = 1;
+            killServer();
+            return false;
+        }
+
+        handleParameterChanges (control.changes);
+        return true;
+    }
+
+    bool waitForControlReply (const int timeoutMs)
+    {
+        const uint32 startTime = Time::getMillisecondCounter();
+
+        for (;;)
+        {
+            if (PluginBridgeHelpers::waitForValue (shared->control.replyCount, lastControlRequest, 50))
+                return true;
+
+            if ((int) (Time::getMillisecondCounter() - startTime) > timeoutMs
+                 || hasServerCrashed() || ! process.isRunning())
+                return false;
+        }
+    }
+
+    // This is called on the audio thread, so rather than checking on the process, it just
+    // gives up after a timeout, and leaves the process to be killed by the next control call.
+    bool waitForAudioReply()
+    {
+        using namespace PluginBridgeHelpers;
+        AudioChannel& audio = shared->audio;
+
+        for (int i = 0; i < processTimeoutMs / 50; ++i)
+        {
+            if (waitForValue (audio.replyCount, lastAudioRequest, 50))
+                return true;
+
+            if (hasServerCrashed())
+                return false;
+        }
+
+        hasCrashed = 1;
+        return false;
+    }
+
+    void killServer()
+    {
+        if (process.isRunning())
+            process.kill();
+    }
+
+    void sendSimpleCommand (const int command)
+    {
+        const ScopedLock sl (controlLock);
+
+        if (shared != nullptr)
+            sendCommand (command);
+    }
+
+    void handleParameterChanges (PluginBridgeHelpers::ParameterChanges& changes)
+    {
+        using namespace PluginBridgeHelpers;
+
+        const int numChanges = jlimit (0, (int) maxParameterChanges, changes.numChanges);
+
+        if (numChanges == 0 && changes.processorChanged == 0)
+            return;
+
+        // (these need copying, because a listener might send another command)
+        int indexes [maxParameterChanges];
+        float values [maxParameterChanges];
+        memcpy (indexes, changes.indexes, sizeof (int) * (size_t) numChanges);
+        memcpy (values, changes.values, sizeof (float) * (size_t) numChanges);
+        const bool processorChanged = changes.processorChanged != 0;
+
+        changes.numChanges = 0;
+        changes.processorChanged = 0;
+
+        for (int i = 0; i < numChanges; ++i)
+            sendParamChangeMessageToListeners (indexes[i], values[i]);
+
+        if (processorChanged)
+            updateHostDisplay();
+    }
+
+    int getInt (const int query, const int index) const
+    {
+        const ScopedLock sl (controlLock);
+
+        if (shared == nullptr)
+            return 0;
+
+        shared->control.intArg1 = query;
+        shared->control.intArg2 = index;
+
+        return const_cast <BridgedPluginInstance*> (this)->sendCommand (PluginBridgeHelpers::cmdGetInt)
+                    ? shared->control.result : 0;
+    }
+
+    String getString (const int query, const int index) const
+    {
+        const ScopedLock sl (controlLock);
+
+        if (shared == nullptr)
+            return String::empty;
+
+        shared->control.intArg1 = query;
+        shared->control.intArg2 = index;
+
+        return const_cast <BridgedPluginInstance*> (this)->sendCommand (PluginBridgeHelpers::cmdGetString)
+                    ? PluginBridgeHelpers::readString (shared->control) : String::empty;
+    }
+
+    void getState (MemoryBlock& destData, const bool currentProgramOnly)
+    {
+        using namespace PluginBridgeHelpers;
+        const ScopedLock sl (controlLock);
+
+        destData.setSize (0);
+
+        if (shared == nullptr)
+            return;
+
+        ControlChannel& control = shared->control;
+
+        // The server keeps hold of the state, and we read it back in chunks that fit into the shared buffer
+        control.intArg1 = currentProgramOnly ? 1 : 0;
+
+        if (! sendCommand (cmdGetState))
+            return;
+
+        const int totalSize = jmax (0, control.result);
+        destData.setSize ((size_t) totalSize);
+
+        for (int pos = 0; pos < totalSize;)
+        {
+            control.intArg1 = pos;
+            const int num = sendCommand (cmdReadStateChunk) ? jlimit (0, totalSize - pos, control.dataSize) : 0;
+
+            if (num == 0)
+            {
+                destData.setSize (0);
+                return;
+            }
+
+            destData.copyFrom (control.data, pos, (size_t) num);
+            pos += num;
+        }
+    }
+
+    void setState (const void* data, const int sizeInBytes, const bool currentProgramOnly)
+    {
+        using namespace PluginBridgeHelpers;
+        const ScopedLock sl (controlLock);
+
+        if (shared == nullptr)
+            return;
+
+        ControlChannel& control = shared->control;
+
+        for (int pos = 0; pos < sizeInBytes; pos += dataBufferSize)
+        {
+            const int num = jmin ((int) dataBufferSize, sizeInBytes - pos);
+            memcpy (control.data, static_cast <const char*> (data) + pos, (size_t) num);
+            control.dataSize = num;
+            control.intArg1 = pos;
+
+            if (! sendCommand (cmdWriteStateChunk))
+                return;
+        }
+
+        control.intArg1 = currentProgramOnly ? 1 : 0;
+        control.intArg2 = sizeInBytes;
+        sendCommand (cmdSetState);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BridgedPluginInstance);
+};
+
+//==============================================================================
+class PluginBridgeServer   : private AudioProcessorListener,
+                             private AudioPlayHead
+{
+public:
+    PluginBridgeServer (const File& sharedFile)
+        : mappedFile (sharedFile, MemoryMappedFile::readWrite),
+          shared (static_cast <PluginBridgeHelpers::SharedData*> (mappedFile.getData())),
+          lastRequest (0),
+          buffer (1, 1),
+          processorChanged (false)
+    {
+        if (mappedFile.getSize() < sizeof (PluginBridgeHelpers::SharedData)
+             || shared->magic != PluginBridgeHelpers::magicNumber)
+            shared = nullptr;
+    }
+
+    ~PluginBridgeServer()
+    {
+        audioThread = nullptr;
+
+        if (plugin != nullptr)
+            plugin->removeListener (this);
+    }
+
+    void run (AudioPluginFormatManager& formatManager)
+    {
+        using namespace PluginBridgeHelpers;
+
+        if (shared == nullptr)
+            return;
+
+        ControlChannel& control = shared->control;
+
+        for (;;)
+        {
+            const int request = control.requestCount.get();
+
+            if (request == lastRequest)
+            {
+                waitForValueToChange (control.requestCount, request, 1000);
+
+                if (control.requestCount.get() == lastRequest && ! isProcessAlive (shared->hostProcessId))
+                    break; // the host has gone away without telling us..
+
+                continue;
+            }
+
+            lastRequest = request;
+            const int command = control.command;
+
+            if (command == cmdQuit)
+                audioThread = nullptr;
+
+            handleCommand (command, formatManager);
+            addParameterChangesToReply (control.changes);
+
+            control.replyCount.set (request);
+            wakeWaiters (control.replyCount);
+
+            if (command == cmdQuit || (command == cmdCreate && plugin == nullptr))
+                break;
+        }
+    }
+
+private:
+    //==============================================================================
+    // Services the audio channel, so that processBlock() calls never have to wait
+    // for whatever the main thread might be doing.
+    class AudioThread  : public Thread
+    {
+    public:
+        AudioThread (PluginBridgeServer& owner_)
+            : Thread ("Plugin bridge audio"),
+              owner (owner_),
+              lastAudioRequest (owner_.shared->audio.requestCount.get())
+        {
+            startThread (9);
+        }
+
+        ~AudioThread()
+        {
+            signalThreadShouldExit();
+            PluginBridgeHelpers::wakeWaiters (owner.shared->audio.requestCount);
+            stopThread (5000);
+        }
+
+        void run()
+        {
+            using namespace PluginBridgeHelpers;
+            AudioChannel& audio = owner.shared->audio;
+
+            while (! threadShouldExit())
+            {
+                const int request = audio.requestCount.get();
+
+                if (request == lastAudioRequest)
+                {
+                    waitForValueToChange (audio.requestCount, request, 100);
+                    continue;
+                }
+
+                lastAudioRequest = request;
+
+                owner.process();
+                owner.addParameterChangesToReply (audio.changes);
+
+                audio.replyCount.set (request);
+                wakeWaiters (audio.replyCount);
+            }
+        }
+
+    private:
+        PluginBridgeServer& owner;
+        int lastAudioRequest;
+
+        JUCE_DECLARE_NON_COPYABLE (AudioThread);
+    };
+
+    //==============================================================================
+    MemoryMappedFile mappedFile;
+    PluginBridgeHelpers::SharedData* shared;
+    int lastRequest;
+    ScopedPointer <AudioPluginInstance> plugin;
+    ScopedPointer <AudioThread> audioThread;
+    AudioSampleBuffer buffer;
+    MidiBuffer midi;
+    MemoryBlock state;
+
+    CriticalSection changeLock;
+    Array <int> changedParameterIndexes;
+    Array <float> changedParameterValues;
+    bool processorChanged;
+
+    //==============================================================================
+    void handleCommand (const int command, AudioPluginFormatManager& formatManager)
+    {
+        using namespace PluginBridgeHelpers;
+        ControlChannel& control = shared->control;
+
+        switch (command)
+        {
+            case cmdCreate:         createPlugin (formatManager); break;
+            case cmdGetParameter:   control.floatArg = plugin->getParameter (control.intArg1); break;
+            case cmdSetParameter:   plugin->setParameter (control.intArg1, control.floatArg); break;
+            case cmdGetInt:         control.result = getInt (control.intArg1, control.intArg2); break;
+            case cmdGetString:      writeString (control, getString (control.intArg1, control.intArg2)); break;
+            case cmdSetCurrentProgram:  plugin->setCurrentProgram (control.intArg1); break;
+            case cmdChangeProgramName:  plugin->changeProgramName (control.intArg1, readString (control)); break;
+
+            case cmdPrepare:
+            {
+                const ScopedLock sl (plugin->getCallbackLock());
+                plugin->prepareToPlay (control.doubleArg, control.intArg1);
+                break;
+            }
+
+            case cmdRelease:
+            {
+                const ScopedLock sl (plugin->getCallbackLock());
+                plugin->releaseResources();
+                break;
+            }
+
+            case cmdReset:
+            {
+                const ScopedLock sl (plugin->getCallbackLock());
+                plugin->reset();
+                break;
+            }
+
+            case cmdGetState:
+                state.setSize (0);
+
+                if (control.intArg1 != 0)
+                    plugin->getCurrentProgramStateInformation (state);
+                else
+                    plugin->getStateInformation (state);
+
+                control.result = (int) state.getSize();
+                break;
+
+            case cmdReadStateChunk:
+            {
+                const int start = jlimit (0, (int) state.getSize(), control.intArg1);
+                control.dataSize = jmin ((int) dataBufferSize, (int) state.getSize() - start);
+                memcpy (control.data, static_cast <const char*> (state.getData()) + start, (size_t) control.dataSize);
+                break;
+            }
+
+            case cmdWriteStateChunk:
+                if (control.intArg1 == 0)
+                    state.setSize (0);
+
+                state.append (control.data, (size_t) jlimit (0, (int) dataBufferSize, control.dataSize));
+                break;
+
+            case cmdSetState:
+                jassert ((int) state.getSize() == control.intArg2);
+
+                if (control.intArg1 != 0)
+                    plugin->setCurrentProgramStateInformation (state.getData(), (int) state.getSize());
+                else
+                    plugin->setStateInformation (state.getData(), (int) state.getSize());
+
+                state.setSize (0);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void createPlugin (AudioPluginFormatManager& formatManager)
+    {
+        using namespace PluginBridgeHelpers;
+        ControlChannel& control = shared->control;
+
+        XmlDocument doc (readString (control));
+        const ScopedPointer <XmlElement> descXml (doc.getDocumentElement());
+        PluginDescription desc;
+        String errorMessage;
+
+        if (descXml != nullptr && desc.loadFromXml (*descXml))
+            plugin = formatManager.createPluginInstance (desc, errorMessage);
+        else
+            errorMessage = TRANS ("Invalid plugin description");
+
+        if (plugin == nullptr)
+        {
+            control.result = 0;
+            writeString (control, errorMessage);
+            return;
+        }
+
+        plugin->fillInPluginDescription (desc);
+        plugin->setPlayHead (this);
+        plugin->addListener (this);
+
+        XmlElement info ("BRIDGEDPLUGIN");
+        info.setAttribute ("name", plugin->getName());
+        info.setAttribute ("numInputs", plugin->getNumInputChannels());
+        info.setAttribute ("numOutputs", plugin->getNumOutputChannels());
+        info.setAttribute ("latency", plugin->getLatencySamples());
+        info.setAttribute ("tailLength", plugin->getTailLengthSeconds());
+        info.setAttribute ("acceptsMidi", plugin->acceptsMidi());
+        info.setAttribute ("producesMidi", plugin->producesMidi());
+        info.addChildElement (desc.createXml());
+
+        control.result = 1;
+        writeString (control, info.createDocument (String::empty, true, false));
+
+        audioThread = new AudioThread (*this);
+    }
+
+    // Called on the audio thread
+    void process()
+    {
+        using namespace PluginBridgeHelpers;
+        AudioChannel& audio = shared->audio;
+
+        const int numSamples = jlimit (0, (int) maxBlockSize, audio.numSamples);
+        const int numChannels = jlimit (0, (int) maxChannels, audio.numChannels);
+
+        // The plugin processes the audio directly in the shared memory
+        float* channels [maxChannels];
+
+        for (int i = 0; i < numChannels; ++i)
+            channels[i] = audio.audio + i * maxBlockSize;
+
+        buffer.setDataToReferTo (channels, numChannels, numSamples);
+
+        midi.clear();
+        readMidi (midi, audio.midi, jlimit (0, (int) midiBufferSize, audio.numMidiBytes), 0);
+
+        {
+            const ScopedLock sl (plugin->getCallbackLock());
+            plugin->processBlock (buffer, midi);
+        }
+
+        audio.numMidiBytes = writeMidi (audio.midi, midi, 0, numSamples);
+        audio.latency = plugin->getLatencySamples();
+    }
+
+    int getInt (const int query, const int index) const
+    {
+        using namespace PluginBridgeHelpers;
+
+        switch (query)
+        {
+            case queryNumParameters:        return plugin->getNumParameters();
+            case queryNumPrograms:          return plugin->getNumPrograms();
+            case queryCurrentProgram:       return plugin->getCurrentProgram();
+            case queryInputIsStereoPair:    return plugin->isInputChannelStereoPair (index) ? 1 : 0;
+            case queryOutputIsStereoPair:   return plugin->isOutputChannelStereoPair (index) ? 1 : 0;
+            case queryParameterAutomatable: return plugin->isParameterAutomatable (index) ? 1 : 0;
+            default:                        break;
+        }
+
+        return 0;
+    }
+
+    String getString (const int query, const int index) const
+    {
+        using namespace PluginBridgeHelpers;
+
+        switch (query)
+        {
+            case queryParameterName:        return plugin->getParameterName (index);
+            case queryParameterText:        return plugin->getParameterText (index);
+            case queryParameterLabel:       return plugin->getParameterLabel (index);
+            case queryProgramName:          return plugin->getProgramName (index);
+            case queryInputChannelName:     return plugin->getInputChannelName (index);
+            case queryOutputChannelName:    return plugin->getOutputChannelName (index);
+            default:                        break;
+        }
+
+        return String::empty;
+    }
+
+    // Any changes that are waiting go back with whichever reply is sent next, on either channel
+    void addParameterChangesToReply (PluginBridgeHelpers::ParameterChanges& changes)
+    {
+        using namespace PluginBridgeHelpers;
+
+        const ScopedLock sl (changeLock);
+
+        const int numChanges = jmin ((int) maxParameterChanges, changedParameterIndexes.size());
+
+        for (int i = 0; i < numChanges; ++i)
+        {
+            changes.indexes[i] = changedParameterIndexes.getUnchecked (i);
+            changes.values[i]  = changedParameterValues.getUnchecked (i);
+        }
+
+        changes.numChanges = numChanges;
+        changes.processorChanged = processorChanged ? 1 : 0;
+
+        changedParameterIndexes.removeRange (0, numChanges);
+        changedParameterValues.removeRange (0, numChanges);
+        processorChanged = false;
+    }
+
+    //==============================================================================
+    void audioProcessorParameterChanged (AudioProcessor*, int parameterIndex, float newValue)
+    {
+        const ScopedLock sl (changeLock);
+        changedParameterIndexes.add (parameterIndex);
+        changedParameterValues.add (newValue);
+    }
+
+    void audioProcessorChanged (AudioProcessor*)
+    {
+        const ScopedLock sl (changeLock);
+        processorChanged = true;
+    }
+
+    bool getCurrentPosition (CurrentPositionInfo& result)
+    {
+        if (shared->audio.hasPositionInfo == 0)
+            return false;
+
+        result = shared->audio.positionInfo;
+        return true;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginBridgeServer);
+};
+
+//==============================================================================
+AudioPluginInstance* PluginBridge::createBridgedInstance (const PluginDescription& description,
+                                                          const StringArray& serverCommand,
+                                                          String& errorMessage)
+{
+    ScopedPointer <BridgedPluginInstance> instance (new BridgedPluginInstance());
+
+    if (! instance->launch (description, serverCommand, errorMessage))
+        return nullptr;
+
+    return instance.release();
+}
+
+bool PluginBridge::performBridgeServer (AudioPluginFormatManager& formatManager,
+                                        const StringArray& args)
+{
+    const int flagIndex = args.indexOf (PluginBridgeHelpers::commandLineFlag);
+
+    if (flagIndex < 0)
+        return false;
+
+    const File sharedFile (args [flagIndex + 1]);
+    PluginBridgeServer server (sharedFile);
+    server.run (formatManager);
+    return true;
+}
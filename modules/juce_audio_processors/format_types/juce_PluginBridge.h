@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_PLUGINBRIDGE_JUCEHEADER__
+#define __JUCE_PLUGINBRIDGE_JUCEHEADER__
+
+#include "../format/juce_AudioPluginFormatManager.h"
+
+
+//==============================================================================
+/**
+    Runs plugins inside a separate child process, so that they can't crash the host.
+
+    createBridgedInstance() launches a "bridge server" process which loads the real
+    plugin, and returns an AudioPluginInstance that forwards everything to it. Audio,
+    MIDI, parameter changes and state data are passed through a block of shared memory,
+    so a processBlock() call only costs a couple of context-switches, and if the plugin
+    crashes or hangs, the instance just goes silent rather than taking the host down.
+    The audio has a channel of its own, so processBlock() never has to wait for a
+    parameter query or state transfer that another thread is in the middle of.
+
+    The server process is normally just another copy of your app, which must call
+    performBridgeServer() as soon as it starts up, e.g.
+    @code
+    void initialise (const String&)
+    {
+        AudioPluginFormatManager formatManager;
+        formatManager.addDefaultFormats();
+
+        if (PluginBridge::performBridgeServer (formatManager, getCommandLineParameterArray()))
+        {
+            quit();
+            return;
+        }
+        ...
+    @endcode
+
+    Note that bridged plugins don't provide an editor, so your host will need to use
+    a GenericAudioProcessorEditor to show their parameters.
+
+    @see PluginDirectoryScanner::useWorkerProcesses
+*/
+class JUCE_API  PluginBridge
+{
+public:
+    //==============================================================================
+    /** Launches a server process to load the given plugin, and returns an instance
+        which communicates with it.
+
+        @param description      the plugin to load
+        @param serverCommand    the executable (and any arguments it needs) which will
+                                act as the server - normally your own app's executable
+        @param errorMessage     if the plugin can't be loaded, this will be set to a
+                                description of the problem
+        @returns    a new instance, which the caller must delete, or nullptr if the
+                    server couldn't be started or couldn't load the plugin
+    */
+    static AudioPluginInstance* createBridgedInstance (const PluginDescription& description,
+                                                       const StringArray& serverCommand,
+                                                       String& errorMessage);
+
+    /** If the command-line arguments are those that createBridgedInstance() uses to
+        launch a server, this will load the plugin and run it until the host deletes
+        its instance, or the host process exits.
+
+        @returns true if this was a bridge server command-line, in which case your app
+                 should exit as soon as this returns; false if it wasn't, in which case
+                 nothing will have been done.
+    */
+    static bool performBridgeServer (AudioPluginFormatManager& formatManager,
+                                     const StringArray& commandLineArguments);
+
+private:
+    PluginBridge();
+    JUCE_DECLARE_NON_COPYABLE (PluginBridge);
+};
+
+
+#endif   // __JUCE_PLUGINBRIDGE_JUCEHEADER__
@@ -58,6 +58,11 @@
  #undef KeyPress
 #endif
 
+#if JUCE_LINUX
+ #include <sys/syscall.h>
+ #include <linux/futex.h>
+#endif
+
 //==============================================================================
 namespace juce
 {
@@ -66,13 +71,17 @@ namespace juce
 // format_types/*.mm, scanning/*.cpp
 #include "format/juce_AudioPluginFormat.cpp"
 #include "format/juce_AudioPluginFormatManager.cpp"
+#include "format/juce_PluginInstanceLoader.cpp"
 #include "processors/juce_AudioProcessor.cpp"
 #include "processors/juce_AudioProcessorEditor.cpp"
 #include "processors/juce_AudioProcessorGraph.cpp"
+#include "processors/juce_FixedBlockSizeAdapter.cpp"
 #include "processors/juce_GenericAudioProcessorEditor.cpp"
+#include "processors/juce_ParameterChangeQueue.cpp"
 #include "processors/juce_PluginDescription.cpp"
 #include "format_types/juce_VSTPluginFormat.cpp"
 #include "format_types/juce_AudioUnitPluginFormat.mm"
+#include "format_types/juce_PluginBridge.cpp"
 #include "scanning/juce_KnownPluginList.cpp"
 #include "scanning/juce_PluginDirectoryScanner.cpp"
 #include "scanning/juce_PluginListComponent.cpp"
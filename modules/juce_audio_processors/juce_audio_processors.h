@@ -84,9 +84,15 @@ namespace juce
 #ifndef __JUCE_AUDIOPROCESSORLISTENER_JUCEHEADER__
  #include "processors/juce_AudioProcessorListener.h"
 #endif
+#ifndef __JUCE_FIXEDBLOCKSIZEADAPTER_JUCEHEADER__
+ #include "processors/juce_FixedBlockSizeAdapter.h"
+#endif
 #ifndef __JUCE_GENERICAUDIOPROCESSOREDITOR_JUCEHEADER__
  #include "processors/juce_GenericAudioProcessorEditor.h"
 #endif
+#ifndef __JUCE_PARAMETERCHANGEQUEUE_JUCEHEADER__
+ #include "processors/juce_ParameterChangeQueue.h"
+#endif
 #ifndef __JUCE_PLUGINDESCRIPTION_JUCEHEADER__
  #include "processors/juce_PluginDescription.h"
 #endif
@@ -96,6 +102,9 @@ namespace juce
 #ifndef __JUCE_AUDIOPLUGINFORMATMANAGER_JUCEHEADER__
  #include "format/juce_AudioPluginFormatManager.h"
 #endif
+#ifndef __JUCE_PLUGININSTANCELOADER_JUCEHEADER__
+ #include "format/juce_PluginInstanceLoader.h"
+#endif
 #ifndef __JUCE_AUDIOUNITPLUGINFORMAT_JUCEHEADER__
  #include "format_types/juce_AudioUnitPluginFormat.h"
 #endif
@@ -105,6 +114,9 @@ namespace juce
 #ifndef __JUCE_LADSPAPLUGINFORMAT_JUCEHEADER__
  #include "format_types/juce_LADSPAPluginFormat.h"
 #endif
+#ifndef __JUCE_PLUGINBRIDGE_JUCEHEADER__
+ #include "format_types/juce_PluginBridge.h"
+#endif
 #include "format_types/juce_VSTMidiEventList.h"
 #ifndef __JUCE_VSTPLUGINFORMAT_JUCEHEADER__
  #include "format_types/juce_VSTPluginFormat.h"
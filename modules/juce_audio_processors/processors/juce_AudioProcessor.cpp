@@ -26,6 +26,7 @@
 AudioProcessor::AudioProcessor()
     : wrapperType (wrapperType_Undefined),
       playHead (nullptr),
+      listeners (new ListenerArray()),
       sampleRate (0),
       blockSize (0),
       numInputChannels (0),
@@ -47,6 +48,8 @@ AudioProcessor::~AudioProcessor()
     // or more parameters without having made a corresponding call to endParameterChangeGesture...
     jassert (changingParams.countNumberOfSetBits() == 0);
    #endif
+
+    delete listeners.get();
 }
 
 void AudioProcessor::setPlayHead (AudioPlayHead* const newPlayHead) noexcept
@@ -54,16 +57,70 @@ void AudioProcessor::setPlayHead (AudioPlayHead* const newPlayHead) noexcept
     playHead = newPlayHead;
 }
 
+//==============================================================================
+/*  A listener array is never modified once it's been published - adding or removing a
+    listener swaps in a new copy, and the old copies are only deleted once nobody can still
+    be using them. So the listeners can be called on any thread without taking a lock.
+*/
+class AudioProcessor::ListenerArrayReader
+{
+public:
+    ListenerArrayReader (AudioProcessor& owner_) noexcept
+        : owner (owner_)
+    {
+        // (the count must go up before the array is read, so that the writer can't
+        // delete an old array that a reader has just picked up)
+        ++owner.numListenerReaders;
+        array = owner.listeners.get();
+    }
+
+    ~ListenerArrayReader() noexcept
+    {
+        --owner.numListenerReaders;
+    }
+
+    int size() const noexcept                                       { return array->size(); }
+    AudioProcessorListener* operator[] (const int index) const noexcept   { return array->getUnchecked (index); }
+
+private:
+    AudioProcessor& owner;
+    const ListenerArray* array;
+
+    JUCE_DECLARE_NON_COPYABLE (ListenerArrayReader);
+};
+
 void AudioProcessor::addListener (AudioProcessorListener* const newListener)
 {
     const ScopedLock sl (listenerLock);
-    listeners.addIfNotAlreadyThere (newListener);
+
+    if (! listeners.get()->contains (newListener))
+    {
+        ListenerArray* const newArray = new ListenerArray (*listeners.get());
+        newArray->add (newListener);
+        publishListenerArray (newArray);
+    }
 }
 
 void AudioProcessor::removeListener (AudioProcessorListener* const listenerToRemove)
 {
     const ScopedLock sl (listenerLock);
-    listeners.removeFirstMatchingValue (listenerToRemove);
+
+    if (listeners.get()->contains (listenerToRemove))
+    {
+        ListenerArray* const newArray = new ListenerArray (*listeners.get());
+        newArray->removeFirstMatchingValue (listenerToRemove);
+        publishListenerArray (newArray);
+    }
+}
+
+void AudioProcessor::publishListenerArray (ListenerArray* const newArray)
+{
+    oldListenerArrays.add (listeners.exchange (newArray));
+
+    // Anyone who could still be reading one of the old arrays has already been counted,
+    // so if nobody's reading now, they can all go. Otherwise, they'll be deleted next time.
+    if (numListenerReaders.get() == 0)
+        oldListenerArrays.clear();
 }
 
 void AudioProcessor::setPlayConfigDetails (const int newNumIns,
@@ -74,6 +131,9 @@ void AudioProcessor::setPlayConfigDetails (const int newNumIns,
     sampleRate = newSampleRate;
     blockSize  = newBlockSize;
 
+    if (parameterChangeQueue != nullptr)
+        parameterChangeQueue->prepare (newSampleRate, newBlockSize);
+
     if (numInputChannels != newNumIns || numOutputChannels != newNumOuts)
     {
         numInputChannels  = newNumIns;
@@ -108,26 +168,31 @@ void AudioProcessor::setLatencySamples (const int newLatency)
 void AudioProcessor::setParameterNotifyingHost (const int parameterIndex,
                                                 const float newValue)
 {
-    setParameter (parameterIndex, newValue);
+    if (parameterChangeQueue == nullptr)
+        setParameter (parameterIndex, newValue);
+    else if (! parameterChangeQueue->addChange (parameterIndex, newValue))
+        return; // the queue's full, so the change is dropped (and counted) rather than being applied out of order
+
     sendParamChangeMessageToListeners (parameterIndex, newValue);
 }
 
+void AudioProcessor::enableParameterChangeQueue (const int capacity)
+{
+    // this needs to be done in your constructor, before anything can be using the queue..
+    jassert (parameterChangeQueue == nullptr);
+
+    parameterChangeQueue = new ParameterChangeQueue (capacity);
+    parameterChangeQueue->prepare (sampleRate, blockSize);
+}
+
 void AudioProcessor::sendParamChangeMessageToListeners (const int parameterIndex, const float newValue)
 {
     jassert (isPositiveAndBelow (parameterIndex, getNumParameters()));
 
-    for (int i = listeners.size(); --i >= 0;)
-    {
-        AudioProcessorListener* l;
-
-        {
-            const ScopedLock sl (listenerLock);
-            l = listeners [i];
-        }
+    const ListenerArrayReader l (*this);
 
-        if (l != nullptr)
-            l->audioProcessorParameterChanged (this, parameterIndex, newValue);
-    }
+    for (int i = l.size(); --i >= 0;)
+        l[i]->audioProcessorParameterChanged (this, parameterIndex, newValue);
 }
 
 void AudioProcessor::beginParameterChangeGesture (int parameterIndex)
@@ -141,18 +206,10 @@ void AudioProcessor::beginParameterChangeGesture (int parameterIndex)
     changingParams.setBit (parameterIndex);
    #endif
 
-    for (int i = listeners.size(); --i >= 0;)
-    {
-        AudioProcessorListener* l;
-
-        {
-            const ScopedLock sl (listenerLock);
-            l = listeners [i];
-        }
+    const ListenerArrayReader l (*this);
 
-        if (l != nullptr)
-            l->audioProcessorParameterChangeGestureBegin (this, parameterIndex);
-    }
+    for (int i = l.size(); --i >= 0;)
+        l[i]->audioProcessorParameterChangeGestureBegin (this, parameterIndex);
 }
 
 void AudioProcessor::endParameterChangeGesture (int parameterIndex)
@@ -167,34 +224,18 @@ void AudioProcessor::endParameterChangeGesture (int parameterIndex)
     changingParams.clearBit (parameterIndex);
    #endif
 
-    for (int i = listeners.size(); --i >= 0;)
-    {
-        AudioProcessorListener* l;
+    const ListenerArrayReader l (*this);
 
-        {
-            const ScopedLock sl (listenerLock);
-            l = listeners [i];
-        }
-
-        if (l != nullptr)
-            l->audioProcessorParameterChangeGestureEnd (this, parameterIndex);
-    }
+    for (int i = l.size(); --i >= 0;)
+        l[i]->audioProcessorParameterChangeGestureEnd (this, parameterIndex);
 }
 
 void AudioProcessor::updateHostDisplay()
 {
-    for (int i = listeners.size(); --i >= 0;)
-    {
-        AudioProcessorListener* l;
+    const ListenerArrayReader l (*this);
 
-        {
-            const ScopedLock sl (listenerLock);
-            l = listeners [i];
-        }
-
-        if (l != nullptr)
-            l->audioProcessorChanged (this);
-    }
+    for (int i = l.size(); --i >= 0;)
+        l[i]->audioProcessorChanged (this);
 }
 
 String AudioProcessor::getParameterLabel (int) const        { return String::empty; }
@@ -316,4 +357,201 @@ void AudioPlayHead::CurrentPositionInfo::resetToDefault()
     timeSigNumerator = 4;
     timeSigDenominator = 4;
     bpm = 120;
-}
\ No newline at end of file
+}
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioProcessorListenerTests  : public UnitTest
+{
+public:
+    AudioProcessorListenerTests() : UnitTest ("AudioProcessor listeners") {}
+
+    class TestProcessor  : public AudioProcessor
+    {
+    public:
+        TestProcessor (const int queueCapacity)
+            : numSetParameterCalls (0)
+        {
+            if (queueCapacity > 0)
+                enableParameterChangeQueue (queueCapacity);
+        }
+
+        const String getName() const                                { return "Test"; }
+        void prepareToPlay (double, int)                            {}
+        void releaseResources()                                     {}
+        void processBlock (AudioSampleBuffer&, MidiBuffer&)         {}
+
+        const String getInputChannelName (int) const                { return String::empty; }
+        const String getOutputChannelName (int) const               { return String::empty; }
+        bool isInputChannelStereoPair (int) const                   { return false; }
+        bool isOutputChannelStereoPair (int) const                  { return false; }
+        bool acceptsMidi() const                                    { return false; }
+        bool producesMidi() const                                   { return false; }
+
+        AudioProcessorEditor* createEditor()                        { return nullptr; }
+        bool hasEditor() const                                      { return false; }
+
+        int getNumParameters()                                      { return 4; }
+        const String getParameterName (int)                         { return String::empty; }
+        float getParameter (int)                                    { return 0; }
+        const String getParameterText (int)                         { return String::empty; }
+        void setParameter (int, float)                              { ++numSetParameterCalls; }
+
+        int getNumPrograms()                                        { return 0; }
+        int getCurrentProgram()                                     { return 0; }
+        void setCurrentProgram (int)                                {}
+        const String getProgramName (int)                           { return String::empty; }
+        void changeProgramName (int, const String&)                 {}
+
+        void getStateInformation (juce::MemoryBlock&)               {}
+        void setStateInformation (const void*, int)                 {}
+
+        int numSetParameterCalls;
+    };
+
+    class CountingListener  : public AudioProcessorListener
+    {
+    public:
+        CountingListener() {}
+
+        void audioProcessorParameterChanged (AudioProcessor*, int, float)   { ++numCalls; }
+        void audioProcessorChanged (AudioProcessor*)                        {}
+
+        Atomic<int> numCalls;
+    };
+
+    // Keeps sending parameter changes to the listeners, while the test adds and removes them
+    class NotifierThread  : public Thread
+    {
+    public:
+        NotifierThread (AudioProcessor& processor_)
+            : Thread ("notifier"), processor (processor_)
+        {
+        }
+
+        ~NotifierThread()
+        {
+            stopThread (5000);
+        }
+
+        void run()
+        {
+            while (! threadShouldExit())
+            {
+                processor.setParameterNotifyingHost (0, 0.5f);
+                ++numNotifications;
+            }
+        }
+
+        AudioProcessor& processor;
+        Atomic<int> numNotifications;
+    };
+
+    void runTest()
+    {
+        beginTest ("Adding and removing listeners");
+
+        {
+            TestProcessor processor (0);
+            CountingListener l1, l2;
+
+            processor.addListener (&l1);
+            processor.addListener (&l2);
+            processor.addListener (&l1);
+
+            processor.setParameterNotifyingHost (0, 0.5f);
+            expectEquals (processor.numSetParameterCalls, 1);
+            expectEquals (l1.numCalls.get(), 1);
+            expectEquals (l2.numCalls.get(), 1);
+
+            processor.removeListener (&l1);
+            processor.setParameterNotifyingHost (0, 0.5f);
+            expectEquals (l1.numCalls.get(), 1);
+            expectEquals (l2.numCalls.get(), 2);
+
+            processor.removeListener (&l2);
+        }
+
+        beginTest ("Changing the listeners while they're being called");
+
+        {
+            TestProcessor processor (0);
+            CountingListener permanent;
+            OwnedArray<CountingListener> temporary;
+
+            for (int i = 0; i < 8; ++i)
+                temporary.add (new CountingListener());
+
+            processor.addListener (&permanent);
+
+            NotifierThread notifier (processor);
+            notifier.startThread (0);
+
+            Random random (1);
+            const uint32 endTime = Time::getMillisecondCounter() + 10000;
+
+            // (keep going until both threads have had plenty of turns)
+            for (int i = 0; (i < 20000 || notifier.numNotifications.get() < 20000)
+                              && Time::getMillisecondCounter() < endTime; ++i)
+            {
+                CountingListener* const l = temporary.getUnchecked (random.nextInt (temporary.size()));
+
+                if (random.nextBool())
+                    processor.addListener (l);
+                else
+                    processor.removeListener (l);
+
+                if ((i & 255) == 0)
+                    Thread::yield();
+            }
+
+            notifier.stopThread (5000);
+
+            for (int i = 0; i < temporary.size(); ++i)
+                processor.removeListener (temporary.getUnchecked (i));
+
+            expect (notifier.numNotifications.get() > 0);
+            expectEquals (permanent.numCalls.get(), notifier.numNotifications.get());
+
+            processor.removeListener (&permanent);
+        }
+
+        beginTest ("Full parameter change queue");
+
+        {
+            TestProcessor processor (2);
+            CountingListener l;
+            processor.addListener (&l);
+            processor.setPlayConfigDetails (0, 0, 44100.0, 512);
+
+            for (int i = 0; i < 3; ++i)
+                processor.setParameterNotifyingHost (i, 0.5f);
+
+            // the dropped change mustn't be applied out of order, or reported to the host
+            expectEquals (processor.numSetParameterCalls, 0);
+            expectEquals (l.numCalls.get(), 2);
+            expectEquals (processor.getParameterChangeQueue()->getNumDroppedChanges(), 1);
+
+            ParameterChangeQueue& queue = *processor.getParameterChangeQueue();
+            int numChanges = 0;
+
+            for (int block = 0; block < 3; ++block)
+            {
+                queue.startBlock (512);
+
+                for (int i = 0; i < queue.getNumChanges(); ++i)
+                    expectEquals (queue.getChange (i).parameterIndex, numChanges++);
+            }
+
+            expectEquals (numChanges, 2);
+
+            processor.removeListener (&l);
+        }
+    }
+};
+
+static AudioProcessorListenerTests audioProcessorListenerUnitTests;
+
+#endif
@@ -28,6 +28,7 @@
 
 #include "juce_AudioProcessorEditor.h"
 #include "juce_AudioProcessorListener.h"
+#include "juce_ParameterChangeQueue.h"
 #include "juce_AudioPlayHead.h"
 
 
@@ -239,6 +240,18 @@ public:
     */
     void setLatencySamples (int newLatency);
 
+    /** Returns the length of the filter's tail, in seconds.
+
+        This is how long the filter's output can carry on for after its input has become
+        silent - e.g. the decay time of a reverb. An AudioProcessorGraph uses it to stop
+        calling processBlock() on nodes whose input has been silent for longer than this.
+
+        The default implementation returns a negative value, which means that the tail is
+        unknown or infinite, so processBlock() must always be called. Filters that can make
+        a sound without any audio input, such as synths, must also return a negative value.
+    */
+    virtual double getTailLengthSeconds() const                 { return -1.0; }
+
     /** Returns true if the processor wants midi messages. */
     virtual bool acceptsMidi() const = 0;
 
@@ -418,9 +431,27 @@ public:
         Note that to make sure the host correctly handles automation, you should call
         the beginParameterChangeGesture() and endParameterChangeGesture() methods to
         tell the host when the user has started and stopped changing the parameter.
+
+        If the processor has a ParameterChangeQueue, the change is added to the queue
+        instead of calling setParameter(), so that the audio thread can apply it at the
+        correct sample position during a later processBlock(). If the queue is full, the
+        change is dropped, and the host isn't told about it - see
+        ParameterChangeQueue::getNumDroppedChanges().
+
+        @see enableParameterChangeQueue
     */
     void setParameterNotifyingHost (int parameterIndex, float newValue);
 
+    /** Returns the queue of changes that this processor applies at exact sample positions
+        during its processBlock() method, or nullptr if it doesn't use one.
+
+        A host can use this to deliver automation with sample-accurate timing, using
+        ParameterChangeQueue::addChangeAtSample().
+
+        @see enableParameterChangeQueue
+    */
+    ParameterChangeQueue* getParameterChangeQueue() const noexcept     { return parameterChangeQueue; }
+
     /** Returns true if the host can automate this parameter.
 
         By default, this returns true for all parameters.
@@ -539,7 +570,11 @@ public:
     virtual void numChannelsChanged();
 
     //==============================================================================
-    /** Adds a listener that will be called when an aspect of this processor changes. */
+    /** Adds a listener that will be called when an aspect of this processor changes.
+
+        The listeners are called without taking any locks, so it's safe for the audio
+        thread to send them messages while other threads are adding or removing them.
+    */
     void addListener (AudioProcessorListener* newListener);
 
     /** Removes a previously added listener. */
@@ -604,8 +639,27 @@ protected:
     /** @internal */
     void sendParamChangeMessageToListeners (int parameterIndex, float newValue);
 
+    /** Gives the processor a ParameterChangeQueue.
+
+        Call this in your constructor if your processBlock() method can apply parameter
+        changes part-way through a block. Once it's enabled, the processBlock() method must
+        call ParameterChangeQueue::startBlock() on every block, and apply the changes that
+        it returns, because setParameterNotifyingHost() will no longer call setParameter()
+        directly.
+
+        @see getParameterChangeQueue, ParameterChangeQueue
+    */
+    void enableParameterChangeQueue (int capacity = 1024);
+
 private:
-    Array <AudioProcessorListener*> listeners;
+    typedef Array <AudioProcessorListener*> ListenerArray;
+    class ListenerArrayReader;
+    friend class ListenerArrayReader;
+
+    Atomic<ListenerArray*> listeners;
+    Atomic<int> numListenerReaders;
+    OwnedArray<ListenerArray> oldListenerArrays;
+    ScopedPointer<ParameterChangeQueue> parameterChangeQueue;
     Component::SafePointer<AudioProcessorEditor> activeEditor;
     double sampleRate;
     int blockSize, numInputChannels, numOutputChannels, latencySamples;
@@ -613,6 +667,8 @@ private:
     CriticalSection callbackLock, listenerLock;
     String inputSpeakerArrangement, outputSpeakerArrangement;
 
+    void publishListenerArray (ListenerArray*);
+
    #if JUCE_DEBUG
     BigInteger changingParams;
    #endif
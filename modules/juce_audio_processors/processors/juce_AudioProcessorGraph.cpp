@@ -29,6 +29,82 @@ const int AudioProcessorGraph::midiChannelIndex = 0x1000;
 namespace GraphRenderingOps
 {
 
+//==============================================================================
+// IDs for the shared buffers that the ops use, so that the parallel renderer can
+// work out which ops depend on each other.
+enum { graphOutputBufferId = 0 };
+
+static inline int getAudioBufferId (const int channel) noexcept     { return channel * 2 + 1; }
+static inline int getMidiBufferId (const int bufferNum) noexcept    { return bufferNum * 2 + 2; }
+
+//==============================================================================
+/** Keeps track of which of the shared audio channels are known to be silent while a
+    block is being rendered, so that the ops can skip work that wouldn't change anything,
+    and counts how much work was skipped.
+
+    A channel's flag is only used by the ops that read or modify that channel, so when the
+    graph's rendered on several threads, the parallel schedule already makes sure that they
+    don't overlap - only the counters need to be atomic.
+*/
+class SilenceTracker
+{
+public:
+    SilenceTracker()
+        : numChannels (0), numProcessOps (0), numChannelOps (0),
+          emptyChannelMayBeWritten (false)
+    {
+    }
+
+    void setNumChannels (const int numChannels_)
+    {
+        numChannels = numChannels_;
+        silentChannels.calloc ((size_t) numChannels);
+    }
+
+    void startBlock() noexcept
+    {
+        // At the start of a block, the only channel that's known to be silent is the
+        // read-only empty one - the others may still hold data from the last block,
+        // which a node in a feedback loop could read.
+        for (int i = numChannels; --i > 0;)
+            silentChannels[i] = false;
+
+        if (numChannels > 0)
+            silentChannels[0] = ! emptyChannelMayBeWritten;
+
+        numProcessOpsSkipped = 0;
+        numChannelOpsSkipped = 0;
+    }
+
+    bool isSilent (const int channel) const noexcept                { return silentChannels[channel]; }
+
+    void setSilent (const int channel, const bool isSilent_) noexcept
+    {
+        if (channel != 0)
+            silentChannels[channel] = isSilent_;
+    }
+
+    void processOpSkipped() noexcept                                { ++numProcessOpsSkipped; }
+    void channelOpSkipped() noexcept                                { ++numChannelOpsSkipped; }
+
+    // (these are set up by the ops' constructors)
+    void addProcessOp() noexcept                                    { ++numProcessOps; }
+    void addChannelOp() noexcept                                    { ++numChannelOps; }
+
+    // In a feedback loop, a node can end up being given the empty channel as one of its
+    // outputs, in which case the graph can't rely on it staying silent.
+    void setEmptyChannelMayBeWritten() noexcept                     { emptyChannelMayBeWritten = true; }
+
+    int numChannels, numProcessOps, numChannelOps;
+    Atomic<int> numProcessOpsSkipped, numChannelOpsSkipped;
+
+private:
+    HeapBlock<bool> silentChannels;
+    bool emptyChannelMayBeWritten;
+
+    JUCE_DECLARE_NON_COPYABLE (SilenceTracker);
+};
+
 //==============================================================================
 class AudioGraphRenderingOp
 {
@@ -40,6 +116,10 @@ public:
                           const OwnedArray <MidiBuffer>& sharedMidiBuffers,
                           const int numSamples) = 0;
 
+    // Adds the IDs of the buffers that this op reads to one array, and the ones that
+    // it modifies (including any that it also reads) to the other.
+    virtual void getBuffersUsed (Array<int>& buffersRead, Array<int>& buffersModified) const = 0;
+
     JUCE_LEAK_DETECTOR (AudioGraphRenderingOp);
 };
 
@@ -47,17 +127,33 @@ public:
 class ClearChannelOp : public AudioGraphRenderingOp
 {
 public:
-    ClearChannelOp (const int channelNum_)
-        : channelNum (channelNum_)
-    {}
+    ClearChannelOp (const int channelNum_, SilenceTracker& silence_)
+        : channelNum (channelNum_), silence (silence_)
+    {
+        silence.addChannelOp();
+    }
 
     void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
     {
-        sharedBufferChans.clear (channelNum, 0, numSamples);
+        if (silence.isSilent (channelNum))
+        {
+            silence.channelOpSkipped();
+        }
+        else
+        {
+            sharedBufferChans.clear (channelNum, 0, numSamples);
+            silence.setSilent (channelNum, true);
+        }
+    }
+
+    void getBuffersUsed (Array<int>&, Array<int>& buffersModified) const
+    {
+        buffersModified.add (getAudioBufferId (channelNum));
     }
 
 private:
     const int channelNum;
+    SilenceTracker& silence;
 
     JUCE_DECLARE_NON_COPYABLE (ClearChannelOp);
 };
@@ -66,18 +162,40 @@ private:
 class CopyChannelOp : public AudioGraphRenderingOp
 {
 public:
-    CopyChannelOp (const int srcChannelNum_, const int dstChannelNum_)
+    CopyChannelOp (const int srcChannelNum_, const int dstChannelNum_, SilenceTracker& silence_)
         : srcChannelNum (srcChannelNum_),
-          dstChannelNum (dstChannelNum_)
-    {}
+          dstChannelNum (dstChannelNum_),
+          silence (silence_)
+    {
+        silence.addChannelOp();
+    }
 
     void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
     {
-        sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
+        if (! silence.isSilent (srcChannelNum))
+        {
+            sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
+            silence.setSilent (dstChannelNum, false);
+        }
+        else
+        {
+            if (! silence.isSilent (dstChannelNum))
+                sharedBufferChans.clear (dstChannelNum, 0, numSamples);
+
+            silence.setSilent (dstChannelNum, true);
+            silence.channelOpSkipped();
+        }
+    }
+
+    void getBuffersUsed (Array<int>& buffersRead, Array<int>& buffersModified) const
+    {
+        buffersRead.add (getAudioBufferId (srcChannelNum));
+        buffersModified.add (getAudioBufferId (dstChannelNum));
     }
 
 private:
     const int srcChannelNum, dstChannelNum;
+    SilenceTracker& silence;
 
     JUCE_DECLARE_NON_COPYABLE (CopyChannelOp);
 };
@@ -86,18 +204,41 @@ private:
 class AddChannelOp : public AudioGraphRenderingOp
 {
 public:
-    AddChannelOp (const int srcChannelNum_, const int dstChannelNum_)
+    AddChannelOp (const int srcChannelNum_, const int dstChannelNum_, SilenceTracker& silence_)
         : srcChannelNum (srcChannelNum_),
-          dstChannelNum (dstChannelNum_)
-    {}
+          dstChannelNum (dstChannelNum_),
+          silence (silence_)
+    {
+        silence.addChannelOp();
+    }
 
     void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
     {
-        sharedBufferChans.addFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
+        if (silence.isSilent (srcChannelNum))
+        {
+            silence.channelOpSkipped();
+        }
+        else if (silence.isSilent (dstChannelNum))
+        {
+            // (adding to silence is the same as copying)
+            sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
+            silence.setSilent (dstChannelNum, false);
+        }
+        else
+        {
+            sharedBufferChans.addFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
+        }
+    }
+
+    void getBuffersUsed (Array<int>& buffersRead, Array<int>& buffersModified) const
+    {
+        buffersRead.add (getAudioBufferId (srcChannelNum));
+        buffersModified.add (getAudioBufferId (dstChannelNum));
     }
 
 private:
     const int srcChannelNum, dstChannelNum;
+    SilenceTracker& silence;
 
     JUCE_DECLARE_NON_COPYABLE (AddChannelOp);
 };
@@ -115,6 +256,11 @@ public:
         sharedMidiBuffers.getUnchecked (bufferNum)->clear();
     }
 
+    void getBuffersUsed (Array<int>&, Array<int>& buffersModified) const
+    {
+        buffersModified.add (getMidiBufferId (bufferNum));
+    }
+
 private:
     const int bufferNum;
 
@@ -135,6 +281,12 @@ public:
         *sharedMidiBuffers.getUnchecked (dstBufferNum) = *sharedMidiBuffers.getUnchecked (srcBufferNum);
     }
 
+    void getBuffersUsed (Array<int>& buffersRead, Array<int>& buffersModified) const
+    {
+        buffersRead.add (getMidiBufferId (srcBufferNum));
+        buffersModified.add (getMidiBufferId (dstBufferNum));
+    }
+
 private:
     const int srcBufferNum, dstBufferNum;
 
@@ -156,6 +308,12 @@ public:
             ->addEvents (*sharedMidiBuffers.getUnchecked (srcBufferNum), 0, numSamples, 0);
     }
 
+    void getBuffersUsed (Array<int>& buffersRead, Array<int>& buffersModified) const
+    {
+        buffersRead.add (getMidiBufferId (srcBufferNum));
+        buffersModified.add (getMidiBufferId (dstBufferNum));
+    }
+
 private:
     const int srcBufferNum, dstBufferNum;
 
@@ -166,16 +324,28 @@ private:
 class DelayChannelOp : public AudioGraphRenderingOp
 {
 public:
-    DelayChannelOp (const int channel_, const int numSamplesDelay_)
+    DelayChannelOp (const int channel_, const int numSamplesDelay_, SilenceTracker& silence_)
         : channel (channel_),
           bufferSize (numSamplesDelay_ + 1),
-          readIndex (0), writeIndex (numSamplesDelay_)
+          readIndex (0), writeIndex (numSamplesDelay_),
+          numSilentSamplesWritten (numSamplesDelay_ + 1),
+          silence (silence_)
     {
         buffer.calloc ((size_t) bufferSize);
+        silence.addChannelOp();
     }
 
     void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
     {
+        const bool inputIsSilent = silence.isSilent (channel);
+
+        if (inputIsSilent && numSilentSamplesWritten >= bufferSize)
+        {
+            // the delay line only contains silence, so the output will be silent too..
+            silence.channelOpSkipped();
+            return;
+        }
+
         float* data = sharedBufferChans.getSampleData (channel, 0);
 
         for (int i = numSamples; --i >= 0;)
@@ -186,12 +356,21 @@ public:
             if (++readIndex  >= bufferSize) readIndex = 0;
             if (++writeIndex >= bufferSize) writeIndex = 0;
         }
+
+        numSilentSamplesWritten = inputIsSilent ? jmin (bufferSize, numSilentSamplesWritten + numSamples) : 0;
+        silence.setSilent (channel, false);
+    }
+
+    void getBuffersUsed (Array<int>&, Array<int>& buffersModified) const
+    {
+        buffersModified.add (getAudioBufferId (channel));
     }
 
 private:
     HeapBlock<float> buffer;
     const int channel, bufferSize;
-    int readIndex, writeIndex;
+    int readIndex, writeIndex, numSilentSamplesWritten;
+    SilenceTracker& silence;
 
     JUCE_DECLARE_NON_COPYABLE (DelayChannelOp);
 };
@@ -204,149 +383,438 @@ public:
     ProcessBufferOp (const AudioProcessorGraph::Node::Ptr& node_,
                      const Array <int>& audioChannelsToUse_,
                      const int totalChans_,
-                     const int midiBufferToUse_)
+                     const int midiBufferToUse_,
+                     SilenceTracker& silence_)
         : node (node_),
           processor (node_->getProcessor()),
+          lastProcessingTicks (0),
           audioChannelsToUse (audioChannelsToUse_),
           totalChans (jmax (1, totalChans_)),
-          midiBufferToUse (midiBufferToUse_)
+          numIns (node_->getProcessor()->getNumInputChannels()),
+          numOuts (node_->getProcessor()->getNumOutputChannels()),
+          midiBufferToUse (midiBufferToUse_),
+          usesMidi (processor->acceptsMidi() || processor->producesMidi()),
+          writesToGraphOutput (false),
+          readsGraphInput (false),
+          tailLengthSamples (-1),
+          numSilentInputSamples (0),
+          silence (silence_)
     {
         channels.calloc ((size_t) totalChans);
 
         while (audioChannelsToUse.size() < totalChans)
             audioChannelsToUse.add (0);
+
+        const AudioProcessorGraph::AudioGraphIOProcessor* const ioProc
+            = dynamic_cast <const AudioProcessorGraph::AudioGraphIOProcessor*> (processor);
+
+        writesToGraphOutput = ioProc != nullptr && ioProc->isOutput();
+        readsGraphInput = ioProc != nullptr && ioProc->getType() == AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode;
+
+        // Once its input has been silent for longer than its tail plus its latency, the
+        // processor's output will be silent too, so it doesn't need to be called.
+        const double tailLength = processor->getTailLengthSeconds();
+
+        if (tailLength >= 0)
+            tailLengthSamples = (int) jmin (1.0e9, std::ceil (tailLength * processor->getSampleRate()))
+                                  + processor->getLatencySamples();
+
+        for (int i = 0; i < numOuts; ++i)
+            if (audioChannelsToUse.getUnchecked (i) == 0)
+                silence.setEmptyChannelMayBeWritten();
+
+        silence.addProcessOp();
     }
 
     void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
     {
+        const bool inputIsSilent = isInputSilent (sharedMidiBuffers);
+
+        if (inputIsSilent && tailLengthSamples >= 0 && numSilentInputSamples >= tailLengthSamples)
+        {
+            // the input channels are already silent, so just the extra outputs need clearing..
+            for (int i = numIns; i < numOuts; ++i)
+            {
+                const int chan = audioChannelsToUse.getUnchecked (i);
+
+                if (! silence.isSilent (chan))
+                {
+                    sharedBufferChans.clear (chan, 0, numSamples);
+                    silence.setSilent (chan, true);
+                }
+            }
+
+            silence.processOpSkipped();
+            lastProcessingTicks = 0;
+            return;
+        }
+
+        numSilentInputSamples = inputIsSilent ? jmin (numSilentInputSamples + numSamples, 0x40000000) : 0;
+
         for (int i = totalChans; --i >= 0;)
-            channels[i] = sharedBufferChans.getSampleData (audioChannelsToUse.getUnchecked (i), 0);
+        {
+            const int chan = audioChannelsToUse.getUnchecked (i);
+            channels[i] = sharedBufferChans.getSampleData (chan, 0);
+            silence.setSilent (chan, false);
+        }
 
         AudioSampleBuffer buffer (channels, totalChans, numSamples);
 
-        processor->processBlock (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse));
+        const int64 startTicks = Time::getHighResolutionTicks();
+
+        if (usesMidi)
+        {
+            processor->processBlock (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse));
+        }
+        else
+        {
+            // processors that don't use midi get a private buffer, so that they don't
+            // have to wait for other nodes that were given the same shared one.
+            unusedMidi.clear();
+            processor->processBlock (buffer, unusedMidi);
+        }
+
+        lastProcessingTicks = Time::getHighResolutionTicks() - startTicks;
+
+        // the graph's own input can't be skipped, but if it's silent, that's worth knowing..
+        if (readsGraphInput)
+            for (int i = numOuts; --i >= 0;)
+                if (buffer.getMagnitude (i, 0, numSamples) == 0.0f)
+                    silence.setSilent (audioChannelsToUse.getUnchecked (i), true);
+    }
+
+    bool isInputSilent (const OwnedArray <MidiBuffer>& sharedMidiBuffers) const noexcept
+    {
+        for (int i = numIns; --i >= 0;)
+            if (! silence.isSilent (audioChannelsToUse.getUnchecked (i)))
+                return false;
+
+        return ! (usesMidi && sharedMidiBuffers.getUnchecked (midiBufferToUse)->getNumEvents() > 0);
+    }
+
+    void getBuffersUsed (Array<int>& buffersRead, Array<int>& buffersModified) const
+    {
+        for (int i = 0; i < totalChans; ++i)
+        {
+            const int chan = audioChannelsToUse.getUnchecked (i);
+
+            if (chan == 0)
+                buffersRead.addIfNotAlreadyThere (getAudioBufferId (chan)); // the read-only empty buffer
+            else
+                buffersModified.addIfNotAlreadyThere (getAudioBufferId (chan));
+        }
+
+        if (usesMidi)
+            buffersModified.add (getMidiBufferId (midiBufferToUse));
+
+        if (writesToGraphOutput)
+            buffersModified.add (graphOutputBufferId);
     }
 
     const AudioProcessorGraph::Node::Ptr node;
     AudioProcessor* const processor;
+    int64 lastProcessingTicks;  // (the time spent in processBlock() during the last block)
 
 private:
     Array <int> audioChannelsToUse;
     HeapBlock <float*> channels;
     int totalChans;
+    const int numIns, numOuts;
     int midiBufferToUse;
+    MidiBuffer unusedMidi;
+    const bool usesMidi;
+    bool writesToGraphOutput, readsGraphInput;
+    int tailLengthSamples, numSilentInputSamples;
+    SilenceTracker& silence;
 
     JUCE_DECLARE_NON_COPYABLE (ProcessBufferOp);
 };
 
+//==============================================================================
+struct ConnectionSorter
+{
+    static int compareElements (const AudioProcessorGraph::Connection* const first,
+                                const AudioProcessorGraph::Connection* const second) noexcept
+    {
+        if      (first->sourceNodeId < second->sourceNodeId)                return -1;
+        else if (first->sourceNodeId > second->sourceNodeId)                return 1;
+        else if (first->destNodeId < second->destNodeId)                    return -1;
+        else if (first->destNodeId > second->destNodeId)                    return 1;
+        else if (first->sourceChannelIndex < second->sourceChannelIndex)    return -1;
+        else if (first->sourceChannelIndex > second->sourceChannelIndex)    return 1;
+        else if (first->destChannelIndex < second->destChannelIndex)        return -1;
+        else if (first->destChannelIndex > second->destChannelIndex)        return 1;
+
+        return 0;
+    }
+};
+
+//==============================================================================
+/** Returns the index of the first connection whose source is the given node (or the index
+    at which it would be), using the fact that the connections are sorted by their source.
+*/
+static int findFirstConnectionFrom (const OwnedArray<AudioProcessorGraph::Connection>& connections,
+                                    const uint32 sourceNodeId) noexcept
+{
+    int start = 0, end = connections.size();
+
+    while (start < end)
+    {
+        const int mid = (start + end) / 2;
+
+        if (connections.getUnchecked (mid)->sourceNodeId < sourceNodeId)
+            start = mid + 1;
+        else
+            end = mid;
+    }
+
+    return start;
+}
+
+//==============================================================================
+/** A copy of a graph's nodes and connections, which can be turned into a rendering
+    sequence on any thread, without the graph having to be locked.
+
+    The nodes are held in the order in which they need to be rendered.
+*/
+struct GraphSnapshot
+{
+    GraphSnapshot (const Array<AudioProcessorGraph::Node*>& orderedNodes,
+                   const OwnedArray<AudioProcessorGraph::Connection>& connections_,
+                   const double sampleRate_, const int blockSize_, const uint32 snapshotNumber_)
+        : sampleRate (sampleRate_), blockSize (blockSize_), snapshotNumber (snapshotNumber_)
+    {
+        nodes.ensureStorageAllocated (orderedNodes.size());
+
+        for (int i = 0; i < orderedNodes.size(); ++i)
+            nodes.add (orderedNodes.getUnchecked (i));
+
+        connections.ensureStorageAllocated (connections_.size());
+
+        for (int i = 0; i < connections_.size(); ++i)
+            connections.add (new AudioProcessorGraph::Connection (*connections_.getUnchecked (i)));
+    }
+
+    int getNumConnections() const noexcept                                      { return connections.size(); }
+    const AudioProcessorGraph::Connection* getConnection (const int index) const noexcept  { return connections.getUnchecked (index); }
+
+    int getFirstConnectionFrom (const uint32 sourceNodeId) const noexcept   { return findFirstConnectionFrom (connections, sourceNodeId); }
+
+    ReferenceCountedArray<AudioProcessorGraph::Node> nodes;
+    OwnedArray<AudioProcessorGraph::Connection> connections;  // (in the same order as the graph's)
+    const double sampleRate;
+    const int blockSize;
+    const uint32 snapshotNumber;
+
+    JUCE_DECLARE_NON_COPYABLE (GraphSnapshot);
+};
+
 //==============================================================================
 /** Used to calculate the correct sequence of rendering ops needed, based on
     the best re-use of shared buffers at each stage.
+
+    The nodes are rendered in the order that they're held by the snapshot. Before
+    anything's allocated, the connections are indexed by the position of their
+    destination node, and each node output gets a "slot" which records the buffer
+    that currently holds it and the last step at which it's read, so the whole
+    calculation takes roughly linear time in the number of nodes and connections.
 */
 class RenderingOpSequenceCalculator
 {
 public:
     //==============================================================================
-    RenderingOpSequenceCalculator (AudioProcessorGraph& graph_,
-                                   const Array<void*>& orderedNodes_,
-                                   Array<void*>& renderingOps)
+    RenderingOpSequenceCalculator (const GraphSnapshot& graph_,
+                                   Array<void*>& renderingOps,
+                                   SilenceTracker& silence_)
         : graph (graph_),
-          orderedNodes (orderedNodes_),
+          silence (silence_),
+          numNodes (graph_.nodes.size()),
+          nodePositions (jmax (101, graph_.nodes.size() * 2 + 1)),
           totalLatency (0)
     {
-        nodeIds.add ((uint32) zeroNodeID); // first buffer is read-only zeros
-        channels.add (0);
+        indexNodes();
+        indexConnections();
 
-        midiNodeIds.add ((uint32) zeroNodeID);
+        audioBufferContents.add (zeroSlot); // first buffer is read-only zeros
+        midiBufferContents.add (zeroSlot);
 
-        for (int i = 0; i < orderedNodes.size(); ++i)
+        for (int i = 0; i < numNodes; ++i)
         {
-            createRenderingOpsForNode ((AudioProcessorGraph::Node*) orderedNodes.getUnchecked(i),
-                                       renderingOps, i);
-
+            createRenderingOpsForNode (i, renderingOps);
             markAnyUnusedBuffersAsFree (i);
         }
-
-        graph.setLatencySamples (totalLatency);
     }
 
-    int getNumBuffersNeeded() const         { return nodeIds.size(); }
-    int getNumMidiBuffersNeeded() const     { return midiNodeIds.size(); }
+    int getNumBuffersNeeded() const         { return audioBufferContents.size(); }
+    int getNumMidiBuffersNeeded() const     { return midiBufferContents.size(); }
+    int getTotalLatency() const             { return totalLatency; }
 
 private:
     //==============================================================================
-    AudioProcessorGraph& graph;
-    const Array<void*>& orderedNodes;
-    Array <int> channels;
-    Array <uint32> nodeIds, midiNodeIds;
+    const GraphSnapshot& graph;
+    SilenceTracker& silence;
+    const int numNodes;
 
-    enum { freeNodeID = 0xffffffff, zeroNodeID = 0xfffffffe };
+    HashMap<int, int> nodePositions;   // node ID -> (position in the rendering order + 1)
+    Array<int> numIns, numOuts, nodeDelays;
 
-    static bool isNodeBusy (uint32 nodeID) noexcept { return nodeID != freeNodeID && nodeID != zeroNodeID; }
+    // The connections into each node, grouped by destination position, and in reverse order
+    // within each group. The inputs of the node at position n are inputConnections [firstInput[n] .. firstInput[n + 1]).
+    Array<const AudioProcessorGraph::Connection*> inputConnections;
+    Array<int> inputSourcePositions, firstInput;
 
-    Array <uint32> nodeDelayIDs;
-    Array <int> nodeDelays;
-    int totalLatency;
+    // Each node has a slot for each of its outputs, followed by one for its midi output.
+    Array<int> firstSlot, bufferForSlot, lastStepForSlot, nextSlotToFree, firstSlotToFreeAtStep;
+
+    // The slot that each buffer is holding, or one of the special values below.
+    Array<int> audioBufferContents, midiBufferContents;
+    SortedSet<int> freeAudioBuffers, freeMidiBuffers;
 
-    int getNodeDelay (const uint32 nodeID) const          { return nodeDelays [nodeDelayIDs.indexOf (nodeID)]; }
+    enum { freeSlot = -1, zeroSlot = -2 };
+
+    int totalLatency;
 
-    void setNodeDelay (const uint32 nodeID, const int latency)
+    //==============================================================================
+    void indexNodes()
     {
-        const int index = nodeDelayIDs.indexOf (nodeID);
+        numIns.ensureStorageAllocated (numNodes);
+        numOuts.ensureStorageAllocated (numNodes);
+        nodeDelays.insertMultiple (0, 0, numNodes);
+        firstSlot.ensureStorageAllocated (numNodes + 1);
 
-        if (index >= 0)
-        {
-            nodeDelays.set (index, latency);
-        }
-        else
+        int numSlots = 0;
+
+        for (int i = 0; i < numNodes; ++i)
         {
-            nodeDelayIDs.add (nodeID);
-            nodeDelays.add (latency);
+            const AudioProcessorGraph::Node* const node = graph.nodes.getUnchecked (i);
+            nodePositions.set ((int) node->nodeId, i + 1);
+
+            numIns.add (node->getProcessor()->getNumInputChannels());
+            numOuts.add (node->getProcessor()->getNumOutputChannels());
+
+            firstSlot.add (numSlots);
+            numSlots += numOuts.getUnchecked (i) + 1;
         }
+
+        firstSlot.add (numSlots);
+        bufferForSlot.insertMultiple (0, -1, numSlots);
+        lastStepForSlot.insertMultiple (0, -1, numSlots);
+        nextSlotToFree.insertMultiple (0, -1, numSlots);
+        firstSlotToFreeAtStep.insertMultiple (0, -1, numNodes + 1);
     }
 
-    int getInputLatencyForNode (const uint32 nodeID) const
+    void indexConnections()
     {
-        int maxLatency = 0;
+        const int numConnections = graph.getNumConnections();
+        firstInput.insertMultiple (0, 0, numNodes + 1);
 
-        for (int i = graph.getNumConnections(); --i >= 0;)
+        Array<int> destPositions;
+        destPositions.ensureStorageAllocated (numConnections);
+
+        for (int i = 0; i < numConnections; ++i)
         {
             const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
+            const int destPos = getNodePosition (c->destNodeId);
+            destPositions.add (destPos);
+
+            if (destPos >= 0)
+            {
+                firstInput.getReference (destPos + 1)++;
+
+                const int slot = getSlot (getNodePosition (c->sourceNodeId), c->sourceChannelIndex);
+
+                if (slot >= 0 && isUsableInput (destPos, c->destChannelIndex, c->sourceChannelIndex))
+                    lastStepForSlot.set (slot, jmax (lastStepForSlot.getUnchecked (slot), destPos));
+            }
+        }
+
+        for (int i = 0; i < numNodes; ++i)
+            firstInput.getReference (i + 1) += firstInput.getUnchecked (i);
+
+        inputConnections.insertMultiple (0, nullptr, firstInput.getLast());
+        inputSourcePositions.insertMultiple (0, -1, firstInput.getLast());
 
-            if (c->destNodeId == nodeID)
-                maxLatency = jmax (maxLatency, getNodeDelay (c->sourceNodeId));
+        Array<int> nextInput (firstInput);
+
+        for (int i = numConnections; --i >= 0;)
+        {
+            const int destPos = destPositions.getUnchecked (i);
+
+            if (destPos >= 0)
+            {
+                const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
+                const int index = nextInput.getReference (destPos)++;
+
+                inputConnections.set (index, c);
+                inputSourcePositions.set (index, getNodePosition (c->sourceNodeId));
+            }
         }
+    }
+
+    int getNodePosition (const uint32 nodeId) const     { return nodePositions [(int) nodeId] - 1; }
+
+    int getSlot (const int nodePos, const int outputChannel) const noexcept
+    {
+        if (nodePos < 0)
+            return -1;
+
+        if (outputChannel == AudioProcessorGraph::midiChannelIndex)
+            return firstSlot.getUnchecked (nodePos) + numOuts.getUnchecked (nodePos);
+
+        return isPositiveAndBelow (outputChannel, numOuts.getUnchecked (nodePos))
+                 ? firstSlot.getUnchecked (nodePos) + outputChannel : -1;
+    }
+
+    bool isUsableInput (const int destPos, const int destChannel, const int sourceChannel) const noexcept
+    {
+        if (sourceChannel == AudioProcessorGraph::midiChannelIndex)
+            return destChannel == AudioProcessorGraph::midiChannelIndex;
+
+        return isPositiveAndBelow (destChannel, numIns.getUnchecked (destPos));
+    }
+
+    int getNodeDelay (const int nodePos) const          { return nodeDelays [nodePos]; }
+
+    int getInputLatencyForNode (const int nodePos) const
+    {
+        int maxLatency = 0;
+
+        for (int i = firstInput.getUnchecked (nodePos); i < firstInput.getUnchecked (nodePos + 1); ++i)
+            maxLatency = jmax (maxLatency, getNodeDelay (inputSourcePositions.getUnchecked (i)));
 
         return maxLatency;
     }
 
     //==============================================================================
-    void createRenderingOpsForNode (AudioProcessorGraph::Node* const node,
-                                    Array<void*>& renderingOps,
-                                    const int ourRenderingIndex)
+    void createRenderingOpsForNode (const int ourRenderingIndex,
+                                    Array<void*>& renderingOps)
     {
-        const int numIns = node->getProcessor()->getNumInputChannels();
-        const int numOuts = node->getProcessor()->getNumOutputChannels();
+        AudioProcessorGraph::Node* const node = graph.nodes.getUnchecked (ourRenderingIndex);
+
+        const int numIns = this->numIns.getUnchecked (ourRenderingIndex);
+        const int numOuts = this->numOuts.getUnchecked (ourRenderingIndex);
         const int totalChans = jmax (numIns, numOuts);
+        const int firstInputIndex = firstInput.getUnchecked (ourRenderingIndex);
+        const int lastInputIndex = firstInput.getUnchecked (ourRenderingIndex + 1);
 
         Array <int> audioChannelsToUse;
         int midiBufferToUse = -1;
 
-        int maxLatency = getInputLatencyForNode (node->nodeId);
+        int maxLatency = getInputLatencyForNode (ourRenderingIndex);
 
         for (int inputChan = 0; inputChan < numIns; ++inputChan)
         {
             // get a list of all the inputs to this node
-            Array <uint32> sourceNodes;
+            Array <int> sourceNodes;
             Array<int> sourceOutputChans;
 
-            for (int i = graph.getNumConnections(); --i >= 0;)
+            for (int i = firstInputIndex; i < lastInputIndex; ++i)
             {
-                const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
+                const AudioProcessorGraph::Connection* const c = inputConnections.getUnchecked (i);
 
-                if (c->destNodeId == node->nodeId && c->destChannelIndex == inputChan)
+                if (c->destChannelIndex == inputChan)
                 {
-                    sourceNodes.add (c->sourceNodeId);
+                    sourceNodes.add (inputSourcePositions.getUnchecked (i));
                     sourceOutputChans.add (c->sourceChannelIndex);
                 }
             }
@@ -365,13 +833,13 @@ private:
                 else
                 {
                     bufIndex = getFreeBuffer (false);
-                    renderingOps.add (new ClearChannelOp (bufIndex));
+                    renderingOps.add (new ClearChannelOp (bufIndex, silence));
                 }
             }
             else if (sourceNodes.size() == 1)
             {
                 // channel with a straightforward single input..
-                const uint32 srcNode = sourceNodes.getUnchecked(0);
+                const int srcNode = sourceNodes.getUnchecked(0);
                 const int srcChan = sourceOutputChans.getUnchecked(0);
 
                 bufIndex = getBufferContaining (srcNode, srcChan);
@@ -392,7 +860,7 @@ private:
                     // need to use a copy of it..
                     const int newFreeBuffer = getFreeBuffer (false);
 
-                    renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer));
+                    renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer, silence));
 
                     bufIndex = newFreeBuffer;
                 }
@@ -400,7 +868,7 @@ private:
                 const int nodeDelay = getNodeDelay (srcNode);
 
                 if (nodeDelay < maxLatency)
-                    renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
+                    renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay, silence));
             }
             else
             {
@@ -426,7 +894,7 @@ private:
 
                         const int nodeDelay = getNodeDelay (sourceNodes.getUnchecked (i));
                         if (nodeDelay < maxLatency)
-                            renderingOps.add (new DelayChannelOp (sourceBufIndex, maxLatency - nodeDelay));
+                            renderingOps.add (new DelayChannelOp (sourceBufIndex, maxLatency - nodeDelay, silence));
 
                         break;
                     }
@@ -443,18 +911,18 @@ private:
                     if (srcIndex < 0)
                     {
                         // if not found, this is probably a feedback loop
-                        renderingOps.add (new ClearChannelOp (bufIndex));
+                        renderingOps.add (new ClearChannelOp (bufIndex, silence));
                     }
                     else
                     {
-                        renderingOps.add (new CopyChannelOp (srcIndex, bufIndex));
+                        renderingOps.add (new CopyChannelOp (srcIndex, bufIndex, silence));
                     }
 
                     reusableInputIndex = 0;
                     const int nodeDelay = getNodeDelay (sourceNodes.getFirst());
 
                     if (nodeDelay < maxLatency)
-                        renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
+                        renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay, silence));
                 }
 
                 for (int j = 0; j < sourceNodes.size(); ++j)
@@ -473,18 +941,18 @@ private:
                                                            sourceNodes.getUnchecked(j),
                                                            sourceOutputChans.getUnchecked(j)))
                                 {
-                                    renderingOps.add (new DelayChannelOp (srcIndex, maxLatency - nodeDelay));
+                                    renderingOps.add (new DelayChannelOp (srcIndex, maxLatency - nodeDelay, silence));
                                 }
                                 else // buffer is reused elsewhere, can't be delayed
                                 {
                                     const int bufferToDelay = getFreeBuffer (false);
-                                    renderingOps.add (new CopyChannelOp (srcIndex, bufferToDelay));
-                                    renderingOps.add (new DelayChannelOp (bufferToDelay, maxLatency - nodeDelay));
+                                    renderingOps.add (new CopyChannelOp (srcIndex, bufferToDelay, silence));
+                                    renderingOps.add (new DelayChannelOp (bufferToDelay, maxLatency - nodeDelay, silence));
                                     srcIndex = bufferToDelay;
                                 }
                             }
 
-                            renderingOps.add (new AddChannelOp (srcIndex, bufIndex));
+                            renderingOps.add (new AddChannelOp (srcIndex, bufIndex, silence));
                         }
                     }
                 }
@@ -494,7 +962,7 @@ private:
             audioChannelsToUse.add (bufIndex);
 
             if (inputChan < numOuts)
-                markBufferAsContaining (bufIndex, node->nodeId, inputChan);
+                markBufferAsContaining (bufIndex, ourRenderingIndex, inputChan);
         }
 
         for (int outputChan = numIns; outputChan < numOuts; ++outputChan)
@@ -503,19 +971,15 @@ private:
             jassert (bufIndex != 0);
             audioChannelsToUse.add (bufIndex);
 
-            markBufferAsContaining (bufIndex, node->nodeId, outputChan);
+            markBufferAsContaining (bufIndex, ourRenderingIndex, outputChan);
         }
 
         // Now the same thing for midi..
-        Array <uint32> midiSourceNodes;
+        Array <int> midiSourceNodes;
 
-        for (int i = graph.getNumConnections(); --i >= 0;)
-        {
-            const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
-
-            if (c->destNodeId == node->nodeId && c->destChannelIndex == AudioProcessorGraph::midiChannelIndex)
-                midiSourceNodes.add (c->sourceNodeId);
-        }
+        for (int i = firstInputIndex; i < lastInputIndex; ++i)
+            if (inputConnections.getUnchecked (i)->destChannelIndex == AudioProcessorGraph::midiChannelIndex)
+                midiSourceNodes.add (inputSourcePositions.getUnchecked (i));
 
         if (midiSourceNodes.size() == 0)
         {
@@ -603,40 +1067,32 @@ private:
         }
 
         if (node->getProcessor()->producesMidi())
-            markBufferAsContaining (midiBufferToUse, node->nodeId,
+            markBufferAsContaining (midiBufferToUse, ourRenderingIndex,
                                     AudioProcessorGraph::midiChannelIndex);
 
-        setNodeDelay (node->nodeId, maxLatency + node->getProcessor()->getLatencySamples());
+        nodeDelays.set (ourRenderingIndex, maxLatency + node->getProcessor()->getLatencySamples());
 
         if (numOuts == 0)
             totalLatency = maxLatency;
 
         renderingOps.add (new ProcessBufferOp (node, audioChannelsToUse,
-                                               totalChans, midiBufferToUse));
+                                               totalChans, midiBufferToUse, silence));
     }
 
     //==============================================================================
     int getFreeBuffer (const bool forMidi)
     {
-        if (forMidi)
-        {
-            for (int i = 1; i < midiNodeIds.size(); ++i)
-                if (midiNodeIds.getUnchecked(i) == freeNodeID)
-                    return i;
+        // (the buffer stays in the free list until something's actually put into it)
+        SortedSet<int>& freeBuffers = forMidi ? freeMidiBuffers : freeAudioBuffers;
 
-            midiNodeIds.add ((uint32) freeNodeID);
-            return midiNodeIds.size() - 1;
-        }
-        else
-        {
-            for (int i = 1; i < nodeIds.size(); ++i)
-                if (nodeIds.getUnchecked(i) == freeNodeID)
-                    return i;
+        if (freeBuffers.size() > 0)
+            return freeBuffers.getFirst();
 
-            nodeIds.add ((uint32) freeNodeID);
-            channels.add (0);
-            return nodeIds.size() - 1;
-        }
+        Array<int>& contents = forMidi ? midiBufferContents : audioBufferContents;
+
+        contents.add ((int) freeSlot);
+        freeBuffers.add (contents.size() - 1);
+        return contents.size() - 1;
     }
 
     int getReadOnlyEmptyBuffer() const noexcept
@@ -644,248 +1100,769 @@ private:
         return 0;
     }
 
-    int getBufferContaining (const uint32 nodeId, const int outputChannel) const noexcept
+    int getBufferContaining (const int nodePos, const int outputChannel) const noexcept
     {
-        if (outputChannel == AudioProcessorGraph::midiChannelIndex)
+        const int slot = getSlot (nodePos, outputChannel);
+        return slot >= 0 ? bufferForSlot.getUnchecked (slot) : -1;
+    }
+
+    void markAnyUnusedBuffersAsFree (const int stepIndex)
+    {
+        for (int slot = firstSlotToFreeAtStep.getUnchecked (stepIndex); slot >= 0; slot = nextSlotToFree.getUnchecked (slot))
+        {
+            const int bufIndex = bufferForSlot.getUnchecked (slot);
+
+            if (bufIndex >= 0) // (it may already have been overwritten by a node that re-used the buffer)
+            {
+                bufferForSlot.set (slot, -1);
+
+                if (isPositiveAndBelow (bufIndex, midiBufferContents.size())
+                     && midiBufferContents.getUnchecked (bufIndex) == slot)
+                {
+                    midiBufferContents.set (bufIndex, (int) freeSlot);
+                    freeMidiBuffers.add (bufIndex);
+                }
+                else
+                {
+                    audioBufferContents.set (bufIndex, (int) freeSlot);
+
+                    if (bufIndex != getReadOnlyEmptyBuffer()) // (only happens in a feedback loop)
+                        freeAudioBuffers.add (bufIndex);
+                }
+            }
+        }
+    }
+
+    bool isBufferNeededLater (const int stepIndexToSearchFrom,
+                              const int inputChannelOfIndexToIgnore,
+                              const int nodePos,
+                              const int outputChanIndex) const
+    {
+        if (nodePos < 0)
+            return false;
+
+        const uint32 nodeId = graph.nodes.getUnchecked (nodePos)->nodeId;
+
+        for (int i = graph.getFirstConnectionFrom (nodeId); i < graph.getNumConnections(); ++i)
         {
-            for (int i = midiNodeIds.size(); --i >= 0;)
-                if (midiNodeIds.getUnchecked(i) == nodeId)
-                    return i;
+            const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
+
+            if (c->sourceNodeId != nodeId)
+                break;
+
+            if (c->sourceChannelIndex == outputChanIndex)
+            {
+                const int destPos = getNodePosition (c->destNodeId);
+
+                if (destPos >= stepIndexToSearchFrom
+                     && isUsableInput (destPos, c->destChannelIndex, outputChanIndex)
+                     && (destPos > stepIndexToSearchFrom || c->destChannelIndex != inputChannelOfIndexToIgnore))
+                    return true;
+            }
         }
-        else
+
+        return false;
+    }
+
+    void markBufferAsContaining (int bufferNum, int nodePos, int outputIndex)
+    {
+        const bool isMidi = (outputIndex == AudioProcessorGraph::midiChannelIndex);
+        Array<int>& contents = isMidi ? midiBufferContents : audioBufferContents;
+
+        jassert (bufferNum >= (isMidi ? 1 : 0) && bufferNum < contents.size());
+
+        const int oldSlot = contents.getUnchecked (bufferNum);
+
+        if (oldSlot >= 0)
+            bufferForSlot.set (oldSlot, -1);
+        else if (oldSlot == freeSlot)
+            (isMidi ? freeMidiBuffers : freeAudioBuffers).removeValue (bufferNum);
+
+        const int slot = getSlot (nodePos, outputIndex);
+        jassert (slot >= 0);
+
+        contents.set (bufferNum, slot);
+        bufferForSlot.set (slot, bufferNum);
+
+        // schedule the buffer to be freed after the last step that reads it..
+        const int stepToFree = jmax (nodePos, lastStepForSlot.getUnchecked (slot) + 1);
+        nextSlotToFree.set (slot, firstSlotToFreeAtStep.getUnchecked (stepToFree));
+        firstSlotToFreeAtStep.set (stepToFree, slot);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderingOpSequenceCalculator);
+};
+
+//==============================================================================
+/** Splits a sequence of rendering ops into tasks that can be run on several threads.
+
+    Each task holds a ProcessBufferOp, plus the ops that prepare its buffers, in their
+    original order. A task depends on every earlier task that uses any of the same buffers
+    in a conflicting way, so the tasks can be run in any order that respects those
+    dependencies and the results will be exactly the same as running the ops in sequence.
+
+    The schedule also holds a queue of ready tasks for each thread. Threads take tasks
+    from their own queue first, and steal from the others when it's empty.
+*/
+class ParallelRenderingSchedule
+{
+public:
+    //==============================================================================
+    ParallelRenderingSchedule (const Array<void*>& renderingOps, const int numThreads)
+    {
+        for (int i = 0; i < renderingOps.size(); ++i)
         {
-            for (int i = nodeIds.size(); --i >= 0;)
-                if (nodeIds.getUnchecked(i) == nodeId
-                     && channels.getUnchecked(i) == outputChannel)
-                    return i;
+            if (tasks.size() == 0 || tasks.getLast()->containsProcessOp)
+                tasks.add (new Task());
+
+            AudioGraphRenderingOp* const op = static_cast <AudioGraphRenderingOp*> (renderingOps.getUnchecked (i));
+            Task* const task = tasks.getLast();
+            task->ops.add (op);
+            task->containsProcessOp = dynamic_cast <ProcessBufferOp*> (op) != nullptr;
+
+            addDependencies (*op, tasks.size() - 1);
         }
 
-        return -1;
+        for (int i = 0; i < numThreads; ++i)
+            queues.add (new TaskQueue (tasks.size()));
     }
 
-    void markAnyUnusedBuffersAsFree (const int stepIndex)
+    int getNumTasks() const noexcept        { return tasks.size(); }
+    int getNumThreads() const noexcept      { return queues.size(); }
+
+    //==============================================================================
+    // Called by the audio thread before any of the threads start calling runTasks().
+    void prepareForBlock (AudioSampleBuffer& sharedBufferChans_,
+                          const OwnedArray <MidiBuffer>& sharedMidiBuffers_,
+                          const int numSamples_) noexcept
     {
-        for (int i = 0; i < nodeIds.size(); ++i)
+        sharedBufferChans = &sharedBufferChans_;
+        sharedMidiBuffers = &sharedMidiBuffers_;
+        numSamples = numSamples_;
+
+        for (int i = queues.size(); --i >= 0;)
+            queues.getUnchecked (i)->reset();
+
+        int nextQueue = 0;
+
+        for (int i = 0; i < tasks.size(); ++i)
         {
-            if (isNodeBusy (nodeIds.getUnchecked(i))
-                 && ! isBufferNeededLater (stepIndex, -1,
-                                           nodeIds.getUnchecked(i),
-                                           channels.getUnchecked(i)))
+            Task* const task = tasks.getUnchecked (i);
+            task->numInputsPending.set (task->inputs.size());
+
+            if (task->inputs.size() == 0)
             {
-                nodeIds.set (i, (uint32) freeNodeID);
+                queues.getUnchecked (nextQueue)->push (i);
+                nextQueue = (nextQueue + 1) % queues.size();
             }
         }
 
-        for (int i = 0; i < midiNodeIds.size(); ++i)
+        numTasksStarted.set (0);
+        numTasksFinished.set (0);
+    }
+
+    // Runs tasks until all of them have been started. Any number of threads can call this
+    // at the same time, as long as they each use a different thread index. Thread 0 is the
+    // audio thread, and it doesn't return until all the tasks have finished.
+    void runTasks (const int threadIndex) noexcept
+    {
+        const int numTasks = tasks.size();
+        int numIdleLoops = 0;
+
+        while (numTasksFinished.get() < numTasks)
         {
-            if (isNodeBusy (midiNodeIds.getUnchecked(i))
-                 && ! isBufferNeededLater (stepIndex, -1,
-                                           midiNodeIds.getUnchecked(i),
-                                           AudioProcessorGraph::midiChannelIndex))
+            int taskIndex = popTask (threadIndex);
+
+            if (taskIndex < 0)
+            {
+                // once every task has been claimed, there's nothing more for a worker to do..
+                if (threadIndex != 0 && numTasksStarted.get() >= numTasks)
+                    break;
+
+                // Nothing is ready, so spin for a short while before giving away the rest of
+                // our time-slice - the wait is usually just a few microseconds, which is far
+                // less than it'd take a sleeping thread to wake up.
+                if (++numIdleLoops > spinsBeforeYielding)
+                    Thread::yield();
+
+                continue;
+            }
+
+            numIdleLoops = 0;
+
+            while (taskIndex >= 0)
             {
-                midiNodeIds.set (i, (uint32) freeNodeID);
+                ++numTasksStarted;
+                taskIndex = performTask (taskIndex, threadIndex);
             }
         }
     }
 
-    bool isBufferNeededLater (int stepIndexToSearchFrom,
-                              int inputChannelOfIndexToIgnore,
-                              const uint32 nodeId,
-                              const int outputChanIndex) const
+private:
+    //==============================================================================
+    struct Task
+    {
+        Task() : containsProcessOp (false) {}
+
+        Array <AudioGraphRenderingOp*> ops;
+        Array <int> inputs, dependents;
+        Atomic <int> numInputsPending;
+        bool containsProcessOp;
+    };
+
+    // A queue that has room for every task in the schedule, so that each slot only gets
+    // used once per block and pushing never has to wait for a slot to be emptied.
+    struct TaskQueue
     {
-        while (stepIndexToSearchFrom < orderedNodes.size())
+        explicit TaskQueue (const int capacity)
         {
-            const AudioProcessorGraph::Node* const node = (const AudioProcessorGraph::Node*) orderedNodes.getUnchecked (stepIndexToSearchFrom);
+            slots.insertMultiple (0, Atomic<int>(), capacity);
+        }
 
-            if (outputChanIndex == AudioProcessorGraph::midiChannelIndex)
-            {
-                if (inputChannelOfIndexToIgnore != AudioProcessorGraph::midiChannelIndex
-                     && graph.getConnectionBetween (nodeId, AudioProcessorGraph::midiChannelIndex,
-                                                    node->nodeId, AudioProcessorGraph::midiChannelIndex) != nullptr)
-                    return true;
-            }
-            else
+        void reset() noexcept
+        {
+            for (int i = writeIndex.get(); --i >= 0;)
+                slots.getReference (i).set (0);
+
+            writeIndex.set (0);
+            readIndex.set (0);
+        }
+
+        void push (const int taskIndex) noexcept
+        {
+            const int slot = (++writeIndex) - 1;
+            slots.getReference (slot).set (taskIndex + 1);
+        }
+
+        int pop() noexcept
+        {
+            for (;;)
             {
-                for (int i = 0; i < node->getProcessor()->getNumInputChannels(); ++i)
-                    if (i != inputChannelOfIndexToIgnore
-                         && graph.getConnectionBetween (nodeId, outputChanIndex,
-                                                        node->nodeId, i) != nullptr)
-                        return true;
+                const int slot = readIndex.get();
+
+                if (slot >= writeIndex.get())
+                    return -1;
+
+                if (readIndex.compareAndSetBool (slot + 1, slot))
+                {
+                    // the pushing thread may not have finished filling this slot yet..
+                    int value;
+                    while ((value = slots.getReference (slot).get()) == 0)
+                    {}
+
+                    return value - 1;
+                }
             }
+        }
+
+        Array <Atomic<int> > slots;
+        Atomic<int> writeIndex, readIndex;
+
+        JUCE_DECLARE_NON_COPYABLE (TaskQueue);
+    };
+
+    struct BufferUsage
+    {
+        BufferUsage() : lastModifier (-1) {}
+
+        int lastModifier;
+        Array <int> readersSinceLastModified;
+    };
+
+    enum { spinsBeforeYielding = 1000 };
+
+    OwnedArray <Task> tasks;
+    OwnedArray <TaskQueue> queues;
+    OwnedArray <BufferUsage> bufferUsage;
+    Atomic<int> numTasksStarted, numTasksFinished;
+
+    AudioSampleBuffer* sharedBufferChans;
+    const OwnedArray <MidiBuffer>* sharedMidiBuffers;
+    int numSamples;
+
+    //==============================================================================
+    BufferUsage& getUsage (const int bufferId)
+    {
+        while (bufferUsage.size() <= bufferId)
+            bufferUsage.add (new BufferUsage());
+
+        return *bufferUsage.getUnchecked (bufferId);
+    }
 
-            inputChannelOfIndexToIgnore = -1;
-            ++stepIndexToSearchFrom;
+    void addDependency (const int taskIndex, const int inputTaskIndex)
+    {
+        if (inputTaskIndex >= 0 && inputTaskIndex != taskIndex
+             && ! tasks.getUnchecked (taskIndex)->inputs.contains (inputTaskIndex))
+        {
+            tasks.getUnchecked (taskIndex)->inputs.add (inputTaskIndex);
+            tasks.getUnchecked (inputTaskIndex)->dependents.add (taskIndex);
         }
+    }
 
-        return false;
+    void addDependencies (const AudioGraphRenderingOp& op, const int taskIndex)
+    {
+        Array<int> buffersRead, buffersModified;
+        op.getBuffersUsed (buffersRead, buffersModified);
+
+        for (int i = 0; i < buffersRead.size(); ++i)
+        {
+            BufferUsage& usage = getUsage (buffersRead.getUnchecked (i));
+
+            addDependency (taskIndex, usage.lastModifier);
+            usage.readersSinceLastModified.addIfNotAlreadyThere (taskIndex);
+        }
+
+        for (int i = 0; i < buffersModified.size(); ++i)
+        {
+            BufferUsage& usage = getUsage (buffersModified.getUnchecked (i));
+
+            addDependency (taskIndex, usage.lastModifier);
+
+            for (int j = usage.readersSinceLastModified.size(); --j >= 0;)
+                addDependency (taskIndex, usage.readersSinceLastModified.getUnchecked (j));
+
+            usage.lastModifier = taskIndex;
+            usage.readersSinceLastModified.clearQuick();
+        }
     }
 
-    void markBufferAsContaining (int bufferNum, uint32 nodeId, int outputIndex)
+    int popTask (const int threadIndex) noexcept
     {
-        if (outputIndex == AudioProcessorGraph::midiChannelIndex)
+        for (int i = 0; i < queues.size(); ++i)
         {
-            jassert (bufferNum > 0 && bufferNum < midiNodeIds.size());
+            const int taskIndex = queues.getUnchecked ((threadIndex + i) % queues.size())->pop();
 
-            midiNodeIds.set (bufferNum, nodeId);
+            if (taskIndex >= 0)
+                return taskIndex;
         }
-        else
+
+        return -1;
+    }
+
+    // Runs a task, and returns one of the tasks that it has made ready, so that the same
+    // thread can go straight on to it while its buffers are still in the cache.
+    int performTask (const int taskIndex, const int threadIndex) noexcept
+    {
+        const Task& task = *tasks.getUnchecked (taskIndex);
+
+        for (int i = 0; i < task.ops.size(); ++i)
+            task.ops.getUnchecked (i)->perform (*sharedBufferChans, *sharedMidiBuffers, numSamples);
+
+        int nextTask = -1;
+
+        for (int i = 0; i < task.dependents.size(); ++i)
         {
-            jassert (bufferNum >= 0 && bufferNum < nodeIds.size());
+            const int dependent = task.dependents.getUnchecked (i);
 
-            nodeIds.set (bufferNum, nodeId);
-            channels.set (bufferNum, outputIndex);
+            if (--(tasks.getUnchecked (dependent)->numInputsPending) == 0)
+            {
+                if (nextTask < 0)
+                    nextTask = dependent;
+                else
+                    queues.getUnchecked (threadIndex)->push (dependent);
+            }
         }
+
+        ++numTasksFinished;
+        return nextTask;
     }
 
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderingOpSequenceCalculator);
+    JUCE_DECLARE_NON_COPYABLE (ParallelRenderingSchedule);
 };
 
+}
+
 //==============================================================================
-// Holds a fast lookup table for checking which nodes are inputs to others.
-class ConnectionLookupTable
+class AudioProcessorGraph::RenderingThreadPool  : public ReferenceCountedObject
 {
 public:
-    explicit ConnectionLookupTable (const OwnedArray<AudioProcessorGraph::Connection>& connections)
+    explicit RenderingThreadPool (const int numThreads)
+        : activeSchedule (nullptr)
     {
-        for (int i = 0; i < connections.size(); ++i)
+        // the audio thread counts as the first of the threads, so this only needs the others..
+        for (int i = 1; i < numThreads; ++i)
         {
-            const AudioProcessorGraph::Connection* const c = connections.getUnchecked(i);
-
-            int index;
-            Entry* entry = findEntry (c->destNodeId, index);
+            WorkerThread* const worker = new WorkerThread (*this, i);
+            workers.add (worker);
+            worker->startThread (9);
+        }
+    }
 
-            if (entry == nullptr)
-            {
-                entry = new Entry (c->destNodeId);
-                entries.insert (index, entry);
-            }
+    ~RenderingThreadPool()
+    {
+        for (int i = workers.size(); --i >= 0;)
+            workers.getUnchecked (i)->signalThreadShouldExit();
 
-            entry->srcNodes.add (c->sourceNodeId);
-        }
+        for (int i = workers.size(); --i >= 0;)
+            workers.getUnchecked (i)->stopThread (5000);
     }
 
-    bool isAnInputTo (const uint32 possibleInputId,
-                      const uint32 possibleDestinationId) const noexcept
+    int getNumThreads() const noexcept      { return workers.size() + 1; }
+
+    // Called by the audio thread, which takes its share of the tasks and returns when the
+    // whole schedule has been run.
+    void render (GraphRenderingOps::ParallelRenderingSchedule& schedule,
+                 AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
     {
-        return isAnInputToRecursive (possibleInputId, possibleDestinationId, entries.size());
+        jassert (schedule.getNumThreads() == getNumThreads());
+
+        schedule.prepareForBlock (sharedBufferChans, sharedMidiBuffers, numSamples);
+        activeSchedule = &schedule;
+        isRendering.set (1);
+
+        if (schedule.getNumTasks() > 1)
+            for (int i = workers.size(); --i >= 0;)
+                workers.getUnchecked (i)->notify();
+
+        schedule.runTasks (0);
+        isRendering.set (0);
+
+        // All the tasks have finished, but before the schedule can be touched again, any
+        // workers that are still looking for tasks must have noticed that there aren't any..
+        while (numActiveWorkers.get() > 0)
+            Thread::yield();
     }
 
+    typedef ReferenceCountedObjectPtr<RenderingThreadPool> Ptr;
+
 private:
     //==============================================================================
-    struct Entry
+    class WorkerThread  : public Thread
     {
-        explicit Entry (const uint32 destNodeId_) noexcept : destNodeId (destNodeId_) {}
+    public:
+        WorkerThread (RenderingThreadPool& owner_, const int threadIndex_)
+            : Thread ("Graph rendering thread"),
+              owner (owner_), threadIndex (threadIndex_)
+        {
+        }
+
+        void run()
+        {
+            while (! threadShouldExit())
+            {
+                wait (-1);
 
-        const uint32 destNodeId;
-        SortedSet<uint32> srcNodes;
+                ++(owner.numActiveWorkers);
 
-        JUCE_DECLARE_NON_COPYABLE (Entry);
+                if (owner.isRendering.get() != 0)
+                    owner.activeSchedule->runTasks (threadIndex);
+
+                --(owner.numActiveWorkers);
+            }
+        }
+
+    private:
+        RenderingThreadPool& owner;
+        const int threadIndex;
+
+        JUCE_DECLARE_NON_COPYABLE (WorkerThread);
     };
 
-    OwnedArray<Entry> entries;
+    OwnedArray<WorkerThread> workers;
+    GraphRenderingOps::ParallelRenderingSchedule* volatile activeSchedule;
+    Atomic<int> isRendering, numActiveWorkers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderingThreadPool);
+};
+
+//==============================================================================
+/*  A compiled version of the graph: the rendering ops, and the buffers that they use.
 
-    bool isAnInputToRecursive (const uint32 possibleInputId,
-                               const uint32 possibleDestinationId,
-                               int recursionCheck) const noexcept
+    Once it has been built, the only thing that touches one of these is the audio thread,
+    so the graph can publish a new one by just swapping a pointer.
+*/
+class AudioProcessorGraph::RenderSequence
+{
+public:
+    RenderSequence (GraphRenderingOps::GraphSnapshot* const snapshot_, RenderingThreadPool* const threadPool_)
+        : snapshot (snapshot_),
+          threadPool (threadPool_),
+          renderingBuffers (1, 1),
+          latencySamples (0)
     {
-        int index;
-        const Entry* const entry = findEntry (possibleDestinationId, index);
+        GraphRenderingOps::RenderingOpSequenceCalculator calculator (*snapshot, renderingOps, silence);
+
+        latencySamples = calculator.getTotalLatency();
+        silence.setNumChannels (jmax (2, calculator.getNumBuffersNeeded()));
 
-        if (entry != nullptr)
+        // all the buffers are allocated here, so that the audio thread never has to..
+        renderingBuffers.setSize (jmax (2, calculator.getNumBuffersNeeded()), snapshot->blockSize);
+        renderingBuffers.clear();
+
+        for (int i = calculator.getNumMidiBuffersNeeded(); --i >= 0;)
         {
-            const SortedSet<uint32>& srcNodes = entry->srcNodes;
+            MidiBuffer* const midiBuffer = new MidiBuffer();
+            midiBuffer->ensureSize (midiBufferBytesToPreallocate);
+            midiBuffers.add (midiBuffer);
+        }
 
-            if (srcNodes.contains (possibleInputId))
-                return true;
+        if (threadPool != nullptr)
+            schedule = new GraphRenderingOps::ParallelRenderingSchedule (renderingOps, threadPool->getNumThreads());
+
+        for (int i = 0; i < renderingOps.size(); ++i)
+        {
+            GraphRenderingOps::ProcessBufferOp* const op
+                = dynamic_cast <GraphRenderingOps::ProcessBufferOp*> ((GraphRenderingOps::AudioGraphRenderingOp*) renderingOps.getUnchecked(i));
+
+            if (op != nullptr)
+                processOps.add (op);
+        }
+    }
+
+    ~RenderSequence()
+    {
+        deleteRenderOpArray (renderingOps);
+    }
+
+    /** Prepares any of the snapshot's nodes that haven't been prepared yet, and then builds
+        a sequence from it and publishes it. This takes ownership of the snapshot, and can
+        be called on any thread.
+    */
+    static void compile (AudioProcessorGraph& graph, GraphRenderingOps::GraphSnapshot* const snapshot,
+                         RenderingThreadPool* const threadPool)
+    {
+        ScopedPointer<GraphRenderingOps::GraphSnapshot> s (snapshot);
+
+        {
+            const ScopedLock pl (graph.prepareLock);
 
-            if (--recursionCheck >= 0)
             {
-                for (int i = 0; i < srcNodes.size(); ++i)
-                    if (isAnInputToRecursive (possibleInputId, srcNodes.getUnchecked(i), recursionCheck))
-                        return true;
+                // If releaseResources() or prepareToPlay() has been called since the snapshot
+                // was taken, it's out of date, and its nodes mustn't be prepared again.
+                const ScopedLock sl (graph.sequenceLock);
+
+                if (s->snapshotNumber <= graph.lastPublishedSnapshotNumber)
+                    return;
             }
+
+            // (only the nodes that have been added since the last build actually need preparing)
+            for (int i = 0; i < s->nodes.size(); ++i)
+                s->nodes.getUnchecked(i)->prepare (s->sampleRate, s->blockSize, &graph);
         }
 
-        return false;
+        graph.publishSequence (new RenderSequence (s.release(), threadPool));
     }
 
-    Entry* findEntry (const uint32 destNodeId, int& insertIndex) const noexcept
+    uint32 getSnapshotNumber() const noexcept   { return snapshot->snapshotNumber; }
+    int getLatencySamples() const noexcept      { return latencySamples; }
+
+    void perform (const int numSamples)
     {
-        Entry* result = nullptr;
+        // the graph was prepared with a smaller block size than this..
+        jassert (numSamples <= renderingBuffers.getNumSamples());
 
-        int start = 0;
-        int end = entries.size();
+        silence.startBlock();
 
-        for (;;)
+        if (threadPool != nullptr)
+        {
+            threadPool->render (*schedule, renderingBuffers, midiBuffers, numSamples);
+        }
+        else
         {
-            if (start >= end)
+            for (int i = 0; i < renderingOps.size(); ++i)
             {
-                break;
+                GraphRenderingOps::AudioGraphRenderingOp* const op
+                    = (GraphRenderingOps::AudioGraphRenderingOp*) renderingOps.getUnchecked(i);
+
+                op->perform (renderingBuffers, midiBuffers, numSamples);
+            }
+        }
+    }
+
+    /** Passes each node's time for the last block on to its history, and returns their total. */
+    int64 addNodeTimesForLastBlock() noexcept
+    {
+        int64 totalTicks = 0;
+
+        for (int i = processOps.size(); --i >= 0;)
+        {
+            GraphRenderingOps::ProcessBufferOp* const op = processOps.getUnchecked (i);
+
+            totalTicks += op->lastProcessingTicks;
+            op->node->getProcessingTimes().addTime (ticksToMicroseconds (op->lastProcessingTicks));
+        }
+
+        return totalTicks;
+    }
+
+    static float ticksToMicroseconds (const int64 ticks) noexcept
+    {
+        return (float) (Time::highResolutionTicksToSeconds (ticks) * 1000000.0);
+    }
+
+    void addStatisticsForLastBlock (StatisticsCounters& stats) const noexcept
+    {
+        ++stats.numBlocks;
+        stats.numNodeCalls += silence.numProcessOps;
+        stats.numNodeCallsSkipped += silence.numProcessOpsSkipped.get();
+        stats.numChannelOps += silence.numChannelOps;
+        stats.numChannelOpsSkipped += silence.numChannelOpsSkipped.get();
+    }
+
+private:
+    // The snapshot keeps all the nodes alive while the sequence is in use, and gets deleted
+    // along with the sequence, on the message thread.
+    ScopedPointer<GraphRenderingOps::GraphSnapshot> snapshot;
+    RenderingThreadPool::Ptr threadPool;
+    ScopedPointer<GraphRenderingOps::ParallelRenderingSchedule> schedule;
+    Array<void*> renderingOps;
+    Array<GraphRenderingOps::ProcessBufferOp*> processOps;
+    AudioSampleBuffer renderingBuffers;
+    OwnedArray <MidiBuffer> midiBuffers;
+    GraphRenderingOps::SilenceTracker silence;
+    int latencySamples;
+
+    enum { midiBufferBytesToPreallocate = 2048 };
+
+    static void deleteRenderOpArray (Array<void*>& ops)
+    {
+        for (int i = ops.size(); --i >= 0;)
+            delete static_cast<GraphRenderingOps::AudioGraphRenderingOp*> (ops.getUnchecked(i));
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderSequence);
+};
+
+//==============================================================================
+class AudioProcessorGraph::RebuildThread  : public Thread
+{
+public:
+    explicit RebuildThread (AudioProcessorGraph& graph_)
+        : Thread ("Graph rebuild thread"),
+          graph (graph_)
+    {
+        startThread();
+    }
+
+    ~RebuildThread()
+    {
+        stopThread (10000);
+    }
+
+    // Replaces any snapshot that's still waiting to be compiled, as it's now out of date.
+    void compile (GraphRenderingOps::GraphSnapshot* const snapshot, RenderingThreadPool* const threadPool)
+    {
+        {
+            const ScopedLock sl (lock);
+            pendingSnapshot = snapshot;
+            pendingThreadPool = threadPool;
+        }
+
+        notify();
+    }
+
+    void run()
+    {
+        while (! threadShouldExit())
+        {
+            GraphRenderingOps::GraphSnapshot* snapshot;
+            RenderingThreadPool::Ptr threadPool;
+
+            {
+                const ScopedLock sl (lock);
+                snapshot = pendingSnapshot.release();
+                threadPool = pendingThreadPool;
+                pendingThreadPool = nullptr;
             }
-            else if (destNodeId == entries.getUnchecked (start)->destNodeId)
+
+            if (snapshot != nullptr)
             {
-                result = entries.getUnchecked (start);
-                break;
+                RenderSequence::compile (graph, snapshot, threadPool);
+
+                // the message thread will apply the new latency and delete the old sequence..
+                graph.triggerAsyncUpdate();
             }
             else
             {
-                const int halfway = (start + end) / 2;
-
-                if (halfway == start)
-                {
-                    if (destNodeId >= entries.getUnchecked (halfway)->destNodeId)
-                        ++start;
-
-                    break;
-                }
-                else if (destNodeId >= entries.getUnchecked (halfway)->destNodeId)
-                    start = halfway;
-                else
-                    end = halfway;
+                wait (-1);
             }
         }
-
-        insertIndex = start;
-        return result;
     }
 
-    JUCE_DECLARE_NON_COPYABLE (ConnectionLookupTable);
+private:
+    AudioProcessorGraph& graph;
+    CriticalSection lock;
+    ScopedPointer<GraphRenderingOps::GraphSnapshot> pendingSnapshot;
+    RenderingThreadPool::Ptr pendingThreadPool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RebuildThread);
 };
 
 //==============================================================================
-struct ConnectionSorter
+AudioProcessorGraph::Connection::Connection (const uint32 sourceNodeId_, const int sourceChannelIndex_,
+                                             const uint32 destNodeId_, const int destChannelIndex_) noexcept
+    : sourceNodeId (sourceNodeId_), sourceChannelIndex (sourceChannelIndex_),
+      destNodeId (destNodeId_), destChannelIndex (destChannelIndex_)
 {
-    static int compareElements (const AudioProcessorGraph::Connection* const first,
-                                const AudioProcessorGraph::Connection* const second) noexcept
+}
+
+//==============================================================================
+AudioProcessorGraph::TimingHistory::TimingHistory (const int numBlocksToKeep_)
+    : numBlocksToKeep (jmax (1, numBlocksToKeep_)),
+      nextIndex (0)
+{
+    times.calloc ((size_t) numBlocksToKeep);
+}
+
+AudioProcessorGraph::TimingHistory::~TimingHistory()
+{
+}
+
+void AudioProcessorGraph::TimingHistory::addTime (const float microseconds) noexcept
+{
+    times [nextIndex] = microseconds;
+
+    if (++nextIndex >= numBlocksToKeep)
+        nextIndex = 0;
+
+    if (numTimes.get() < numBlocksToKeep)
+        ++numTimes;
+}
+
+const AudioProcessorGraph::TimingHistory::Summary AudioProcessorGraph::TimingHistory::getSummary() const
+{
+    // (if a time gets overwritten while this is copying them, it'll just pick up the newer
+    // one, which doesn't matter for the purposes of a summary)
+    Array<float> sorted;
+    sorted.addArray (static_cast <const float*> (times.getData()), numTimes.get());
+
+    Summary summary;
+    zerostruct (summary);
+    summary.numBlocks = sorted.size();
+
+    if (sorted.size() > 0)
     {
-        if      (first->sourceNodeId < second->sourceNodeId)                return -1;
-        else if (first->sourceNodeId > second->sourceNodeId)                return 1;
-        else if (first->destNodeId < second->destNodeId)                    return -1;
-        else if (first->destNodeId > second->destNodeId)                    return 1;
-        else if (first->sourceChannelIndex < second->sourceChannelIndex)    return -1;
-        else if (first->sourceChannelIndex > second->sourceChannelIndex)    return 1;
-        else if (first->destChannelIndex < second->destChannelIndex)        return -1;
-        else if (first->destChannelIndex > second->destChannelIndex)        return 1;
+        DefaultElementComparator<float> comparator;
+        sorted.sort (comparator);
 
-        return 0;
+        double total = 0;
+        for (int i = sorted.size(); --i >= 0;)
+            total += sorted.getUnchecked (i);
+
+        summary.minimum      = sorted.getFirst();
+        summary.average      = total / sorted.size();
+        summary.maximum      = sorted.getLast();
+
+        // (these use the nearest-rank method)
+        summary.median       = sorted.getUnchecked (jmax (0, (int) std::ceil (sorted.size() * 0.50) - 1));
+        summary.percentile95 = sorted.getUnchecked (jmax (0, (int) std::ceil (sorted.size() * 0.95) - 1));
+        summary.percentile99 = sorted.getUnchecked (jmax (0, (int) std::ceil (sorted.size() * 0.99) - 1));
     }
-};
 
+    return summary;
 }
 
-//==============================================================================
-AudioProcessorGraph::Connection::Connection (const uint32 sourceNodeId_, const int sourceChannelIndex_,
-                                             const uint32 destNodeId_, const int destChannelIndex_) noexcept
-    : sourceNodeId (sourceNodeId_), sourceChannelIndex (sourceChannelIndex_),
-      destNodeId (destNodeId_), destChannelIndex (destChannelIndex_)
+void AudioProcessorGraph::TimingHistory::clear()
 {
+    numTimes = 0;
 }
 
 //==============================================================================
 AudioProcessorGraph::Node::Node (const uint32 nodeId_, AudioProcessor* const processor_) noexcept
     : nodeId (nodeId_),
       processor (processor_),
-      isPrepared (false)
+      isPrepared (false),
+      renderIndex (0)
 {
     jassert (processor_ != nullptr);
 }
@@ -902,6 +1879,7 @@ void AudioProcessorGraph::Node::prepare (const double sampleRate, const int bloc
                                          processor->getNumOutputChannels(),
                                          sampleRate, blockSize);
 
+        processor->setPlayHead (graph->getPlayHead());
         processor->prepareToPlay (sampleRate, blockSize);
     }
 }
@@ -912,6 +1890,7 @@ void AudioProcessorGraph::Node::unprepare()
     {
         isPrepared = false;
         processor->releaseResources();
+        processor->setPlayHead (nullptr);
     }
 }
 
@@ -927,14 +1906,20 @@ void AudioProcessorGraph::Node::setParentGraph (AudioProcessorGraph* const graph
 //==============================================================================
 AudioProcessorGraph::AudioProcessorGraph()
     : lastNodeId (0),
-      renderingBuffers (1, 1),
+      renderOrderNeedsSorting (false),
+      lastSnapshotNumber (0),
+      lastPublishedSnapshotNumber (0),
+      publishedLatency (0),
+      needsRebuild (false),
       currentAudioOutputBuffer (1, 1)
 {
 }
 
 AudioProcessorGraph::~AudioProcessorGraph()
 {
+    rebuildThread = nullptr;
     clearRenderingSequence();
+    renderingThreadPool = nullptr;
     clear();
 }
 
@@ -946,16 +1931,37 @@ const String AudioProcessorGraph::getName() const
 //==============================================================================
 void AudioProcessorGraph::clear()
 {
+    nodesById.clear();
     nodes.clear();
     connections.clear();
-    triggerAsyncUpdate();
+    renderOrder.clear();
+    renderOrderNeedsSorting = false;
+    topologyChanged();
+}
+
+int AudioProcessorGraph::findNodeIndex (const uint32 nodeId) const noexcept
+{
+    int start = 0, end = nodesById.size();
+
+    while (start < end)
+    {
+        const int mid = (start + end) / 2;
+
+        if (nodesById.getUnchecked (mid)->nodeId < nodeId)
+            start = mid + 1;
+        else
+            end = mid;
+    }
+
+    return start;
 }
 
 AudioProcessorGraph::Node* AudioProcessorGraph::getNodeForId (const uint32 nodeId) const
 {
-    for (int i = nodes.size(); --i >= 0;)
-        if (nodes.getUnchecked(i)->nodeId == nodeId)
-            return nodes.getUnchecked(i);
+    Node* const n = nodesById [findNodeIndex (nodeId)];
+
+    if (n != nullptr && n->nodeId == nodeId)
+        return n;
 
     return nullptr;
 }
@@ -984,7 +1990,13 @@ AudioProcessorGraph::Node* AudioProcessorGraph::addNode (AudioProcessor* const n
 
     Node* const n = new Node (nodeId, newProcessor);
     nodes.add (n);
-    triggerAsyncUpdate();
+    nodesById.insert (findNodeIndex (nodeId), n);
+
+    // (a new node has no connections, so it can go anywhere in the rendering order)
+    n->renderIndex = renderOrder.size();
+    renderOrder.add (n);
+
+    topologyChanged();
 
     n->setParentGraph (this);
     return n;
@@ -994,16 +2006,23 @@ bool AudioProcessorGraph::removeNode (const uint32 nodeId)
 {
     disconnectNode (nodeId);
 
-    for (int i = nodes.size(); --i >= 0;)
+    const int index = findNodeIndex (nodeId);
+    Node* const n = nodesById [index];
+
+    if (n != nullptr && n->nodeId == nodeId)
     {
-        if (nodes.getUnchecked(i)->nodeId == nodeId)
-        {
-            nodes.getUnchecked(i)->setParentGraph (nullptr);
-            nodes.remove (i);
-            triggerAsyncUpdate();
+        // (removing a node can't make the rendering order invalid)
+        renderOrder.remove (n->renderIndex);
 
-            return true;
-        }
+        for (int i = n->renderIndex; i < renderOrder.size(); ++i)
+            renderOrder.getUnchecked(i)->renderIndex = i;
+
+        n->setParentGraph (nullptr);
+        nodesById.remove (index);
+        nodes.removeObject (n);
+        topologyChanged();
+
+        return true;
     }
 
     return false;
@@ -1077,14 +2096,15 @@ bool AudioProcessorGraph::addConnection (const uint32 sourceNodeId,
     GraphRenderingOps::ConnectionSorter sorter;
     connections.addSorted (sorter, new Connection (sourceNodeId, sourceChannelIndex,
                                                    destNodeId, destChannelIndex));
-    triggerAsyncUpdate();
+    updateRenderOrder (sourceNodeId, destNodeId);
+    topologyChanged();
     return true;
 }
 
 void AudioProcessorGraph::removeConnection (const int index)
 {
     connections.remove (index);
-    triggerAsyncUpdate();
+    topologyChanged();
 }
 
 bool AudioProcessorGraph::removeConnection (const uint32 sourceNodeId, const int sourceChannelIndex,
@@ -1159,22 +2179,170 @@ bool AudioProcessorGraph::removeIllegalConnections()
 }
 
 //==============================================================================
-static void deleteRenderOpArray (Array<void*>& ops)
+void AudioProcessorGraph::updateRenderOrder (const uint32 sourceNodeId, const uint32 destNodeId)
 {
-    for (int i = ops.size(); --i >= 0;)
-        delete static_cast<GraphRenderingOps::AudioGraphRenderingOp*> (ops.getUnchecked(i));
+    if (renderOrderNeedsSorting)
+        return;
+
+    Node* const source = getNodeForId (sourceNodeId);
+    Node* const dest = getNodeForId (destNodeId);
+    jassert (source != nullptr && dest != nullptr);
+
+    const int start = dest->renderIndex;
+    const int end = source->renderIndex;
+
+    if (start > end)
+        return; // (already in the right order)
+
+    // The only nodes that need to move are the destination and anything that it feeds
+    // which is currently placed before the source. These get moved to just after the source,
+    // keeping their relative order, and nothing outside this range is touched.
+    Array<bool> needsMoving;
+    needsMoving.insertMultiple (0, false, end + 1 - start);
+    needsMoving.set (0, true);
+
+    Array<Node*> nodesToVisit;
+    nodesToVisit.add (dest);
+
+    while (nodesToVisit.size() > 0)
+    {
+        const uint32 nodeId = nodesToVisit.getLast()->nodeId;
+        nodesToVisit.removeLast();
+
+        for (int i = GraphRenderingOps::findFirstConnectionFrom (connections, nodeId); i < connections.size(); ++i)
+        {
+            const Connection* const c = connections.getUnchecked(i);
+
+            if (c->sourceNodeId != nodeId)
+                break;
+
+            Node* const n = getNodeForId (c->destNodeId);
+
+            if (n == source)
+            {
+                // this connection creates a feedback loop, so the order will need sorting out..
+                renderOrderNeedsSorting = true;
+                return;
+            }
+
+            jassert (n->renderIndex > start);
+
+            if (n->renderIndex <= end && ! needsMoving [n->renderIndex - start])
+            {
+                needsMoving.set (n->renderIndex - start, true);
+                nodesToVisit.add (n);
+            }
+        }
+    }
+
+    Array<Node*> nodesToMove;
+    int index = start;
+
+    for (int i = start; i <= end; ++i)
+    {
+        Node* const n = renderOrder.getUnchecked(i);
+
+        if (needsMoving.getUnchecked (i - start))
+        {
+            nodesToMove.add (n);
+        }
+        else
+        {
+            n->renderIndex = index;
+            renderOrder.set (index++, n);
+        }
+    }
+
+    for (int i = 0; i < nodesToMove.size(); ++i)
+    {
+        Node* const n = nodesToMove.getUnchecked(i);
+        n->renderIndex = index;
+        renderOrder.set (index++, n);
+    }
 }
 
-void AudioProcessorGraph::clearRenderingSequence()
+void AudioProcessorGraph::sortRenderOrder()
 {
-    Array<void*> oldOps;
+    // This is a depth-first topological sort: each node is added to the list after all the
+    // nodes that it feeds, and the list is reversed at the end. Starting from the last node
+    // keeps unconnected nodes in their existing order, and if there are feedback loops, the
+    // only connections that end up going backwards are the ones that lead round a loop.
+    const int numNodes = renderOrder.size();
+    enum { unvisited = 0, beingVisited, visited };
+
+    Array<int> states;
+    states.insertMultiple (0, (int) unvisited, numNodes);
+
+    Array<Node*> reversedOrder, stack;
+    Array<int> nextConnections;
+    reversedOrder.ensureStorageAllocated (numNodes);
+    bool hasFeedbackLoops = false;
+
+    for (int i = numNodes; --i >= 0;)
+    {
+        if (states.getUnchecked(i) != unvisited)
+            continue;
+
+        Node* const root = renderOrder.getUnchecked(i);
+        states.set (i, beingVisited);
+        stack.add (root);
+        nextConnections.add (GraphRenderingOps::findFirstConnectionFrom (connections, root->nodeId));
+
+        while (stack.size() > 0)
+        {
+            Node* const node = stack.getLast();
+            const Connection* const c = connections [nextConnections.getLast()];
+
+            if (c != nullptr && c->sourceNodeId == node->nodeId)
+            {
+                nextConnections.getReference (nextConnections.size() - 1)++;
+
+                Node* const dest = getNodeForId (c->destNodeId);
+
+                if (dest != nullptr)
+                {
+                    const int state = states.getUnchecked (dest->renderIndex);
+
+                    if (state == unvisited)
+                    {
+                        states.set (dest->renderIndex, beingVisited);
+                        stack.add (dest);
+                        nextConnections.add (GraphRenderingOps::findFirstConnectionFrom (connections, dest->nodeId));
+                    }
+                    else if (state == beingVisited)
+                    {
+                        hasFeedbackLoops = true;
+                    }
+                }
+            }
+            else
+            {
+                states.set (node->renderIndex, visited);
+                reversedOrder.add (node);
+                stack.removeLast();
+                nextConnections.removeLast();
+            }
+        }
+    }
+
+    jassert (reversedOrder.size() == numNodes);
 
+    for (int i = 0; i < numNodes; ++i)
     {
-        const ScopedLock sl (renderLock);
-        renderingOps.swapWithArray (oldOps);
+        Node* const n = reversedOrder.getUnchecked (numNodes - 1 - i);
+        n->renderIndex = i;
+        renderOrder.set (i, n);
     }
 
-    deleteRenderOpArray (oldOps);
+    // while there are loops, the order has to be re-sorted whenever anything changes..
+    renderOrderNeedsSorting = hasFeedbackLoops;
+}
+
+//==============================================================================
+void AudioProcessorGraph::clearRenderingSequence()
+{
+    publishSequence (nullptr);
+    deleteRetiredSequences();
 }
 
 bool AudioProcessorGraph::isAnInputTo (const uint32 possibleInputId,
@@ -1197,86 +2365,195 @@ bool AudioProcessorGraph::isAnInputTo (const uint32 possibleInputId,
     return false;
 }
 
-void AudioProcessorGraph::buildRenderingSequence()
+void AudioProcessorGraph::buildRenderingSequence (const bool canUseBackgroundThread)
 {
-    Array<void*> newRenderingOps;
-    int numRenderingBuffersNeeded = 2;
-    int numMidiBuffersNeeded = 1;
+    needsRebuild = false;
+
+    GraphRenderingOps::GraphSnapshot* snapshot;
 
     {
+        // (the lock is only held while the graph's layout is copied - the nodes get
+        // prepared and the ops get compiled afterwards, from the snapshot)
         MessageManagerLock mml;
 
-        Array<void*> orderedNodes;
+        if (renderOrderNeedsSorting)
+            sortRenderOrder();
 
-        {
-            const GraphRenderingOps::ConnectionLookupTable table (connections);
+        const ScopedLock sl (sequenceLock);
+        snapshot = new GraphRenderingOps::GraphSnapshot (renderOrder, connections, getSampleRate(),
+                                                         getBlockSize(), ++lastSnapshotNumber);
+    }
 
-            for (int i = 0; i < nodes.size(); ++i)
-            {
-                Node* const node = nodes.getUnchecked(i);
+    if (canUseBackgroundThread && rebuildThread != nullptr)
+    {
+        rebuildThread->compile (snapshot, renderingThreadPool);
+    }
+    else
+    {
+        RenderSequence::compile (*this, snapshot, renderingThreadPool);
+        deleteRetiredSequences();
+    }
+}
 
-                node->prepare (getSampleRate(), getBlockSize(), this);
+void AudioProcessorGraph::publishSequence (RenderSequence* const newSequence)
+{
+    RenderSequence* oldSequence;
 
-                int j = 0;
-                for (; j < orderedNodes.size(); ++j)
-                    if (table.isAnInputTo (node->nodeId, ((Node*) orderedNodes.getUnchecked(j))->nodeId))
-                      break;
+    {
+        const ScopedLock sl (sequenceLock);
 
-                orderedNodes.insert (j, node);
-            }
+        if (newSequence == nullptr)
+        {
+            // this makes any sequences that are still being compiled out-of-date..
+            lastPublishedSnapshotNumber = lastSnapshotNumber;
+        }
+        else if (newSequence->getSnapshotNumber() > lastPublishedSnapshotNumber)
+        {
+            lastPublishedSnapshotNumber = newSequence->getSnapshotNumber();
+            publishedLatency = newSequence->getLatencySamples();
+        }
+        else
+        {
+            // a more recent version of the graph has already been published..
+            retiredSequences.add (newSequence);
+            return;
         }
 
-        GraphRenderingOps::RenderingOpSequenceCalculator calculator (*this, orderedNodes, newRenderingOps);
+        oldSequence = currentSequence.exchange (newSequence);
 
-        numRenderingBuffersNeeded = calculator.getNumBuffersNeeded();
-        numMidiBuffersNeeded = calculator.getNumMidiBuffersNeeded();
+        // The audio thread may still be using the old sequence, so it can't be deleted
+        // here - deleteRetiredSequences() will get rid of it once it's no longer in use.
+        if (oldSequence != nullptr)
+            retiredSequences.add (oldSequence);
     }
+}
+
+void AudioProcessorGraph::deleteRetiredSequences()
+{
+    OwnedArray<RenderSequence> sequencesToDelete;
+    int latency;
 
     {
-        // swap over to the new rendering sequence..
-        const ScopedLock sl (renderLock);
+        const ScopedLock sl (sequenceLock);
 
-        renderingBuffers.setSize (numRenderingBuffersNeeded, getBlockSize());
-        renderingBuffers.clear();
+        // Anything that's been retired and isn't in use now can't be picked up by the audio
+        // thread again, because processBlock() always re-checks the current sequence after
+        // marking one as being in use.
+        RenderSequence* const inUse = sequenceInUse.get();
+
+        for (int i = retiredSequences.size(); --i >= 0;)
+            if (retiredSequences.getUnchecked(i) != inUse)
+                sequencesToDelete.add (retiredSequences.removeAndReturn (i));
+
+        latency = publishedLatency;
+    }
+
+    setLatencySamples (latency);
+}
+
+void AudioProcessorGraph::topologyChanged()
+{
+    needsRebuild = true;
+    triggerAsyncUpdate();
+}
+
+//==============================================================================
+void AudioProcessorGraph::setNumRenderingThreads (int numThreads)
+{
+    numThreads = jlimit (1, 64, numThreads);
+
+    if (numThreads != getNumRenderingThreads())
+    {
+        // the old pool is kept alive by any sequences that are still using it..
+        if (numThreads > 1)
+            renderingThreadPool = new RenderingThreadPool (numThreads);
+        else
+            renderingThreadPool = nullptr;
+
+        // the new threads will be used once the rendering sequence has been rebuilt..
+        topologyChanged();
+    }
+}
 
-        for (int i = midiBuffers.size(); --i >= 0;)
-            midiBuffers.getUnchecked(i)->clear();
+int AudioProcessorGraph::getNumRenderingThreads() const noexcept
+{
+    return renderingThreadPool != nullptr ? renderingThreadPool->getNumThreads() : 1;
+}
 
-        while (midiBuffers.size() < numMidiBuffersNeeded)
-            midiBuffers.add (new MidiBuffer());
+void AudioProcessorGraph::setRebuildsOnBackgroundThread (const bool shouldRebuildOnBackgroundThread)
+{
+    if (shouldRebuildOnBackgroundThread != rebuildsOnBackgroundThread())
+    {
+        if (shouldRebuildOnBackgroundThread)
+        {
+            rebuildThread = new RebuildThread (*this);
+        }
+        else
+        {
+            rebuildThread = nullptr;
 
-        renderingOps.swapWithArray (newRenderingOps);
+            // (the thread may have been deleted with a snapshot that it hadn't compiled yet)
+            topologyChanged();
+        }
     }
+}
+
+bool AudioProcessorGraph::rebuildsOnBackgroundThread() const noexcept
+{
+    return rebuildThread != nullptr;
+}
+
+//==============================================================================
+const AudioProcessorGraph::RenderingStatistics AudioProcessorGraph::getRenderingStatistics() const noexcept
+{
+    RenderingStatistics result;
+    result.numBlocks            = statistics.numBlocks.get();
+    result.numNodeCalls         = statistics.numNodeCalls.get();
+    result.numNodeCallsSkipped  = statistics.numNodeCallsSkipped.get();
+    result.numChannelOps        = statistics.numChannelOps.get();
+    result.numChannelOpsSkipped = statistics.numChannelOpsSkipped.get();
+    return result;
+}
 
-    // delete the old ones..
-    deleteRenderOpArray (newRenderingOps);
+void AudioProcessorGraph::resetRenderingStatistics() noexcept
+{
+    statistics.numBlocks = 0;
+    statistics.numNodeCalls = 0;
+    statistics.numNodeCallsSkipped = 0;
+    statistics.numChannelOps = 0;
+    statistics.numChannelOpsSkipped = 0;
 }
 
 void AudioProcessorGraph::handleAsyncUpdate()
 {
-    buildRenderingSequence();
+    if (needsRebuild)
+        buildRenderingSequence (true);
+    else
+        deleteRetiredSequences();
 }
 
 //==============================================================================
 void AudioProcessorGraph::prepareToPlay (double /*sampleRate*/, int estimatedSamplesPerBlock)
 {
     currentAudioInputBuffer = nullptr;
-    currentAudioOutputBuffer.setSize (jmax (1, getNumOutputChannels()), estimatedSamplesPerBlock);
+    currentAudioOutputBuffer.setSize (jmax (1, getNumInputChannels(), getNumOutputChannels()), estimatedSamplesPerBlock);
     currentMidiInputBuffer = nullptr;
     currentMidiOutputBuffer.clear();
 
     clearRenderingSequence();
-    buildRenderingSequence();
+    buildRenderingSequence (true);
 }
 
 void AudioProcessorGraph::releaseResources()
 {
+    clearRenderingSequence();
+
+    // (this waits for the rebuild thread to finish preparing any nodes that it's working on)
+    const ScopedLock pl (prepareLock);
+
     for (int i = 0; i < nodes.size(); ++i)
         nodes.getUnchecked(i)->unprepare();
 
-    renderingBuffers.setSize (1, 1);
-    midiBuffers.clear();
-
     currentAudioInputBuffer = nullptr;
     currentAudioOutputBuffer.setSize (1, 1);
     currentMidiInputBuffer = nullptr;
@@ -1285,29 +2562,48 @@ void AudioProcessorGraph::releaseResources()
 
 void AudioProcessorGraph::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const int64 startTicks = Time::getHighResolutionTicks();
     const int numSamples = buffer.getNumSamples();
 
-    const ScopedLock sl (renderLock);
+    // Mark the current sequence as being in use, then make sure it's still the current one -
+    // once that's true, the message thread won't delete it until it's been released below.
+    RenderSequence* sequence;
+
+    for (;;)
+    {
+        sequence = currentSequence.get();
+        sequenceInUse = sequence;
+
+        if (currentSequence.get() == sequence)
+            break;
+    }
 
     currentAudioInputBuffer = &buffer;
-    currentAudioOutputBuffer.setSize (jmax (1, buffer.getNumChannels()), numSamples);
+    currentAudioOutputBuffer.setSize (jmax (1, buffer.getNumChannels()), numSamples, false, false, true);
     currentAudioOutputBuffer.clear();
     currentMidiInputBuffer = &midiMessages;
     currentMidiOutputBuffer.clear();
 
-    for (int i = 0; i < renderingOps.size(); ++i)
-    {
-        GraphRenderingOps::AudioGraphRenderingOp* const op
-            = (GraphRenderingOps::AudioGraphRenderingOp*) renderingOps.getUnchecked(i);
+    int64 nodeTicks = 0;
 
-        op->perform (renderingBuffers, midiBuffers, numSamples);
+    if (sequence != nullptr)
+    {
+        sequence->perform (numSamples);
+        sequence->addStatisticsForLastBlock (statistics);
+        nodeTicks = sequence->addNodeTimesForLastBlock();
     }
 
+    sequenceInUse = nullptr;
+
     for (int i = 0; i < buffer.getNumChannels(); ++i)
         buffer.copyFrom (i, 0, currentAudioOutputBuffer, i, 0, numSamples);
 
     midiMessages.clear();
     midiMessages.addEvents (currentMidiOutputBuffer, 0, buffer.getNumSamples(), 0);
+
+    const int64 totalTicks = Time::getHighResolutionTicks() - startTicks;
+    totalProcessingTimes.addTime (RenderSequence::ticksToMicroseconds (totalTicks));
+    overheadProcessingTimes.addTime (RenderSequence::ticksToMicroseconds (jmax ((int64) 0, totalTicks - nodeTicks)));
 }
 
 const String AudioProcessorGraph::getInputChannelName (int channelIndex) const
@@ -1433,6 +2729,13 @@ bool AudioProcessorGraph::AudioGraphIOProcessor::producesMidi() const
     return type == midiInputNode;
 }
 
+double AudioProcessorGraph::AudioGraphIOProcessor::getTailLengthSeconds() const
+{
+    // the input nodes produce data that doesn't come from their own inputs, so they
+    // can never be skipped..
+    return isInput() ? -1.0 : 0.0;
+}
+
 const String AudioProcessorGraph::AudioGraphIOProcessor::getInputChannelName (int channelIndex) const
 {
     switch (type)
@@ -1504,3 +2807,144 @@ void AudioProcessorGraph::AudioGraphIOProcessor::setParentGraph (AudioProcessorG
         updateHostDisplay();
     }
 }
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioProcessorGraphTests  : public UnitTest
+{
+public:
+    AudioProcessorGraphTests() : UnitTest ("AudioProcessorGraph") {}
+
+    // Passes its audio straight through, and says that its output dies away a fixed
+    // number of samples after its input stops.
+    class TailProcessor  : public AudioProcessor
+    {
+    public:
+        TailProcessor (const double tailLengthSeconds_)
+            : tailLengthSeconds (tailLengthSeconds_), numCalls (0)
+        {
+            setPlayConfigDetails (1, 1, testSampleRate, testBlockSize);
+        }
+
+        const String getName() const                                { return "Tail"; }
+        void prepareToPlay (double, int)                            {}
+        void releaseResources()                                     {}
+        void processBlock (AudioSampleBuffer&, MidiBuffer&)         { ++numCalls; }
+        double getTailLengthSeconds() const                         { return tailLengthSeconds; }
+
+        const String getInputChannelName (int) const                { return String::empty; }
+        const String getOutputChannelName (int) const               { return String::empty; }
+        bool isInputChannelStereoPair (int) const                   { return false; }
+        bool isOutputChannelStereoPair (int) const                  { return false; }
+        bool acceptsMidi() const                                    { return false; }
+        bool producesMidi() const                                   { return false; }
+
+        AudioProcessorEditor* createEditor()                        { return nullptr; }
+        bool hasEditor() const                                      { return false; }
+
+        int getNumParameters()                                      { return 0; }
+        const String getParameterName (int)                         { return String::empty; }
+        float getParameter (int)                                    { return 0; }
+        const String getParameterText (int)                         { return String::empty; }
+        void setParameter (int, float)                              {}
+
+        int getNumPrograms()                                        { return 0; }
+        int getCurrentProgram()                                     { return 0; }
+        void setCurrentProgram (int)                                {}
+        const String getProgramName (int)                           { return String::empty; }
+        void changeProgramName (int, const String&)                 {}
+
+        void getStateInformation (juce::MemoryBlock&)               {}
+        void setStateInformation (const void*, int)                 {}
+
+        const double tailLengthSeconds;
+        int numCalls;
+    };
+
+    // (these make the tail a whole number of samples, without any rounding)
+    static const double testSampleRate;
+    enum { testBlockSize = 64, testTailSamples = 128 };
+
+    static void renderBlock (AudioProcessorGraph& graph, const float inputLevel, AudioSampleBuffer& buffer)
+    {
+        for (int i = 0; i < testBlockSize; ++i)
+            *buffer.getSampleData (0, i) = inputLevel;
+
+        MidiBuffer midi;
+        graph.processBlock (buffer, midi);
+    }
+
+    void runTest()
+    {
+        beginTest ("Skipping silent nodes");
+
+        AudioProcessorGraph graph;
+        graph.setPlayConfigDetails (1, 1, testSampleRate, testBlockSize);
+
+        typedef AudioProcessorGraph::AudioGraphIOProcessor IOProcessor;
+        const uint32 inputId  = graph.addNode (new IOProcessor (IOProcessor::audioInputNode))->nodeId;
+        const uint32 outputId = graph.addNode (new IOProcessor (IOProcessor::audioOutputNode))->nodeId;
+
+        TailProcessor* const processor = new TailProcessor (testTailSamples / testSampleRate);
+        const uint32 processorId = graph.addNode (processor)->nodeId;
+
+        expect (graph.addConnection (inputId, 0, processorId, 0));
+        expect (graph.addConnection (processorId, 0, outputId, 0));
+
+        graph.prepareToPlay (testSampleRate, testBlockSize);
+        graph.resetRenderingStatistics();
+
+        AudioSampleBuffer buffer (1, testBlockSize);
+
+        renderBlock (graph, 0.5f, buffer);
+        expectEquals (processor->numCalls, 1);
+        expectEquals (*buffer.getSampleData (0, testBlockSize - 1), 0.5f);
+
+        // The input's now silent, but the processor has to carry on being called until
+        // its tail has run out..
+        for (int i = 0; i < testTailSamples / testBlockSize; ++i)
+            renderBlock (graph, 0.0f, buffer);
+
+        expectEquals (processor->numCalls, 1 + testTailSamples / testBlockSize);
+
+        AudioProcessorGraph::RenderingStatistics stats (graph.getRenderingStatistics());
+        expectEquals (stats.numNodeCallsSkipped, (int64) 0);
+
+        // ..and from then on it's skipped, along with the output node that it feeds.
+        const int numSkippedBlocks = 7;
+
+        for (int i = 0; i < numSkippedBlocks; ++i)
+        {
+            renderBlock (graph, 0.0f, buffer);
+            expectEquals (buffer.getMagnitude (0, 0, testBlockSize), 0.0f);
+        }
+
+        expectEquals (processor->numCalls, 1 + testTailSamples / testBlockSize);
+
+        stats = graph.getRenderingStatistics();
+        expectEquals (stats.numNodeCallsSkipped, (int64) (numSkippedBlocks * 2));
+
+        beginTest ("Waking up again");
+
+        renderBlock (graph, 0.25f, buffer);
+        expectEquals (processor->numCalls, 2 + testTailSamples / testBlockSize);
+        expectEquals (*buffer.getSampleData (0, 0), 0.25f);
+
+        stats = graph.getRenderingStatistics();
+        const int numBlocks = 2 + testTailSamples / testBlockSize + numSkippedBlocks;
+
+        expectEquals (stats.numBlocks, (int64) numBlocks);
+        expectEquals (stats.numNodeCalls, (int64) (numBlocks * 3));
+        expectEquals (stats.numNodeCallsSkipped, (int64) (numSkippedBlocks * 2));
+
+        graph.releaseResources();
+    }
+};
+
+const double AudioProcessorGraphTests::testSampleRate = 32768.0;
+
+static AudioProcessorGraphTests audioProcessorGraphTests;
+
+#endif
@@ -44,6 +44,12 @@
 
     To play back a graph through an audio device, you might want to use an
     AudioProcessorPlayer object.
+
+    Whenever a node or connection is added or removed, the graph recompiles its whole
+    rendering sequence, rather than just the part that's downstream of the change,
+    because the buffers are shared out across the entire sequence. That takes roughly
+    linear time in the size of the graph - see setRebuildsOnBackgroundThread() if it
+    needs to be kept off the message thread.
 */
 class JUCE_API  AudioProcessorGraph   : public AudioProcessor,
                                         private AsyncUpdater
@@ -58,6 +64,66 @@ public:
     */
     ~AudioProcessorGraph();
 
+    //==============================================================================
+    /** Keeps a history of how long part of a graph took to render each of the most
+        recent blocks.
+
+        The graph's audio thread adds a new time after each block without locking or
+        allocating anything, overwriting the oldest one, and the times can be read back
+        on any other thread.
+
+        @see Node::getProcessingTimes, AudioProcessorGraph::getTotalProcessingTimes
+    */
+    class JUCE_API  TimingHistory
+    {
+    public:
+        //==============================================================================
+        /** Creates a history that will keep the given number of the most recent times. */
+        explicit TimingHistory (int numBlocksToKeep = 256);
+
+        /** Destructor. */
+        ~TimingHistory();
+
+        //==============================================================================
+        /** Describes the times that are currently in a TimingHistory.
+            All the times are in microseconds.
+        */
+        struct Summary
+        {
+            int numBlocks;          /**< The number of blocks that these figures are based on. */
+            double minimum;         /**< The shortest time. */
+            double average;         /**< The mean of all the times. */
+            double maximum;         /**< The longest time. */
+            double median;          /**< The 50th percentile. */
+            double percentile95;    /**< The time that 95% of the blocks were faster than. */
+            double percentile99;    /**< The time that 99% of the blocks were faster than. */
+        };
+
+        /** Returns a summary of the most recent times.
+            This mustn't be called from the audio thread, as it needs to allocate memory.
+        */
+        const Summary getSummary() const;
+
+        /** Discards all the times that have been recorded so far. */
+        void clear();
+
+        //==============================================================================
+        /** Adds a new time, in microseconds.
+            This is called by the graph's audio thread, and must only be called by one
+            thread at a time.
+        */
+        void addTime (float microseconds) noexcept;
+
+    private:
+        //==============================================================================
+        HeapBlock<float> times;
+        const int numBlocksToKeep;
+        int nextIndex;
+        Atomic<int> numTimes;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TimingHistory);
+    };
+
     //==============================================================================
     /** Represents one of the nodes, or processors, in an AudioProcessorGraph.
 
@@ -83,6 +149,13 @@ public:
         */
         NamedValueSet properties;
 
+        /** Returns the times that the node's processor took to render the most recent blocks.
+
+            The time for each block is measured around the call to its processBlock() method,
+            and is zero if the node was skipped because its input was silent.
+        */
+        TimingHistory& getProcessingTimes() noexcept            { return processingTimes; }
+
         //==============================================================================
         /** A convenient typedef for referring to a pointer to a node object. */
         typedef ReferenceCountedObjectPtr <Node> Ptr;
@@ -93,6 +166,8 @@ public:
 
         const ScopedPointer<AudioProcessor> processor;
         bool isPrepared;
+        int renderIndex;
+        TimingHistory processingTimes;
 
         Node (uint32 nodeId, AudioProcessor*) noexcept;
 
@@ -159,7 +234,8 @@ public:
     int getNumNodes() const                                         { return nodes.size(); }
 
     /** Returns a pointer to one of the nodes in the graph.
-        This will return nullptr if the index is out of range.
+        The nodes are kept in the order in which they were added. This will return nullptr
+        if the index is out of range.
         @see getNodeForId
     */
     Node* getNode (const int index) const                           { return nodes [index]; }
@@ -322,6 +398,7 @@ public:
         bool isOutputChannelStereoPair (int index) const;
         bool acceptsMidi() const;
         bool producesMidi() const;
+        double getTailLengthSeconds() const;
 
         bool hasEditor() const;
         AudioProcessorEditor* createEditor();
@@ -351,6 +428,98 @@ public:
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioGraphIOProcessor);
     };
 
+    //==============================================================================
+    /** Sets the number of threads that will be used to render the graph.
+
+        By default, all the nodes are processed on the audio thread, one after another. If
+        you give the graph more threads than this, nodes that don't depend on each other's
+        output will be processed at the same time by a set of high-priority worker threads,
+        with the audio thread doing its share of the work. The order in which each buffer
+        is modified stays the same, so the output is identical to the single-threaded result.
+
+        While the graph is rendering, the worker threads spin rather than sleep when they're
+        waiting for a node's inputs to be ready, so this is only worthwhile when there are
+        several independent branches that each use a significant amount of CPU. It also means
+        that the processors in the graph must be happy to be called on different threads.
+
+        The new threads will start being used once the graph has rebuilt its rendering
+        sequence, which happens asynchronously.
+    */
+    void setNumRenderingThreads (int numThreads);
+
+    /** Returns the number of threads that the graph uses for rendering, including the audio thread.
+        @see setNumRenderingThreads
+    */
+    int getNumRenderingThreads() const noexcept;
+
+    /** Enables or disables rebuilding the rendering sequence on a background thread.
+
+        Whenever nodes or connections are changed, the graph has to recompile the sequence
+        of operations that it uses to render itself. Each rebuild starts by taking a copy of
+        the graph's layout while holding the MessageManagerLock, and then calls prepareToPlay()
+        on any processors that have been added since the last rebuild, and compiles the copy.
+
+        By default, those last two steps happen synchronously: on the message thread after an
+        edit, or inside the graph's own prepareToPlay() method. If you enable this option,
+        they're always done by a background thread instead - that includes the first build
+        and the one made by prepareToPlay(), so the new processors' prepareToPlay() methods
+        will be called on that thread, too. The audio thread carries on playing the old
+        sequence until the new one is ready, and then switches over to it without blocking.
+        Because prepareToPlay() throws away the old sequence, the graph will output silence
+        until the background thread has finished, and the new latency is only reported once
+        the message thread has been told that the sequence is ready.
+    */
+    void setRebuildsOnBackgroundThread (bool shouldRebuildOnBackgroundThread);
+
+    /** Returns true if the rendering sequence is being rebuilt on a background thread.
+        @see setRebuildsOnBackgroundThread
+    */
+    bool rebuildsOnBackgroundThread() const noexcept;
+
+    //==============================================================================
+    /** Some totals describing how much work the graph has done, and how much it managed
+        to avoid doing.
+
+        While it's rendering, the graph keeps track of which of its internal channels are
+        known to be silent. Copying or mixing a silent channel is skipped, and a node whose
+        input has been silent for longer than its AudioProcessor::getTailLengthSeconds()
+        won't have its processBlock() method called at all.
+
+        @see getRenderingStatistics
+    */
+    struct RenderingStatistics
+    {
+        int64 numBlocks;              /**< The number of blocks that have been rendered. */
+        int64 numNodeCalls;           /**< The number of times a node needed processing. */
+        int64 numNodeCallsSkipped;    /**< How many of those node calls were skipped because the node was silent. */
+        int64 numChannelOps;          /**< The number of times a channel needed to be copied, mixed, cleared or delayed. */
+        int64 numChannelOpsSkipped;   /**< How many of those channel operations were skipped because of silence. */
+    };
+
+    /** Returns the totals that have been counted since the last call to resetRenderingStatistics().
+        This can be called on any thread.
+    */
+    const RenderingStatistics getRenderingStatistics() const noexcept;
+
+    /** Sets all the rendering statistics back to zero. */
+    void resetRenderingStatistics() noexcept;
+
+    /** Returns the times that the graph took to render the most recent blocks, measured
+        across the whole of its processBlock() method.
+        @see getOverheadProcessingTimes, Node::getProcessingTimes
+    */
+    TimingHistory& getTotalProcessingTimes() noexcept           { return totalProcessingTimes; }
+
+    /** Returns the part of each block's total time that wasn't spent inside the nodes'
+        processBlock() methods - i.e. the time spent copying, mixing and delaying the
+        graph's internal buffers.
+
+        When the graph is using more than one rendering thread, the nodes' times are added
+        up across all the threads, so this will usually read as zero.
+        @see getTotalProcessingTimes, setNumRenderingThreads
+    */
+    TimingHistory& getOverheadProcessingTimes() noexcept        { return overheadProcessingTimes; }
+
     //==============================================================================
     // AudioProcessor methods:
 
@@ -389,13 +558,34 @@ public:
 private:
     //==============================================================================
     ReferenceCountedArray <Node> nodes;
+    Array <Node*> nodesById;   // the same nodes, sorted by ID so that getNodeForId() can do a binary search
     OwnedArray <Connection> connections;
     uint32 lastNodeId;
-    AudioSampleBuffer renderingBuffers;
-    OwnedArray <MidiBuffer> midiBuffers;
 
-    CriticalSection renderLock;
-    Array<void*> renderingOps;
+    Array<Node*> renderOrder;
+    bool renderOrderNeedsSorting;
+
+    class RenderingThreadPool;
+    class RenderSequence;
+    class RebuildThread;
+
+    CriticalSection sequenceLock, prepareLock;
+    Atomic<RenderSequence*> currentSequence, sequenceInUse;
+    OwnedArray<RenderSequence> retiredSequences;
+    uint32 lastSnapshotNumber, lastPublishedSnapshotNumber;
+    int publishedLatency;
+    bool needsRebuild;
+
+    ReferenceCountedObjectPtr<RenderingThreadPool> renderingThreadPool;
+    ScopedPointer<RebuildThread> rebuildThread;
+
+    struct StatisticsCounters
+    {
+        Atomic<int64> numBlocks, numNodeCalls, numNodeCallsSkipped, numChannelOps, numChannelOpsSkipped;
+    };
+
+    StatisticsCounters statistics;
+    TimingHistory totalProcessingTimes, overheadProcessingTimes;
 
     friend class AudioGraphIOProcessor;
     AudioSampleBuffer* currentAudioInputBuffer;
@@ -405,7 +595,13 @@ private:
 
     void handleAsyncUpdate();
     void clearRenderingSequence();
-    void buildRenderingSequence();
+    void buildRenderingSequence (bool canUseBackgroundThread);
+    void publishSequence (RenderSequence*);
+    void deleteRetiredSequences();
+    void topologyChanged();
+    int findNodeIndex (uint32 nodeId) const noexcept;
+    void updateRenderOrder (uint32 sourceNodeId, uint32 destNodeId);
+    void sortRenderOrder();
     bool isAnInputTo (uint32 possibleInputId, uint32 possibleDestinationId, int recursionCheck) const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioProcessorGraph);
@@ -0,0 +1,488 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+class FixedBlockSizeAdapter::WrapperEditor  : public AudioProcessorEditor,
+                                             private ComponentListener
+{
+public:
+    WrapperEditor (FixedBlockSizeAdapter& owner_, AudioProcessorEditor* content_)
+        : AudioProcessorEditor (&owner_),
+          content (content_)
+    {
+        addAndMakeVisible (content);
+        content->addComponentListener (this);
+        setSize (content->getWidth(), content->getHeight());
+    }
+
+    ~WrapperEditor()
+    {
+        content->removeComponentListener (this);
+        content = nullptr;
+    }
+
+    void componentMovedOrResized (Component&, bool /*wasMoved*/, bool wasResized)
+    {
+        if (wasResized)
+            setSize (content->getWidth(), content->getHeight());
+    }
+
+private:
+    ScopedPointer<AudioProcessorEditor> content;
+
+    JUCE_DECLARE_NON_COPYABLE (WrapperEditor);
+};
+
+//==============================================================================
+FixedBlockSizeAdapter::FixedBlockSizeAdapter (AudioProcessor* const processorToWrap, const int blockSize)
+    : processor (processorToWrap),
+      fixedBlockSize (jmax (1, blockSize)),
+      position (0),
+      numBlockChannels (0)
+{
+    jassert (processor != nullptr);
+
+    setPlayConfigDetails (processor->getNumInputChannels(), processor->getNumOutputChannels(),
+                          processor->getSampleRate(), processor->getBlockSize());
+
+    setLatencySamples (processor->getLatencySamples() + fixedBlockSize);
+    processor->addListener (this);
+}
+
+FixedBlockSizeAdapter::~FixedBlockSizeAdapter()
+{
+    processor->removeListener (this);
+}
+
+//==============================================================================
+void FixedBlockSizeAdapter::prepareToPlay (const double sampleRate, int)
+{
+    processor->setPlayConfigDetails (getNumInputChannels(), getNumOutputChannels(),
+                                     sampleRate, fixedBlockSize);
+    processor->setPlayHead (getPlayHead());
+    processor->setNonRealtime (isNonRealtime());
+    processor->prepareToPlay (sampleRate, fixedBlockSize);
+
+    allocateBlock (jmax (1, getNumInputChannels(), getNumOutputChannels()));
+    clearBlock();
+
+    setLatencySamples (processor->getLatencySamples() + fixedBlockSize);
+}
+
+void FixedBlockSizeAdapter::releaseResources()
+{
+    processor->releaseResources();
+
+    blockData.free();
+    blockChannels.free();
+    numBlockChannels = 0;
+    blockMidi.clear();
+    pendingOutputMidi.clear();
+    outgoingMidi.clear();
+}
+
+void FixedBlockSizeAdapter::reset()
+{
+    processor->reset();
+    clearBlock();
+}
+
+void FixedBlockSizeAdapter::allocateBlock (const int numChannels)
+{
+    // each channel is padded to a multiple of 4 samples, so that they all start on 16-byte boundaries..
+    const int channelStride = (fixedBlockSize + 3) & ~3;
+
+    blockData.malloc ((size_t) (numChannels * channelStride) * sizeof (float) + 16);
+    blockChannels.malloc ((size_t) numChannels + 1);
+
+    float* const firstChannel = reinterpret_cast <float*> ((reinterpret_cast <pointer_sized_int> (blockData.getData()) + 15) & ~(pointer_sized_int) 15);
+
+    for (int i = 0; i < numChannels; ++i)
+        blockChannels[i] = firstChannel + i * channelStride;
+
+    blockChannels[numChannels] = nullptr;
+    numBlockChannels = numChannels;
+}
+
+void FixedBlockSizeAdapter::clearBlock()
+{
+    for (int i = 0; i < numBlockChannels; ++i)
+        zeromem (blockChannels[i], sizeof (float) * (size_t) fixedBlockSize);
+
+    position = 0;
+    blockMidi.clear();
+    pendingOutputMidi.clear();
+}
+
+//==============================================================================
+void FixedBlockSizeAdapter::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    // prepareToPlay() must be called before processing!
+    jassert (numBlockChannels > 0);
+
+    const int numChans = jmin (buffer.getNumChannels(), numBlockChannels);
+    const int numSamples = buffer.getNumSamples();
+
+    MidiBuffer::Iterator midiIterator (midiMessages);
+    const uint8* midiData;
+    int midiDataSize, midiPosition;
+    bool isMidiEventPending = midiIterator.getNextEvent (midiData, midiDataSize, midiPosition);
+
+    outgoingMidi.clear();
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int numThisTime = jmin (numSamples - done, fixedBlockSize - position);
+
+        // The part of the block that's about to be filled with input still holds the
+        // output from the last block, so the two are just swapped over..
+        for (int i = 0; i < numChans; ++i)
+        {
+            float* const hostData = buffer.getSampleData (i, done);
+            float* const data = blockChannels[i] + position;
+
+            for (int j = 0; j < numThisTime; ++j)
+            {
+                const float input = hostData[j];
+                hostData[j] = data[j];
+                data[j] = input;
+            }
+        }
+
+        // ..and the same happens to the midi events in that part of the block.
+        while (isMidiEventPending && midiPosition < done + numThisTime)
+        {
+            blockMidi.addEvent (midiData, midiDataSize, position + jmax (0, midiPosition - done));
+            isMidiEventPending = midiIterator.getNextEvent (midiData, midiDataSize, midiPosition);
+        }
+
+        if (! pendingOutputMidi.isEmpty())
+            outgoingMidi.addEvents (pendingOutputMidi, position, numThisTime, done - position);
+
+        position += numThisTime;
+        done += numThisTime;
+
+        if (position == fixedBlockSize)
+            processNextBlock();
+    }
+
+    midiMessages.swapWith (outgoingMidi);
+}
+
+void FixedBlockSizeAdapter::processNextBlock()
+{
+    AudioSampleBuffer block (blockChannels, numBlockChannels, fixedBlockSize);
+
+    {
+        const ScopedLock sl (processor->getCallbackLock());
+
+        if (processor->isSuspended())
+        {
+            block.clear();
+            blockMidi.clear();
+        }
+        else
+        {
+            processor->processBlock (block, blockMidi);
+        }
+    }
+
+    pendingOutputMidi.swapWith (blockMidi);
+    blockMidi.clear();
+    position = 0;
+}
+
+//==============================================================================
+void FixedBlockSizeAdapter::fillInPluginDescription (PluginDescription& description) const
+{
+    const AudioPluginInstance* const plugin = dynamic_cast <const AudioPluginInstance*> (processor.get());
+
+    if (plugin != nullptr)
+    {
+        plugin->fillInPluginDescription (description);
+    }
+    else
+    {
+        description.name = getName();
+        description.numInputChannels = getNumInputChannels();
+        description.numOutputChannels = getNumOutputChannels();
+        description.isInstrument = processor->acceptsMidi() && getNumInputChannels() == 0;
+    }
+}
+
+void* FixedBlockSizeAdapter::getPlatformSpecificData()
+{
+    AudioPluginInstance* const plugin = dynamic_cast <AudioPluginInstance*> (processor.get());
+    return plugin != nullptr ? plugin->getPlatformSpecificData() : nullptr;
+}
+
+void FixedBlockSizeAdapter::refreshParameterList()
+{
+    AudioPluginInstance* const plugin = dynamic_cast <AudioPluginInstance*> (processor.get());
+
+    if (plugin != nullptr)
+        plugin->refreshParameterList();
+}
+
+const String FixedBlockSizeAdapter::getName() const                                 { return processor->getName(); }
+const String FixedBlockSizeAdapter::getInputChannelName (int index) const           { return processor->getInputChannelName (index); }
+const String FixedBlockSizeAdapter::getOutputChannelName (int index) const          { return processor->getOutputChannelName (index); }
+bool FixedBlockSizeAdapter::isInputChannelStereoPair (int index) const              { return processor->isInputChannelStereoPair (index); }
+bool FixedBlockSizeAdapter::isOutputChannelStereoPair (int index) const             { return processor->isOutputChannelStereoPair (index); }
+bool FixedBlockSizeAdapter::acceptsMidi() const                                     { return processor->acceptsMidi(); }
+bool FixedBlockSizeAdapter::producesMidi() const                                    { return processor->producesMidi(); }
+bool FixedBlockSizeAdapter::hasEditor() const                                       { return processor->hasEditor(); }
+
+double FixedBlockSizeAdapter::getTailLengthSeconds() const
+{
+    const double tailLength = processor->getTailLengthSeconds();
+
+    // the output carries on for an extra block after the input stops..
+    if (tailLength < 0 || getSampleRate() <= 0)
+        return tailLength;
+
+    return tailLength + fixedBlockSize / getSampleRate();
+}
+
+AudioProcessorEditor* FixedBlockSizeAdapter::createEditor()
+{
+    AudioProcessorEditor* const content = processor->createEditorIfNeeded();
+    return content != nullptr ? new WrapperEditor (*this, content) : nullptr;
+}
+
+//==============================================================================
+int FixedBlockSizeAdapter::getNumParameters()                                       { return processor->getNumParameters(); }
+const String FixedBlockSizeAdapter::getParameterName (int index)                    { return processor->getParameterName (index); }
+float FixedBlockSizeAdapter::getParameter (int index)                               { return processor->getParameter (index); }
+const String FixedBlockSizeAdapter::getParameterText (int index)                    { return processor->getParameterText (index); }
+String FixedBlockSizeAdapter::getParameterLabel (int index) const                   { return processor->getParameterLabel (index); }
+void FixedBlockSizeAdapter::setParameter (int index, float newValue)                { processor->setParameter (index, newValue); }
+bool FixedBlockSizeAdapter::isParameterAutomatable (int index) const                { return processor->isParameterAutomatable (index); }
+bool FixedBlockSizeAdapter::isMetaParameter (int index) const                       { return processor->isMetaParameter (index); }
+
+int FixedBlockSizeAdapter::getNumPrograms()                                         { return processor->getNumPrograms(); }
+int FixedBlockSizeAdapter::getCurrentProgram()                                      { return processor->getCurrentProgram(); }
+void FixedBlockSizeAdapter::setCurrentProgram (int index)                           { processor->setCurrentProgram (index); }
+const String FixedBlockSizeAdapter::getProgramName (int index)                      { return processor->getProgramName (index); }
+void FixedBlockSizeAdapter::changeProgramName (int index, const String& newName)    { processor->changeProgramName (index, newName); }
+
+void FixedBlockSizeAdapter::getStateInformation (juce::MemoryBlock& destData)                   { processor->getStateInformation (destData); }
+void FixedBlockSizeAdapter::getCurrentProgramStateInformation (juce::MemoryBlock& destData)     { processor->getCurrentProgramStateInformation (destData); }
+void FixedBlockSizeAdapter::setStateInformation (const void* data, int sizeInBytes)             { processor->setStateInformation (data, sizeInBytes); }
+void FixedBlockSizeAdapter::setCurrentProgramStateInformation (const void* data, int sizeInBytes) { processor->setCurrentProgramStateInformation (data, sizeInBytes); }
+
+//==============================================================================
+void FixedBlockSizeAdapter::audioProcessorParameterChanged (AudioProcessor*, int parameterIndex, float newValue)
+{
+    sendParamChangeMessageToListeners (parameterIndex, newValue);
+}
+
+void FixedBlockSizeAdapter::audioProcessorChanged (AudioProcessor*)
+{
+    updateHostDisplay();
+}
+
+void FixedBlockSizeAdapter::audioProcessorParameterChangeGestureBegin (AudioProcessor*, int parameterIndex)
+{
+    beginParameterChangeGesture (parameterIndex);
+}
+
+void FixedBlockSizeAdapter::audioProcessorParameterChangeGestureEnd (AudioProcessor*, int parameterIndex)
+{
+    endParameterChangeGesture (parameterIndex);
+}
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class FixedBlockSizeAdapterTests  : public UnitTest
+{
+public:
+    FixedBlockSizeAdapterTests() : UnitTest ("FixedBlockSizeAdapter") {}
+
+    // Delays its audio by a fixed number of samples, passes its midi straight through, and
+    // records the block sizes and midi positions that it's given.
+    class DelayProcessor  : public AudioProcessor
+    {
+    public:
+        DelayProcessor (const int delay_)
+            : delay (delay_), blockPosition (0), hadWrongBlockSize (false)
+        {
+            setPlayConfigDetails (1, 1, 44100.0, 512);
+            setLatencySamples (delay);
+        }
+
+        const String getName() const                                { return "Delay"; }
+        void prepareToPlay (double, int)                            { delayLine.calloc ((size_t) delay + 1); }
+        void releaseResources()                                     {}
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer& midi)
+        {
+            const int numSamples = buffer.getNumSamples();
+
+            if (numSamples != getBlockSize())
+                hadWrongBlockSize = true;
+
+            float* const data = buffer.getSampleData (0);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                delayLine [delay] = data[i];
+                data[i] = delayLine[0];
+                memmove (delayLine, delayLine + 1, sizeof (float) * (size_t) delay);
+            }
+
+            MidiBuffer::Iterator iter (midi);
+            const uint8* midiData;
+            int numBytes, samplePosition;
+
+            while (iter.getNextEvent (midiData, numBytes, samplePosition))
+                midiPositionsSeen.add (blockPosition + samplePosition);
+
+            blockPosition += numSamples;
+        }
+
+        const String getInputChannelName (int) const                { return String::empty; }
+        const String getOutputChannelName (int) const               { return String::empty; }
+        bool isInputChannelStereoPair (int) const                   { return false; }
+        bool isOutputChannelStereoPair (int) const                  { return false; }
+        bool acceptsMidi() const                                    { return true; }
+        bool producesMidi() const                                   { return true; }
+
+        AudioProcessorEditor* createEditor()                        { return nullptr; }
+        bool hasEditor() const                                      { return false; }
+
+        int getNumParameters()                                      { return 0; }
+        const String getParameterName (int)                         { return String::empty; }
+        float getParameter (int)                                    { return 0; }
+        const String getParameterText (int)                         { return String::empty; }
+        void setParameter (int, float)                              {}
+
+        int getNumPrograms()                                        { return 0; }
+        int getCurrentProgram()                                     { return 0; }
+        void setCurrentProgram (int)                                {}
+        const String getProgramName (int)                           { return String::empty; }
+        void changeProgramName (int, const String&)                 {}
+
+        void getStateInformation (juce::MemoryBlock&)               {}
+        void setStateInformation (const void*, int)                 {}
+
+        const int delay;
+        HeapBlock<float> delayLine;
+        int blockPosition;
+        bool hadWrongBlockSize;
+        Array<int> midiPositionsSeen;
+    };
+
+    void runTest()
+    {
+        beginTest ("Irregular host blocks");
+
+        const int fixedBlockSize = 64, innerDelay = 7, totalLength = 3000, midiSpacing = 23;
+        const int hostBlockSizes[] = { 1, 37, 64, 5, 200, 13, 63, 65, 128, 2, 500 };
+
+        DelayProcessor* const inner = new DelayProcessor (innerDelay);
+        FixedBlockSizeAdapter adapter (inner, fixedBlockSize);
+        adapter.setPlayConfigDetails (1, 1, 44100.0, 512);
+        adapter.prepareToPlay (44100.0, 512);
+
+        const int latency = adapter.getLatencySamples();
+        expectEquals (latency, innerDelay + fixedBlockSize);
+
+        // The input is a ramp which starts at 1, so that each sample says where it came from,
+        // and there's a midi event every few samples.
+        Array<int> outputMidiPositions;
+        AudioSampleBuffer output (1, totalLength);
+
+        for (int pos = 0, blockIndex = 0; pos < totalLength; ++blockIndex)
+        {
+            const int numSamples = jmin (totalLength - pos,
+                                         hostBlockSizes [blockIndex % numElementsInArray (hostBlockSizes)]);
+
+            AudioSampleBuffer block (1, numSamples);
+            MidiBuffer midi;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                *block.getSampleData (0, i) = (float) (pos + i + 1);
+
+                if ((pos + i) % midiSpacing == 0)
+                    midi.addEvent (MidiMessage::noteOn (1, 60, 0.5f), i);
+            }
+
+            adapter.processBlock (block, midi);
+            output.copyFrom (0, pos, block, 0, 0, numSamples);
+
+            MidiBuffer::Iterator iter (midi);
+            const uint8* midiData;
+            int numBytes, samplePosition;
+
+            while (iter.getNextEvent (midiData, numBytes, samplePosition))
+            {
+                expect (isPositiveAndBelow (samplePosition, numSamples));
+                outputMidiPositions.add (pos + samplePosition);
+            }
+
+            pos += numSamples;
+        }
+
+        adapter.releaseResources();
+
+        expect (! inner->hadWrongBlockSize, "the wrapped processor was given the wrong block size");
+
+        bool isDelayedCorrectly = true;
+
+        for (int i = 0; i < totalLength; ++i)
+        {
+            const float expected = i < latency ? 0.0f : (float) (i - latency + 1);
+
+            if (*output.getSampleData (0, i) != expected)
+                isDelayedCorrectly = false;
+        }
+
+        expect (isDelayedCorrectly, "the output isn't delayed by the reported latency");
+
+        beginTest ("Midi positions");
+
+        // The wrapped processor sees each event at its original position, counted in its own
+        // blocks, and the events come out of the adapter one block later.
+        const int numBlocksProcessed = totalLength / fixedBlockSize;
+        const int numEventsSeen = (numBlocksProcessed * fixedBlockSize + midiSpacing - 1) / midiSpacing;
+        expectEquals (inner->midiPositionsSeen.size(), numEventsSeen);
+
+        for (int i = 0; i < inner->midiPositionsSeen.size(); ++i)
+            expectEquals (inner->midiPositionsSeen.getUnchecked (i), i * midiSpacing);
+
+        const int numEventsOut = (totalLength - fixedBlockSize + midiSpacing - 1) / midiSpacing;
+        expectEquals (outputMidiPositions.size(), numEventsOut);
+
+        for (int i = 0; i < outputMidiPositions.size(); ++i)
+            expectEquals (outputMidiPositions.getUnchecked (i), i * midiSpacing + fixedBlockSize);
+    }
+};
+
+static FixedBlockSizeAdapterTests fixedBlockSizeAdapterTests;
+
+#endif
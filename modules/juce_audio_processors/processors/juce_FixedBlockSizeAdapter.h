@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_FIXEDBLOCKSIZEADAPTER_JUCEHEADER__
+#define __JUCE_FIXEDBLOCKSIZEADAPTER_JUCEHEADER__
+
+#include "juce_AudioPluginInstance.h"
+#include "juce_AudioProcessorListener.h"
+
+
+//==============================================================================
+/**
+    Wraps another processor so that its processBlock() method is always called with
+    the same number of samples.
+
+    Hosts may call processBlock() with any number of samples, which is awkward for
+    processors that work in fixed-size frames, e.g. FFT-based effects. This wrapper
+    collects its input into blocks of a fixed size, passes each complete block to the
+    processor that it wraps, and plays back the results one block later.
+
+    That means it adds exactly one block of latency, which is added to the wrapped
+    processor's own latency and reported with setLatencySamples(). MIDI events are
+    moved along with the audio, so they reach the wrapped processor at the positions
+    in its blocks that correspond to their original timestamps, and any MIDI that it
+    produces is delayed by the same amount as the audio.
+
+    Each channel of the blocks that are passed to the wrapped processor starts on a
+    16-byte boundary.
+
+    The adapter is itself an AudioPluginInstance which passes the parameters, programs,
+    state and editor of the plugin that it wraps straight through, so it can be put in
+    an AudioProcessorGraph in place of the original plugin, e.g.
+    @code
+    graph.addNode (new FixedBlockSizeAdapter (pluginInstance, 1024));
+    @endcode
+
+    @see AudioProcessorGraph
+*/
+class JUCE_API  FixedBlockSizeAdapter  : public AudioPluginInstance,
+                                         private AudioProcessorListener
+{
+public:
+    //==============================================================================
+    /** Creates an adapter for a processor.
+
+        @param processorToWrap  the processor to call - this will be deleted by the adapter
+        @param blockSize        the number of samples that the wrapped processor will be
+                                given in each call to its processBlock() method
+    */
+    FixedBlockSizeAdapter (AudioProcessor* processorToWrap, int blockSize);
+
+    /** Destructor. */
+    ~FixedBlockSizeAdapter();
+
+    //==============================================================================
+    /** Returns the processor that is being wrapped. */
+    AudioProcessor* getWrappedProcessor() const noexcept            { return processor; }
+
+    /** Returns the block size that the wrapped processor is given. */
+    int getFixedBlockSize() const noexcept                          { return fixedBlockSize; }
+
+    //==============================================================================
+    /** @internal */
+    void fillInPluginDescription (PluginDescription& description) const;
+    /** @internal */
+    void* getPlatformSpecificData();
+    /** @internal */
+    void refreshParameterList();
+    /** @internal */
+    const String getName() const;
+    /** @internal */
+    void prepareToPlay (double sampleRate, int estimatedSamplesPerBlock);
+    /** @internal */
+    void releaseResources();
+    /** @internal */
+    void processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+    /** @internal */
+    void reset();
+    /** @internal */
+    const String getInputChannelName (int channelIndex) const;
+    /** @internal */
+    const String getOutputChannelName (int channelIndex) const;
+    /** @internal */
+    bool isInputChannelStereoPair (int index) const;
+    /** @internal */
+    bool isOutputChannelStereoPair (int index) const;
+    /** @internal */
+    double getTailLengthSeconds() const;
+    /** @internal */
+    bool acceptsMidi() const;
+    /** @internal */
+    bool producesMidi() const;
+    /** @internal */
+    AudioProcessorEditor* createEditor();
+    /** @internal */
+    bool hasEditor() const;
+    /** @internal */
+    int getNumParameters();
+    /** @internal */
+    const String getParameterName (int parameterIndex);
+    /** @internal */
+    float getParameter (int parameterIndex);
+    /** @internal */
+    const String getParameterText (int parameterIndex);
+    /** @internal */
+    String getParameterLabel (int parameterIndex) const;
+    /** @internal */
+    void setParameter (int parameterIndex, float newValue);
+    /** @internal */
+    bool isParameterAutomatable (int parameterIndex) const;
+    /** @internal */
+    bool isMetaParameter (int parameterIndex) const;
+    /** @internal */
+    int getNumPrograms();
+    /** @internal */
+    int getCurrentProgram();
+    /** @internal */
+    void setCurrentProgram (int index);
+    /** @internal */
+    const String getProgramName (int index);
+    /** @internal */
+    void changeProgramName (int index, const String& newName);
+    /** @internal */
+    void getStateInformation (juce::MemoryBlock& destData);
+    /** @internal */
+    void getCurrentProgramStateInformation (juce::MemoryBlock& destData);
+    /** @internal */
+    void setStateInformation (const void* data, int sizeInBytes);
+    /** @internal */
+    void setCurrentProgramStateInformation (const void* data, int sizeInBytes);
+
+private:
+    //==============================================================================
+    class WrapperEditor;
+    friend class WrapperEditor;
+
+    ScopedPointer<AudioProcessor> processor;
+    const int fixedBlockSize;
+    int position;
+    HeapBlock<char> blockData;
+    HeapBlock<float*> blockChannels;
+    int numBlockChannels;
+    MidiBuffer blockMidi, pendingOutputMidi, outgoingMidi;
+
+    void allocateBlock (int numChannels);
+    void clearBlock();
+    void processNextBlock();
+
+    void audioProcessorParameterChanged (AudioProcessor*, int parameterIndex, float newValue);
+    void audioProcessorChanged (AudioProcessor*);
+    void audioProcessorParameterChangeGestureBegin (AudioProcessor*, int parameterIndex);
+    void audioProcessorParameterChangeGestureEnd (AudioProcessor*, int parameterIndex);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FixedBlockSizeAdapter);
+};
+
+
+#endif   // __JUCE_FIXEDBLOCKSIZEADAPTER_JUCEHEADER__
@@ -0,0 +1,424 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+ParameterChangeQueue::ParameterChangeQueue (const int capacity)
+    : mask ((uint32) nextPowerOfTwo (jmax (2, capacity)) - 1),
+      readPosition (0),
+      numWaiting (0),
+      numBlockChanges (0),
+      blockStartPosition (0),
+      blockStartTicks (0),
+      nextBlockPosition (0),
+      samplesPerTick (0),
+      maximumBlockSize (0)
+{
+    const size_t numSlots = (size_t) mask + 1;
+
+    slots.calloc (numSlots);
+    waitingChanges.calloc (numSlots);
+    blockChanges.calloc (numSlots);
+
+    // Each slot's sequence number says whose turn it is to use it: when it equals the
+    // write position, a writer can claim it, and when it's one more than the read
+    // position, the reader can take the change that's in it.
+    for (uint32 i = 0; i <= mask; ++i)
+        slots[i].sequence = i;
+}
+
+ParameterChangeQueue::~ParameterChangeQueue()
+{
+}
+
+void ParameterChangeQueue::prepare (const double sampleRate, const int maximumBlockSize_)
+{
+    WaitingChange unused;
+    while (readNextChange (unused))
+    {}
+
+    numWaiting = 0;
+    numBlockChanges = 0;
+
+    ++timingSequence;
+    blockStartPosition = 0;
+    blockStartTicks = Time::getHighResolutionTicks();
+    nextBlockPosition = 0;
+    samplesPerTick = sampleRate / (double) Time::getHighResolutionTicksPerSecond();
+    maximumBlockSize = jmax (0, maximumBlockSize_);
+    ++timingSequence;
+}
+
+//==============================================================================
+bool ParameterChangeQueue::addChange (const int parameterIndex, const float newValue) noexcept
+{
+    const int64 now = Time::getHighResolutionTicks();
+    int64 startPosition, startTicks;
+
+    // (the audio thread changes these at the start of each block, so if it's in the middle
+    // of doing that, we'll need to read them again)
+    for (;;)
+    {
+        const int sequence = timingSequence.get();
+
+        if ((sequence & 1) == 0)
+        {
+            startPosition = blockStartPosition;
+            startTicks = blockStartTicks;
+
+            if (timingSequence.get() == sequence)
+                break;
+        }
+    }
+
+    // A change that arrives while a block is playing is put into the next block, at the
+    // same distance from its start, so that the changes are spaced out as they were made.
+    const int samplesSinceBlockStart = (int) jlimit ((int64) 0, (int64) maximumBlockSize,
+                                                     (int64) ((now - startTicks) * samplesPerTick));
+
+    return addChangeAtSample (parameterIndex, newValue,
+                              startPosition + maximumBlockSize + samplesSinceBlockStart);
+}
+
+bool ParameterChangeQueue::addChangeAtSample (const int parameterIndex, const float newValue,
+                                              const int64 samplePosition) noexcept
+{
+    Slot* slot;
+
+    for (;;)
+    {
+        const uint32 position = writePosition.get();
+        slot = slots + (position & mask);
+
+        const int diff = (int) (slot->sequence.get() - position);
+
+        if (diff == 0)
+        {
+            if (writePosition.compareAndSetBool (position + 1, position))
+            {
+                slot->parameterIndex = parameterIndex;
+                slot->newValue = newValue;
+                slot->samplePosition = samplePosition;
+                slot->sequence = position + 1;
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the queue is full, so this change has to be lost..
+            ++numDroppedChanges;
+            return false;
+        }
+
+        // otherwise, another thread got to this slot first, so try the next one..
+    }
+}
+
+int64 ParameterChangeQueue::getNextBlockPosition() const noexcept
+{
+    for (;;)
+    {
+        const int sequence = timingSequence.get();
+
+        if ((sequence & 1) == 0)
+        {
+            const int64 position = nextBlockPosition;
+
+            if (timingSequence.get() == sequence)
+                return position;
+        }
+    }
+}
+
+//==============================================================================
+bool ParameterChangeQueue::readNextChange (WaitingChange& change) noexcept
+{
+    Slot& slot = slots [readPosition & mask];
+
+    if ((int) (slot.sequence.get() - (readPosition + 1)) < 0)
+        return false;
+
+    change.samplePosition = slot.samplePosition;
+    change.parameterIndex = slot.parameterIndex;
+    change.newValue = slot.newValue;
+
+    slot.sequence = readPosition + mask + 1;
+    ++readPosition;
+    return true;
+}
+
+void ParameterChangeQueue::addWaitingChange (const WaitingChange& change) noexcept
+{
+    // (changes nearly always arrive in order, so this hardly ever has to move anything)
+    int index = numWaiting;
+
+    while (index > 0 && waitingChanges [index - 1].samplePosition > change.samplePosition)
+    {
+        waitingChanges [index] = waitingChanges [index - 1];
+        --index;
+    }
+
+    waitingChanges [index] = change;
+    ++numWaiting;
+}
+
+void ParameterChangeQueue::startBlock (const int numSamples) noexcept
+{
+    ++timingSequence;
+    const int64 startPosition = nextBlockPosition;
+    blockStartPosition = startPosition;
+    blockStartTicks = Time::getHighResolutionTicks();
+    nextBlockPosition += numSamples;
+    ++timingSequence;
+
+    WaitingChange change;
+
+    while (numWaiting <= (int) mask && readNextChange (change))
+        addWaitingChange (change);
+
+    const int64 endPosition = startPosition + numSamples;
+    numBlockChanges = 0;
+
+    while (numBlockChanges < numWaiting
+            && waitingChanges [numBlockChanges].samplePosition < endPosition)
+    {
+        const WaitingChange& w = waitingChanges [numBlockChanges];
+        Change& c = blockChanges [numBlockChanges++];
+
+        c.parameterIndex = w.parameterIndex;
+        c.newValue = w.newValue;
+        c.sampleOffset = (int) jmax ((int64) 0, w.samplePosition - startPosition);
+    }
+
+    numWaiting -= numBlockChanges;
+    memmove (waitingChanges, waitingChanges + numBlockChanges, (size_t) numWaiting * sizeof (WaitingChange));
+}
+
+const ParameterChangeQueue::Change& ParameterChangeQueue::getChange (const int index) const noexcept
+{
+    jassert (isPositiveAndBelow (index, numBlockChanges));
+    return blockChanges [index];
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ParameterChangeQueueTests  : public UnitTest
+{
+public:
+    ParameterChangeQueueTests() : UnitTest ("ParameterChangeQueue") {}
+
+    enum { numWriters = 4, numChangesPerWriter = 20000 };
+
+    // Adds a sequence of changes for its own parameter, retrying whenever the queue is full.
+    // These run at normal priority, like the UI threads that would be making changes.
+    class WriterThread  : public Thread
+    {
+    public:
+        WriterThread (ParameterChangeQueue& queue_, const int parameterIndex_)
+            : Thread ("queue writer"), queue (queue_), parameterIndex (parameterIndex_)
+        {
+        }
+
+        ~WriterThread()
+        {
+            stopThread (5000);
+        }
+
+        void run()
+        {
+            for (int i = 0; i < numChangesPerWriter && ! threadShouldExit();)
+            {
+                if (queue.addChangeAtSample (parameterIndex, (float) i, queue.getNextBlockPosition()))
+                    ++i;
+                else
+                    Thread::yield();
+            }
+        }
+
+    private:
+        ParameterChangeQueue& queue;
+        const int parameterIndex;
+    };
+
+    void runTest()
+    {
+        beginTest ("Ordering");
+
+        {
+            ParameterChangeQueue queue (16);
+            queue.prepare (44100.0, 512);
+
+            queue.addChangeAtSample (0, 0.0f, 300);
+            queue.addChangeAtSample (1, 0.1f, 100);
+            queue.addChangeAtSample (2, 0.2f, 100);
+            queue.addChangeAtSample (3, 0.3f, 600);
+            queue.addChangeAtSample (4, 0.4f, 100);
+
+            queue.startBlock (512);
+            expectEquals (queue.getNumChanges(), 4);
+
+            // (changes on the same sample must stay in the order in which they were added)
+            const int expectedIndexes[] = { 1, 2, 4, 0 };
+            const int expectedOffsets[] = { 100, 100, 100, 300 };
+
+            for (int i = 0; i < queue.getNumChanges(); ++i)
+            {
+                expectEquals (queue.getChange (i).parameterIndex, expectedIndexes[i]);
+                expectEquals (queue.getChange (i).sampleOffset, expectedOffsets[i]);
+            }
+
+            queue.startBlock (512);
+            expectEquals (queue.getNumChanges(), 1);
+            expectEquals (queue.getChange (0).parameterIndex, 3);
+            expectEquals (queue.getChange (0).sampleOffset, 88);
+
+            queue.startBlock (512);
+            expectEquals (queue.getNumChanges(), 0);
+        }
+
+        beginTest ("Positions that have already been played");
+
+        {
+            ParameterChangeQueue queue (16);
+            queue.prepare (44100.0, 512);
+            queue.startBlock (512);
+            queue.startBlock (512);
+
+            expect (queue.getNextBlockPosition() == 1024);
+
+            queue.addChangeAtSample (0, 0.5f, 10);
+            queue.addChangeAtSample (1, 0.5f, 1030);
+            queue.addChangeAtSample (2, 0.5f, 1023);
+
+            queue.startBlock (512);
+            expectEquals (queue.getNumChanges(), 3);
+            expectEquals (queue.getChange (0).parameterIndex, 0);
+            expectEquals (queue.getChange (0).sampleOffset, 0);
+            expectEquals (queue.getChange (1).parameterIndex, 2);
+            expectEquals (queue.getChange (1).sampleOffset, 0);
+            expectEquals (queue.getChange (2).parameterIndex, 1);
+            expectEquals (queue.getChange (2).sampleOffset, 6);
+        }
+
+        beginTest ("Changes added now");
+
+        {
+            ParameterChangeQueue queue (16);
+            queue.prepare (44100.0, 512);
+            queue.addChange (7, 0.25f);
+
+            int numFound = 0;
+
+            for (int block = 0; block < 3; ++block)
+            {
+                queue.startBlock (512);
+
+                for (int i = 0; i < queue.getNumChanges(); ++i)
+                {
+                    expectEquals (queue.getChange (i).parameterIndex, 7);
+                    expect (isPositiveAndBelow (queue.getChange (i).sampleOffset, 512));
+                    ++numFound;
+                }
+            }
+
+            expectEquals (numFound, 1);
+        }
+
+        beginTest ("Full queue");
+
+        {
+            ParameterChangeQueue queue (4);
+            queue.prepare (44100.0, 512);
+
+            for (int i = 0; i < 4; ++i)
+                expect (queue.addChangeAtSample (i, 0.0f, 0));
+
+            expect (! queue.addChangeAtSample (4, 0.0f, 0));
+            expect (! queue.addChange (5, 0.0f));
+            expectEquals (queue.getNumDroppedChanges(), 2);
+
+            queue.startBlock (512);
+            expectEquals (queue.getNumChanges(), 4);
+
+            for (int i = 0; i < queue.getNumChanges(); ++i)
+                expectEquals (queue.getChange (i).parameterIndex, i);
+
+            // once it's been read, there's room again..
+            expect (queue.addChangeAtSample (6, 0.0f, 0));
+            queue.startBlock (512);
+            expectEquals (queue.getNumChanges(), 1);
+            expectEquals (queue.getNumDroppedChanges(), 2);
+        }
+
+        beginTest ("Multiple writers");
+
+        {
+            ParameterChangeQueue queue (64);
+            queue.prepare (44100.0, 64);
+
+            OwnedArray<WriterThread> writers;
+
+            for (int i = 0; i < numWriters; ++i)
+                writers.add (new WriterThread (queue, i));
+
+            for (int i = 0; i < numWriters; ++i)
+                writers.getUnchecked (i)->startThread (0);
+
+            int nextValues [numWriters] = { 0 };
+            int numReceived = 0;
+            bool inOrder = true;
+            const uint32 startTime = Time::getMillisecondCounter();
+
+            while (numReceived < numWriters * numChangesPerWriter
+                    && Time::getMillisecondCounter() < startTime + 30000)
+            {
+                queue.startBlock (64);
+
+                for (int i = 0; i < queue.getNumChanges(); ++i)
+                {
+                    const ParameterChangeQueue::Change& c = queue.getChange (i);
+
+                    if (isPositiveAndBelow (c.parameterIndex, (int) numWriters))
+                        inOrder = inOrder && (c.newValue == (float) nextValues [c.parameterIndex]++);
+                    else
+                        inOrder = false;
+
+                    ++numReceived;
+                }
+
+                if (queue.getNumChanges() == 0)
+                    Thread::yield();
+            }
+
+            writers.clear();
+
+            expectEquals (numReceived, (int) (numWriters * numChangesPerWriter));
+            expect (inOrder, "each writer's changes should arrive in the order in which they were added");
+        }
+    }
+};
+
+static ParameterChangeQueueTests parameterChangeQueueUnitTests;
+
+#endif
@@ -0,0 +1,189 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_PARAMETERCHANGEQUEUE_JUCEHEADER__
+#define __JUCE_PARAMETERCHANGEQUEUE_JUCEHEADER__
+
+
+//==============================================================================
+/**
+    A lock-free queue of parameter changes, which lets a processor apply each change
+    at the sample at which it was meant to happen.
+
+    Any number of threads can add changes at the same time, without blocking each other
+    or the audio thread. At the start of each processBlock(), the audio thread calls
+    startBlock(), and can then read back the changes that fall inside that block, in
+    order, along with their offsets from the start of the block.
+
+    A change can either be given an exact position on the queue's sample timeline (e.g. by
+    a host that's playing back automation), or it can just be added "now" (e.g. from a
+    slider), in which case the queue works out where it belongs from the time at which it
+    arrived. Changes that are made during one block then keep their spacing when they're
+    applied in the next one, rather than all landing on its first sample.
+
+    E.g.
+    @code
+    void MyProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+    {
+        ParameterChangeQueue& changes = *getParameterChangeQueue();
+        changes.startBlock (buffer.getNumSamples());
+
+        int pos = 0;
+
+        for (int i = 0; i < changes.getNumChanges(); ++i)
+        {
+            const ParameterChangeQueue::Change& change = changes.getChange (i);
+
+            renderSection (buffer, pos, change.sampleOffset - pos);
+            pos = change.sampleOffset;
+
+            applyParameter (change.parameterIndex, change.newValue);
+        }
+
+        renderSection (buffer, pos, buffer.getNumSamples() - pos);
+    }
+    @endcode
+
+    @see AudioProcessor::enableParameterChangeQueue
+*/
+class JUCE_API  ParameterChangeQueue
+{
+public:
+    //==============================================================================
+    /** Creates a queue that can hold up to the given number of changes that are waiting
+        to be played. The capacity will be rounded up to a power of two.
+    */
+    explicit ParameterChangeQueue (int capacity = 1024);
+
+    /** Destructor. */
+    ~ParameterChangeQueue();
+
+    //==============================================================================
+    /** Tells the queue the rate at which it'll be played, and the largest block size.
+
+        This is needed to position the changes that are added with addChange(). It also
+        discards any waiting changes and moves the timeline back to zero, so it mustn't be
+        called while the queue is being played.
+    */
+    void prepare (double sampleRate, int maximumBlockSize);
+
+    //==============================================================================
+    /** Adds a change that will be applied as soon as possible, on the sample that
+        corresponds to the time at which it was added.
+
+        This can be called from any thread, and doesn't block.
+
+        @returns false if the queue was full, in which case the change is discarded
+    */
+    bool addChange (int parameterIndex, float newValue) noexcept;
+
+    /** Adds a change that must be applied at a particular position on the queue's timeline.
+
+        The timeline counts the samples that have been played since prepare() was called,
+        so a host that's about to render a block will usually use getNextBlockPosition()
+        plus the offset of the change within that block. If the position has already been
+        played, the change will be applied at the start of the next block.
+
+        This can be called from any thread, and doesn't block.
+
+        @returns false if the queue was full, in which case the change is discarded
+    */
+    bool addChangeAtSample (int parameterIndex, float newValue, int64 samplePosition) noexcept;
+
+    /** Returns the position on the timeline at which the next block will start. */
+    int64 getNextBlockPosition() const noexcept;
+
+    /** Returns the number of changes that have been discarded because the queue was full.
+
+        A change that doesn't fit is lost rather than being applied out of order, so if this
+        is ever more than zero, the queue's capacity needs to be increased.
+    */
+    int getNumDroppedChanges() const noexcept               { return numDroppedChanges.get(); }
+
+    //==============================================================================
+    /** Describes a change that is to be applied during the current block. */
+    struct Change
+    {
+        int parameterIndex;     /**< The index of the parameter that's changing. */
+        float newValue;         /**< The parameter's new value. */
+        int sampleOffset;       /**< The offset from the start of the block at which to apply it. */
+    };
+
+    /** Collects the changes that fall inside the next block, and moves the timeline on.
+
+        This must be called by the audio thread at the start of each block. It doesn't
+        lock or allocate any memory.
+    */
+    void startBlock (int numSamples) noexcept;
+
+    /** Returns the number of changes that are to be applied during the current block. */
+    int getNumChanges() const noexcept                      { return numBlockChanges; }
+
+    /** Returns one of the changes for the current block.
+        These are sorted in order of their sample offsets, and changes that are due on the
+        same sample are kept in the order in which they were added.
+    */
+    const Change& getChange (int index) const noexcept;
+
+private:
+    //==============================================================================
+    struct Slot
+    {
+        Atomic<uint32> sequence;
+        int parameterIndex;
+        float newValue;
+        int64 samplePosition;
+    };
+
+    struct WaitingChange
+    {
+        int64 samplePosition;
+        int parameterIndex;
+        float newValue;
+    };
+
+    HeapBlock<Slot> slots;
+    const uint32 mask;
+    Atomic<uint32> writePosition;
+    uint32 readPosition;
+    Atomic<int> numDroppedChanges;
+
+    HeapBlock<WaitingChange> waitingChanges;
+    HeapBlock<Change> blockChanges;
+    int numWaiting, numBlockChanges;
+
+    Atomic<int> timingSequence;
+    int64 blockStartPosition, blockStartTicks, nextBlockPosition;
+    double samplesPerTick;
+    int maximumBlockSize;
+
+    bool readNextChange (WaitingChange&) noexcept;
+    void addWaitingChange (const WaitingChange&) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterChangeQueue);
+};
+
+
+#endif   // __JUCE_PARAMETERCHANGEQUEUE_JUCEHEADER__
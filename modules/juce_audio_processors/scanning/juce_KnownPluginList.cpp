@@ -28,6 +28,8 @@ KnownPluginList::~KnownPluginList() {}
 
 void KnownPluginList::clear()
 {
+    fileFingerprints.clear();
+
     if (types.size() > 0)
     {
         types.clear();
@@ -69,13 +71,34 @@ bool KnownPluginList::addType (const PluginDescription& type)
     }
 
     types.add (new PluginDescription (type));
+
+    if (type.lastFileModTime != Time() && ! fileFingerprints.contains (type.fileOrIdentifier))
+    {
+        // We can only trust the file's current size if it hasn't been modified since the type was created
+        const FileFingerprint current (FileFingerprint::forFile (type.fileOrIdentifier));
+
+        if (current.isValid())
+            fileFingerprints.set (type.fileOrIdentifier,
+                                  FileFingerprint (type.lastFileModTime,
+                                                   current.modificationTime == type.lastFileModTime ? current.size : -1));
+    }
+
     sendChangeMessage();
     return true;
 }
 
 void KnownPluginList::removeType (const int index)
 {
-    types.remove (index);
+    if (isPositiveAndBelow (index, types.size()))
+    {
+        const String file (types.getUnchecked (index)->fileOrIdentifier);
+        types.remove (index);
+
+        // a file can contain several types, so its fingerprint is still needed until the last one goes
+        if (getTypeForFile (file) == nullptr)
+            fileFingerprints.remove (file);
+    }
+
     sendChangeMessage();
 }
 
@@ -97,8 +120,45 @@ namespace
     enum { menuIdBase = 0x324503f4 };
 }
 
+//==============================================================================
+KnownPluginList::FileFingerprint::FileFingerprint() noexcept
+    : size (-1)
+{
+}
+
+KnownPluginList::FileFingerprint::FileFingerprint (const Time& modificationTime_, const int64 size_) noexcept
+    : modificationTime (modificationTime_), size (size_)
+{
+}
+
+KnownPluginList::FileFingerprint KnownPluginList::FileFingerprint::forFile (const String& fileOrIdentifier)
+{
+    const Time modTime (getPluginFileModTime (fileOrIdentifier));
+
+    if (modTime == Time())
+        return FileFingerprint();
+
+    return FileFingerprint (modTime, File (fileOrIdentifier).getSize());
+}
+
+bool KnownPluginList::FileFingerprint::isValid() const noexcept
+{
+    return modificationTime != Time();
+}
+
+bool KnownPluginList::FileFingerprint::matches (const FileFingerprint& currentState) const noexcept
+{
+    return isValid()
+            && modificationTime == currentState.modificationTime
+            && (size < 0 || size == currentState.size);
+}
+
+//==============================================================================
 bool KnownPluginList::isListingUpToDate (const String& fileOrIdentifier) const
 {
+    if (fileFingerprints.contains (fileOrIdentifier))
+        return fileFingerprints [fileOrIdentifier].matches (FileFingerprint::forFile (fileOrIdentifier));
+
     if (getTypeForFile (fileOrIdentifier) == 0)
         return false;
 
@@ -145,6 +205,9 @@ bool KnownPluginList::scanAndAddFile (const String& fileOrIdentifier,
             return false;
     }
 
+    // (take the fingerprint before loading the file, in case it gets changed while we're doing so)
+    const FileFingerprint fingerprint (FileFingerprint::forFile (fileOrIdentifier));
+
     OwnedArray <PluginDescription> found;
     format.findAllTypesForFile (found, fileOrIdentifier);
 
@@ -160,6 +223,9 @@ bool KnownPluginList::scanAndAddFile (const String& fileOrIdentifier,
         }
     }
 
+    if (found.size() > 0 && fingerprint.isValid())
+        fileFingerprints.set (fileOrIdentifier, fingerprint);
+
     return addedOne;
 }
 
@@ -267,6 +333,209 @@ void KnownPluginList::recreateFromXml (const XmlElement& xml)
     }
 }
 
+//==============================================================================
+namespace KnownPluginListStreamHelpers
+{
+    const int magicNumber = (int) ByteOrder::littleEndianInt ("KPL1");
+
+    void writeString (OutputStream& out, const String& s)
+    {
+        const int numBytes = s.getNumBytesAsUTF8();
+
+        out.writeInt (numBytes);
+        out.write (s.toUTF8().getAddress(), (size_t) numBytes);
+    }
+
+    // Reads directly from a block of memory, as this needs to be as quick as possible
+    struct Reader
+    {
+        Reader (const MemoryBlock& block) noexcept
+            : data (static_cast <const char*> (block.getData())),
+              numBytes (block.getSize()), position (0), failed (false)
+        {
+        }
+
+        const char* getBytes (const size_t num) noexcept
+        {
+            if (failed || position + num > numBytes)
+            {
+                failed = true;
+                return nullptr;
+            }
+
+            const char* const d = data + position;
+            position += num;
+            return d;
+        }
+
+        int readInt() noexcept
+        {
+            const char* const d = getBytes (4);
+            return d != nullptr ? (int) ByteOrder::littleEndianInt (d) : 0;
+        }
+
+        int64 readInt64() noexcept
+        {
+            const char* const d = getBytes (8);
+
+            if (d == nullptr)
+                return 0;
+
+            uint64 v;
+            memcpy (&v, d, 8);
+            return (int64) ByteOrder::swapIfBigEndian (v);
+        }
+
+        int readCount() noexcept
+        {
+            const int n = readInt();
+
+            if (n < 0 || (size_t) n > numBytes - position)
+            {
+                failed = true;
+                return 0;
+            }
+
+            return n;
+        }
+
+        String readString()
+        {
+            const int len = readCount();
+            const char* const d = getBytes ((size_t) len);
+            return d != nullptr ? String::fromUTF8 (d, len) : String::empty;
+        }
+
+        const char* const data;
+        const size_t numBytes;
+        size_t position;
+        bool failed;
+    };
+}
+
+void KnownPluginList::writeToStream (OutputStream& out) const
+{
+    using namespace KnownPluginListStreamHelpers;
+
+    // Each file is written once, along with its fingerprint, and the types then refer to it by index
+    StringArray files;
+    HashMap <String, int> fileIndexes (jmax (101, types.size()));
+
+    for (int i = 0; i < types.size(); ++i)
+    {
+        const String& file = types.getUnchecked(i)->fileOrIdentifier;
+
+        if (! fileIndexes.contains (file))
+        {
+            fileIndexes.set (file, files.size());
+            files.add (file);
+        }
+    }
+
+    out.writeInt (magicNumber);
+    out.writeInt (files.size());
+
+    for (int i = 0; i < files.size(); ++i)
+    {
+        FileFingerprint fingerprint (fileFingerprints [files[i]]);
+
+        if (! fingerprint.isValid())
+            fingerprint = FileFingerprint (getTypeForFile (files[i])->lastFileModTime, -1);
+
+        writeString (out, files[i]);
+        out.writeInt64 (fingerprint.modificationTime.toMilliseconds());
+        out.writeInt64 (fingerprint.size);
+    }
+
+    out.writeInt (types.size());
+
+    for (int i = 0; i < types.size(); ++i)
+    {
+        const PluginDescription& d = *types.getUnchecked(i);
+
+        out.writeInt (fileIndexes [d.fileOrIdentifier]);
+        writeString (out, d.name);
+        writeString (out, d.descriptiveName);
+        writeString (out, d.pluginFormatName);
+        writeString (out, d.category);
+        writeString (out, d.manufacturerName);
+        writeString (out, d.version);
+        out.writeInt64 (d.lastFileModTime.toMilliseconds());
+        out.writeInt (d.uid);
+        out.writeInt (d.isInstrument ? 1 : 0);
+        out.writeInt (d.numInputChannels);
+        out.writeInt (d.numOutputChannels);
+    }
+}
+
+bool KnownPluginList::readFromStream (InputStream& input)
+{
+    using namespace KnownPluginListStreamHelpers;
+
+    clear();
+
+    MemoryBlock block;
+    input.readIntoMemoryBlock (block);
+    Reader reader (block);
+
+    if (reader.readInt() != magicNumber)
+        return false;
+
+    const int numFiles = reader.readCount();
+    StringArray files;
+    Array <FileFingerprint> fingerprints;
+    fingerprints.ensureStorageAllocated (numFiles);
+
+    for (int i = 0; i < numFiles && ! reader.failed; ++i)
+    {
+        files.add (reader.readString());
+        const Time modTime (reader.readInt64());
+        fingerprints.add (FileFingerprint (modTime, reader.readInt64()));
+    }
+
+    const int numTypes = reader.readCount();
+    types.ensureStorageAllocated (numTypes);
+
+    for (int i = 0; i < numTypes && ! reader.failed; ++i)
+    {
+        const int fileIndex = reader.readInt();
+
+        if (! isPositiveAndBelow (fileIndex, files.size()))
+            break;
+
+        PluginDescription* const d = new PluginDescription();
+        types.add (d);
+
+        d->fileOrIdentifier     = files [fileIndex];
+        d->name                 = reader.readString();
+        d->descriptiveName      = reader.readString();
+        d->pluginFormatName     = reader.readString();
+        d->category             = reader.readString();
+        d->manufacturerName     = reader.readString();
+        d->version              = reader.readString();
+        d->lastFileModTime      = Time (reader.readInt64());
+        d->uid                  = reader.readInt();
+        d->isInstrument         = reader.readInt() != 0;
+        d->numInputChannels     = reader.readInt();
+        d->numOutputChannels    = reader.readInt();
+    }
+
+    if (reader.failed || types.size() != numTypes)
+    {
+        types.clear();
+        return false;
+    }
+
+    fileFingerprints.remapTable (jmax (101, files.size()));
+
+    for (int i = 0; i < files.size(); ++i)
+        if (fingerprints.getReference(i).isValid())
+            fileFingerprints.set (files[i], fingerprints.getReference(i));
+
+    sendChangeMessage();
+    return true;
+}
+
 //==============================================================================
 struct PluginTreeUtils
 {
@@ -441,3 +710,148 @@ int KnownPluginList::getIndexChosenByMenu (const int menuResultCode) const
     const int i = menuResultCode - menuIdBase;
     return isPositiveAndBelow (i, types.size()) ? i : -1;
 }
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class KnownPluginListTests  : public UnitTest
+{
+public:
+    KnownPluginListTests() : UnitTest ("KnownPluginList") {}
+
+    static PluginDescription createType (const File& file, const String& name, const int uid)
+    {
+        PluginDescription d;
+        d.name = name;
+        d.descriptiveName = name + " - a test plugin";
+        d.pluginFormatName = "VST";
+        d.category = "Effect";
+        d.manufacturerName = String::fromUTF8 ("Test M\xc3\xa4nufacturer");
+        d.version = "1.0";
+        d.fileOrIdentifier = file.getFullPathName();
+        d.lastFileModTime = file.getLastModificationTime();
+        d.uid = uid;
+        d.isInstrument = (uid & 1) != 0;
+        d.numInputChannels = 2;
+        d.numOutputChannels = uid % 8;
+        return d;
+    }
+
+    static MemoryBlock writeToBlock (const KnownPluginList& list)
+    {
+        MemoryBlock block;
+
+        {
+            MemoryOutputStream out (block, false);
+            list.writeToStream (out);
+        }
+
+        return block;
+    }
+
+    bool listsAreEqual (const KnownPluginList& list1, const KnownPluginList& list2)
+    {
+        const ScopedPointer<XmlElement> xml1 (list1.createXml());
+        const ScopedPointer<XmlElement> xml2 (list2.createXml());
+        return xml1->isEquivalentTo (xml2, false);
+    }
+
+    // Makes the file bigger without changing its modification time, so that only the
+    // size in the fingerprint can tell that it's been changed
+    static void changeFileSize (const File& file)
+    {
+        const Time modTime (file.getLastModificationTime());
+        file.appendText ("some more data");
+        file.setLastModificationTime (modTime);
+    }
+
+    void runTest()
+    {
+        const File file1 (File::createTempFile ("plugin1"));
+        const File file2 (File::createTempFile ("plugin2"));
+        file1.replaceWithText ("plugin one");
+        file2.replaceWithText ("plugin two");
+
+        KnownPluginList list;
+        list.addType (createType (file1, "First", 1));
+        list.addType (createType (file1, "Second", 2));
+        list.addType (createType (file2, "Third", 3));
+
+        PluginDescription shellType (createType (file2, "Not a file", 4));
+        shellType.fileOrIdentifier = "AudioUnit:Effects/aufx,test,Test";
+        shellType.lastFileModTime = Time();
+        list.addType (shellType);
+
+        const MemoryBlock data (writeToBlock (list));
+
+        beginTest ("Stream round trip");
+        {
+            KnownPluginList reloaded;
+            MemoryInputStream in (data, false);
+
+            expect (reloaded.readFromStream (in));
+            expectEquals (reloaded.getNumTypes(), 4);
+            expect (listsAreEqual (list, reloaded));
+            expect (reloaded.isListingUpToDate (file1.getFullPathName()));
+            expect (reloaded.isListingUpToDate (file2.getFullPathName()));
+
+            // writing the reloaded list should produce exactly the same data again
+            expect (writeToBlock (reloaded) == data);
+        }
+
+        beginTest ("Truncated and corrupted streams");
+        {
+            bool allFailed = true;
+
+            for (size_t size = 0; size < data.getSize(); ++size)
+            {
+                KnownPluginList reloaded;
+                MemoryInputStream in (data.getData(), size, false);
+
+                if (reloaded.readFromStream (in) || reloaded.getNumTypes() != 0)
+                    allFailed = false;
+            }
+
+            expect (allFailed, "a truncated stream was read without failing");
+
+            MemoryBlock corrupted (data);
+            corrupted[4] = (char) 0xff; // make the file count huge
+            corrupted[7] = (char) 0x7f;
+
+            KnownPluginList reloaded;
+            MemoryInputStream in (corrupted, false);
+            expect (! reloaded.readFromStream (in));
+            expectEquals (reloaded.getNumTypes(), 0);
+        }
+
+        beginTest ("Removing types");
+        {
+            KnownPluginList reloaded;
+            MemoryInputStream in (data, false);
+            expect (reloaded.readFromStream (in));
+
+            changeFileSize (file1);
+            expect (! reloaded.isListingUpToDate (file1.getFullPathName()));
+
+            // the file still contains the other type, so the change must still be noticed
+            reloaded.removeType (0);
+            expect (reloaded.getTypeForFile (file1.getFullPathName()) != nullptr);
+            expect (! reloaded.isListingUpToDate (file1.getFullPathName()));
+
+            reloaded.removeType (0);
+            expect (reloaded.getTypeForFile (file1.getFullPathName()) == nullptr);
+            expect (! reloaded.isListingUpToDate (file1.getFullPathName()));
+
+            expectEquals (reloaded.getNumTypes(), 2);
+            expect (reloaded.isListingUpToDate (file2.getFullPathName()));
+        }
+
+        file1.deleteFile();
+        file2.deleteFile();
+    }
+};
+
+static KnownPluginListTests knownPluginListUnitTests;
+
+#endif
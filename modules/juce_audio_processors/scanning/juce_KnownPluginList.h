@@ -98,6 +98,10 @@ public:
 
     /** Returns true if the specified file is already known about and if it
         hasn't been modified since our entry was created.
+
+        The list keeps an index of the size and modification time of each file that it
+        knows about, so this only needs to check the file itself, rather than looking
+        through all the types in the list.
     */
     bool isListingUpToDate (const String& possiblePluginFileOrIdentifier) const;
 
@@ -147,6 +151,23 @@ public:
     /** Recreates the state of this list from its stored XML format. */
     void recreateFromXml (const XmlElement& xml);
 
+    /** Writes the list to a stream in a compact binary format.
+
+        This is much quicker to reload than the XML format, and it also stores the
+        size and modification time of each plugin file, so that after reloading it,
+        a rescan will only need to re-test the files that have actually changed.
+
+        @see readFromStream
+    */
+    void writeToStream (OutputStream& output) const;
+
+    /** Replaces the contents of the list with some data that was written by
+        writeToStream().
+
+        If the data isn't valid, this returns false and leaves the list empty.
+    */
+    bool readFromStream (InputStream& input);
+
     //==============================================================================
     /** A structure that recursively holds a tree of plugins.
         @see KnownPluginList::createTree()
@@ -165,6 +186,22 @@ private:
     //==============================================================================
     OwnedArray <PluginDescription> types;
 
+    struct FileFingerprint
+    {
+        FileFingerprint() noexcept;
+        FileFingerprint (const Time& modificationTime, int64 size) noexcept;
+
+        static FileFingerprint forFile (const String& fileOrIdentifier);
+
+        bool isValid() const noexcept;
+        bool matches (const FileFingerprint& currentState) const noexcept;
+
+        Time modificationTime;
+        int64 size; // -1 if unknown
+    };
+
+    HashMap <String, FileFingerprint> fileFingerprints;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KnownPluginList);
 };
 
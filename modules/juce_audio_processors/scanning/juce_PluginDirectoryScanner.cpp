@@ -23,6 +23,217 @@
   ==============================================================================
 */
 
+//==============================================================================
+namespace PluginScanWorkerHelpers
+{
+    const char* const commandLineFlag = "--juce-plugin-scan-worker";
+    const char* const messagePrefix   = "juce-plugin-scan:";
+
+    void writeMessage (const char* type, const String& text)
+    {
+        // The leading newline makes sure that our message starts on a fresh line, even
+        // if the plugin has written some junk of its own to stdout.
+        const String message ("\n" + String (messagePrefix) + type + " " + text + "\n");
+        fputs (message.toUTF8(), stdout);
+        fflush (stdout);
+    }
+}
+
+//==============================================================================
+class PluginDirectoryScanner::WorkerProcess  : public Thread
+{
+public:
+    WorkerProcess (PluginDirectoryScanner& owner_)
+        : Thread ("Plugin scan worker"),
+          fileStartTime (0),
+          isBusy (false),
+          hasTimedOut (false),
+          failedToLaunch (false),
+          owner (owner_)
+    {
+    }
+
+    ~WorkerProcess()
+    {
+        stop();
+    }
+
+    //==============================================================================
+    struct Result
+    {
+        String file;
+        OwnedArray <PluginDescription> typesFound;
+        bool crashed;
+    };
+
+    // These must only be accessed while holding the owner's workerLock
+    OwnedArray <Result> results;
+    StringArray unscannedFiles;
+    String currentFile;
+    uint32 fileStartTime;
+    bool isBusy, hasTimedOut, failedToLaunch;
+
+    //==============================================================================
+    // called on the scanner's thread, while the worker isn't busy
+    void scanFiles (const StringArray& files)
+    {
+        waitForThreadToExit (-1);
+
+        filesToScan = files;
+        currentFile = String::empty;
+        fileStartTime = Time::getMillisecondCounter();
+        isBusy = true;
+        hasTimedOut = false;
+
+        startThread();
+    }
+
+    // called on the scanner's thread, while holding the workerLock
+    void timeOut()
+    {
+        hasTimedOut = true;
+        process.kill();
+    }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+
+        {
+            const ScopedLock sl (owner.workerLock);
+
+            if (isBusy)
+                process.kill();
+        }
+
+        waitForThreadToExit (-1);
+    }
+
+    //==============================================================================
+    void run()
+    {
+        StringArray args (owner.workerCommand);
+        args.add (PluginScanWorkerHelpers::commandLineFlag);
+        args.add (owner.format.getName());
+        args.addArray (filesToScan);
+
+        bool launched;
+
+        {
+            const ScopedLock sl (owner.workerLock);
+            launched = (! threadShouldExit()) && process.start (args);
+        }
+
+        StringArray remainingFiles (filesToScan);
+        OwnedArray <PluginDescription> typesForCurrentFile;
+        bool anyMessagesReceived = false;
+
+        if (launched)
+        {
+            const String prefix (PluginScanWorkerHelpers::messagePrefix);
+            MemoryOutputStream line;
+
+            for (;;)
+            {
+                char c;
+                if (process.readProcessOutput (&c, 1) <= 0)
+                    break;
+
+                if (c != '\n')
+                {
+                    line.writeByte (c);
+                    continue;
+                }
+
+                const String message (line.toUTF8().trimCharactersAtEnd ("\r"));
+                line.reset();
+
+                if (! message.startsWith (prefix))
+                    continue;
+
+                anyMessagesReceived = true;
+                const String type (message.substring (prefix.length()).upToFirstOccurrenceOf (" ", false, false));
+                const String text (message.fromFirstOccurrenceOf (" ", false, false));
+
+                if (type == "SCANNING")
+                {
+                    typesForCurrentFile.clear();
+
+                    const ScopedLock sl (owner.workerLock);
+                    currentFile = text;
+                    fileStartTime = Time::getMillisecondCounter();
+                }
+                else if (type == "PLUGIN")
+                {
+                    XmlDocument doc (text);
+                    ScopedPointer <XmlElement> xml (doc.getDocumentElement());
+                    PluginDescription desc;
+
+                    if (xml != nullptr && desc.loadFromXml (*xml))
+                        typesForCurrentFile.add (new PluginDescription (desc));
+                }
+                else if (type == "DONE")
+                {
+                    Result* const r = new Result();
+                    r->file = text;
+                    r->crashed = false;
+                    r->typesFound.swapWithArray (typesForCurrentFile);
+
+                    const ScopedLock sl (owner.workerLock);
+                    results.add (r);
+                    remainingFiles.removeString (text);
+                    currentFile = String::empty;
+                    owner.workerFinishedFile.signal();
+                }
+            }
+
+            if (! process.waitForProcessToFinish (1000))
+                process.kill();
+        }
+
+        const ScopedLock sl (owner.workerLock);
+
+        if (threadShouldExit())
+        {
+            // we're being stopped, so whatever was in progress wasn't the plugin's fault..
+            unscannedFiles.addArray (remainingFiles);
+        }
+        else if (! anyMessagesReceived)
+        {
+            // if the worker never even managed to start scanning, then there's probably
+            // something wrong with its command-line, rather than with the plugins..
+            unscannedFiles.addArray (remainingFiles);
+            failedToLaunch = true;
+        }
+        else
+        {
+            if (currentFile.isNotEmpty())
+            {
+                Result* const r = new Result();
+                r->file = currentFile;
+                r->crashed = true;
+                results.add (r);
+
+                remainingFiles.removeString (currentFile);
+            }
+
+            unscannedFiles.addArray (remainingFiles);
+        }
+
+        currentFile = String::empty;
+        isBusy = false;
+        owner.workerFinishedFile.signal();
+    }
+
+private:
+    PluginDirectoryScanner& owner;
+    ChildProcess process;
+    StringArray filesToScan;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkerProcess);
+};
+
+//==============================================================================
 PluginDirectoryScanner::PluginDirectoryScanner (KnownPluginList& listToAddTo,
                                                 AudioPluginFormat& formatToLookFor,
                                                 FileSearchPath directoriesToSearch,
@@ -32,7 +243,9 @@ PluginDirectoryScanner::PluginDirectoryScanner (KnownPluginList& listToAddTo,
       format (formatToLookFor),
       deadMansPedalFile (deadMansPedalFile_),
       nextIndex (0),
-      progress (0)
+      progress (0),
+      workerTimeoutMs (0),
+      numFilesFinished (0)
 {
     directoriesToSearch.removeRedundantPaths();
 
@@ -54,16 +267,28 @@ PluginDirectoryScanner::PluginDirectoryScanner (KnownPluginList& listToAddTo,
 
 PluginDirectoryScanner::~PluginDirectoryScanner()
 {
+    workers.clear();
 }
 
 //==============================================================================
 const String PluginDirectoryScanner::getNextPluginFileThatWillBeScanned() const
 {
+    {
+        const ScopedLock sl (workerLock);
+
+        for (int i = 0; i < workers.size(); ++i)
+            if (workers.getUnchecked(i)->currentFile.isNotEmpty())
+                return format.getNameOfPluginFromIdentifier (workers.getUnchecked(i)->currentFile);
+    }
+
     return format.getNameOfPluginFromIdentifier (filesOrIdentifiersToScan [nextIndex]);
 }
 
 bool PluginDirectoryScanner::scanNextFile (const bool dontRescanIfAlreadyInList)
 {
+    if (workers.size() > 0)
+        return scanNextFileWithWorkers();
+
     String file (filesOrIdentifiersToScan [nextIndex]);
 
     if (file.isNotEmpty() && ! list.isListingUpToDate (file))
@@ -95,10 +320,220 @@ bool PluginDirectoryScanner::scanNextFile (const bool dontRescanIfAlreadyInList)
 bool PluginDirectoryScanner::skipNextFile()
 {
     if (nextIndex >= filesOrIdentifiersToScan.size())
+        return numFilesFinished < filesOrIdentifiersToScan.size();
+
+    ++nextIndex;
+    progress = ++numFilesFinished / (float) filesOrIdentifiersToScan.size();
+    return numFilesFinished < filesOrIdentifiersToScan.size();
+}
+
+//==============================================================================
+void PluginDirectoryScanner::useWorkerProcesses (const StringArray& workerCommand_,
+                                                 int numWorkers, const int timeoutMs)
+{
+    stopWorkers();
+
+    workerCommand = workerCommand_;
+    workerTimeoutMs = timeoutMs;
+
+    if (numWorkers <= 0)
+        numWorkers = SystemStats::getNumCpus();
+
+    if (workerCommand.size() > 0)
+        for (int i = 0; i < jmax (1, numWorkers); ++i)
+            workers.add (new WorkerProcess (*this));
+}
+
+bool PluginDirectoryScanner::scanNextFileWithWorkers()
+{
+    for (;;)
+    {
+        startIdleWorkers();
+
+        const bool gotResults = handleWorkerResults();
+
+        if (workers.size() == 0)
+            break; // the workers couldn't be launched, so carry on scanning in-process..
+
+        bool anyBusy = false;
+
+        {
+            const ScopedLock sl (workerLock);
+
+            for (int i = workers.size(); --i >= 0;)
+                anyBusy = anyBusy || workers.getUnchecked(i)->isBusy;
+        }
+
+        if (gotResults || ! (anyBusy || nextIndex < filesOrIdentifiersToScan.size()))
+            break;
+
+        checkWorkerTimeouts();
+        workerFinishedFile.wait (50);
+    }
+
+    progress = numFilesFinished / (float) filesOrIdentifiersToScan.size();
+    return numFilesFinished < filesOrIdentifiersToScan.size();
+}
+
+void PluginDirectoryScanner::startIdleWorkers()
+{
+    for (int i = 0; i < workers.size(); ++i)
+    {
+        WorkerProcess* const w = workers.getUnchecked(i);
+
+        {
+            const ScopedLock sl (workerLock);
+
+            if (w->isBusy)
+                continue;
+        }
+
+        // Give each worker a batch of files, to save launching a process for every one
+        // of them, but keep the batches small enough that all the workers have something to do..
+        const int numLeft = filesOrIdentifiersToScan.size() - nextIndex;
+        const int batchSize = jlimit (1, 8, numLeft / workers.size());
+        StringArray batch;
+
+        while (batch.size() < batchSize && nextIndex < filesOrIdentifiersToScan.size())
+        {
+            const String file (filesOrIdentifiersToScan [nextIndex++]);
+
+            if (file.isNotEmpty() && ! list.isListingUpToDate (file))
+                batch.add (file);
+            else
+                ++numFilesFinished;
+        }
+
+        if (batch.size() == 0)
+            break;
+
+        w->scanFiles (batch);
+    }
+}
+
+void PluginDirectoryScanner::checkWorkerTimeouts()
+{
+    const uint32 now = Time::getMillisecondCounter();
+    const ScopedLock sl (workerLock);
+
+    for (int i = workers.size(); --i >= 0;)
+    {
+        WorkerProcess* const w = workers.getUnchecked(i);
+
+        if (w->isBusy && ! w->hasTimedOut && (int) (now - w->fileStartTime) > workerTimeoutMs)
+            w->timeOut();
+    }
+}
+
+bool PluginDirectoryScanner::handleWorkerResults()
+{
+    OwnedArray <WorkerProcess::Result> results;
+    StringArray unscannedFiles;
+    bool launchFailed = false;
+
+    {
+        const ScopedLock sl (workerLock);
+
+        for (int i = 0; i < workers.size(); ++i)
+        {
+            WorkerProcess* const w = workers.getUnchecked(i);
+
+            results.addArray (w->results);
+            w->results.clear (false);
+
+            unscannedFiles.addArray (w->unscannedFiles);
+            w->unscannedFiles.clear();
+
+            launchFailed = launchFailed || w->failedToLaunch;
+        }
+    }
+
+    for (int i = 0; i < unscannedFiles.size(); ++i)
+        returnFileToQueue (unscannedFiles[i]);
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        const WorkerProcess::Result& r = *results.getUnchecked(i);
+
+        for (int j = 0; j < r.typesFound.size(); ++j)
+            list.addType (*r.typesFound.getUnchecked(j));
+
+        if (r.typesFound.size() == 0)
+            failedFiles.add (r.file);
+
+        addToDeadMansPedalFile (r.file, r.crashed);
+        ++numFilesFinished;
+    }
+
+    if (launchFailed)
+    {
+        // If this happens, check that the worker command is correct, and that your app
+        // calls performWorkerScan() when it starts up!
+        jassertfalse;
+        stopWorkers();
+    }
+
+    return results.size() > 0;
+}
+
+void PluginDirectoryScanner::stopWorkers()
+{
+    for (int i = workers.size(); --i >= 0;)
+    {
+        workers.getUnchecked(i)->stop();
+        workers.getUnchecked(i)->failedToLaunch = false;
+    }
+
+    // pick up anything that was finished before they stopped, and re-queue the rest..
+    handleWorkerResults();
+    workers.clear();
+}
+
+void PluginDirectoryScanner::returnFileToQueue (const String& file)
+{
+    const int index = filesOrIdentifiersToScan.indexOf (file);
+
+    if (index >= 0 && index < nextIndex)
+        filesOrIdentifiersToScan.move (index, --nextIndex);
+}
+
+bool PluginDirectoryScanner::performWorkerScan (AudioPluginFormatManager& formatManager,
+                                                const StringArray& args)
+{
+    const int flagIndex = args.indexOf (PluginScanWorkerHelpers::commandLineFlag);
+
+    if (flagIndex < 0)
         return false;
 
-    progress = ++nextIndex / (float) filesOrIdentifiersToScan.size();
-    return nextIndex < filesOrIdentifiersToScan.size();
+    AudioPluginFormat* format = nullptr;
+
+    for (int i = 0; i < formatManager.getNumFormats(); ++i)
+        if (formatManager.getFormat (i)->getName() == args [flagIndex + 1])
+            format = formatManager.getFormat (i);
+
+    jassert (format != nullptr); // the worker's format manager must contain the format being scanned!
+
+    for (int i = flagIndex + 2; i < args.size(); ++i)
+    {
+        const String file (args[i]);
+        PluginScanWorkerHelpers::writeMessage ("SCANNING", file);
+
+        if (format != nullptr)
+        {
+            OwnedArray <PluginDescription> typesFound;
+            format->findAllTypesForFile (typesFound, file);
+
+            for (int j = 0; j < typesFound.size(); ++j)
+            {
+                const ScopedPointer <XmlElement> xml (typesFound.getUnchecked(j)->createXml());
+                PluginScanWorkerHelpers::writeMessage ("PLUGIN", xml->createDocument (String::empty, true, false));
+            }
+        }
+
+        PluginScanWorkerHelpers::writeMessage ("DONE", file);
+    }
+
+    return true;
 }
 
 StringArray PluginDirectoryScanner::getDeadMansPedalFile()
@@ -119,3 +554,18 @@ void PluginDirectoryScanner::setDeadMansPedalFile (const StringArray& newContent
     if (deadMansPedalFile != File::nonexistent)
         deadMansPedalFile.replaceWithText (newContents.joinIntoString ("\n"), true, true);
 }
+
+void PluginDirectoryScanner::addToDeadMansPedalFile (const String& file, const bool shouldBeAdded)
+{
+    StringArray crashedPlugins (getDeadMansPedalFile());
+
+    if (crashedPlugins.contains (file) != shouldBeAdded)
+    {
+        if (shouldBeAdded)
+            crashedPlugins.add (file);
+        else
+            crashedPlugins.removeString (file);
+
+        setDeadMansPedalFile (crashedPlugins);
+    }
+}
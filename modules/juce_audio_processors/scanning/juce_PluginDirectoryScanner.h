@@ -36,6 +36,13 @@
 
     To use one of these, create it and call scanNextFile() repeatedly, until
     it returns false.
+
+    By default, each plugin is loaded inside the calling process, one at a time. If
+    you call useWorkerProcesses(), the files will instead be shared out between a set
+    of child processes which are scanned in parallel, so that a plugin which crashes
+    or hangs can't take your app down with it. For this to work, your app must call
+    performWorkerScan() when it starts up, so that it can act as a worker when it's
+    launched by the scanner.
 */
 class JUCE_API  PluginDirectoryScanner
 {
@@ -105,6 +112,59 @@ public:
     */
     const StringArray& getFailedFiles() const noexcept              { return failedFiles; }
 
+    //==============================================================================
+    /** Makes the scanner load the plugins in some separate worker processes, rather
+        than in the calling process.
+
+        Each worker is launched with the given command followed by some extra arguments
+        which tell it which files to scan - normally you'd just pass the path of your
+        own executable, and make sure that your app calls performWorkerScan() as soon
+        as it starts up.
+
+        The files are shared out between the workers, which are run in parallel, and
+        scanNextFile() will then return as soon as any of them has finished a file. If a
+        worker crashes, or spends longer than timeoutMs on a single file, the file it was
+        working on is added to the failed files and the dead-man's-pedal list, and a
+        new worker carries on with the rest of its files.
+
+        @param workerCommand    the executable (and any arguments it needs) to launch
+        @param numWorkers       the number of processes to run at once - if this is 0 or
+                                less, one will be used for each CPU core
+        @param timeoutMs        how long a worker is allowed to spend on a single file
+                                before it's killed
+    */
+    void useWorkerProcesses (const StringArray& workerCommand,
+                             int numWorkers = 0,
+                             int timeoutMs = 30000);
+
+    /** If the command-line arguments are those that a PluginDirectoryScanner uses to
+        launch a worker process, this will scan the files that it lists and write the
+        results to stdout, for the scanner to read.
+
+        Your app should call this when it starts up if it's going to use worker processes
+        for scanning, e.g.
+        @code
+        void initialise (const String&)
+        {
+            AudioPluginFormatManager formatManager;
+            formatManager.addDefaultFormats();
+
+            if (PluginDirectoryScanner::performWorkerScan (formatManager, getCommandLineParameterArray()))
+            {
+                quit();
+                return;
+            }
+            ...
+        @endcode
+
+        @returns true if this was a worker command-line, in which case the files will
+                 have been scanned and your app should exit immediately; false if it
+                 wasn't, in which case nothing will have been done.
+        @see useWorkerProcesses
+    */
+    static bool performWorkerScan (AudioPluginFormatManager& formatManager,
+                                   const StringArray& commandLineArguments);
+
 private:
     //==============================================================================
     KnownPluginList& list;
@@ -115,8 +175,24 @@ private:
     int nextIndex;
     float progress;
 
+    class WorkerProcess;
+    friend class WorkerProcess;
+    friend class OwnedArray<WorkerProcess>;
+    OwnedArray<WorkerProcess> workers;
+    StringArray workerCommand;
+    CriticalSection workerLock;
+    WaitableEvent workerFinishedFile;
+    int workerTimeoutMs, numFilesFinished;
+
+    bool scanNextFileWithWorkers();
+    void startIdleWorkers();
+    void checkWorkerTimeouts();
+    bool handleWorkerResults();
+    void stopWorkers();
+    void returnFileToQueue (const String& file);
     StringArray getDeadMansPedalFile();
     void setDeadMansPedalFile (const StringArray& newContents);
+    void addToDeadMansPedalFile (const String& file, bool shouldBeAdded);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginDirectoryScanner);
 };
@@ -56,6 +56,11 @@ void PluginListComponent::setOptionsButtonText (const String& newText)
     resized();
 }
 
+void PluginListComponent::setScanWorkerCommand (const StringArray& workerCommand)
+{
+    scanWorkerCommand = workerCommand;
+}
+
 void PluginListComponent::resized()
 {
     listBox.setBounds (0, 0, getWidth(), getHeight() - 30);
@@ -223,6 +228,9 @@ public:
           progress (0.0),
           scanner (owner.list, format, path, true, owner.deadMansPedalFile)
     {
+        if (owner.scanWorkerCommand.size() > 0)
+            scanner.useWorkerProcesses (owner.scanWorkerCommand);
+
         aw.addButton (TRANS("Cancel"), 0, KeyPress (KeyPress::escapeKey));
         aw.addProgressBarComponent (progress);
         aw.enterModalState();
@@ -61,6 +61,11 @@ public:
     /** Changes the text in the panel's button. */
     void setOptionsButtonText (const String& newText);
 
+    /** Makes the component scan for plugins using separate worker processes.
+        See PluginDirectoryScanner::useWorkerProcesses() for details of how to set this up.
+    */
+    void setScanWorkerCommand (const StringArray& workerCommand);
+
     //==============================================================================
     /** @internal */
     void resized();
@@ -83,6 +88,7 @@ private:
     ListBox listBox;
     TextButton optionsButton;
     PropertiesFile* propertiesToUse;
+    StringArray scanWorkerCommand;
 
     class Scanner;
     friend class Scanner;
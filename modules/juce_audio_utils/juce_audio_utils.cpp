@@ -47,6 +47,7 @@ namespace juce
 #include "gui/juce_AudioThumbnail.cpp"
 #include "gui/juce_AudioThumbnailCache.cpp"
 #include "gui/juce_MidiKeyboardComponent.cpp"
+#include "players/juce_AudioProcessorOfflineRenderer.cpp"
 #include "players/juce_AudioProcessorPlayer.cpp"
 // END_AUTOINCLUDE
 
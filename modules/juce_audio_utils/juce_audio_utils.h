@@ -50,6 +50,9 @@ namespace juce
 #ifndef __JUCE_MIDIKEYBOARDCOMPONENT_JUCEHEADER__
  #include "gui/juce_MidiKeyboardComponent.h"
 #endif
+#ifndef __JUCE_AUDIOPROCESSOROFFLINERENDERER_JUCEHEADER__
+ #include "players/juce_AudioProcessorOfflineRenderer.h"
+#endif
 #ifndef __JUCE_AUDIOPROCESSORPLAYER_JUCEHEADER__
  #include "players/juce_AudioProcessorPlayer.h"
 #endif
@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+AudioProcessorOfflineRenderer::AudioProcessorOfflineRenderer (AudioProcessor& processor_,
+                                                              const double sampleRate_,
+                                                              const int blockSize_)
+    : processor (processor_),
+      sampleRate (sampleRate_),
+      blockSize (jmax (1, blockSize_)),
+      numRenderingThreads (0),
+      compensateForLatency (true),
+      numSamplesToRender (0),
+      numSamplesRendered (0),
+      renderTimeSeconds (0)
+{
+    jassert (sampleRate > 0);
+
+    position.resetToDefault();
+    position.isPlaying = true;
+    setTempo (120.0);
+}
+
+AudioProcessorOfflineRenderer::~AudioProcessorOfflineRenderer()
+{
+}
+
+//==============================================================================
+void AudioProcessorOfflineRenderer::setTempo (const double bpm, const int timeSigNumerator, const int timeSigDenominator)
+{
+    jassert (bpm > 0 && timeSigNumerator > 0 && timeSigDenominator > 0);
+
+    position.bpm = bpm;
+    position.timeSigNumerator = timeSigNumerator;
+    position.timeSigDenominator = timeSigDenominator;
+}
+
+void AudioProcessorOfflineRenderer::setMidiSequence (const MidiMessageSequence& sequence)
+{
+    midiSequence = sequence;
+}
+
+void AudioProcessorOfflineRenderer::setNumRenderingThreads (const int numThreads)
+{
+    numRenderingThreads = jmax (0, numThreads);
+}
+
+void AudioProcessorOfflineRenderer::setCompensatesForLatency (const bool shouldCompensate) noexcept
+{
+    compensateForLatency = shouldCompensate;
+}
+
+void AudioProcessorOfflineRenderer::signalShouldStop() noexcept
+{
+    shouldStop = 1;
+}
+
+double AudioProcessorOfflineRenderer::getProgress() const noexcept
+{
+    return numSamplesToRender > 0 ? numSamplesRendered / (double) numSamplesToRender : 0.0;
+}
+
+double AudioProcessorOfflineRenderer::getRealtimeFactor() const noexcept
+{
+    return renderTimeSeconds > 0 ? (numSamplesRendered / sampleRate) / renderTimeSeconds : 0.0;
+}
+
+//==============================================================================
+bool AudioProcessorOfflineRenderer::render (AudioFormatWriter& writer, const int64 numSamples)
+{
+    // the writer needs to be running at the same rate as the processor!
+    jassert (writer.getSampleRate() == sampleRate);
+
+    shouldStop = 0;
+    numSamplesToRender = jmax ((int64) 0, numSamples);
+    numSamplesRendered = 0;
+    renderTimeSeconds = 0;
+
+    AudioProcessorGraph* const graph = dynamic_cast <AudioProcessorGraph*> (&processor);
+    const int oldNumRenderingThreads = graph != nullptr ? graph->getNumRenderingThreads() : 0;
+
+    if (graph != nullptr && numRenderingThreads > 0)
+        graph->setNumRenderingThreads (numRenderingThreads);
+
+    AudioPlayHead* const oldPlayHead = processor.getPlayHead();
+    const bool wasNonRealtime = processor.isNonRealtime();
+
+    processor.setPlayHead (this);
+    processor.setNonRealtime (true);
+    processor.setPlayConfigDetails (processor.getNumInputChannels(), writer.getNumChannels(),
+                                    sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+
+    const int64 startTicks = Time::getHighResolutionTicks();
+    const bool ok = renderBlocks (writer, writer.getNumChannels());
+    renderTimeSeconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks);
+
+    processor.releaseResources();
+    processor.setNonRealtime (wasNonRealtime);
+    processor.setPlayHead (oldPlayHead);
+
+    if (graph != nullptr && numRenderingThreads > 0)
+        graph->setNumRenderingThreads (oldNumRenderingThreads);
+
+    return ok;
+}
+
+bool AudioProcessorOfflineRenderer::renderBlocks (AudioFormatWriter& writer, const int numOutputChannels)
+{
+    AudioSampleBuffer buffer (jmax (1, processor.getNumInputChannels(), numOutputChannels), blockSize);
+    MidiBuffer midi;
+
+    int64 samplesToSkip = compensateForLatency ? processor.getLatencySamples() : 0;
+    const int64 totalSamples = numSamplesToRender + samplesToSkip;
+    int64 renderPosition = 0;
+    int nextMidiEvent = 0;
+
+    while (renderPosition < totalSamples)
+    {
+        if (shouldStop.get() != 0)
+            return false;
+
+        const int numThisTime = (int) jmin ((int64) blockSize, totalSamples - renderPosition);
+        AudioSampleBuffer block (buffer.getArrayOfChannels(), buffer.getNumChannels(), numThisTime);
+        block.clear();
+
+        midi.clear();
+        const double blockEndTime = (renderPosition + numThisTime) / sampleRate;
+
+        for (; nextMidiEvent < midiSequence.getNumEvents(); ++nextMidiEvent)
+        {
+            const MidiMessage& m = midiSequence.getEventPointer (nextMidiEvent)->message;
+
+            if (m.getTimeStamp() >= blockEndTime)
+                break;
+
+            const int64 eventPosition = (int64) (m.getTimeStamp() * sampleRate + 0.5);
+            midi.addEvent (m, (int) jlimit ((int64) 0, (int64) numThisTime - 1, eventPosition - renderPosition));
+        }
+
+        updatePosition (renderPosition);
+
+        {
+            const ScopedLock sl (processor.getCallbackLock());
+
+            if (processor.isSuspended())
+                block.clear();
+            else
+                processor.processBlock (block, midi);
+        }
+
+        renderPosition += numThisTime;
+
+        // the processor's latency is thrown away from the start of the output..
+        const int numToSkip = (int) jmin (samplesToSkip, (int64) numThisTime);
+        samplesToSkip -= numToSkip;
+
+        if (numThisTime > numToSkip)
+        {
+            if (! writer.writeFromAudioSampleBuffer (block, numToSkip, numThisTime - numToSkip))
+                return false;
+
+            numSamplesRendered += numThisTime - numToSkip;
+        }
+    }
+
+    return true;
+}
+
+//==============================================================================
+void AudioProcessorOfflineRenderer::updatePosition (const int64 samplePosition) noexcept
+{
+    const double quarterNotesPerBar = position.timeSigNumerator * 4.0 / position.timeSigDenominator;
+
+    position.timeInSamples = samplePosition;
+    position.timeInSeconds = samplePosition / sampleRate;
+    position.ppqPosition = position.timeInSeconds * position.bpm / 60.0;
+    position.ppqPositionOfLastBarStart = std::floor (position.ppqPosition / quarterNotesPerBar) * quarterNotesPerBar;
+}
+
+bool AudioProcessorOfflineRenderer::getCurrentPosition (CurrentPositionInfo& result)
+{
+    result = position;
+    return true;
+}
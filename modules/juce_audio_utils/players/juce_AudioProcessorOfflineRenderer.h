@@ -0,0 +1,153 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_AUDIOPROCESSOROFFLINERENDERER_JUCEHEADER__
+#define __JUCE_AUDIOPROCESSOROFFLINERENDERER_JUCEHEADER__
+
+#include "../../juce_audio_processors/processors/juce_AudioProcessor.h"
+
+
+//==============================================================================
+/**
+    Renders the output of an AudioProcessor into an AudioFormatWriter, as fast as
+    the processor can go.
+
+    This is for bouncing a graph or plugin to a file without an audio device. It
+    prepares the processor, calls processBlock() repeatedly with silent inputs
+    and an optional MIDI sequence, and writes each block to the writer. While it's
+    rendering, the processor's AudioPlayHead is replaced by one that reports a
+    playing transport at the position being rendered.
+
+    If the processor is an AudioProcessorGraph, setNumRenderingThreads() lets you
+    spread the graph's work across several threads for the duration of the render.
+
+    E.g.
+    @code
+    AudioProcessorOfflineRenderer renderer (graph, 44100.0);
+    renderer.setTempo (128.0);
+
+    if (renderer.render (*writer, 60 * 44100))
+        DBG ("rendered at " + String (renderer.getRealtimeFactor()) + "x realtime");
+    @endcode
+
+    The render() method blocks until it has finished, so you'll probably want to call
+    it from a background thread - e.g. a ThreadWithProgressWindow can call it, and
+    poll getProgress() and signalShouldStop() from the other thread.
+
+    @see AudioProcessorPlayer, AudioProcessorGraph::setNumRenderingThreads
+*/
+class JUCE_API  AudioProcessorOfflineRenderer  : private AudioPlayHead
+{
+public:
+    //==============================================================================
+    /** Creates a renderer for a processor.
+
+        The processor will not be deleted by this object, and it mustn't be in use by
+        anything else (e.g. an AudioProcessorPlayer) while a render is happening.
+    */
+    AudioProcessorOfflineRenderer (AudioProcessor& processor,
+                                   double sampleRate,
+                                   int blockSize = 512);
+
+    /** Destructor. */
+    ~AudioProcessorOfflineRenderer();
+
+    //==============================================================================
+    /** Sets the tempo and time signature that the play head will report. */
+    void setTempo (double bpm, int timeSigNumerator = 4, int timeSigDenominator = 4);
+
+    /** Gives the renderer a sequence of MIDI events to send to the processor.
+        The sequence's timestamps must be in seconds, relative to the start of the render.
+        The sequence is copied, so you don't need to keep it.
+    */
+    void setMidiSequence (const MidiMessageSequence& sequence);
+
+    /** If the processor is an AudioProcessorGraph, this sets the number of threads it
+        should use while it's being rendered. The graph's previous setting is restored
+        afterwards. A value of 0 leaves the graph's setting alone.
+        @see AudioProcessorGraph::setNumRenderingThreads
+    */
+    void setNumRenderingThreads (int numThreads);
+
+    /** If enabled (which is the default), the first getLatencySamples() samples of the
+        processor's output are thrown away, so that the file lines up with the input.
+    */
+    void setCompensatesForLatency (bool shouldCompensate) noexcept;
+
+    //==============================================================================
+    /** Renders some audio into a writer.
+
+        The processor's output channels are set to the writer's number of channels, and
+        the writer's sample rate should match the one this renderer was created with.
+
+        @param writer       the writer to send the audio to - this isn't deleted
+        @param numSamples   the number of samples to write
+        @returns true if all the samples were rendered and written successfully; false if
+                 the writer failed or signalShouldStop() was called
+    */
+    bool render (AudioFormatWriter& writer, int64 numSamples);
+
+    /** Can be called from any thread to make render() stop as soon as possible. */
+    void signalShouldStop() noexcept;
+
+    /** Returns the proportion of the current render that has been done, from 0 to 1.
+        This can be called from any thread.
+    */
+    double getProgress() const noexcept;
+
+    //==============================================================================
+    /** Returns the number of samples that the last call to render() wrote. */
+    int64 getNumSamplesRendered() const noexcept            { return numSamplesRendered; }
+
+    /** Returns the number of seconds that the last call to render() took. */
+    double getRenderTimeSeconds() const noexcept            { return renderTimeSeconds; }
+
+    /** Returns how many times faster than realtime the last call to render() ran.
+        E.g. 10.0 means that a minute of audio took six seconds to render.
+    */
+    double getRealtimeFactor() const noexcept;
+
+private:
+    //==============================================================================
+    AudioProcessor& processor;
+    const double sampleRate;
+    const int blockSize;
+    CurrentPositionInfo position;
+    MidiMessageSequence midiSequence;
+    int numRenderingThreads;
+    bool compensateForLatency;
+    Atomic<int> shouldStop;
+    int64 numSamplesToRender, numSamplesRendered;
+    double renderTimeSeconds;
+
+    bool renderBlocks (AudioFormatWriter&, int numOutputChannels);
+    void updatePosition (int64 samplePosition) noexcept;
+    bool getCurrentPosition (CurrentPositionInfo&);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioProcessorOfflineRenderer);
+};
+
+
+#endif   // __JUCE_AUDIOPROCESSOROFFLINERENDERER_JUCEHEADER__
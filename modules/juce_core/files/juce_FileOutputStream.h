@@ -86,6 +86,15 @@ public:
     */
     Result truncate();
 
+    /** Asks the filesystem to reserve space for the given number of bytes beyond the
+        current write position, without changing the file's length.
+
+        Reserving the space in advance can make long, streamed writes faster and less
+        prone to fragmentation. This isn't supported on all platforms or filesystems, in
+        which case it'll return an error and the stream will carry on working normally.
+    */
+    Result preallocate (int64 numBytesToReserve);
+
     //==============================================================================
     void flush();
     int64 getPosition();
@@ -525,6 +525,30 @@ Result FileOutputStream::truncate()
     return getResultForReturnValue (ftruncate (getFD (fileHandle), (off_t) currentPosition));
 }
 
+Result FileOutputStream::preallocate (const int64 numBytesToReserve)
+{
+    if (fileHandle == 0)
+        return status;
+
+    flush();
+
+   #if JUCE_LINUX && defined (FALLOC_FL_KEEP_SIZE)
+    return getResultForReturnValue (fallocate (getFD (fileHandle), FALLOC_FL_KEEP_SIZE,
+                                               (off_t) currentPosition, (off_t) numBytesToReserve));
+   #elif JUCE_MAC || JUCE_IOS
+    fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t) numBytesToReserve, 0 };
+
+    if (fcntl (getFD (fileHandle), F_PREALLOCATE, &store) != -1)
+        return Result::ok();
+
+    store.fst_flags = F_ALLOCATEALL;
+    return getResultForReturnValue (fcntl (getFD (fileHandle), F_PREALLOCATE, &store));
+   #else
+    (void) numBytesToReserve;
+    return Result::fail ("Preallocation isn't supported on this platform");
+   #endif
+}
+
 //==============================================================================
 String SystemStats::getEnvironmentVariable (const String& name, const String& defaultValue)
 {
@@ -309,6 +309,13 @@ Result FileOutputStream::truncate()
                                               : WindowsFileHelpers::getResultForLastError();
 }
 
+Result FileOutputStream::preallocate (const int64)
+{
+    // reserving space without moving the end-of-file needs SetFileInformationByHandle,
+    // which isn't available on all the versions of Windows that we support..
+    return Result::fail ("Preallocation isn't supported on this platform");
+}
+
 //==============================================================================
 MemoryMappedFile::MemoryMappedFile (const File& file, MemoryMappedFile::AccessMode mode)
     : address (nullptr),
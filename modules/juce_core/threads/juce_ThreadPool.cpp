@@ -54,13 +54,98 @@ void ThreadPoolJob::signalJobShouldExit()
     shouldStop = true;
 }
 
+//==============================================================================
+/*  A double-ended queue of tasks. The thread that owns a queue adds and removes
+    tasks at the back, so that it works on the most recently added (and most
+    cache-friendly) ones first, while other threads steal the oldest tasks from
+    the front. Each operation only holds the lock for a few instructions, and the
+    lock is hardly ever contended, because threads only steal when they run out
+    of their own work.
+*/
+class ThreadPool::WorkQueue
+{
+public:
+    WorkQueue()
+        : tasks (initialCapacity), capacity (initialCapacity), start (0)
+    {
+    }
+
+    ~WorkQueue()
+    {
+        jassert (isEmpty()); // a TaskGroup must have been deleted without waiting for its tasks!
+    }
+
+    bool isEmpty() const noexcept       { return numTasks.get() == 0; }
+
+    void addToBack (Task* const task)
+    {
+        const SpinLock::ScopedLockType sl (lock);
+
+        if (numTasks.value == capacity)
+        {
+            HeapBlock<Task*> newTasks ((size_t) capacity * 2);
+
+            for (int i = 0; i < capacity; ++i)
+                newTasks[i] = tasks [(start + i) & (capacity - 1)];
+
+            tasks.swapWith (newTasks);
+            capacity *= 2;
+            start = 0;
+        }
+
+        tasks [(start + numTasks.value) & (capacity - 1)] = task;
+        ++numTasks;
+    }
+
+    Task* removeFromBack()
+    {
+        if (isEmpty())
+            return nullptr;
+
+        const SpinLock::ScopedLockType sl (lock);
+
+        if (numTasks.value == 0)
+            return nullptr;
+
+        return tasks [(start + --numTasks) & (capacity - 1)];
+    }
+
+    Task* removeFromFront()
+    {
+        if (isEmpty())
+            return nullptr;
+
+        const SpinLock::ScopedLockType sl (lock);
+
+        if (numTasks.value == 0)
+            return nullptr;
+
+        Task* const task = tasks [start];
+        start = (start + 1) & (capacity - 1);
+        --numTasks;
+        return task;
+    }
+
+private:
+    enum { initialCapacity = 64 }; // must be a power of 2
+
+    HeapBlock<Task*> tasks;
+    int capacity, start;
+    Atomic<int> numTasks;
+    SpinLock lock;
+
+    JUCE_DECLARE_NON_COPYABLE (WorkQueue);
+};
+
 //==============================================================================
 class ThreadPool::ThreadPoolThread  : public Thread
 {
 public:
-    ThreadPoolThread (ThreadPool& pool_)
+    ThreadPoolThread (ThreadPool& pool_, const int index_)
         : Thread ("Pool"),
-          pool (pool_)
+          index (index_),
+          pool (pool_),
+          numSpins (SystemStats::getNumCpus() > 1 ? 50 : 0)
     {
     }
 
@@ -68,19 +153,100 @@ public:
     {
         while (! threadShouldExit())
         {
-            if (! pool.runNextJob())
-                wait (500);
+            if (! pool.runNextTask (this, true) && ! waitBrieflyForWork())
+            {
+                // Having declared that we're about to sleep, we need to check once more for work,
+                // because anything that was added before the count changed won't have woken us.
+                // Anything added after it will call notify(), and if that happens before we get
+                // to wait(), the event will stay signalled, so the wake-up can't be missed.
+                isSleeping = 1;
+                ++(pool.numSleepingThreads);
+
+                if (! pool.isWorkWaiting())
+                    wait (-1);
+
+                --(pool.numSleepingThreads);
+                isSleeping = 0;
+            }
+        }
+    }
+
+    // Going to sleep and being woken again costs far more than running a small task, so
+    // when a thread runs out of work, it spins for a moment first in case more turns up.
+    // (On a single CPU this would just hold up the thread that's adding the work).
+    bool waitBrieflyForWork() const
+    {
+        for (int i = numSpins; --i >= 0;)
+        {
+            Thread::yield();
+
+            if (pool.isWorkWaiting())
+                return true;
         }
+
+        return false;
     }
 
+    WorkQueue queue;
+    Atomic<int> isSleeping;
+    const int index;
+
 private:
     ThreadPool& pool;
+    const int numSpins;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThreadPoolThread);
 };
 
+//==============================================================================
+ThreadPool::TaskGroup::TaskGroup (ThreadPool& pool_)
+    : pool (pool_)
+{
+}
+
+ThreadPool::TaskGroup::~TaskGroup()
+{
+    wait();
+}
+
+void ThreadPool::TaskGroup::addTask (Task* const task, const bool wakeUpThread)
+{
+    task->group = this;
+    ++numPendingTasks;
+    pool.addTask (task, wakeUpThread);
+}
+
+void ThreadPool::TaskGroup::taskFinished()
+{
+    // The lock stops wait() returning (and the group being deleted) while the
+    // thread that finished the last task is still signalling the event.
+    const SpinLock::ScopedLockType sl (finishLock);
+
+    if (--numPendingTasks == 0)
+        finishedEvent.signal();
+}
+
+void ThreadPool::TaskGroup::wait()
+{
+    ThreadPoolThread* const currentThread = isFinished() ? nullptr : pool.getCurrentPoolThread();
+
+    while (! isFinished())
+    {
+        // If there's nothing left to run, then all of our remaining tasks must be running
+        // on other threads, and the last one to finish will signal the event.
+        if (! pool.runNextTask (currentThread, false))
+            finishedEvent.wait (-1);
+    }
+
+    // Taking the lock makes sure that the thread which finished the last task has let go
+    // of the group. The signal is passed on in case another thread is waiting for it too.
+    const SpinLock::ScopedLockType sl (finishLock);
+    finishedEvent.signal();
+}
+
 //==============================================================================
 ThreadPool::ThreadPool (const int numThreads)
+    : sharedQueue (new WorkQueue())
 {
     jassert (numThreads > 0); // not much point having a pool without any threads!
 
@@ -88,6 +254,7 @@ ThreadPool::ThreadPool (const int numThreads)
 }
 
 ThreadPool::ThreadPool()
+    : sharedQueue (new WorkQueue())
 {
     createThreads (SystemStats::getNumCpus());
 }
@@ -100,8 +267,10 @@ ThreadPool::~ThreadPool()
 
 void ThreadPool::createThreads (int numThreads)
 {
-    for (int i = jmax (1, numThreads); --i >= 0;)
-        threads.add (new ThreadPoolThread (*this));
+    numThreads = jmax (1, numThreads);
+
+    for (int i = 0; i < numThreads; ++i)
+        threads.add (new ThreadPoolThread (*this, i));
 
     for (int i = threads.size(); --i >= 0;)
         threads.getUnchecked(i)->startThread();
@@ -131,10 +300,10 @@ void ThreadPool::addJob (ThreadPoolJob* const job, const bool deleteJobWhenFinis
         {
             const ScopedLock sl (lock);
             jobs.add (job);
+            ++numWaitingJobs;
         }
 
-        for (int i = threads.size(); --i >= 0;)
-            threads.getUnchecked(i)->notify();
+        wakeUpSleepingThreads (1);
     }
 }
 
@@ -203,6 +372,7 @@ bool ThreadPool::removeJob (ThreadPoolJob* const job,
             else
             {
                 jobs.removeFirstMatchingValue (job);
+                --numWaitingJobs;
                 addToDeleteList (deletionList, job);
             }
         }
@@ -238,6 +408,7 @@ bool ThreadPool::removeAllJobs (const bool interruptRunningJobs, const int timeO
                     else
                     {
                         jobs.remove (i);
+                        --numWaitingJobs;
                         addToDeleteList (deletionList, job);
                     }
                 }
@@ -308,6 +479,8 @@ ThreadPoolJob* ThreadPool::pickNextJobToRun()
 
             if (job != nullptr && ! job->isActive)
             {
+                --numWaitingJobs;
+
                 if (job->shouldStop)
                 {
                     jobs.remove (i);
@@ -360,6 +533,7 @@ bool ThreadPool::runNextJob()
             {
                 // move the job to the end of the queue if it wants another go
                 jobs.move (jobs.indexOf (job), -1);
+                ++numWaitingJobs;
             }
         }
     }
@@ -375,3 +549,401 @@ void ThreadPool::addToDeleteList (OwnedArray<ThreadPoolJob>& deletionList, Threa
     if (job->shouldBeDeleted)
         deletionList.add (job);
 }
+
+//==============================================================================
+void ThreadPool::addTask (Task* const task, const bool wakeUpThread)
+{
+    ThreadPoolThread* const currentThread = getCurrentPoolThread();
+
+    if (currentThread != nullptr)
+        currentThread->queue.addToBack (task);
+    else
+        sharedQueue->addToBack (task);
+
+    if (wakeUpThread)
+        wakeUpSleepingThreads (1);
+}
+
+ThreadPool::Task* ThreadPool::stealTask (ThreadPoolThread* const currentThread) const
+{
+    Task* task = sharedQueue->removeFromFront();
+
+    // start with the thread after this one, so that the thieves don't all pick on the same victim
+    const int firstVictim = currentThread != nullptr ? currentThread->index + 1 : 0;
+
+    for (int i = 0; i < threads.size() && task == nullptr; ++i)
+        task = threads.getUnchecked ((firstVictim + i) % threads.size())->queue.removeFromFront();
+
+    return task;
+}
+
+bool ThreadPool::runNextTask (ThreadPoolThread* const currentThread, const bool canRunJobs)
+{
+    Task* task = nullptr;
+
+    if (currentThread != nullptr)
+        task = currentThread->queue.removeFromBack();
+
+    // Jobs get a turn before any stealing happens, so that a steady stream of tasks can't
+    // starve them. A thread that's waiting for a TaskGroup mustn't pick up a job though,
+    // because the job could run for much longer than the tasks it's waiting for.
+    if (task == nullptr)
+    {
+        if (canRunJobs && numWaitingJobs.get() > 0 && runNextJob())
+            return true;
+
+        task = stealTask (currentThread);
+
+        if (task == nullptr)
+            return false;
+    }
+
+    JUCE_TRY
+    {
+        task->run();
+    }
+    JUCE_CATCH_ALL_ASSERT
+
+    TaskGroup* const group = task->group;
+    delete task;
+    group->taskFinished();
+
+    return true;
+}
+
+ThreadPool::ThreadPoolThread* ThreadPool::getCurrentPoolThread() const noexcept
+{
+    const Thread* const currentThread = Thread::getCurrentThread();
+
+    if (currentThread != nullptr)
+        for (int i = threads.size(); --i >= 0;)
+            if (threads.getUnchecked(i) == currentThread)
+                return threads.getUnchecked(i);
+
+    return nullptr;
+}
+
+bool ThreadPool::isWorkWaiting() const noexcept
+{
+    if (numWaitingJobs.get() > 0 || ! sharedQueue->isEmpty())
+        return true;
+
+    for (int i = threads.size(); --i >= 0;)
+        if (! threads.getUnchecked(i)->queue.isEmpty())
+            return true;
+
+    return false;
+}
+
+void ThreadPool::wakeUpSleepingThreads (int maxNumThreadsToWake)
+{
+    if (numSleepingThreads.get() > 0)
+    {
+        for (int i = threads.size(); --i >= 0 && maxNumThreadsToWake > 0;)
+        {
+            ThreadPoolThread* const t = threads.getUnchecked(i);
+
+            if (t->isSleeping.compareAndSetBool (0, 1))
+            {
+                t->notify();
+                --maxNumThreadsToWake;
+            }
+        }
+    }
+}
+
+int ThreadPool::getNumChunks (const int numIndexes, const int grainSize) const noexcept
+{
+    if (numIndexes <= 0)
+        return 0;
+
+    if (grainSize > 0)
+        return (int) ((numIndexes + (int64) grainSize - 1) / grainSize);
+
+    // a few chunks per thread gives the threads a chance to balance things out if
+    // some indexes take longer than others
+    return jmin (numIndexes, threads.size() * 4);
+}
+
+int ThreadPool::getChunkStart (const int startIndex, const int endIndex, const int chunk, const int numChunks) noexcept
+{
+    return startIndex + (int) (((int64) (endIndex - startIndex) * chunk) / numChunks);
+}
+
+//==============================================================================
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ThreadPoolTests  : public UnitTest
+{
+public:
+    ThreadPoolTests() : UnitTest ("ThreadPool") {}
+
+    struct CountingTask
+    {
+        CountingTask (Atomic<int>& counter_) noexcept : counter (counter_) {}
+        void operator()() const noexcept            { ++counter; }
+
+        Atomic<int>& counter;
+    };
+
+    // Runs a group of tasks of its own and waits for them, from inside a pool thread.
+    struct NestedGroupTask
+    {
+        NestedGroupTask (ThreadPool& pool_, Atomic<int>& counter_, const int numTasks_) noexcept
+            : pool (pool_), counter (counter_), numTasks (numTasks_) {}
+
+        void operator()() const
+        {
+            ThreadPool::TaskGroup group (pool);
+
+            for (int i = numTasks; --i >= 0;)
+                group.run (CountingTask (counter));
+
+            group.wait();
+        }
+
+        ThreadPool& pool;
+        Atomic<int>& counter;
+        int numTasks;
+    };
+
+    struct MarkIndex
+    {
+        MarkIndex (int* marks_) noexcept : marks (marks_) {}
+        void operator() (const int index) const noexcept    { ++marks [index]; }
+
+        int* marks;
+    };
+
+    // The values vary wildly in magnitude, so the total depends on the order they're added in.
+    struct UnevenValue
+    {
+        double operator() (const int index) const noexcept  { return (index % 3 == 0 ? 1.0e10 : 1.0) / (index + 1); }
+    };
+
+    struct Sum
+    {
+        double operator() (const double a, const double b) const noexcept   { return a + b; }
+    };
+
+    struct IndexValue
+    {
+        int64 operator() (const int index) const noexcept   { return index; }
+    };
+
+    struct Sum64
+    {
+        int64 operator() (const int64 a, const int64 b) const noexcept      { return a + b; }
+    };
+
+    class CountingJob  : public ThreadPoolJob
+    {
+    public:
+        CountingJob (Atomic<int>& counter_, const int numRuns_)
+            : ThreadPoolJob ("counter"), counter (counter_), numRunsLeft (numRuns_) {}
+
+        JobStatus runJob()
+        {
+            ++counter;
+            return --numRunsLeft > 0 ? jobNeedsRunningAgain : jobHasFinished;
+        }
+
+    private:
+        Atomic<int>& counter;
+        int numRunsLeft;
+    };
+
+    // A job that runs a group of tasks, which is allowed to share the pool with it.
+    class TaskRunningJob  : public ThreadPoolJob
+    {
+    public:
+        TaskRunningJob (ThreadPool& pool_, Atomic<int>& counter_)
+            : ThreadPoolJob ("tasks"), pool (pool_), counter (counter_) {}
+
+        JobStatus runJob()
+        {
+            NestedGroupTask (pool, counter, 50)();
+            return jobHasFinished;
+        }
+
+    private:
+        ThreadPool& pool;
+        Atomic<int>& counter;
+    };
+
+    // Blocks until the other task has run, so that the two can only finish if they run on
+    // different threads - i.e. if the thread that's waiting for the group has woken up one
+    // of the pool's threads to help out.
+    struct WaitingTask
+    {
+        WaitingTask (WaitableEvent& event_, Atomic<int>& result_) noexcept : event (event_), result (result_) {}
+        void operator()() const         { if (event.wait (5000)) ++result; }
+
+        WaitableEvent& event;
+        Atomic<int>& result;
+    };
+
+    struct SignallingTask
+    {
+        SignallingTask (WaitableEvent& event_) noexcept : event (event_) {}
+        void operator()() const         { event.signal(); }
+
+        WaitableEvent& event;
+    };
+
+    //==============================================================================
+    void testNestedGroups (const int numThreads)
+    {
+        ThreadPool pool (numThreads);
+        Atomic<int> counter;
+
+        {
+            ThreadPool::TaskGroup group (pool);
+
+            for (int i = 20; --i >= 0;)
+                group.run (NestedGroupTask (pool, counter, 100));
+
+            group.wait();
+            expect (group.isFinished());
+        }
+
+        expectEquals (counter.get(), 20 * 100);
+    }
+
+    void testParallelFor (ThreadPool& pool, const int numIndexes, const int grainSize)
+    {
+        HeapBlock<int> marks ((size_t) numIndexes, true);
+        pool.parallelFor (0, numIndexes, MarkIndex (marks), grainSize);
+
+        int numWrong = 0;
+        for (int i = 0; i < numIndexes; ++i)
+            if (marks[i] != 1)
+                ++numWrong;
+
+        expectEquals (numWrong, 0);
+    }
+
+    void runTest()
+    {
+        beginTest ("Nested TaskGroup waits");
+        testNestedGroups (1);
+        testNestedGroups (2);
+        testNestedGroups (4);
+
+        beginTest ("Single-thread pool");
+        {
+            ThreadPool pool (1);
+            expectEquals (pool.getNumThreads(), 1);
+
+            testParallelFor (pool, 10000, 0);
+            testParallelFor (pool, 10000, 1);
+            testParallelFor (pool, 1, 0);
+            testParallelFor (pool, 0, 0);
+
+            expectEquals (pool.parallelReduce (0, 1000, (int64) 0, IndexValue(), Sum64(), 3), (int64) (999 * 1000 / 2));
+            expectEquals (pool.parallelReduce (5, 5, (int64) 0, IndexValue(), Sum64()), (int64) 0);
+            expectEquals (pool.parallelReduce (5, 6, (int64) 0, IndexValue(), Sum64()), (int64) 5);
+        }
+
+        beginTest ("parallelReduce determinism");
+        {
+            const int numIndexes = 100000, grainSize = 997;
+
+            // the chunks are combined in order, so this is what the result should be on any pool
+            const int numChunks = (numIndexes + grainSize - 1) / grainSize;
+            double expected = 0;
+
+            for (int chunk = 0; chunk < numChunks; ++chunk)
+            {
+                double chunkTotal = 0;
+
+                for (int i = (int) (((int64) numIndexes * chunk) / numChunks);
+                         i < (int) (((int64) numIndexes * (chunk + 1)) / numChunks); ++i)
+                    chunkTotal += UnevenValue() (i);
+
+                expected += chunkTotal;
+            }
+
+            for (int numThreads = 1; numThreads <= 4; ++numThreads)
+            {
+                ThreadPool pool (numThreads);
+
+                for (int repeat = 0; repeat < 10; ++repeat)
+                {
+                    const double total = pool.parallelReduce (0, numIndexes, 0.0, UnevenValue(), Sum(), grainSize);
+                    expect (total == expected, "parallelReduce gave a different total with " + String (numThreads) + " threads");
+                }
+            }
+        }
+
+        beginTest ("Jobs and tasks mixed");
+        {
+            ThreadPool pool (3);
+            Atomic<int> jobCounter, taskCounter;
+            const int numJobs = 200, numRunsPerJob = 3;
+            HeapBlock<int> marks (1000, true);
+
+            for (int i = 0; i < numJobs; ++i)
+                pool.addJob (new CountingJob (jobCounter, numRunsPerJob), true);
+
+            for (int i = 0; i < 10; ++i)
+                pool.addJob (new TaskRunningJob (pool, taskCounter), true);
+
+            {
+                ThreadPool::TaskGroup group (pool);
+
+                for (int i = 0; i < 1000; ++i)
+                    group.run (CountingTask (taskCounter));
+
+                pool.parallelFor (0, 1000, MarkIndex (marks), 10);
+                group.wait();
+            }
+
+            const uint32 startTime = Time::getMillisecondCounter();
+
+            while (pool.getNumJobs() > 0 && Time::getMillisecondCounter() < startTime + 10000)
+                Thread::sleep (1);
+
+            expectEquals (pool.getNumJobs(), 0);
+            expectEquals (jobCounter.get(), numJobs * numRunsPerJob);
+            expectEquals (taskCounter.get(), 1000 + 10 * 50);
+        }
+
+        beginTest ("Sleep and wake");
+        {
+            ThreadPool pool (2);
+
+            for (int i = 0; i < 20; ++i)
+            {
+                // give the threads time to run out of work and go to sleep
+                Thread::sleep (10);
+
+                Atomic<int> counter;
+                CountingJob* const job = new CountingJob (counter, 1);
+                pool.addJob (job, false);
+                expect (pool.waitForJobToFinish (job, 5000), "a sleeping thread didn't wake up for a job");
+                delete job;
+                expectEquals (counter.get(), 1);
+
+                Thread::sleep (10);
+
+                WaitableEvent event;
+                Atomic<int> numWaitsSucceeded;
+
+                {
+                    ThreadPool::TaskGroup group (pool);
+                    group.run (WaitingTask (event, numWaitsSucceeded));
+                    group.run (SignallingTask (event));
+                    group.wait();
+                }
+
+                expectEquals (numWaitsSucceeded.get(), 1);
+            }
+        }
+    }
+};
+
+static ThreadPoolTests threadPoolUnitTests;
+
+#endif
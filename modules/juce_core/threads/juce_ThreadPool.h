@@ -30,6 +30,7 @@
 #include "../text/juce_StringArray.h"
 #include "../containers/juce_Array.h"
 #include "../containers/juce_OwnedArray.h"
+#include "../memory/juce_ScopedPointer.h"
 class ThreadPool;
 class ThreadPoolThread;
 
@@ -139,6 +140,17 @@ private:
     When a ThreadPoolJob object is added to the ThreadPool's list, its runJob() method
     will be called by the next pooled thread that becomes free.
 
+    As well as ThreadPoolJobs, the pool can run large numbers of small tasks very cheaply,
+    using a TaskGroup, or the parallelFor() and parallelReduce() methods. Each thread keeps
+    its own queue of these tasks, and threads which run out of work will steal tasks from
+    the others, so there's very little locking involved in scheduling them.
+
+    ThreadPoolJobs don't go through those queues: they're kept in a single list that's
+    protected by a lock, because a job can be removed, searched for, re-run or waited for
+    at any time, by any thread, and the work-stealing queues can't support that. So each
+    job costs several microseconds to add and run, compared to a fraction of a microsecond
+    for a task - if you've got a lot of small pieces of work, use a TaskGroup instead.
+
     @see ThreadPoolJob, Thread
 */
 class JUCE_API  ThreadPool
@@ -285,8 +297,224 @@ public:
     */
     bool setThreadPriorities (int newPriority);
 
+    /** Returns the number of threads that the pool is running. */
+    int getNumThreads() const noexcept                  { return threads.size(); }
+
+    //==============================================================================
+private:
+    class Task;
+
+public:
+    /**
+        A set of lightweight tasks which are run by a ThreadPool, and which can be
+        waited for together.
+
+        A task can be any copyable functor object with an operator()() method. It's far
+        cheaper to run one of these than a ThreadPoolJob, so they're suitable for splitting
+        up work into quite small pieces, and tasks may add more tasks to their own group or
+        to other groups.
+
+        e.g. @code
+        ThreadPool::TaskGroup group (pool);
+
+        for (int i = 0; i < numTiles; ++i)
+            group.run (TileRenderer (image, i));
+
+        group.wait();
+        @endcode
+
+        @see ThreadPool::parallelFor
+    */
+    class JUCE_API  TaskGroup
+    {
+    public:
+        /** Creates an empty group of tasks which will be run by the given pool. */
+        explicit TaskGroup (ThreadPool& pool);
+
+        /** Destructor.
+            If any of the group's tasks are still queued or running, this will wait for
+            them to finish.
+        */
+        ~TaskGroup();
+
+        /** Adds a task to the group.
+            The functor object is copied, and its operator()() method will be called on
+            one of the pool's threads, or by a thread that is inside wait().
+        */
+        template <class FunctorType>
+        void run (const FunctorType& functor)           { addTask (new FunctorTask<FunctorType> (functor)); }
+
+        /** Waits until all the tasks in the group have finished.
+
+            Rather than just blocking, the calling thread will help out by running any tasks
+            that are waiting in the pool's queues, so it's safe to call this from inside a
+            task, or with a pool that only has one thread.
+        */
+        void wait();
+
+        /** Returns true if all of the tasks that have been added have finished running. */
+        bool isFinished() const noexcept                { return numPendingTasks.get() == 0; }
+
+    private:
+        friend class ThreadPool;
+        ThreadPool& pool;
+        Atomic<int> numPendingTasks;
+        SpinLock finishLock;
+        WaitableEvent finishedEvent;
+
+        void addTask (Task*, bool wakeUpThread = true);
+        void taskFinished();
+
+        JUCE_DECLARE_NON_COPYABLE (TaskGroup);
+    };
+
+    //==============================================================================
+    /** Calls a functor for each index in a range, spreading the calls across the pool's threads.
+
+        The functor's operator() (int index) const method will be called once for each value in
+        the range startIndex to (endIndex - 1). The range is split up into chunks of
+        consecutive indexes which are run as tasks, and the calling thread works on them too,
+        so this will return when all the calls have been made.
+
+        @param startIndex   the first index to pass to the functor
+        @param endIndex     one more than the last index to pass to the functor
+        @param functor      the object to call - this isn't copied, and will be called
+                            by several threads at once
+        @param grainSize    the number of indexes to run in each task. If this is zero or
+                            less, the range will be split into a few chunks per thread
+    */
+    template <class FunctorType>
+    void parallelFor (const int startIndex, const int endIndex, const FunctorType& functor, const int grainSize = 0)
+    {
+        const int numChunks = getNumChunks (endIndex - startIndex, grainSize);
+
+        if (numChunks <= 1)
+        {
+            for (int i = startIndex; i < endIndex; ++i)
+                functor (i);
+
+            return;
+        }
+
+        TaskGroup group (*this);
+
+        for (int i = numChunks; --i > 0;)
+            group.addTask (new FunctorTask<ForRangeTask<FunctorType> > (ForRangeTask<FunctorType> (functor, getChunkStart (startIndex, endIndex, i, numChunks),
+                                                                                                             getChunkStart (startIndex, endIndex, i + 1, numChunks))),
+                           false);
+
+        wakeUpSleepingThreads (numChunks - 1);
+        ForRangeTask<FunctorType> (functor, startIndex, getChunkStart (startIndex, endIndex, 1, numChunks))();
+        group.wait();
+    }
+
+    /** Calculates a value for each index in a range in parallel, and combines the results.
+
+        This calls the functor's "ValueType operator() (int index) const" method for each index
+        from startIndex to (endIndex - 1), and combines the values by calling
+        "ValueType operator() (const ValueType&, const ValueType&) const" on the combiner.
+
+        Each chunk of the range is combined starting from the identity value, and the chunks'
+        results are then combined in order, so as long as the combiner is associative, the
+        result will be the same as doing the whole thing on one thread (and will be the same
+        every time, even for floating-point values).
+
+        @see parallelFor
+    */
+    template <typename ValueType, class FunctorType, class CombinerType>
+    ValueType parallelReduce (const int startIndex, const int endIndex, const ValueType& identity,
+                              const FunctorType& functor, const CombinerType& combiner, const int grainSize = 0)
+    {
+        const int numChunks = jmax (1, getNumChunks (endIndex - startIndex, grainSize));
+
+        Array<ValueType> chunkResults;
+        chunkResults.insertMultiple (0, identity, numChunks);
+
+        {
+            TaskGroup group (*this);
+
+            for (int i = numChunks; --i > 0;)
+                group.addTask (new FunctorTask<ReduceRangeTask<ValueType, FunctorType, CombinerType> > (
+                                    ReduceRangeTask<ValueType, FunctorType, CombinerType> (functor, combiner, chunkResults.getReference (i),
+                                                                                           getChunkStart (startIndex, endIndex, i, numChunks),
+                                                                                           getChunkStart (startIndex, endIndex, i + 1, numChunks))),
+                               false);
+
+            wakeUpSleepingThreads (numChunks - 1);
+
+            ReduceRangeTask<ValueType, FunctorType, CombinerType> (functor, combiner, chunkResults.getReference (0), startIndex,
+                                                                   getChunkStart (startIndex, endIndex, 1, numChunks))();
+            group.wait();
+        }
+
+        ValueType result (identity);
+
+        for (int i = 0; i < numChunks; ++i)
+            result = combiner (result, chunkResults.getReference (i));
+
+        return result;
+    }
+
 
 private:
+    //==============================================================================
+    class Task
+    {
+    public:
+        Task() noexcept : group (nullptr) {}
+        virtual ~Task() {}
+
+        virtual void run() = 0;
+
+        TaskGroup* group;
+    };
+
+    template <class FunctorType>
+    class FunctorTask  : public Task
+    {
+    public:
+        FunctorTask (const FunctorType& functor_) : functor (functor_) {}
+        void run()      { functor(); }
+
+    private:
+        FunctorType functor;
+    };
+
+    template <class FunctorType>
+    struct ForRangeTask
+    {
+        ForRangeTask (const FunctorType& functor_, const int start_, const int end_) noexcept
+            : functor (functor_), start (start_), end (end_) {}
+
+        void operator()() const
+        {
+            for (int i = start; i < end; ++i)
+                functor (i);
+        }
+
+        const FunctorType& functor;
+        int start, end;
+    };
+
+    template <typename ValueType, class FunctorType, class CombinerType>
+    struct ReduceRangeTask
+    {
+        ReduceRangeTask (const FunctorType& functor_, const CombinerType& combiner_,
+                         ValueType& result_, const int start_, const int end_) noexcept
+            : functor (functor_), combiner (combiner_), result (result_), start (start_), end (end_) {}
+
+        void operator()() const
+        {
+            for (int i = start; i < end; ++i)
+                result = combiner (result, functor (i));
+        }
+
+        const FunctorType& functor;
+        const CombinerType& combiner;
+        ValueType& result;
+        int start, end;
+    };
+
     //==============================================================================
     Array <ThreadPoolJob*> jobs;
 
@@ -295,8 +523,23 @@ private:
     friend class OwnedArray <ThreadPoolThread>;
     OwnedArray <ThreadPoolThread> threads;
 
+    class WorkQueue;
+    friend class WorkQueue;
+    friend class ScopedPointer <WorkQueue>;
+    ScopedPointer <WorkQueue> sharedQueue;
+
     CriticalSection lock;
     WaitableEvent jobFinishedSignal;
+    Atomic<int> numWaitingJobs, numSleepingThreads;
+
+    void addTask (Task*, bool wakeUpThread);
+    bool runNextTask (ThreadPoolThread*, bool canRunJobs);
+    Task* stealTask (ThreadPoolThread*) const;
+    ThreadPoolThread* getCurrentPoolThread() const noexcept;
+    bool isWorkWaiting() const noexcept;
+    void wakeUpSleepingThreads (int maxNumThreadsToWake);
+    int getNumChunks (int numIndexes, int grainSize) const noexcept;
+    static int getChunkStart (int startIndex, int endIndex, int chunk, int numChunks) noexcept;
 
     bool runNextJob();
     ThreadPoolJob* pickNextJobToRun();